@@ -0,0 +1,494 @@
+//    ipoke_bench - standalone benchmark of the ipoke~ write engine
+//    by Pierre Alexandre Tremblay
+//    reports ns per input sample for each overdub x interp mode, on a set of realistic index trajectories
+//    usage: ipoke_bench [buffer frames] [buffer channels] [input samples]
+//    set IPOKE_ISA=scalar|sse2|avx2 in the environment to force the gap-filling kernels, IPOKE_ANTIALIAS=1 to low-pass the slow writes,
+//    IPOKE_SPLAT=1|2 to write at the fractional indices, IPOKE_JOURNAL=frames to stage the writes (each row is then followed by the time
+//    the buffer would be locked, the two copies of the staged frames), IPOKE_STATS=1 to update the statistics counters, IPOKE_BUDGET=frames
+//    to bound the frames filled in the gaps per vector, IPOKE_JUMP=frames to crossfade the longer steps instead of filling them,
+//    IPOKE_FEEDBACK=1 to give the overdub columns a signal ratio, IPOKE_COMBINE=0..5 to write in one of the combine modes,
+//    IPOKE_SNAP=threshold to snap the decayed overdubs under it to zero, IPOKE_THREADS=writers to time that many writers of the same buffer
+//    at different offsets, each in its own thread holding the stripes it writes, against the same writers one after the other in one
+//    thread (unstaged, not on Windows)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+#include <time.h>
+
+#include "ipoke_core.h"
+#include "ipoke_fill.h"
+
+#ifndef _WIN32
+#include <pthread.h>
+#include "ipoke_partage.h"
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define BENCH_VECTOR 64
+#define BENCH_RUNS 5                                    // best of, to keep the numbers stable
+#define BENCH_MAX_CHANS 64
+#define BENCH_BRANCHES 8                                // overdub x interp
+#define BENCH_MAX_THREADS 64
+
+typedef struct _trajectory
+{
+    const char *name;
+    double *index;
+} t_trajectory;
+
+static double bench_now(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static unsigned long bench_seed = 22222;
+static double bench_checksum = 0.;
+static char bench_antialias = 0;
+static char bench_splat = IPOKE_SPLAT_OFF;
+static long bench_journal = 0;
+static char bench_stats = 0;
+static long bench_budget = 0;
+static long bench_jump = 0;
+static char bench_combine = IPOKE_COMBINE_OVERDUB;
+static double bench_seuil = 0.;
+static long bench_threads = 0;                          // writers of the threads mode, 0 for the usual tables
+static double *bench_retours = NULL;                    // the per sample overdub ratios, NULL for the constant one
+static double bench_held = 0.;                          // time spent in the staging copies by the last case
+static double bench_clock = 0.;                         // cost of reading the clock, taken out of each timed copy
+
+static double bench_rand(void)                          // deterministic across runs so numbers are comparable
+{
+    bench_seed = bench_seed * 1103515245UL + 12345UL;
+    return (double)((bench_seed >> 16) & 0x7FFF) / 32768.;
+}
+
+static double *bench_ramp(long n, long frames, double start, double speed)
+{
+    double *ind = malloc(n * sizeof(double));
+    double pos = start;
+    long i;
+
+    for (i = 0; i < n; i++)
+    {
+        ind[i] = pos;
+        pos += speed;
+        if (pos >= frames)
+            pos -= frames;
+        else if (pos < 0.)
+            pos += frames;
+    }
+    return ind;
+}
+
+static double *bench_scrub(long n, long frames)         // speed swinging between -16x and 16x
+{
+    double *ind = malloc(n * sizeof(double));
+    double pos = frames * 0.5;
+    long i;
+
+    for (i = 0; i < n; i++)
+    {
+        ind[i] = pos;
+        pos += 16. * sin(2. * M_PI * i / 22050.);
+        while (pos >= frames)
+            pos -= frames;
+        while (pos < 0.)
+            pos += frames;
+    }
+    return ind;
+}
+
+static double *bench_jumps(long n, long frames)         // 1x with a jump of about half the buffer every 4096 samples
+{
+    double *ind = malloc(n * sizeof(double));
+    double pos = 0.;
+    long demivie = (long)(frames * 0.5);
+    long i;
+
+    for (i = 0; i < n; i++)
+    {
+        if (i && !(i % 4096))
+            pos += demivie + (bench_rand() - 0.5) * 2048.;
+        while (pos >= frames)
+            pos -= frames;
+        ind[i] = pos;
+        pos += 1.;
+    }
+    return ind;
+}
+
+// one write, through the staging area when there is one
+static long bench_write(t_ipoke_core *x, float *tab, long frames, long nc, long chan, const double * const *vals, long nvals, const double *ind, long n)
+{
+    long dirty_flag, staged;
+    double start = 0.;
+    unsigned int fpu = ipoke_fill_flush_denormals();    // as around a perform call
+
+    if (x->journal)
+        start = bench_now();
+    staged = ipoke_core_stage_in(x, tab, frames, nc, chan, nvals, ind, n);
+    if (x->journal)
+        bench_held += bench_now() - start - bench_clock;
+
+    if (staged)
+        dirty_flag = (nvals > 1) ? ipoke_core_write_multi(x, x->journal, frames, nvals, 0, vals, nvals, x->journal_index, n)
+                                 : ipoke_core_write(x, x->journal, frames, 1, 0, vals[0], x->journal_index, n);
+    else
+        dirty_flag = (nvals > 1) ? ipoke_core_write_multi(x, tab, frames, nc, chan, vals, nvals, ind, n)
+                                 : ipoke_core_write(x, tab, frames, nc, chan, vals[0], ind, n);
+
+    if (staged)
+    {
+        start = bench_now();
+        ipoke_core_stage_out(x, tab, frames, nc, chan, nvals, dirty_flag);
+        bench_held += bench_now() - start - bench_clock;
+    }
+    ipoke_fill_restore_denormals(fpu);
+    return dirty_flag;
+}
+
+// one object writing the last channel, one object per channel, or one multichannel object writing them all
+#define BENCH_MONO 0
+#define BENCH_SEPARATE 1
+#define BENCH_MULTI 2
+
+static void bench_config(t_ipoke_core *x, double overdub, char interp)
+{
+    x->overdub = overdub;
+    x->interp = interp;
+    x->antialias = bench_antialias;
+    x->splat = bench_splat;
+    x->compter = bench_stats;
+    x->budget = bench_budget;
+    x->saut = bench_jump;
+    x->combine = bench_combine;
+    x->seuil = bench_seuil;
+}
+
+static double bench_case(long mode, double overdub, char interp, float *tab, long frames, long nc, const double *val, const double *ind, long n)
+{
+    t_ipoke_core cores[BENCH_MAX_CHANS];
+    const double *vals[BENCH_MAX_CHANS];
+    long ncores = (mode == BENCH_SEPARATE) ? nc : 1;
+    double start, elapsed, best = 0., held, best_held = 0.;
+    long r, c, i;
+
+    for (r = 0; r < BENCH_RUNS; r++)
+    {
+        for (c = 0; c < ncores; c++)
+        {
+            ipoke_core_init(&cores[c]);
+            bench_config(&cores[c], overdub, interp);
+            if (bench_journal)
+                ipoke_core_set_journal(&cores[c], bench_journal, (mode == BENCH_MULTI) ? nc : 1, BENCH_VECTOR);
+        }
+        if (mode == BENCH_MULTI)
+            ipoke_core_set_nvals(&cores[0], nc);
+
+        bench_held = 0.;
+        start = bench_now();
+        for (i = 0; i < n; i += BENCH_VECTOR)
+        {
+            for (c = 0; c < nc; c++)
+                vals[c] = val + i;
+            for (c = 0; c < ncores; c++)
+                cores[c].retours = (bench_retours && overdub != 0.) ? bench_retours + i : NULL;
+            switch (mode)
+            {
+                case BENCH_MONO:
+                    bench_write(&cores[0], tab, frames, nc, nc - 1, vals, 1, ind + i, BENCH_VECTOR);
+                    break;
+                case BENCH_SEPARATE:
+                    for (c = 0; c < nc; c++)
+                        bench_write(&cores[c], tab, frames, nc, c, vals, 1, ind + i, BENCH_VECTOR);
+                    break;
+                case BENCH_MULTI:
+                    bench_write(&cores[0], tab, frames, nc, 0, vals, nc, ind + i, BENCH_VECTOR);
+                    break;
+            }
+        }
+        elapsed = bench_now() - start;
+        held = bench_held;
+
+        if (!r || elapsed < best)
+        {
+            best = elapsed;
+            best_held = held;
+        }
+        bench_checksum += tab[(frames / 3) * nc + nc - 1];
+        for (c = 0; c < ncores; c++)
+            ipoke_core_free(&cores[c]);
+    }
+    bench_held = best_held / n;
+    return best / n;
+}
+
+#ifndef _WIN32
+// a writer of the threads mode, in the last channel: the trajectory shifted by its offset, as the voices of a granular recorder
+typedef struct _writer
+{
+    t_ipoke_core core;
+    t_ipoke_partage *partage;                           // NULL when alone in its thread
+    t_ipoke_bandes bandes;
+    double decalage;
+    double ind[BENCH_VECTOR];
+    float *tab;
+    long frames;
+    long nc;
+    const double *val;
+    const double *traj;
+    long n;
+} t_writer;
+
+static void bench_writer(t_writer *w, long i)
+{
+    double pos;
+    long j;
+
+    for (j = 0; j < BENCH_VECTOR; j++)
+    {
+        pos = w->traj[i + j] + w->decalage;
+        w->ind[j] = (pos >= w->frames) ? pos - w->frames : pos;
+    }
+    if (w->partage)
+        ipoke_partage_entre(w->partage, &w->bandes, &w->core, w->frames, w->ind, BENCH_VECTOR);
+    ipoke_core_write(&w->core, w->tab, w->frames, w->nc, w->nc - 1, w->val + i, w->ind, BENCH_VECTOR);
+    if (w->partage)
+        ipoke_partage_sort(w->partage, &w->bandes);
+}
+
+static void *bench_thread(void *data)
+{
+    t_writer *w = (t_writer *)data;
+    unsigned int fpu = ipoke_fill_flush_denormals();
+    long i;
+
+    for (i = 0; i < w->n; i += BENCH_VECTOR)
+        bench_writer(w, i);
+    ipoke_fill_restore_denormals(fpu);
+    return NULL;
+}
+
+// nw writers, in nw threads sharing the stripes of the buffer or one after the other in this one: ns per input sample of all of them
+static double bench_threads_case(char parallel, long nw, double overdub, char interp, float *tab, long frames, long nc, const double *val, const double *ind, long n)
+{
+    t_writer *w = malloc(nw * sizeof(t_writer));
+    pthread_t fils[BENCH_MAX_THREADS];
+    double start, elapsed, best = 0.;
+    unsigned int fpu;
+    long r, k, i;
+
+    for (r = 0; r < BENCH_RUNS; r++)
+    {
+        for (k = 0; k < nw; k++)
+        {
+            ipoke_core_init(&w[k].core);
+            bench_config(&w[k].core, overdub, interp);
+            w[k].partage = parallel ? ipoke_partage_prend(tab, frames) : NULL;     // each its own, as each ipoke~
+            w[k].bandes.nb = 0;
+            w[k].decalage = (double)frames * k / nw;
+            w[k].tab = tab;
+            w[k].frames = frames;
+            w[k].nc = nc;
+            w[k].val = val;
+            w[k].traj = ind;
+            w[k].n = n;
+        }
+
+        start = bench_now();
+        if (parallel)
+        {
+            for (k = 0; k < nw; k++)
+                pthread_create(&fils[k], NULL, bench_thread, &w[k]);
+            for (k = 0; k < nw; k++)
+                pthread_join(fils[k], NULL);
+        }
+        else
+        {
+            fpu = ipoke_fill_flush_denormals();
+            for (i = 0; i < n; i += BENCH_VECTOR)
+                for (k = 0; k < nw; k++)
+                    bench_writer(&w[k], i);
+            ipoke_fill_restore_denormals(fpu);
+        }
+        elapsed = bench_now() - start;
+
+        if (!r || elapsed < best)
+            best = elapsed;
+        bench_checksum += tab[(frames / 3) * nc + nc - 1];
+        for (k = 0; k < nw; k++)
+        {
+            ipoke_core_free(&w[k].core);
+            ipoke_partage_lache(w[k].partage);
+        }
+    }
+    free(w);
+    return best / ((double)n * nw);
+}
+#endif
+
+int main(int argc, char **argv)
+{
+    long frames = (argc > 1) ? atol(argv[1]) : 441000;
+    long nc = (argc > 2) ? atol(argv[2]) : 1;
+    long n = (argc > 3) ? atol(argv[3]) : 1 << 18;
+    float *tab;
+    double *val;
+    t_trajectory traj[7];
+    double held[BENCH_BRANCHES];
+    long ntraj = 7, t, b, m, i;
+
+    static const struct { double overdub; char interp; const char *name; } branches[BENCH_BRANCHES] = {
+        { 0.,  IPOKE_INTERP_HOLD, "replace/hold" },
+        { 0.,  IPOKE_INTERP_LINEAR, "replace/linear" },
+        { 0.,  IPOKE_INTERP_CUBIC, "replace/cubic" },
+        { 0.,  IPOKE_INTERP_SINC, "replace/sinc" },
+        { 0.5, IPOKE_INTERP_HOLD, "overdub/hold" },
+        { 0.5, IPOKE_INTERP_LINEAR, "overdub/linear" },
+        { 0.5, IPOKE_INTERP_CUBIC, "overdub/cubic" },
+        { 0.5, IPOKE_INTERP_SINC, "overdub/sinc" },
+    };
+    static const char *modes[3] = {
+        "one channel",
+        "all channels, one object per channel",
+        "all channels, one multichannel object",
+    };
+
+    if (frames < 2 || nc < 1 || nc > BENCH_MAX_CHANS || n < BENCH_VECTOR)
+    {
+        fprintf(stderr, "usage: %s [buffer frames] [buffer channels (1 to %d)] [input samples]\n", argv[0], BENCH_MAX_CHANS);
+        return 1;
+    }
+    n -= n % BENCH_VECTOR;
+
+    if (getenv("IPOKE_ISA"))
+    {
+        const char *isa = getenv("IPOKE_ISA");
+        ipoke_fill_select(!strcmp(isa, "scalar") ? IPOKE_ISA_SCALAR : !strcmp(isa, "sse2") ? IPOKE_ISA_SSE2 : IPOKE_ISA_AVX2);
+    }
+    else
+        ipoke_fill_select(-1);                          // as the hosts do when they load the object
+
+    if (getenv("IPOKE_ANTIALIAS"))
+        bench_antialias = (atoi(getenv("IPOKE_ANTIALIAS")) != 0);
+    if (getenv("IPOKE_SPLAT"))
+        bench_splat = (char)atoi(getenv("IPOKE_SPLAT"));
+    if (getenv("IPOKE_STATS"))
+        bench_stats = (atoi(getenv("IPOKE_STATS")) != 0);
+    if (getenv("IPOKE_BUDGET"))
+        bench_budget = atol(getenv("IPOKE_BUDGET"));
+    if (getenv("IPOKE_JUMP"))
+        bench_jump = atol(getenv("IPOKE_JUMP"));
+    if (getenv("IPOKE_COMBINE"))
+        bench_combine = (char)atoi(getenv("IPOKE_COMBINE"));
+    if (getenv("IPOKE_SNAP"))
+        bench_seuil = atof(getenv("IPOKE_SNAP"));
+#ifndef _WIN32
+    if (getenv("IPOKE_THREADS"))
+    {
+        bench_threads = atol(getenv("IPOKE_THREADS"));
+        if (bench_threads > BENCH_MAX_THREADS)
+            bench_threads = BENCH_MAX_THREADS;
+    }
+#endif
+    if (getenv("IPOKE_JOURNAL"))
+    {
+        double start = bench_now();
+
+        bench_journal = atol(getenv("IPOKE_JOURNAL"));
+        for (i = 0; i < 10000; i++)
+            bench_now();
+        bench_clock = (bench_now() - start) / 10001.;
+    }
+
+    tab = calloc(frames * nc, sizeof(float));
+    val = malloc(n * sizeof(double));
+    for (i = 0; i < n; i++)
+        val[i] = sin(2. * M_PI * i / 100.);
+    if (getenv("IPOKE_FEEDBACK") && atoi(getenv("IPOKE_FEEDBACK")))
+    {
+        bench_retours = malloc(n * sizeof(double));
+        for (i = 0; i < n; i++)                                 // a slow swell around the constant ratio
+            bench_retours[i] = 0.5 + 0.25 * sin(2. * M_PI * i / 44100.);
+    }
+
+    traj[0].name = "1x";        traj[0].index = bench_ramp(n, frames, 0., 1.);
+    traj[1].name = "0.25x";     traj[1].index = bench_ramp(n, frames, 0., 0.25);
+    traj[2].name = "8x";        traj[2].index = bench_ramp(n, frames, 0., 8.);
+    traj[3].name = "reverse";   traj[3].index = bench_ramp(n, frames, frames - 1., -1.);
+    traj[4].name = "scrub";     traj[4].index = bench_scrub(n, frames);
+    traj[5].name = "jumps";     traj[5].index = bench_jumps(n, frames);
+    traj[6].name = "1.1x";      traj[6].index = bench_ramp(n, frames, 0.3, 1.1);
+
+    printf("ipoke~ write engine: %ld frames x %ld channels, %ld input samples, vector %d, %s fills%s%s%s%s%s%s%s%s, combine %d\n", frames, nc, n, BENCH_VECTOR, ipoke_fill_name(), bench_antialias ? ", anti-aliased" : "",
+           (bench_splat == IPOKE_SPLAT_CUBIC) ? ", cubic splatting" : bench_splat ? ", linear splatting" : "", bench_journal ? ", staged" : "", bench_stats ? ", counting" : "",
+           bench_budget ? ", bounded fills" : "", bench_jump ? ", jumps crossfaded" : "", bench_retours ? ", signal overdub" : "", bench_seuil > 0. ? ", snapped" : "", bench_combine);
+
+#ifndef _WIN32
+    if (bench_threads > 0)
+    {
+        static const char *titres[3] = { "one thread", "threads", "speedup" };
+        double temps[2][BENCH_BRANCHES];
+
+        printf("\n%ld writers in the last channel, spread over the buffer: one thread writing them in turn, then a thread each\n", bench_threads);
+        for (t = 0; t < ntraj; t++)
+        {
+            for (b = 0; b < BENCH_BRANCHES; b++)
+                for (m = 0; m < 2; m++)
+                    temps[m][b] = bench_threads_case((char)m, bench_threads, branches[b].overdub, branches[b].interp, tab, frames, nc, val, traj[t].index, n);
+            printf("\n%-10s", traj[t].name);
+            for (b = 0; b < BENCH_BRANCHES; b++)
+                printf("%15s", branches[b].name);
+            printf("\n");
+            for (m = 0; m < 3; m++)
+            {
+                printf("%-10s", titres[m]);
+                for (b = 0; b < BENCH_BRANCHES; b++)
+                    printf("%15.3f", (m < 2) ? temps[m][b] : temps[0][b] / temps[1][b]);
+                printf("\n");
+            }
+        }
+    }
+#endif
+
+    for (m = 0; m < ((nc > 1) ? 3 : 1) && bench_threads <= 0; m++)      // the single writer tables, when not timing the threads
+    {
+        printf("\n%s\n%-10s", modes[m], "ns/sample");
+        for (b = 0; b < BENCH_BRANCHES; b++)
+            printf("%15s", branches[b].name);
+        printf("\n");
+
+        for (t = 0; t < ntraj; t++)
+        {
+            printf("%-10s", traj[t].name);
+            for (b = 0; b < BENCH_BRANCHES; b++)
+            {
+                printf("%15.3f", bench_case(m, branches[b].overdub, branches[b].interp, tab, frames, nc, val, traj[t].index, n));
+                held[b] = bench_held;
+            }
+            printf("\n");
+            if (bench_journal)
+            {
+                printf("%-10s", "  locked");
+                for (b = 0; b < BENCH_BRANCHES; b++)
+                    printf("%15.3f", held[b]);
+                printf("\n");
+            }
+        }
+    }
+    printf("(checksum %g)\n", bench_checksum);
+
+    for (t = 0; t < ntraj; t++)
+        free(traj[t].index);
+    free(bench_retours);
+    free(val);
+    free(tab);
+    return 0;
+}
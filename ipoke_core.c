@@ -0,0 +1,2725 @@
+//    ipoke_core - the host-independent write engine of ipoke~
+//    by Pierre Alexandre Tremblay
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <limits.h>
+
+#include "ipoke_core.h"
+#include "ipoke_fill.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define IPOKE_TICKS() __rdtsc()
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define IPOKE_TICKS() __rdtsc()
+#endif
+
+#define IPOKE_CORE_CHUNK 64
+#define IPOKE_CORE_PER_CHAN (3 + IPOKE_CORE_HISTORY + IPOKE_SINC_TAPS + 2 * IPOKE_DECIM_TAPS + 2 + IPOKE_CORE_RESTES * IPOKE_CORE_RESTE + IPOKE_CORE_BROUILLON / 2)    // doubles of state per channel in multichannel mode
+#define IPOKE_CORE_RATIO 4.                                                      // largest ratio of two successive gaps the cubic tangents follow
+#define IPOKE_CORE_LISSAGE 0.1                                                   // smoothing of the measured write speed
+#define IPOKE_CORE_SIGNAL 2                                                      // overdub_on of the kernels taking the ratio from x->retours, see ipoke_core_ecriture
+#define IPOKE_CORE_COURT 64                                                      // gaps up to this long are always filled at once, whatever the budget
+#define IPOKE_CORE_AMORCE 1024                                                   // inputs replayed before a rendered segment, at least
+#define IPOKE_CORE_AMORCE_MAX 65536                                              // at most, and frames they may span
+#define IPOKE_CORE_BLOC 4096                                                     // inputs rendered per write call
+#define IPOKE_CORE_UN 4294967296.                                                // one frame of the write position of IPOKE_UNITS_RATE
+
+// the seek handed from the main thread to the audio one: the position is stored whole before the count is bumped, and read after it
+#ifdef _MSC_VER
+#include <intrin.h>
+#define ipoke_core_publie(p, v) _InterlockedExchange64((volatile long long *)(p), (v))
+#define ipoke_core_lit(p) _InterlockedCompareExchange64((volatile long long *)(p), 0, 0)
+#define ipoke_core_incremente(p) _InterlockedIncrement((volatile long *)(p))
+#define ipoke_core_lit_compte(p) _InterlockedCompareExchange((volatile long *)(p), 0, 0)
+#else
+#define ipoke_core_publie(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define ipoke_core_lit(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define ipoke_core_incremente(p) __atomic_add_fetch((p), 1, __ATOMIC_RELEASE)
+#define ipoke_core_lit_compte(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#endif
+
+// the generic kernels below are only written once: forcing them inline in each specialisation lets the compiler fold the constant modes away
+#if defined(_MSC_VER)
+#define IPOKE_INLINE __forceinline
+#elif defined(__GNUC__)
+#define IPOKE_INLINE __attribute__((always_inline)) inline
+#else
+#define IPOKE_INLINE inline
+#endif
+
+static long wrap_index(long index, long arrayLength)
+{
+    if (index >= arrayLength || index < 0)                                              // in one go, however far
+    {
+        index %= arrayLength;
+        if (index < 0)
+            index += arrayLength;
+    }
+    return index;
+}
+
+// the same for a fractional position, known to be past the start of the region
+static double wrap_position(double position, long arrayLength)
+{
+    if (position >= arrayLength || position < 0.)
+    {
+        position = fmod(position, (double)arrayLength);                                 // exact
+        if (position < 0.)
+            position += arrayLength;
+        if (position >= arrayLength)                                                    // rounded up from just below zero
+            position = 0.;
+    }
+    return position;
+}
+
+void ipoke_core_init(t_ipoke_core *x)
+{
+    x->interp = IPOKE_INTERP_LINEAR;
+    x->overdub = 0.;
+    x->combine = IPOKE_COMBINE_OVERDUB;
+    x->retours = NULL;
+    x->retour = 0.;
+    x->valeur = 0.;
+    x->nb_val = 0;
+    x->index_precedent = -1;
+    x->nb_hist = 0;
+    x->pas_precedent = 0;
+    x->antialias = 0;
+    x->periode = 1.;
+    x->pos_passe = -1;
+    x->splat = IPOKE_SPLAT_OFF;
+    x->position_precedente = 0.;
+    x->splat_index[0] = x->splat_index[1] = 0;
+    x->choix = 0;
+    x->modif_debut = x->modif_etendue = 0;
+    memset(&x->stats, 0, sizeof(x->stats));
+    x->compter = 0;
+    x->nvals = 0;
+    x->valeurs = x->coeffs = x->bases = x->histoires = x->points = x->passes = x->cumuls = NULL;
+    x->brouillons = NULL;
+    x->saut = 0;
+    x->sens = 1;
+    ipoke_core_set_fondu(x, 64);
+    x->budget = 0;
+    x->premier_reste = x->nb_restes = 0;
+    x->restes_multi = NULL;
+    x->journal = NULL;
+    x->journal_index = NULL;
+    x->taille_journal = x->nchans_journal = x->vecteur_journal = 0;
+    x->journal_debut = x->journal_etendue = 0;
+    x->boucle_debut = x->boucle_fin = 0;
+    x->region_debut = x->region_etendue = 0;
+    x->frames_tampon = 0;
+    x->origine = 0;
+    x->seuil = 0.;
+    x->cible = NULL;
+    x->unites = IPOKE_UNITS_SAMPLES;
+    x->frames_ms = 44.1;
+    x->tete = 0;
+    x->marche = 1;
+    x->cale = 0;                                                                        // the bits of 0.
+    x->calage = x->calage_vu = 0;
+    x->positions = NULL;
+    x->vecteur_positions = 0;
+}
+
+void ipoke_core_reset(t_ipoke_core *x)
+{
+    long c;
+
+    x->index_precedent = -1;
+    x->valeur = 0.;                                 // do not average stale values into the next write
+    x->nb_hist = 0;
+    x->pos_passe = -1;
+    x->nb_restes = 0;                               // the carried fills are dropped with the rest
+    for (c = 0; c < x->nvals; c++)
+        x->valeurs[c] = 0.;
+}
+
+void ipoke_core_free(t_ipoke_core *x)
+{
+    free(x->valeurs);
+    x->valeurs = x->coeffs = x->bases = x->histoires = x->points = x->passes = x->cumuls = x->restes_multi = NULL;
+    x->brouillons = NULL;
+    x->nvals = 0;
+    x->nb_restes = 0;
+    ipoke_core_set_journal(x, 0, 0, 0);
+    ipoke_core_set_positions(x, 0);
+}
+
+void ipoke_core_set_fondu(t_ipoke_core *x, long len)
+{
+    long k;
+
+    if (len < 0)
+        len = 0;
+    else if (len > IPOKE_CORE_FONDU)
+        len = IPOKE_CORE_FONDU;
+    for (k = 0; k < len; k++)
+        x->fondu[k] = 0.5 * (1. + cos(M_PI * (k + 1) / (len + 1)));
+    x->long_fondu = len;
+}
+
+long ipoke_core_set_nvals(t_ipoke_core *x, long nvals)
+{
+    double *valeurs;
+    long c;
+
+    if (nvals == x->nvals)
+        return 1;
+
+    valeurs = (double *)malloc(IPOKE_CORE_PER_CHAN * nvals * sizeof(double));
+    if (!valeurs)
+        return 0;
+    for (c = 0; c < IPOKE_CORE_PER_CHAN * nvals; c++)
+        valeurs[c] = 0.;
+
+    free(x->valeurs);
+    x->valeurs = valeurs;
+    x->coeffs = valeurs + nvals;
+    x->bases = valeurs + 2 * nvals;
+    x->histoires = valeurs + 3 * nvals;
+    x->points = valeurs + (3 + IPOKE_CORE_HISTORY) * nvals;
+    x->passes = valeurs + (3 + IPOKE_CORE_HISTORY + IPOKE_SINC_TAPS) * nvals;
+    x->cumuls = valeurs + (3 + IPOKE_CORE_HISTORY + IPOKE_SINC_TAPS + 2 * IPOKE_DECIM_TAPS) * nvals;
+    x->restes_multi = valeurs + (3 + IPOKE_CORE_HISTORY + IPOKE_SINC_TAPS + 2 * IPOKE_DECIM_TAPS + 2) * nvals;
+    x->brouillons = (float *)(x->restes_multi + IPOKE_CORE_RESTES * IPOKE_CORE_RESTE * nvals);
+    x->nb_restes = 0;
+    x->nvals = nvals;
+    x->index_precedent = -1;
+    x->nb_hist = 0;
+    x->pos_passe = -1;
+    return 1;
+}
+
+//***********************************************************************************************
+// anti-aliasing
+
+// the inputs go in the memory of the low-pass filter, twice so the last IPOKE_DECIM_TAPS always follow each other from pos_passe
+static void ipoke_core_ecoute(t_ipoke_core *x, double *passe, long nvals, const double *entrees)
+{
+    long pos = x->pos_passe;
+    long j, c;
+
+    if (pos < 0)                                                                        // a restart forgets the inputs from before the stop
+    {
+        for (j = 0; j < 2 * IPOKE_DECIM_TAPS; j++)
+            for (c = 0; c < nvals; c++)
+                passe[j * nvals + c] = entrees[c];
+        x->pos_passe = 0;
+        x->periode = 1.;
+        return;
+    }
+
+    for (c = 0; c < nvals; c++)
+        passe[pos * nvals + c] = passe[(pos + IPOKE_DECIM_TAPS) * nvals + c] = entrees[c];
+    x->pos_passe = (pos + 1 < IPOKE_DECIM_TAPS) ? pos + 1 : 0;
+}
+
+// the speed of the write head, as input samples per index step: above 1 several inputs land on each index and have to be filtered
+static double ipoke_core_periode(t_ipoke_core *x, long nb_val, long pas)
+{
+    x->periode += IPOKE_CORE_LISSAGE * ((double)nb_val / labs(pas) - x->periode);
+    return x->periode;
+}
+
+//***********************************************************************************************
+// written region
+
+// the frames a kernel writes follow each other round the buffer, as every step is filled:
+// it follows them as offsets from the first one and adds them to the modified arc at each stop and at the end of the vector
+typedef struct _ipoke_trace
+{
+    long origine;                                                                       // first frame written, -1 before
+    long decalage;                                                                      // the head, from origine
+    long bas;                                                                           // the lowest and highest frames reached, from origine
+    long haut;
+} t_ipoke_trace;
+
+static IPOKE_INLINE void ipoke_trace_point(t_ipoke_trace *t, long index)
+{
+    if (t->origine < 0)
+    {
+        t->origine = index;
+        t->decalage = t->bas = t->haut = 0;
+    }
+}
+
+// a step of a started trace, without branches as it comes at every input
+static IPOKE_INLINE void ipoke_trace_avance(t_ipoke_trace *t, long pas)
+{
+    t->decalage += pas;
+    t->bas = (t->decalage < t->bas) ? t->decalage : t->bas;
+    t->haut = (t->decalage > t->haut) ? t->decalage : t->haut;
+}
+
+static IPOKE_INLINE void ipoke_trace_pas(t_ipoke_trace *t, long index_precedent, long pas)
+{
+    ipoke_trace_point(t, index_precedent);
+    ipoke_trace_avance(t, pas);
+}
+
+// the smallest arc round the buffer holding both the modified one and etendue frames from debut
+// debut is in the frames the kernels see, the staged arc or the loop region: the arc is kept in the buffer's, the whole region if it goes round it
+static void ipoke_core_union(t_ipoke_core *x, long debut, long etendue, long frames);
+
+static void ipoke_core_nettoie(t_ipoke_core *x, long debut, long etendue, long frames);
+
+static void ipoke_core_marque(t_ipoke_core *x, long debut, long etendue, long frames)
+{
+    if (x->cible)
+        ipoke_core_nettoie(x, debut, etendue, frames);
+    if (x->journal_etendue)
+    {
+        debut += x->journal_debut;
+        if (debut >= frames)
+            debut -= frames;
+    }
+    if (frames < x->frames_tampon)
+    {
+        if (etendue >= frames || debut + etendue > frames)
+        {
+            debut = 0;
+            etendue = frames;
+        }
+        debut += x->region_debut;
+        frames = x->frames_tampon;
+    }
+    ipoke_core_union(x, debut, etendue, frames);
+}
+
+// the smallest arc covering the modified one and etendue frames from debut, in buffer frames
+static void ipoke_core_union(t_ipoke_core *x, long debut, long etendue, long frames)
+{
+    long a = x->modif_debut, la = x->modif_etendue;
+    long de_a, de_b;
+
+    if (etendue >= frames)
+    {
+        x->modif_debut = 0;
+        x->modif_etendue = frames;
+        return;
+    }
+    if (!la)
+    {
+        x->modif_debut = debut;
+        x->modif_etendue = etendue;
+        return;
+    }
+
+    de_a = debut - a;                                                                   // from the start of one arc to the end of the other
+    if (de_a < 0)
+        de_a += frames;
+    de_a += etendue;
+    if (de_a < la)
+        de_a = la;
+    de_b = a - debut;
+    if (de_b < 0)
+        de_b += frames;
+    de_b += la;
+    if (de_b < etendue)
+        de_b = etendue;
+
+    if (de_b < de_a)
+    {
+        x->modif_debut = debut;
+        de_a = de_b;
+    }
+    x->modif_etendue = (de_a < frames) ? de_a : frames;
+}
+
+// the frames of an arc just written that the overdub decayed under x->seuil are snapped to zero, while they are still in the cache
+static void ipoke_core_nettoie(t_ipoke_core *x, long debut, long etendue, long frames)
+{
+    long fin = x->cible_frames;                                                         // the staging area only holds the staged frames
+    long premier;
+
+    if (etendue > frames)
+        etendue = frames;
+    premier = (etendue < frames - debut) ? etendue : frames - debut;
+    if (debut < fin)
+        ipoke_fill_snap(x->cible + debut * x->cible_nc, x->cible_nc, x->cible_nvals, (premier < fin - debut) ? premier : fin - debut, (float)x->seuil);
+    etendue -= premier;
+    if (etendue > 0)
+        ipoke_fill_snap(x->cible, x->cible_nc, x->cible_nvals, (etendue < fin) ? etendue : fin, (float)x->seuil);
+}
+
+// marge is the number of frames written past the highest one reached
+static IPOKE_INLINE void ipoke_core_trace(t_ipoke_core *x, t_ipoke_trace *t, long frames, long marge)
+{
+    long debut;
+
+    if (t->origine < 0)
+        return;
+    debut = (t->origine + t->bas) % frames;                                             // more than a buffer away when the head went round in one vector
+    if (debut < 0)
+        debut += frames;
+    ipoke_core_marque(x, debut, t->haut - t->bas + 1 + marge, frames);
+    t->origine = -1;
+}
+
+// the kernels count in a local copy, added to x->stats once per call so the counters stay in registers
+static IPOKE_INLINE void ipoke_core_compte(t_ipoke_stats *compte, long index, long index_precedent, long pas, long nb_val)
+{
+    unsigned long longueur = labs(pas);
+    unsigned long l;
+    long classe = 0;
+
+    for (l = longueur - 1; l && classe < IPOKE_STATS_CLASSES - 1; l >>= 1)             // the number of bits of the gap
+        classe++;
+    compte->pas[classe]++;
+    compte->remplies += longueur - 1;
+    compte->tours += ((index > index_precedent) != (pas > 0));
+    compte->moyennes += (nb_val > 1);
+}
+
+// the step counted by ipoke_core_compte was a jump, not filled
+static void ipoke_core_saute(t_ipoke_stats *compte, long index, long index_precedent, long pas)
+{
+    compte->remplies -= labs(pas) - 1;
+    compte->tours -= ((index > index_precedent) != (pas > 0));
+    compte->sauts++;
+}
+
+static void ipoke_core_comptes(t_ipoke_core *x, const t_ipoke_stats *compte)
+{
+    long c;
+
+    x->stats.echantillons += compte->echantillons;
+    x->stats.remplies += compte->remplies;
+    for (c = 0; c < IPOKE_STATS_CLASSES; c++)
+        x->stats.pas[c] += compte->pas[c];
+    x->stats.tours += compte->tours;
+    x->stats.moyennes += compte->moyennes;
+    x->stats.sauts += compte->sauts;
+}
+
+long ipoke_core_modif(t_ipoke_core *x, long *debut)
+{
+    long etendue = x->modif_etendue;
+
+    *debut = x->modif_debut;
+    x->modif_etendue = 0;
+    return etendue;
+}
+
+//***********************************************************************************************
+// several heads
+
+void ipoke_core_follow(t_ipoke_core *x, const t_ipoke_core *modele)
+{
+    if (x->splat != modele->splat)                                                      // restarted as the model was
+    {
+        x->splat = modele->splat;
+        ipoke_core_reset(x);
+    }
+    if (x->antialias != modele->antialias)
+    {
+        x->antialias = modele->antialias;
+        x->pos_passe = -1;
+    }
+    if (x->long_fondu != modele->long_fondu)
+    {
+        memcpy(x->fondu, modele->fondu, modele->long_fondu * sizeof(double));
+        x->long_fondu = modele->long_fondu;
+    }
+    x->interp = modele->interp;
+    x->overdub = modele->overdub;
+    x->combine = modele->combine;
+    x->retours = modele->retours;
+    x->saut = modele->saut;
+    x->budget = modele->budget;
+    x->compter = modele->compter;
+    x->boucle_debut = modele->boucle_debut;
+    x->boucle_fin = modele->boucle_fin;
+    x->seuil = modele->seuil;
+    x->unites = modele->unites;
+    x->frames_ms = modele->frames_ms;
+}
+
+void ipoke_core_join(t_ipoke_core *x, t_ipoke_core *tete)
+{
+    long debut, etendue = ipoke_core_modif(tete, &debut);
+    t_ipoke_stats *compte = &tete->stats;
+    long c;
+
+    if (etendue)
+        ipoke_core_union(x, debut, etendue, tete->frames_tampon);
+    if (!tete->compter)
+        return;
+    x->stats.echantillons += compte->echantillons;
+    x->stats.remplies += compte->remplies;
+    for (c = 0; c < IPOKE_STATS_CLASSES; c++)
+        x->stats.pas[c] += compte->pas[c];
+    x->stats.tours += compte->tours;
+    x->stats.moyennes += compte->moyennes;
+    x->stats.sauts += compte->sauts;
+    memset(compte, 0, sizeof(t_ipoke_stats));
+}
+
+//***********************************************************************************************
+// gap filling
+
+// the history only matters to the higher order modes, which restart it from the first point written after a stop
+static IPOKE_INLINE void ipoke_core_push(t_ipoke_core *x, char interp, double *histoire, long nvals, const double *valeurs)
+{
+    long j, c;
+
+    if (interp < IPOKE_INTERP_CUBIC)
+    {
+        x->nb_hist = 0;
+        return;
+    }
+
+    if (!x->nb_hist)
+    {
+        for (j = 0; j < IPOKE_CORE_HISTORY; j++)
+            for (c = 0; c < nvals; c++)
+                histoire[j * nvals + c] = valeurs[c];
+        x->nb_hist = 1;
+        x->pas_precedent = 0;
+    }
+    else
+    {
+        for (j = 0; j < (IPOKE_CORE_HISTORY - 1) * nvals; j++)
+            histoire[j] = histoire[j + nvals];
+        for (c = 0; c < nvals; c++)
+            histoire[(IPOKE_CORE_HISTORY - 1) * nvals + c] = valeurs[c];
+    }
+}
+
+// the curve of a gap of pas steps (signed), from the last written point valeur to the new value valeur_entree:
+// the linear coefficient, the cubic coefficients or the sinc points, in curve[j * stride]
+static IPOKE_INLINE void ipoke_core_curve(t_ipoke_core *x, char interp, const double *histoire, long nvals, long pas, double valeur, double valeur_entree, double *curve, long stride)
+{
+    double m0, m1, d0, d1, h0, h1;
+    long j;
+
+    switch (interp)
+    {
+        case IPOKE_INTERP_HOLD:
+            curve[0] = 0.;
+            break;
+        case IPOKE_INTERP_LINEAR:
+            curve[0] = (valeur_entree - valeur) / pas;                                  // calculate the interpolation coefficient
+            break;
+        case IPOKE_INTERP_CUBIC:
+            // tangents of the parabola through the previous point, the last one and the new one, per gap length
+            // the ratio of the gap lengths is bounded, so a jump after small steps does not blow the slopes up
+            h1 = labs(pas);
+            h0 = x->pas_precedent ? x->pas_precedent : h1;
+            if (h1 > IPOKE_CORE_RATIO * h0)
+                h0 = h1 / IPOKE_CORE_RATIO;
+            else if (h0 > IPOKE_CORE_RATIO * h1)
+                h0 = h1 * IPOKE_CORE_RATIO;
+            d1 = valeur_entree - valeur;
+            d0 = (valeur - histoire[(IPOKE_CORE_HISTORY - 2) * nvals]) * h1 / h0;
+            m0 = (d1 * h0 + d0 * h1) / (h0 + h1);
+            m1 = d1 + (d1 - d0) * h1 / (h0 + h1);
+            curve[0] = valeur;
+            curve[stride] = m0;
+            curve[2 * stride] = 3. * (valeur_entree - valeur) - 2. * m0 - m1;
+            curve[3 * stride] = 2. * (valeur - valeur_entree) + m0 + m1;
+            break;
+        case IPOKE_INTERP_SINC:
+            for (j = 0; j <= IPOKE_SINC_CENTRE; j++)                                    // the written points
+                curve[j * stride] = histoire[(IPOKE_CORE_HISTORY - 1 - IPOKE_SINC_CENTRE + j) * nvals];
+            curve[j * stride] = valeur_entree;                                          // the new one
+            for (j++; j < IPOKE_SINC_TAPS; j++)                                         // and the unknown ones beyond, reflected around it to keep its slope
+                curve[j * stride] = 2. * valeur_entree - curve[(2 * (IPOKE_SINC_CENTRE + 1) - j) * stride];
+            break;
+    }
+}
+
+//***********************************************************************************************
+// combine modes
+
+// what the frames are written with: 0 replaces, 1 takes a constant ratio, IPOKE_CORE_SIGNAL the ratios of x->retours,
+// and the non-linear modes, above it, keep their IPOKE_COMBINE value: they fill a scratch area first, then combine it with the buffer
+static int ipoke_core_ecriture(const t_ipoke_core *x)
+{
+    switch (x->combine)
+    {
+        case IPOKE_COMBINE_REPLACE:
+            return 0;
+        case IPOKE_COMBINE_ADD:
+            return 1;
+        case IPOKE_COMBINE_XFADE:
+        case IPOKE_COMBINE_MAX:
+        case IPOKE_COMBINE_SOFTSAT:
+            return x->combine;
+        default:
+            return x->retours ? IPOKE_CORE_SIGNAL : (x->overdub != 0.);
+    }
+}
+
+// the ratio of the old content outside of the write loops: the last one of the signal if there is one
+static double ipoke_core_ratio(const t_ipoke_core *x)
+{
+    switch (x->combine)
+    {
+        case IPOKE_COMBINE_REPLACE:
+            return 0.;
+        case IPOKE_COMBINE_XFADE:
+            return sin(x->overdub * M_PI * 0.5);
+        case IPOKE_COMBINE_OVERDUB:
+            return x->retours ? x->retour : x->overdub;
+        default:
+            return 1.;
+    }
+}
+
+// and the gain of the new one
+static double ipoke_core_gain(const t_ipoke_core *x)
+{
+    return (x->combine == IPOKE_COMBINE_XFADE) ? cos(x->overdub * M_PI * 0.5) : 1.;
+}
+
+// one frame of old content written over with v: a is the ratio of the old content, b the gain of v
+static IPOKE_INLINE double ipoke_core_point(int ecriture, float old, double v, double a, double b)
+{
+    switch (ecriture)
+    {
+        case 0:
+            return v;
+        case IPOKE_COMBINE_XFADE:
+            return (old * a) + (v * b);
+        case IPOKE_COMBINE_MAX:
+            return (fabs(v) > fabsf(old)) ? v : old;
+        case IPOKE_COMBINE_SOFTSAT:
+            return ipoke_fill_sature(old + v);
+        default:
+            return (old * a) + v;
+    }
+}
+
+// len frames of nvals channels filled in brouillon combined with the ones from tab, in one of the non-linear modes
+static void ipoke_core_combine(const t_ipoke_core *x, int ecriture, float *tab, long nc, long nvals, long len, const float *brouillon)
+{
+    switch (ecriture)
+    {
+        case IPOKE_COMBINE_XFADE:
+            ipoke_fill_xfade(tab, nc, nvals, len, brouillon, ipoke_core_ratio(x), ipoke_core_gain(x));
+            break;
+        case IPOKE_COMBINE_MAX:
+            ipoke_fill_max(tab, nc, nvals, len, brouillon);
+            break;
+        case IPOKE_COMBINE_SOFTSAT:
+            ipoke_fill_softsat(tab, nc, nvals, len, brouillon);
+            break;
+    }
+}
+
+static float *ipoke_core_brouillon(t_ipoke_core *x, long nvals)
+{
+    return (nvals == 1) ? x->brouillon : x->brouillons;
+}
+
+//***********************************************************************************************
+// gap filling
+
+// fills len frames from tab, the first one being offset steps away from the last written point
+// overdub_on says whether overdub is non-zero, so that a constant one picks the fill at compile time,
+// or is IPOKE_CORE_SIGNAL when the ratio goes from overdub at the last written point by pente_retour per step
+static IPOKE_INLINE void ipoke_core_fill_segment(char interp, char overdub_on, float *tab, long nc, long len, double offset, long pas, double valeur, const double *curve,
+                                                 double overdub, double pente_retour)
+{
+    if (len <= 0)
+        return;
+
+    if (len == 1 && interp < IPOKE_INTERP_CUBIC)                                        // a single frame, as at 2x: written here rather than through a call
+    {
+        if (overdub_on == IPOKE_CORE_SIGNAL)
+            *tab = (float)((*tab * (overdub + offset * pente_retour)) + (valeur + offset * curve[0]));
+        else if (overdub_on)
+            *tab = (float)((*tab * overdub) + (valeur + offset * curve[0]));
+        else
+            *tab = (float)(valeur + offset * curve[0]);
+        return;
+    }
+
+    if (overdub_on == IPOKE_CORE_SIGNAL)
+    {
+        if (interp < IPOKE_INTERP_CUBIC)                                                // in one go
+        {
+            ipoke_fill_ramp_feedback(tab, nc, len, valeur + offset * curve[0], curve[0], overdub + offset * pente_retour, pente_retour);
+            return;
+        }
+        ipoke_fill_scale(tab, nc, 1, len, overdub + offset * pente_retour, pente_retour);   // or the old content scaled first and the curve added to it
+        overdub = 1.;
+    }
+
+    switch (interp)
+    {
+        case IPOKE_INTERP_HOLD:
+        case IPOKE_INTERP_LINEAR:
+            if (overdub_on)
+                ipoke_fill_ramp_overdub(tab, nc, len, valeur + offset * curve[0], curve[0], overdub);
+            else
+                ipoke_fill_ramp(tab, nc, len, valeur + offset * curve[0], curve[0]);
+            break;
+        case IPOKE_INTERP_CUBIC:
+            ipoke_fill_cubic(tab, nc, len, offset / pas, 1. / pas, curve, overdub_on ? overdub : 0.);
+            break;
+        case IPOKE_INTERP_SINC:
+            ipoke_fill_sinc(tab, nc, len, offset / pas, 1. / pas, curve, overdub_on ? overdub : 0.);
+            break;
+    }
+}
+
+// the same in a non-linear mode, through the scratch area
+static void ipoke_core_fill_brouillon(t_ipoke_core *x, int ecriture, char interp, float *tab, long nc, long len, double offset, long pas, double valeur, const double *curve)
+{
+    long k, l;
+
+    for (k = 0; k < len; k += l)
+    {
+        l = (len - k < IPOKE_CORE_BROUILLON) ? len - k : IPOKE_CORE_BROUILLON;
+        ipoke_core_fill_segment(interp, 0, x->brouillon, 1, l, offset + k, pas, valeur, curve, 0., 0.);
+        ipoke_core_combine(x, ecriture, tab + k * nc, nc, 1, l, x->brouillon);
+    }
+}
+
+// ecriture as given by ipoke_core_ecriture
+static void ipoke_core_fill_segment_multi(t_ipoke_core *x, int ecriture, float *tab, long nc, long nvals, long len, double offset, long pas, double overdub, double pente_retour)
+{
+    long c, k, l;
+
+    if (len <= 0)
+        return;
+
+    if (ecriture > IPOKE_CORE_SIGNAL)                                                  // filled in the scratch area first
+    {
+        for (k = 0; k < len; k += l)
+        {
+            l = (len - k < IPOKE_CORE_BROUILLON) ? len - k : IPOKE_CORE_BROUILLON;
+            ipoke_core_fill_segment_multi(x, 0, x->brouillons, nvals, nvals, l, offset + k, pas, 0., 0.);
+            ipoke_core_combine(x, ecriture, tab + k * nc, nc, nvals, l, x->brouillons);
+        }
+        return;
+    }
+
+    if (ecriture == IPOKE_CORE_SIGNAL && x->interp >= IPOKE_INTERP_CUBIC)
+    {
+        ipoke_fill_scale(tab, nc, nvals, len, overdub + offset * pente_retour, pente_retour);
+        overdub = 1.;
+    }
+
+    switch (x->interp)
+    {
+        case IPOKE_INTERP_HOLD:
+        case IPOKE_INTERP_LINEAR:
+            for (c = 0; c < nvals; c++)
+                x->bases[c] = x->valeurs[c] + offset * x->coeffs[c];
+            if (ecriture == IPOKE_CORE_SIGNAL)
+                ipoke_fill_ramp_multi_feedback(tab, nc, nvals, len, x->bases, x->coeffs, overdub + offset * pente_retour, pente_retour);
+            else if (overdub != 0.)
+                ipoke_fill_ramp_multi_overdub(tab, nc, nvals, len, x->bases, x->coeffs, overdub);
+            else
+                ipoke_fill_ramp_multi(tab, nc, nvals, len, x->bases, x->coeffs);
+            break;
+        case IPOKE_INTERP_CUBIC:
+            ipoke_fill_cubic_multi(tab, nc, nvals, len, offset / pas, 1. / pas, x->points, overdub);
+            break;
+        case IPOKE_INTERP_SINC:
+            ipoke_fill_sinc_multi(tab, nc, nvals, len, offset / pas, 1. / pas, x->points, overdub);
+            break;
+    }
+}
+
+
+// the gap between index_precedent and index, going the shortest way round the buffer
+// pas is the signed step, wrap-corrected: the segments are then filled in memory order, each with its offset from index_precedent
+#define IPOKE_CORE_GAP(fill_segment)                                                                                            \
+    if (index - index_precedent > 0)                                                    /* are we going up */                   \
+    {                                                                                                                           \
+        if (pas < 0)                                                                    /* the other way round */               \
+        {                                                                                                                       \
+            fill_segment(0, index_precedent, -index_precedent);                        /* fill the gap to zero */              \
+            fill_segment(index + 1, frames - index - 1, -(index_precedent + frames - index - 1));   /* fill the gap from the top */ \
+        }                                                                                                                       \
+        else                                                                            /* just fill the gaps */                \
+            fill_segment(index_precedent + 1, pas - 1, 1);                                                                      \
+    }                                                                                                                           \
+    else                                                                                /* if we are going down */              \
+    {                                                                                                                           \
+        if (pas > 0)                                                                    /* the other way round */               \
+        {                                                                                                                       \
+            fill_segment(index_precedent + 1, frames - index_precedent - 1, 1);        /* fill the gap to the top */           \
+            fill_segment(0, index, frames - index_precedent);                          /* fill the gap from zero */            \
+        }                                                                                                                       \
+        else                                                                            /* just fill the gaps */                \
+            fill_segment(index + 1, -pas - 1, pas + 1);                                                                         \
+    }
+
+static long ipoke_core_pas(long index, long index_precedent, long frames, long demivie)
+{
+    long pas = index - index_precedent;                                                 // calculate the step to do
+
+    if (pas > demivie)                                                                  // is it faster to go the other way round?
+        pas -= frames;
+    else if ((-pas) > demivie)
+        pas += frames;
+    return pas;
+}
+
+//***********************************************************************************************
+// jumps
+
+// a step longer than x->saut is a jump, a deliberate move of the head: nothing is filled in between.
+// the step it leaves between the last written frame and the old content ahead of it is faded into that content,
+// and the same for the one the next write will make with the old content behind the new index, so neither end clicks.
+
+// depart is the last frame written, arrivee the new index and entrees the values arriving there, sens the direction of the writing
+static long ipoke_core_punch(t_ipoke_core *x, float *tab, long frames, long nc, long nvals, long depart, long arrivee, long sens, const double *entrees)
+{
+    long len = x->long_fondu;
+    long apres, avant, f, k, c;
+    double sortie, entree;
+    double ratio = ipoke_core_ratio(x), gain = ipoke_core_gain(x);
+    int ecriture = ipoke_core_ecriture(x);
+
+    if (len > frames / 2 - 1)                                                           // never round the buffer
+        len = frames / 2 - 1;
+    if (len <= 0)
+        return 0;
+
+    apres = depart + sens;
+    if (apres < 0)
+        apres += frames;
+    else if (apres >= frames)
+        apres -= frames;
+    avant = arrivee - sens;
+    if (avant < 0)
+        avant += frames;
+    else if (avant >= frames)
+        avant -= frames;
+
+    for (c = 0; c < nvals; c++)
+    {
+        sortie = tab[depart * nc + c] - tab[apres * nc + c];                            // both steps before either fade
+        entree = ipoke_core_point(ecriture, tab[arrivee * nc + c], entrees[c], ratio, gain) - tab[avant * nc + c];
+        for (k = 0; k < len; k++)
+        {
+            f = apres + sens * k;
+            if (f < 0)
+                f += frames;
+            else if (f >= frames)
+                f -= frames;
+            tab[f * nc + c] += (float)(sortie * x->fondu[k]);
+        }
+        for (k = 0; k < len; k++)
+        {
+            f = avant - sens * k;
+            if (f < 0)
+                f += frames;
+            else if (f >= frames)
+                f -= frames;
+            tab[f * nc + c] += (float)(entree * x->fondu[k]);
+        }
+    }
+
+    if (sens > 0)
+    {
+        ipoke_core_marque(x, apres, len, frames);
+        ipoke_core_marque(x, (avant - len + 1 < 0) ? avant - len + 1 + frames : avant - len + 1, len, frames);
+    }
+    else
+    {
+        ipoke_core_marque(x, (apres - len + 1 < 0) ? apres - len + 1 + frames : apres - len + 1, len, frames);
+        ipoke_core_marque(x, avant, len, frames);
+    }
+    return 1;
+}
+
+//***********************************************************************************************
+// bounded gap filling
+
+// with a budget, a gap longer than what is left of it in the current call is filled from its start as far as the budget goes,
+// and the rest is queued and carried on at the beginning of the next calls, oldest first.
+// a newer write on frames still to fill cuts them out of the queued fill, so it never overwrites it later
+
+// one segment of a carried fill, len frames from tab, offset steps away from its start, written as ecriture says
+static void ipoke_core_reste_segment(t_ipoke_core *x, t_ipoke_reste *r, float *tab, long nc, long len, double offset, int ecriture)
+{
+    long nvals = r->nvals;
+    double *bases = r->valeurs + nvals;
+    const double *curve = r->valeurs + 2 * nvals;
+    double overdub = ecriture ? ipoke_core_ratio(x) : 0.;                               // a constant ratio at the time of the fill
+    double pente_retour = 0.;
+    float *brouillon;
+    long c, k, l;
+
+    if (ecriture == IPOKE_CORE_SIGNAL)                                                  // a signal one from its two ends, as the gaps filled at once
+    {
+        overdub = r->retour;
+        pente_retour = (r->retour_fin - r->retour) / r->pas;
+    }
+
+    if (len <= 0)
+        return;
+    if (ecriture > IPOKE_CORE_SIGNAL)                                                  // filled in the scratch area first
+    {
+        brouillon = ipoke_core_brouillon(x, nvals);
+        for (k = 0; k < len; k += l)
+        {
+            l = (len - k < IPOKE_CORE_BROUILLON) ? len - k : IPOKE_CORE_BROUILLON;
+            ipoke_core_reste_segment(x, r, brouillon, nvals, l, offset + k, 0);
+            ipoke_core_combine(x, ecriture, tab + k * nc, nc, nvals, l, brouillon);
+        }
+        return;
+    }
+    if (nvals == 1)                                                                     // the single channel fills are quicker
+    {
+        ipoke_core_fill_segment(r->interp, (ecriture == IPOKE_CORE_SIGNAL) ? IPOKE_CORE_SIGNAL : (overdub != 0.), tab, nc, len, offset, r->pas, r->valeurs[0], curve,
+                                overdub, pente_retour);
+        return;
+    }
+
+    if (ecriture == IPOKE_CORE_SIGNAL && r->interp >= IPOKE_INTERP_CUBIC)
+    {
+        ipoke_fill_scale(tab, nc, nvals, len, overdub + offset * pente_retour, pente_retour);
+        overdub = 1.;
+    }
+
+    switch (r->interp)
+    {
+        case IPOKE_INTERP_HOLD:
+        case IPOKE_INTERP_LINEAR:
+            for (c = 0; c < nvals; c++)
+                bases[c] = r->valeurs[c] + offset * curve[c];
+            if (ecriture == IPOKE_CORE_SIGNAL)
+                ipoke_fill_ramp_multi_feedback(tab, nc, nvals, len, bases, curve, overdub + offset * pente_retour, pente_retour);
+            else if (overdub != 0.)
+                ipoke_fill_ramp_multi_overdub(tab, nc, nvals, len, bases, curve, overdub);
+            else
+                ipoke_fill_ramp_multi(tab, nc, nvals, len, bases, curve);
+            break;
+        case IPOKE_INTERP_CUBIC:
+            ipoke_fill_cubic_multi(tab, nc, nvals, len, offset / r->pas, 1. / r->pas, curve, overdub);
+            break;
+        case IPOKE_INTERP_SINC:
+            ipoke_fill_sinc_multi(tab, nc, nvals, len, offset / r->pas, 1. / r->pas, curve, overdub);
+            break;
+    }
+}
+
+// fills at most libre of the steps left and returns how many
+static long ipoke_core_avance(t_ipoke_core *x, t_ipoke_reste *r, float *tab, long frames, long nc, long libre)
+{
+    long fin = r->fin;
+    long len, bas, start, premier;
+
+    if (fin - r->debut + 1 > libre)
+        fin = r->debut + libre - 1;
+    len = fin - r->debut + 1;
+    if (len <= 0)
+        return 0;
+
+    bas = (r->pas > 0) ? r->debut : -fin;                                               // the lowest frame in memory, from index
+    start = r->index + bas;
+    if (start < 0)
+        start += frames;
+    else if (start >= frames)
+        start -= frames;
+    premier = (len < frames - start) ? len : frames - start;                            // up to the end of the buffer, the rest from zero
+    ipoke_core_reste_segment(x, r, tab + start * nc, nc, premier, bas, ipoke_core_ecriture(x));
+    ipoke_core_reste_segment(x, r, tab, nc, len - premier, bas + premier, ipoke_core_ecriture(x));
+    ipoke_core_marque(x, start, len, frames);
+
+    r->debut = fin + 1;
+    return len;
+}
+
+// carries on with the queued fills, oldest first, and returns the frames filled
+static long ipoke_core_reprend(t_ipoke_core *x, float *tab, long frames, long nc, long libre)
+{
+    t_ipoke_reste *r;
+    long fait = 0;
+
+    while (x->nb_restes && fait < libre)
+    {
+        r = &x->restes[x->premier_reste];
+        fait += ipoke_core_avance(x, r, tab, frames, nc, libre - fait);
+        if (r->debut > r->fin)
+        {
+            x->premier_reste = (x->premier_reste + 1 < IPOKE_CORE_RESTES) ? x->premier_reste + 1 : 0;
+            x->nb_restes--;
+        }
+    }
+    return fait;
+}
+
+// a new fill at the end of the queue, from index over the steps debut to fin of pas; when the queue is full the oldest is dropped
+static t_ipoke_reste *ipoke_core_nouveau_reste(t_ipoke_core *x, long nvals, long index, long pas, long debut, long fin, char interp)
+{
+    long slot;
+    t_ipoke_reste *r;
+
+    if (x->nb_restes == IPOKE_CORE_RESTES)
+    {
+        x->premier_reste = (x->premier_reste + 1 < IPOKE_CORE_RESTES) ? x->premier_reste + 1 : 0;
+        x->nb_restes--;
+    }
+    slot = x->premier_reste + x->nb_restes;
+    if (slot >= IPOKE_CORE_RESTES)
+        slot -= IPOKE_CORE_RESTES;
+    x->nb_restes++;
+
+    r = &x->restes[slot];
+    r->index = index;
+    r->pas = pas;
+    r->debut = debut;
+    r->fin = fin;
+    r->interp = interp;
+    r->nvals = nvals;
+    r->valeurs = (nvals == 1) ? x->reste_simple[slot] : x->restes_multi + slot * IPOKE_CORE_RESTE * nvals;
+    return r;
+}
+
+// the steps a to b of a queued fill were written over: widens [*i0, *i1] to those among the ones it still has to fill
+static void ipoke_core_recouvre(const t_ipoke_reste *r, long a, long b, long *i0, long *i1)
+{
+    if (a < r->debut)
+        a = r->debut;
+    if (b > r->fin)
+        b = r->fin;
+    if (a > b)
+        return;
+    if (a < *i0)
+        *i0 = a;
+    if (b > *i1)
+        *i1 = b;
+}
+
+// the len frames from start were just written: none of the queued fills may write them later
+static void ipoke_core_coupe(t_ipoke_core *x, long start, long len, long frames)
+{
+    t_ipoke_reste *r;
+    long i, slot, k, i0, i1;
+
+    for (i = 0; i < x->nb_restes; i++)
+    {
+        slot = x->premier_reste + i;
+        if (slot >= IPOKE_CORE_RESTES)
+            slot -= IPOKE_CORE_RESTES;
+        r = &x->restes[slot];
+
+        k = (r->pas > 0) ? start - r->index : r->index - (start + len - 1);            // the written frames as steps of the fill, from k round the buffer
+        k %= frames;
+        if (k < 0)
+            k += frames;
+        i0 = r->fin + 1;
+        i1 = r->debut - 1;
+        if (len >= frames)
+            ipoke_core_recouvre(r, 0, frames - 1, &i0, &i1);
+        else if (k + len <= frames)
+            ipoke_core_recouvre(r, k, k + len - 1, &i0, &i1);
+        else                                                                            // in two pieces
+        {
+            ipoke_core_recouvre(r, k, frames - 1, &i0, &i1);
+            ipoke_core_recouvre(r, 0, k + len - 1 - frames, &i0, &i1);
+        }
+        if (i0 > i1)
+            continue;
+        if (i0 > r->debut)                                                              // keep the steps before the written ones
+            r->fin = i0 - 1;
+        else                                                                            // or the ones after
+            r->debut = i1 + 1;
+    }
+}
+
+// the gap of pas steps from index does not fit in libre: queues it with its values and curve (rows of nvals), and the overdub ratios
+// at both ends when they come from a signal, and fills what fits
+static long ipoke_core_differe(t_ipoke_core *x, float *tab, long frames, long nc, long nvals, long index, long pas, char interp,
+                               const double *valeurs, const double *curve, double retour, double retour_fin, long libre)
+{
+    t_ipoke_reste *r = ipoke_core_nouveau_reste(x, nvals, index, pas, 1, labs(pas) - 1, interp);
+    long rangs = (interp == IPOKE_INTERP_SINC) ? IPOKE_SINC_TAPS : (interp == IPOKE_INTERP_CUBIC) ? 4 : 1;
+    long c;
+
+    r->retour = retour;
+    r->retour_fin = retour_fin;
+    for (c = 0; c < nvals; c++)
+        r->valeurs[c] = valeurs[c];
+    for (c = 0; c < rangs * nvals; c++)
+        r->valeurs[2 * nvals + c] = curve[c];
+    return ipoke_core_avance(x, r, tab, frames, nc, libre);
+}
+
+//***********************************************************************************************
+// fractional splatting
+
+// each input is spread on the frames around its fractional index, over the distance from the previous input (at least one frame):
+// writing slower than real time, a frame gets the normalised weighted average of the inputs around it;
+// faster, the weights of two successive inputs always sum to one in between, which is the linear interpolation of their fractional positions.
+// the two frames around the last input keep accumulating until the head leaves them, the ones in between are written at once.
+
+// weight of an input at the distance x from a frame, x in units of its reach
+static double ipoke_core_poids(char splat, double x)
+{
+    if (x >= 1.)
+        return 0.;
+    return (splat == IPOKE_SPLAT_CUBIC) ? 1. - x * x * (3. - 2. * x) : 1. - x;
+}
+
+// writes the normalised value of one of the two accumulating frames over the old one, overdub being its ratio
+static long ipoke_core_flush(t_ipoke_core *x, float *tab, long nc, long slot, long nvals, const double *cumuls, double overdub)
+{
+    double poids = x->splat_poids[slot];
+    int ecriture = ipoke_core_ecriture(x);
+    double gain = (ecriture == IPOKE_COMBINE_XFADE) ? ipoke_core_gain(x) : 1.;
+    float *frame;
+    long c;
+
+    if (poids <= 0.)
+        return 0;
+
+    frame = tab + x->splat_index[slot] * nc;
+    for (c = 0; c < nvals; c++)
+        frame[c] = (float)ipoke_core_point(ecriture, frame[c], cumuls[slot * nvals + c] / poids, overdub, gain);
+    return 1;
+}
+
+// the frames from debut to fin (unrolled from the previous position, so possibly out of the buffer) get the linear interpolation of the two inputs, in memory order
+// a is the frame of the previous input: when they do not fit in *libre, they are queued as a linear gap from it
+// the overdub ratio is overdub at precedente and goes by pente_retour per frame, which is only used with a signal ratio
+static void ipoke_core_splat_ramp(t_ipoke_core *x, float *tab, long frames, long nc, long nvals, long a, long debut, long fin, double precedente, const double *valeurs, double *pentes, double *bases,
+                                  double overdub, double pente_retour, long *libre)
+{
+    t_ipoke_reste *r;
+    int ecriture = ipoke_core_ecriture(x);
+    float *brouillon = ipoke_core_brouillon(x, nvals);
+    long start, len, c, k, l;
+
+    if (fin < debut)
+        return;
+    if (fin - debut + 1 > *libre && fin - debut + 1 >= IPOKE_CORE_COURT)
+    {
+        r = (debut > a) ? ipoke_core_nouveau_reste(x, nvals, a, fin + 1 - a, debut - a, fin - a, IPOKE_INTERP_LINEAR)
+                        : ipoke_core_nouveau_reste(x, nvals, a, debut - 2 - a, a - fin, a - debut, IPOKE_INTERP_LINEAR);
+        for (c = 0; c < nvals; c++)
+        {
+            r->valeurs[c] = valeurs[c] + (a - precedente) * pentes[c];
+            r->valeurs[2 * nvals + c] = pentes[c];
+        }
+        r->retour = overdub + (a - precedente) * pente_retour;
+        r->retour_fin = overdub + (a + r->pas - precedente) * pente_retour;
+        *libre -= ipoke_core_avance(x, r, tab, frames, nc, *libre);
+        return;
+    }
+    *libre -= fin - debut + 1;
+
+    while (debut <= fin)
+    {
+        start = debut;                                                                  // at most one buffer away
+        if (start >= frames)
+            start -= frames;
+        else if (start < 0)
+            start += frames;
+        len = fin - debut + 1;
+        if (len > frames - start)                                                       // up to the end of the buffer, the rest from zero
+            len = frames - start;
+        if (ecriture > IPOKE_CORE_SIGNAL)                                              // through the scratch area
+        {
+            for (k = 0; k < len; k += l)
+            {
+                l = (len - k < IPOKE_CORE_BROUILLON) ? len - k : IPOKE_CORE_BROUILLON;
+                for (c = 0; c < nvals; c++)
+                    bases[c] = valeurs[c] + (debut + k - precedente) * pentes[c];
+                ipoke_fill_ramp_multi(brouillon, nvals, nvals, l, bases, pentes);
+                ipoke_core_combine(x, ecriture, tab + (start + k) * nc, nc, nvals, l, brouillon);
+            }
+            debut += len;
+            continue;
+        }
+        for (c = 0; c < nvals; c++)
+            bases[c] = valeurs[c] + (debut - precedente) * pentes[c];
+        if (ecriture == IPOKE_CORE_SIGNAL)
+            ipoke_fill_ramp_multi_feedback(tab + start * nc, nc, nvals, len, bases, pentes, overdub + (debut - precedente) * pente_retour, pente_retour);
+        else if (overdub != 0.)
+            ipoke_fill_ramp_multi_overdub(tab + start * nc, nc, nvals, len, bases, pentes, overdub);
+        else
+            ipoke_fill_ramp_multi(tab + start * nc, nc, nvals, len, bases, pentes);
+        debut += len;
+    }
+}
+
+static long ipoke_core_splat(t_ipoke_core *x, float *tab, long frames, long nc, const double * const *inval, long nvals, const double *inind, long n,
+                             double *valeurs, double *cumuls, double *pentes, double *bases)
+{
+    char dirty_flag, splat, mode;
+    double position, precedente, dp, fin, h, u, f, wo, wi, wo1, wi1;
+    double overdub = ipoke_core_ratio(x), retour_entree;                               // the ratio of the previous input and of this one
+    int signal = (ipoke_core_ecriture(x) == IPOKE_CORE_SIGNAL);
+    long demivie, index, index_precedent, pas, a, b, s, c, depart, arrivee, ecrits = 0;
+    long libre = (x->budget > 0) ? x->budget : LONG_MAX;
+    t_ipoke_trace trace = { -1, 0, 0, 0 };
+    t_ipoke_stats compte = { 0 };
+    char compter = x->compter;
+
+    demivie = (long)(frames * 0.5);
+    dirty_flag = 0;
+    splat = x->splat;
+    precedente = x->position_precedente;
+    index_precedent = x->index_precedent;
+    if (x->nb_restes)
+        libre -= ipoke_core_reprend(x, tab, frames, nc, libre);
+
+    for (s = 0; s < n; s++)
+    {
+        position = inind[s];
+
+        if (position < 0.0)                                                             // if the writing is stopped
+        {
+            if (index_precedent >= 0)                                                   // and if it is the 1st one to be stopped, write what is accumulated
+            {
+                if (x->nb_restes)
+                    ipoke_core_coupe(x, index_precedent, 2, frames);
+                dirty_flag |= ipoke_core_flush(x, tab, nc, 0, nvals, cumuls, overdub);
+                dirty_flag |= ipoke_core_flush(x, tab, nc, 1, nvals, cumuls, overdub);
+                ipoke_trace_point(&trace, index_precedent);
+                ipoke_core_trace(x, &trace, frames, 1);
+                index_precedent = -1;
+            }
+            continue;
+        }
+
+        position = wrap_position(position - x->origine, frames);                       // make sure it is in the region's boundaries
+        index = (long)position;
+        f = position - index;
+        retour_entree = signal ? x->retours[s] : overdub;
+        ecrits++;
+
+        if (index_precedent >= 0 && x->saut)
+        {
+            dp = position - precedente;
+            if (dp > demivie)
+                dp -= frames;
+            else if (dp < -demivie)
+                dp += frames;
+            if (fabs(dp) > x->saut)                                                     // a jump: what is accumulated is written, the ends crossfaded and the writing restarts
+            {
+                dirty_flag |= ipoke_core_flush(x, tab, nc, 0, nvals, cumuls, overdub);
+                dirty_flag |= ipoke_core_flush(x, tab, nc, 1, nvals, cumuls, overdub);
+                if (x->nb_restes)
+                    ipoke_core_coupe(x, index_precedent, 2, frames);
+                ipoke_trace_point(&trace, index_precedent);
+                ipoke_core_trace(x, &trace, frames, 1);
+
+                depart = (x->sens > 0) ? 1 : 0;                                         // the last frame written, the one ahead if it got anything
+                if (x->splat_poids[depart] <= 0.)
+                    depart = 1 - depart;
+                depart = x->splat_index[depart];
+                x->splat_index[0] = index;
+                x->splat_index[1] = (index + 1 < frames) ? index + 1 : 0;
+                arrivee = (x->sens > 0 && f > 0.) ? x->splat_index[1] : index;           // and the first one the next inputs write
+                for (c = 0; c < nvals; c++)
+                    bases[c] = inval[c][s];
+                if (signal)                                                             // the fades take the ratio of the new index
+                    x->retour = overdub = retour_entree;
+                dirty_flag |= ipoke_core_punch(x, tab, frames, nc, nvals, depart, arrivee, x->sens, bases);
+                if (compter)
+                    compte.sauts++;
+
+                x->splat_poids[0] = (f == 0.) ? 1. : 0.;                                // unlike a start, an input right on a frame writes it
+                x->splat_poids[1] = 0.;
+                for (c = 0; c < nvals; c++)
+                {
+                    cumuls[c] = x->splat_poids[0] * inval[c][s];
+                    cumuls[nvals + c] = 0.;
+                    valeurs[c] = inval[c][s];
+                }
+                precedente = position;
+                index_precedent = index;
+                continue;
+            }
+        }
+
+        if (index_precedent < 0)                                                        // the first input only starts the next segment
+        {
+            x->splat_index[0] = index;
+            x->splat_index[1] = (index + 1 < frames) ? index + 1 : 0;
+            x->splat_poids[0] = x->splat_poids[1] = 0.;
+            for (c = 0; c < 2 * nvals; c++)
+                cumuls[c] = 0.;
+            precedente = position;
+            index_precedent = index;
+            overdub = retour_entree;
+            for (c = 0; c < nvals; c++)
+                valeurs[c] = inval[c][s];
+            continue;
+        }
+
+        dp = position - precedente;                                                     // the signed distance, the shortest way round the buffer
+        if (dp > demivie)
+            dp -= frames;
+        else if (dp < -demivie)
+            dp += frames;
+
+        if (index == index_precedent)                                                   // still between the same two frames: they take it all
+        {
+            u = precedente - index;
+            if (dp > 0.)                                                                // the previous input reaches up, the new one down
+            {
+                wo = 0.;
+                wo1 = ipoke_core_poids(splat, 1. - u);
+                wi = ipoke_core_poids(splat, f);
+                wi1 = 0.;
+            }
+            else if (dp < 0.)                                                           // and the other way round
+            {
+                wo = (u > 0.) ? ipoke_core_poids(splat, u) : 0.;
+                wo1 = 0.;
+                wi = (f == 0.) ? 1. : 0.;
+                wi1 = ipoke_core_poids(splat, 1. - f);
+            }
+            else                                                                        // not moving: both ways
+            {
+                wo = wo1 = 0.;
+                wi = ipoke_core_poids(splat, f);
+                wi1 = ipoke_core_poids(splat, 1. - f);
+            }
+            x->splat_poids[0] += wo + wi;
+            x->splat_poids[1] += wo1 + wi1;
+            for (c = 0; c < nvals; c++)
+            {
+                cumuls[c] += wo * valeurs[c] + wi * inval[c][s];
+                cumuls[nvals + c] += wo1 * valeurs[c] + wi1 * inval[c][s];
+            }
+        }
+        else
+        {
+            h = (fabs(dp) > 1.) ? fabs(dp) : 1.;                                        // the reach of both inputs
+            mode = (fabs(dp) > 1.) ? IPOKE_SPLAT_LINEAR : splat;                        // further, it is an interpolation, linear like the frames filled in between
+            fin = precedente + dp;                                                      // the new position, unrolled from the previous one
+            a = index_precedent;
+            b = (long)floor(fin);
+            if (x->nb_restes)                                                           // everything from the frame of one input to the one above the other
+                ipoke_core_coupe(x, (dp > 0.) ? a : index, labs(b - a) + 2, frames);
+
+            if (dp > 0.)                                                                // going up, the lower frame is done
+            {
+                dirty_flag |= ipoke_core_flush(x, tab, nc, 0, nvals, cumuls, overdub);
+                wo = ipoke_core_poids(mode, (a + 1 - precedente) / h);                  // the upper one gets both inputs
+                wi = ipoke_core_poids(mode, (fin - (a + 1)) / h);
+                x->splat_poids[1] += wo + wi;
+                for (c = 0; c < nvals; c++)
+                    cumuls[nvals + c] += wo * valeurs[c] + wi * inval[c][s];
+
+                if (b == a + 1)                                                         // and carries on as the lower one
+                {
+                    x->splat_poids[0] = x->splat_poids[1];
+                    for (c = 0; c < nvals; c++)
+                        cumuls[c] = cumuls[nvals + c];
+                }
+                else                                                                    // or is done too, the frames in between are interpolated and the new lower one starts
+                {
+                    dirty_flag |= ipoke_core_flush(x, tab, nc, 1, nvals, cumuls, overdub);
+                    for (c = 0; c < nvals; c++)
+                        pentes[c] = (inval[c][s] - valeurs[c]) / dp;
+                    ipoke_core_splat_ramp(x, tab, frames, nc, nvals, a, a + 2, b - 1, precedente, valeurs, pentes, bases, overdub, (retour_entree - overdub) / dp, &libre);
+                    wo = ipoke_core_poids(mode, (b - precedente) / h);
+                    wi = ipoke_core_poids(mode, (fin - b) / h);
+                    x->splat_poids[0] = wo + wi;
+                    for (c = 0; c < nvals; c++)
+                        cumuls[c] = wo * valeurs[c] + wi * inval[c][s];
+                    dirty_flag = 1;
+                }
+                x->splat_poids[1] = 0.;
+                for (c = 0; c < nvals; c++)
+                    cumuls[nvals + c] = 0.;
+            }
+            else                                                                        // going down, the upper frame is done
+            {
+                dirty_flag |= ipoke_core_flush(x, tab, nc, 1, nvals, cumuls, overdub);
+                u = precedente - a;                                                     // the lower one gets both inputs
+                wo = (u > 0.) ? ipoke_core_poids(mode, u / h) : 0.;
+                wi = ipoke_core_poids(mode, (a - fin) / h);
+                x->splat_poids[0] += wo + wi;
+                for (c = 0; c < nvals; c++)
+                    cumuls[c] += wo * valeurs[c] + wi * inval[c][s];
+
+                if (b + 1 == a)                                                         // and carries on as the upper one
+                {
+                    x->splat_poids[1] = x->splat_poids[0];
+                    for (c = 0; c < nvals; c++)
+                        cumuls[nvals + c] = cumuls[c];
+                }
+                else                                                                    // or is done too, the frames in between are interpolated and the new upper one starts
+                {
+                    dirty_flag |= ipoke_core_flush(x, tab, nc, 0, nvals, cumuls, overdub);
+                    for (c = 0; c < nvals; c++)
+                        pentes[c] = (inval[c][s] - valeurs[c]) / dp;
+                    ipoke_core_splat_ramp(x, tab, frames, nc, nvals, a, b + 2, a - 1, precedente, valeurs, pentes, bases, overdub, (retour_entree - overdub) / dp, &libre);
+                    wo = ipoke_core_poids(mode, (precedente - (b + 1)) / h);
+                    wi = ipoke_core_poids(mode, (b + 1 - fin) / h);
+                    x->splat_poids[1] = wo + wi;
+                    for (c = 0; c < nvals; c++)
+                        cumuls[nvals + c] = wo * valeurs[c] + wi * inval[c][s];
+                    dirty_flag = 1;
+                }
+                wi = (f == 0.) ? 1. : 0.;                                               // the new lower one only has the new input if it is right on it
+                x->splat_poids[0] = wi;
+                for (c = 0; c < nvals; c++)
+                    cumuls[c] = wi * inval[c][s];
+            }
+            x->splat_index[0] = index;
+            x->splat_index[1] = (index + 1 < frames) ? index + 1 : 0;
+            x->sens = (dp > 0.) ? 1 : -1;
+            pas = ipoke_core_pas(index, index_precedent, frames, demivie);
+            if (compter)
+                ipoke_core_compte(&compte, index, index_precedent, pas, 0);
+            ipoke_trace_pas(&trace, index_precedent, pas);
+            index_precedent = index;
+        }
+
+        precedente = position;
+        overdub = retour_entree;
+        for (c = 0; c < nvals; c++)
+            valeurs[c] = inval[c][s];
+    }
+
+    x->position_precedente = precedente;
+    x->index_precedent = index_precedent;
+    if (signal)
+        x->retour = overdub;
+    if (compter)
+    {
+        compte.echantillons = ecrits;
+        ipoke_core_comptes(x, &compte);
+    }
+    ipoke_core_trace(x, &trace, frames, 1);                                             // the frame above the last one is accumulating too
+
+    return dirty_flag;
+}
+
+//***********************************************************************************************
+// loop region
+
+// the loop region asked for, within a buffer of frames: returns its length and its first frame in debut
+static long ipoke_core_bornes(const t_ipoke_core *x, long frames, long *debut)
+{
+    long fin = x->boucle_fin;
+
+    *debut = x->boucle_debut;
+    if (fin <= 0 || fin > frames)
+        fin = frames;
+    if (*debut < 0 || *debut > fin - 2)                                                 // at least two frames, or the whole buffer
+        *debut = 0;
+    return fin - *debut;
+}
+
+// the same, applied: when it moved, the writing restarts as all the positions kept are in the old one
+static long ipoke_core_cadre(t_ipoke_core *x, long frames)
+{
+    long debut, etendue = ipoke_core_bornes(x, frames, &debut);
+
+    if (debut != x->region_debut || etendue != x->region_etendue)
+    {
+        if (x->region_etendue)
+            ipoke_core_reset(x);
+        x->region_debut = debut;
+        x->region_etendue = etendue;
+    }
+    x->frames_tampon = frames;
+    return x->region_etendue;
+}
+
+// what the kernels write in: the region, from its first frame, or the staged arc while there is one, its indices being already relative to it
+static long ipoke_core_vue(t_ipoke_core *x, float **tab, long frames, long nc)
+{
+    if (x->journal_etendue)
+    {
+        x->origine = 0;
+        return x->region_etendue;
+    }
+    frames = ipoke_core_cadre(x, frames);
+    *tab += x->region_debut * nc;
+    x->origine = x->region_debut;
+    return frames;
+}
+
+// the channels a write call writes in what ipoke_core_vue gave, for the snapping of the decayed frames
+static void ipoke_core_vise(t_ipoke_core *x, float *tab, long chan, long frames, long nc, long nvals)
+{
+    x->cible = (x->seuil > 0. && ipoke_core_ecriture(x)) ? tab + chan : NULL;
+    x->cible_nc = nc;
+    x->cible_nvals = nvals;
+    x->cible_frames = x->journal_etendue ? x->journal_etendue : frames;
+}
+
+// hands an arc of the region over as one or two runs of buffer frames
+static void ipoke_core_rend(long debut, long etendue, long region_debut, long region_etendue, t_ipoke_core_visite visite, void *data)
+{
+    long premier;
+
+    if (etendue >= region_etendue)
+    {
+        visite(data, region_debut, region_etendue);
+        return;
+    }
+    debut = wrap_index(debut, region_etendue);
+    premier = (etendue < region_etendue - debut) ? etendue : region_etendue - debut;
+    visite(data, region_debut + debut, premier);
+    if (etendue > premier)
+        visite(data, region_debut, etendue - premier);
+}
+
+// floor without the call, for the positions of a vector: they are far within a long
+static long plancher(double position)
+{
+    long i = (long)position;
+
+    return (position < (double)i) ? i - 1 : i;
+}
+
+void ipoke_core_portee(const t_ipoke_core *x, long frames, const double *inind, long n, t_ipoke_core_visite visite, void *data)
+{
+    long debut, etendue = ipoke_core_bornes(x, frames, &debut);
+    long demivie = (long)(etendue * 0.5);
+    long marge = x->splat ? 2 : 0;                                                      // the splat frames on both sides of a position
+    long fondu = (x->saut ? x->long_fondu : 0) + marge;
+    char meme = (debut == x->region_debut && etendue == x->region_etendue);            // a new region restarts
+    char ecrit = meme && x->index_precedent >= 0;
+    double precedente = x->splat ? x->position_precedente : x->index_precedent;
+    double lieu = precedente, position, dp;                                            // where the run gathered so far is, unwrapped
+    long bas = 0, haut = -1, a, b, s, slot;
+    const t_ipoke_reste *r;
+
+    for (s = 0; meme && s < x->nb_restes; s++)                                          // the fills carried over go first
+    {
+        slot = x->premier_reste + s;
+        if (slot >= IPOKE_CORE_RESTES)
+            slot -= IPOKE_CORE_RESTES;
+        r = &x->restes[slot];
+        if (r->debut <= r->fin)
+            ipoke_core_rend((r->pas > 0) ? r->index + r->debut : r->index - r->fin, r->fin - r->debut + 1, debut, etendue, visite, data);
+    }
+    for (s = 0; s < n; s++)
+    {
+        position = inind[s];
+        if (position < 0.0)                                                             // a stop writes the pending frames, and ends the run
+        {
+            if (ecrit)
+            {
+                a = (long)floor(lieu) - marge;
+                b = (long)floor(lieu) + marge;
+                bas = (haut < bas || a < bas) ? a : bas;
+                haut = (b > haut) ? b : haut;
+                ipoke_core_rend(bas, haut - bas + 1, debut, etendue, visite, data);
+            }
+            haut = bas - 1;
+            ecrit = 0;
+            continue;
+        }
+        position = x->splat ? wrap_position(position - debut, etendue) : wrap_index((long)position - debut, etendue);
+        if (!ecrit)
+        {
+            lieu = position;
+            a = (long)position - marge;
+            b = (long)position + marge;
+        }
+        else
+        {
+            dp = position - precedente;                                                 // the way the kernels go, the shortest round the region
+            if (dp > demivie)
+                dp -= etendue;
+            else if (dp < -demivie)
+                dp += etendue;
+            if (x->saut && fabs(dp) + (x->splat ? 0 : 1) > x->saut)                     // a jump: the crossfades around both ends
+            {
+                if (haut >= bas)
+                    ipoke_core_rend(bas, haut - bas + 1, debut, etendue, visite, data);
+                ipoke_core_rend((long)floor(lieu) - fondu, 2 * fondu + 2, debut, etendue, visite, data);
+                haut = bas - 1;
+                lieu = position;
+                a = (long)position - fondu;
+                b = (long)position + fondu + 1;
+            }
+            else
+            {
+                a = plancher((dp < 0.) ? lieu + dp : lieu) - marge;
+                b = plancher((dp < 0.) ? lieu : lieu + dp) + marge;
+                lieu += dp;
+            }
+        }
+        if (haut < bas)
+        {
+            bas = a;
+            haut = b;
+        }
+        else                                                                            // the steps follow each other, so the run stays in one piece
+        {
+            bas = (a < bas) ? a : bas;
+            haut = (b > haut) ? b : haut;
+        }
+        precedente = position;
+        ecrit = 1;
+    }
+    if (haut >= bas)
+        ipoke_core_rend(bas, haut - bas + 1, debut, etendue, visite, data);
+}
+
+//***********************************************************************************************
+// index units
+
+long ipoke_core_set_positions(t_ipoke_core *x, long vecteur)
+{
+    double *positions = NULL;
+
+    if (vecteur > 0 && !(positions = (double *)malloc(vecteur * sizeof(double))))
+        return 0;
+    free(x->positions);
+    x->positions = positions;
+    x->vecteur_positions = (vecteur > 0) ? vecteur : 0;
+    return 1;
+}
+
+void ipoke_core_seek(t_ipoke_core *x, double position)
+{
+    long long bits;
+
+    memcpy(&bits, &position, sizeof(bits));
+    ipoke_core_publie(&x->cale, bits);
+    ipoke_core_incremente(&x->calage);
+}
+
+// the write position at the indices, advancing by their rates: a 32.32 fixed point frame, so that it is as exact in the last frame
+// of a long buffer as in the first, and adding a constant rate never drifts
+static void ipoke_core_avance_tete(t_ipoke_core *x, long frames, const double *inind, const float *inind_float, long n, double *positions)
+{
+    long debut, etendue = ipoke_core_bornes(x, frames, &debut), i;
+    long long bas = (long long)debut << 32, haut = (long long)(debut + etendue) << 32, tour = (long long)etendue << 32, t, bits;
+    long calage = ipoke_core_lit_compte(&x->calage);
+    double vitesse, cale;
+
+    if (calage != x->calage_vu)                                                         // a seek since the last vector
+    {
+        x->calage_vu = calage;
+        bits = ipoke_core_lit(&x->cale);
+        memcpy(&cale, &bits, sizeof(cale));
+        x->marche = (cale >= 0.);
+        if (x->marche)
+            x->tete = (cale < frames) ? (long long)(cale * IPOKE_CORE_UN) : bas;
+        ipoke_core_reset(x);                                                            // a jump: the writing restarts there
+    }
+    if (!x->marche)
+    {
+        for (i = 0; i < n; i++)
+            positions[i] = -1.;
+        return;
+    }
+    t = x->tete;
+    for (i = 0; i < n; i++)
+    {
+        if (t < bas || t >= haut)                                                       // in the region, which may have moved
+        {
+            t = (t - bas) % tour;
+            t += (t < 0) ? haut : bas;
+        }
+        positions[i] = (double)t * (1. / IPOKE_CORE_UN);
+        vitesse = inind ? inind[i] : inind_float[i];
+        if (vitesse > etendue || vitesse < -etendue || vitesse != vitesse)              // no faster than the region in one input, so it cannot overflow
+            vitesse = (vitesse > 0.) ? etendue : (vitesse < 0.) ? -etendue : 0.;
+        t += (long long)floor(vitesse * IPOKE_CORE_UN + 0.5);
+    }
+    if (t < bas || t >= haut)
+    {
+        t = (t - bas) % tour;
+        t += (t < 0) ? haut : bas;
+    }
+    x->tete = t;
+}
+
+static const double *ipoke_core_unites(t_ipoke_core *x, long frames, const double *inind, const float *inind_float, long n)
+{
+    double *positions = x->positions;
+    double base = 0., echelle = 1., v;
+    long debut, i;
+
+    switch (x->unites)
+    {
+        case IPOKE_UNITS_RATE:
+            ipoke_core_avance_tete(x, frames, inind, inind_float, n, positions);
+            return positions;
+        case IPOKE_UNITS_PHASE:
+            echelle = (double)ipoke_core_bornes(x, frames, &debut);
+            base = debut;
+            break;
+        case IPOKE_UNITS_MS:
+            echelle = x->frames_ms;
+            break;
+    }
+    for (i = 0; i < n; i++)
+    {
+        v = inind ? inind[i] : inind_float[i];
+        positions[i] = (v < 0.) ? -1. : base + v * echelle;
+    }
+    return positions;
+}
+
+const double *ipoke_core_positions(t_ipoke_core *x, long frames, const double *inind, long n)
+{
+    if (x->unites == IPOKE_UNITS_SAMPLES || !x->positions)
+        return inind;
+    return ipoke_core_unites(x, frames, inind, NULL, n);
+}
+
+const double *ipoke_core_positions_float(t_ipoke_core *x, long frames, const float *inind, long n)
+{
+    return ipoke_core_unites(x, frames, NULL, inind, n);
+}
+
+//***********************************************************************************************
+// one channel
+
+// the generic kernel: ecriture (see ipoke_core_ecriture), interp, mono (one channel buffer, so the frames follow each other), flottant (the inputs are floats)
+// and simple (none of the features of ipoke_core_simple is on) are constants in each specialisation below, so each of them only keeps its own branches
+static IPOKE_INLINE long ipoke_core_kernel(t_ipoke_core *x, float *tab, long frames, long nc, const void *inval, const void *inind, long n,
+                                           char ecriture, char interp, char mono, char flottant, char simple)
+{
+    char dirty_flag;
+    double valeur_entree, valeur, index_tampon, overdub, gain, retour_entree = 0., pente_retour = 0.;
+    double curve[IPOKE_SINC_TAPS];
+    long nb_val, index, index_precedent, pas, demivie, i, ecrits = 0;
+    long libre = (x->budget > 0) ? x->budget : LONG_MAX;                               // frames the gaps can still fill in this call
+    long saut = simple ? 0 : x->saut, sens = x->sens, origine = simple ? 0 : x->origine;
+    float *ecrit;
+    t_ipoke_trace trace = { -1, 0, 0, 0 };
+    t_ipoke_stats compte = { 0 };
+    char compter = simple ? 0 : x->compter;
+    char antialias = simple ? 0 : x->antialias;                                         // in registers: tab could alias x for the compiler
+    char restes = !simple;                                                              // whether fills can be carried over
+
+    if (mono)
+        nc = 1;
+    demivie = (long)(frames * 0.5);
+    if (restes && x->nb_restes)                                                         // the gaps left over by the previous calls first
+        libre -= ipoke_core_reprend(x, tab, frames, nc, libre);
+
+    index_precedent = x->index_precedent;
+    valeur = x->valeur;
+    nb_val = x->nb_val;
+    if (index_precedent >= 0)                                                           // the trace is started wherever the head is, so the steps do not check it
+        ipoke_trace_point(&trace, index_precedent);
+    dirty_flag = 0;
+    overdub = (ecriture == IPOKE_CORE_SIGNAL) ? x->retour : (ecriture ? ipoke_core_ratio(x) : 0.);   // with a signal, the ratio of the input at index_precedent
+    gain = (ecriture == IPOKE_COMBINE_XFADE) ? ipoke_core_gain(x) : 1.;
+
+    for (i = 0; i < n; i++)
+    {
+        valeur_entree = flottant ? ((const float *)inval)[i] : ((const double *)inval)[i];
+        index_tampon = flottant ? ((const float *)inind)[i] : ((const double *)inind)[i];
+        if (ecriture == IPOKE_CORE_SIGNAL)
+            retour_entree = x->retours[i];
+
+        if (index_tampon < 0.0)                                                         // if the writing is stopped
+        {
+            if (index_precedent >= 0)                                                   // and if it is the 1st one to be stopped
+            {
+                ecrit = tab + index_precedent * nc;                                     // write the average value at the last given index
+                *ecrit = (float)ipoke_core_point(ecriture, *ecrit, valeur/nb_val, overdub, gain);
+                if (restes && x->nb_restes)
+                    ipoke_core_coupe(x, index_precedent, 1, frames);
+                ipoke_trace_point(&trace, index_precedent);
+                ipoke_core_trace(x, &trace, frames, 0);
+                valeur = 0.0;
+                index_precedent = -1;
+                x->nb_hist = 0;
+                dirty_flag = 1;
+            }
+        }
+        else
+        {
+            index = wrap_index((long)(index_tampon) - origine, frames);                 // truncate the next index and make sure it is in the region's boundaries
+            ecrits++;
+
+            if (index_precedent < 0)                                                    // if it is the first index to write, resets the averaging and the values
+            {
+                index_precedent = index;
+                ipoke_trace_point(&trace, index);
+                nb_val = 0;
+                x->pos_passe = -1;
+            }
+
+            if (antialias)                                                              // keep the inputs for the low-pass filter
+                ipoke_core_ecoute(x, x->passe, 1, &valeur_entree);
+
+            if (index == index_precedent)                                               // if the index has not moved, accumulate the value to average later.
+            {
+                valeur += valeur_entree;
+                nb_val += 1;
+                if (ecriture == IPOKE_CORE_SIGNAL)                                    // the last ratio given at an index is the one it gets
+                    overdub = retour_entree;
+            }
+            else                                                                        // if it moves
+            {
+                pas = ipoke_core_pas(index, index_precedent, frames, demivie);
+                if (compter)
+                    ipoke_core_compte(&compte, index, index_precedent, pas, nb_val);
+
+                if (antialias && (ipoke_core_periode(x, nb_val, pas) > 1.))             // slower than real time: low-pass the input rather than box-averaging it
+                {
+                    valeur = ipoke_fill_lowpass(x->passe + x->pos_passe, x->periode);
+                    nb_val = 1;
+                }
+                else if (nb_val != 1)                                                   // is there more than one values to average
+                {
+                    valeur = valeur/nb_val;                                             // if yes, calculate the average
+                    nb_val = 1;
+                }
+
+                ecrit = tab + index_precedent * nc;                                     // write the average value at the last index
+                *ecrit = (float)ipoke_core_point(ecriture, *ecrit, valeur, overdub, gain);
+                dirty_flag = 1;
+
+                if (saut && labs(pas) > saut)                                           // a jump: crossfaded at both ends instead of filled
+                {
+                    if (compter)
+                        ipoke_core_saute(&compte, index, index_precedent, pas);
+                    if (restes && x->nb_restes)
+                        ipoke_core_coupe(x, index_precedent, 1, frames);
+                    ipoke_trace_point(&trace, index_precedent);
+                    ipoke_core_trace(x, &trace, frames, 0);
+                    if (ecriture == IPOKE_CORE_SIGNAL)                                // the fades take the ratio of the new index
+                        x->retour = overdub = retour_entree;
+                    ipoke_core_punch(x, tab, frames, nc, 1, index_precedent, index, sens, &valeur_entree);
+                    x->nb_hist = 0;                                                     // the curves restart from the new index
+                    x->pas_precedent = 0;
+                    valeur = valeur_entree;
+                    index_precedent = index;
+                    ipoke_trace_point(&trace, index);
+                    continue;
+                }
+
+                if (interp >= IPOKE_INTERP_CUBIC)                                       // the lower modes keep no history
+                    ipoke_core_push(x, interp, x->histoire, 1, &valeur);
+                if (interp >= IPOKE_INTERP_CUBIC || labs(pas) > 1)                      // and need no curve without a gap
+                    ipoke_core_curve(x, interp, x->histoire, 1, pas, valeur, valeur_entree, curve, 1);
+
+                if (restes && x->nb_restes)                                             // the older gaps must not write over this one later
+                    ipoke_core_coupe(x, (pas > 0) ? index_precedent : index + 1, labs(pas), frames);
+                if (ecriture == IPOKE_CORE_SIGNAL)
+                {
+                    pente_retour = (retour_entree - overdub) / pas;                     // the ratio is interpolated linearly across the gap
+                    x->retour = retour_entree;                                          // where the next gap starts from
+                }
+                if (!simple && labs(pas) - 1 > libre && labs(pas) > IPOKE_CORE_COURT)  // too long for this call: fill what fits, the rest later
+                    libre -= ipoke_core_differe(x, tab, frames, nc, 1, index_precedent, pas, interp, &valeur, curve, overdub,
+                                                (ecriture == IPOKE_CORE_SIGNAL) ? retour_entree : overdub, libre);
+                else if (labs(pas) > 1)                                                 // nothing to fill between neighbours
+                {
+#define IPOKE_CORE_SEGMENT(start, len, offset)                                                                                  \
+    do {                                                                                                                        \
+        if (ecriture > IPOKE_CORE_SIGNAL)                                                                                       \
+            ipoke_core_fill_brouillon(x, ecriture, interp, tab + (start) * nc, nc, len, offset, pas, valeur, curve);            \
+        else                                                                                                                    \
+            ipoke_core_fill_segment(interp, ecriture, tab + (start) * nc, nc, len, offset, pas, valeur, curve, overdub, pente_retour); \
+    } while (0)
+                    IPOKE_CORE_GAP(IPOKE_CORE_SEGMENT)
+#undef IPOKE_CORE_SEGMENT
+                    if (!simple)
+                        libre -= labs(pas) - 1;
+                }
+
+                ipoke_trace_avance(&trace, pas);
+                if (interp >= IPOKE_INTERP_CUBIC)
+                    x->pas_precedent = labs(pas);
+                sens = (pas > 0) ? 1 : -1;
+                valeur = valeur_entree;                                                 // transfer the new previous value
+                if (ecriture == IPOKE_CORE_SIGNAL)
+                    overdub = retour_entree;
+            }
+            index_precedent = index;                                                    // transfer the new previous address
+        }
+    }
+
+    x->index_precedent = index_precedent;
+    x->valeur = valeur;
+    x->nb_val = nb_val;
+    x->sens = sens;
+    if (interp < IPOKE_INTERP_CUBIC)                                                    // so that a higher mode restarts its history
+        x->nb_hist = 0;
+    if (ecriture == IPOKE_CORE_SIGNAL)
+        x->retour = overdub;
+    if (compter)
+    {
+        compte.echantillons = ecrits;
+        ipoke_core_comptes(x, &compte);
+    }
+    if (trace.haut > trace.bas)                                                         // only once the head has moved: the frame it is on is still accumulating
+        ipoke_core_trace(x, &trace, frames, 0);
+
+    return dirty_flag;
+}
+
+// one specialisation per features x writing x interp x mono x input type, named after them
+#define IPOKE_CORE_NOYAU(si, od, in, mo, fl)                                                                                    \
+    static long ipoke_core_noyau_##si##od##in##mo##fl(t_ipoke_core *x, float *tab, long frames, long nc, const void *inval, const void *inind, long n) \
+    {                                                                                                                           \
+        return ipoke_core_kernel(x, tab, frames, nc, inval, inind, n, od, in, mo, fl, si);                                      \
+    }
+#define IPOKE_CORE_NOYAUX(si, od, mo, fl) IPOKE_CORE_NOYAU(si, od, 0, mo, fl) IPOKE_CORE_NOYAU(si, od, 1, mo, fl) IPOKE_CORE_NOYAU(si, od, 2, mo, fl) IPOKE_CORE_NOYAU(si, od, 3, mo, fl)
+#define IPOKE_CORE_ECRITURE(si, od) IPOKE_CORE_NOYAUX(si, od, 0, 0) IPOKE_CORE_NOYAUX(si, od, 0, 1) IPOKE_CORE_NOYAUX(si, od, 1, 0) IPOKE_CORE_NOYAUX(si, od, 1, 1)
+#define IPOKE_CORE_TABLE(si, od, mo, fl) { ipoke_core_noyau_##si##od##0##mo##fl, ipoke_core_noyau_##si##od##1##mo##fl, ipoke_core_noyau_##si##od##2##mo##fl, ipoke_core_noyau_##si##od##3##mo##fl }
+#define IPOKE_CORE_TABLES(si, od) { { IPOKE_CORE_TABLE(si, od, 0, 0), IPOKE_CORE_TABLE(si, od, 0, 1) }, { IPOKE_CORE_TABLE(si, od, 1, 0), IPOKE_CORE_TABLE(si, od, 1, 1) } }
+
+IPOKE_CORE_ECRITURE(0, 0) IPOKE_CORE_ECRITURE(0, 1) IPOKE_CORE_ECRITURE(0, 2) IPOKE_CORE_ECRITURE(0, 3) IPOKE_CORE_ECRITURE(0, 4) IPOKE_CORE_ECRITURE(0, 5)
+IPOKE_CORE_ECRITURE(1, 0) IPOKE_CORE_ECRITURE(1, 1) IPOKE_CORE_ECRITURE(1, 2) IPOKE_CORE_ECRITURE(1, 3) IPOKE_CORE_ECRITURE(1, 4) IPOKE_CORE_ECRITURE(1, 5)
+
+static const t_ipoke_core_noyau ipoke_core_noyaux[2][IPOKE_COMBINE_SOFTSAT + 1][2][2][IPOKE_INTERP_SINC + 1] = {        // [simple][writing][mono][float][interp]
+    { IPOKE_CORE_TABLES(0, 0), IPOKE_CORE_TABLES(0, 1), IPOKE_CORE_TABLES(0, 2), IPOKE_CORE_TABLES(0, 3), IPOKE_CORE_TABLES(0, 4), IPOKE_CORE_TABLES(0, 5) },
+    { IPOKE_CORE_TABLES(1, 0), IPOKE_CORE_TABLES(1, 1), IPOKE_CORE_TABLES(1, 2), IPOKE_CORE_TABLES(1, 3), IPOKE_CORE_TABLES(1, 4), IPOKE_CORE_TABLES(1, 5) },
+};
+
+#undef IPOKE_CORE_TABLES
+#undef IPOKE_CORE_TABLE
+#undef IPOKE_CORE_ECRITURE
+#undef IPOKE_CORE_NOYAUX
+#undef IPOKE_CORE_NOYAU
+
+// none of the features tested per input is on: no low-pass, counting, jumps, budget or fills carried over, and no loop region offset,
+// so the specialisations leaving their tests out can write. The fills carried over by a budget just turned off keep the full ones until they are done
+static int ipoke_core_simple(const t_ipoke_core *x)
+{
+    return !x->antialias && !x->compter && !x->saut && !x->budget && !x->nb_restes && !x->origine;
+}
+
+// the key of the specialisation matching the current modes, never 0
+static long ipoke_core_choix(t_ipoke_core *x, long nc)
+{
+    return 1 + ipoke_core_ecriture(x) + (IPOKE_COMBINE_SOFTSAT + 1) * ((nc == 1) + 2 * (x->interp + (IPOKE_INTERP_SINC + 1) * ipoke_core_simple(x)));
+}
+
+void ipoke_core_select(t_ipoke_core *x, long nc)
+{
+    int ecriture = ipoke_core_ecriture(x);
+    int mono = (nc == 1);
+    int interp = (x->interp >= IPOKE_INTERP_HOLD && x->interp <= IPOKE_INTERP_SINC) ? x->interp : IPOKE_INTERP_LINEAR;
+    int simple = ipoke_core_simple(x);
+
+    x->interp = (char)interp;
+    x->noyau = ipoke_core_noyaux[simple][ecriture][mono][0][interp];
+    x->noyau_float = ipoke_core_noyaux[simple][ecriture][mono][1][interp];
+    x->choix = ipoke_core_choix(x, nc);
+}
+
+long ipoke_core_write(t_ipoke_core *x, float *tab, long frames, long nc, long chan, const double *inval, const double *inind, long n)
+{
+    frames = ipoke_core_vue(x, &tab, frames, nc);
+    ipoke_core_vise(x, tab, chan, frames, nc, 1);
+    if (x->splat)
+    {
+        double pente, base;
+
+        return ipoke_core_splat(x, tab + chan, frames, nc, &inval, 1, inind, n, &x->valeur, x->cumul, &pente, &base);
+    }
+
+    if (x->choix != ipoke_core_choix(x, nc))                                            // the modes were changed without ipoke_core_select
+        ipoke_core_select(x, nc);
+    return x->noyau(x, tab + chan, frames, nc, inval, inind, n);
+}
+
+// the 32bit perform has its own specialisations reading the float vectors, so they do not have to be widened first
+long ipoke_core_write_float(t_ipoke_core *x, float *tab, long frames, long nc, long chan, const float *inval, const float *inind, long n)
+{
+    double val[IPOKE_CORE_CHUNK], ind[IPOKE_CORE_CHUNK];
+    const double *retours = x->retours;
+    long dirty_flag = 0;
+    long todo, i;
+
+    if (!x->splat)
+    {
+        frames = ipoke_core_vue(x, &tab, frames, nc);
+        ipoke_core_vise(x, tab, chan, frames, nc, 1);
+        if (x->choix != ipoke_core_choix(x, nc))
+            ipoke_core_select(x, nc);
+        return x->noyau_float(x, tab + chan, frames, nc, inval, inind, n);
+    }
+
+    while (n > 0)                                                                       // the splatting kernel is shared with the multichannel mode and only reads doubles
+    {
+        todo = (n < IPOKE_CORE_CHUNK) ? n : IPOKE_CORE_CHUNK;
+        for (i = 0; i < todo; i++)
+        {
+            val[i] = inval[i];
+            ind[i] = inind[i];
+        }
+        dirty_flag |= ipoke_core_write(x, tab, frames, nc, chan, val, ind, todo);
+        if (retours)
+            x->retours += todo;                                                         // the ratios are already doubles
+        inval += todo;
+        inind += todo;
+        n -= todo;
+    }
+    x->retours = retours;
+    return dirty_flag;
+}
+
+//***********************************************************************************************
+// multichannel
+
+long ipoke_core_write_multi(t_ipoke_core *x, float *tab, long frames, long nc, long chan, const double * const *inval, long nvals, const double *inind, long n)
+{
+    char dirty_flag;
+    double index_tampon, overdub, gain, retour_entree, pente_retour = 0., *valeurs;
+    float *frame;
+    long nb_val, index, index_precedent, pas, demivie, s, c, origine, ecrits = 0;
+    long libre = (x->budget > 0) ? x->budget : LONG_MAX;
+    t_ipoke_trace trace = { -1, 0, 0, 0 };
+    t_ipoke_stats compte = { 0 };
+    char compter = x->compter;
+    int ecriture = ipoke_core_ecriture(x);
+
+    if (nvals > x->nvals)
+        nvals = x->nvals;
+    if (nvals < 1)
+        return 0;
+    frames = ipoke_core_vue(x, &tab, frames, nc);
+    origine = x->origine;
+    ipoke_core_vise(x, tab, chan, frames, nc, nvals);
+
+    if (x->splat)
+        return ipoke_core_splat(x, tab + chan, frames, nc, inval, nvals, inind, n, x->valeurs, x->cumuls, x->coeffs, x->bases);
+
+    demivie = (long)(frames * 0.5);
+
+    index_precedent = x->index_precedent;
+    valeurs = x->valeurs;
+    nb_val = x->nb_val;
+    dirty_flag = 0;
+    overdub = ipoke_core_ratio(x);                                                      // the ratio of the input at index_precedent
+    gain = ipoke_core_gain(x);
+    tab += chan;
+    if (x->nb_restes)
+        libre -= ipoke_core_reprend(x, tab, frames, nc, libre);
+
+    for (s = 0; s < n; s++)
+    {
+        index_tampon = inind[s];
+
+        if (index_tampon < 0.0)                                                         // if the writing is stopped
+        {
+            if (index_precedent >= 0)                                                   // and if it is the 1st one to be stopped
+            {
+                frame = tab + index_precedent * nc;
+                for (c = 0; c < nvals; c++)                                             // write the average values at the last given index
+                {
+                    frame[c] = (float)ipoke_core_point(ecriture, frame[c], valeurs[c]/nb_val, overdub, gain);
+                    valeurs[c] = 0.0;
+                }
+                if (x->nb_restes)
+                    ipoke_core_coupe(x, index_precedent, 1, frames);
+                ipoke_trace_point(&trace, index_precedent);
+                ipoke_core_trace(x, &trace, frames, 0);
+                index_precedent = -1;
+                x->nb_hist = 0;
+                dirty_flag = 1;
+            }
+        }
+        else
+        {
+            index = wrap_index((long)(index_tampon) - origine, frames);                 // truncate the next index and make sure it is in the region's boundaries
+            retour_entree = (ecriture == IPOKE_CORE_SIGNAL) ? x->retours[s] : overdub;
+            ecrits++;
+
+            if (index_precedent < 0)                                                    // if it is the first index to write, resets the averaging and the values
+            {
+                index_precedent = index;
+                nb_val = 0;
+                x->pos_passe = -1;
+            }
+
+            if (x->antialias)                                                           // keep the inputs for the low-pass filters
+            {
+                for (c = 0; c < nvals; c++)
+                    x->bases[c] = inval[c][s];
+                ipoke_core_ecoute(x, x->passes, nvals, x->bases);
+            }
+
+            if (index == index_precedent)                                               // if the index has not moved, accumulate the values to average later.
+            {
+                for (c = 0; c < nvals; c++)
+                    valeurs[c] += inval[c][s];
+                nb_val += 1;
+                overdub = retour_entree;                                                // the last ratio given at an index is the one it gets
+            }
+            else                                                                        // if it moves
+            {
+                pas = ipoke_core_pas(index, index_precedent, frames, demivie);
+                if (compter)
+                    ipoke_core_compte(&compte, index, index_precedent, pas, nb_val);
+
+                if (x->antialias && (ipoke_core_periode(x, nb_val, pas) > 1.))          // slower than real time: low-pass the inputs rather than box-averaging them
+                {
+                    ipoke_fill_lowpass_multi(valeurs, x->passes + x->pos_passe * nvals, nvals, x->periode);
+                    nb_val = 1;
+                }
+                else if (nb_val != 1)                                                   // is there more than one values to average
+                {
+                    for (c = 0; c < nvals; c++)
+                        valeurs[c] = valeurs[c]/nb_val;                                 // if yes, calculate the averages
+                    nb_val = 1;
+                }
+
+                frame = tab + index_precedent * nc;                                     // write the average values at the last index
+                for (c = 0; c < nvals; c++)
+                    frame[c] = (float)ipoke_core_point(ecriture, frame[c], valeurs[c], overdub, gain);
+                dirty_flag = 1;
+
+                if (x->saut && labs(pas) > x->saut)                                     // a jump: crossfaded at both ends instead of filled
+                {
+                    if (compter)
+                        ipoke_core_saute(&compte, index, index_precedent, pas);
+                    if (x->nb_restes)
+                        ipoke_core_coupe(x, index_precedent, 1, frames);
+                    ipoke_trace_point(&trace, index_precedent);
+                    ipoke_core_trace(x, &trace, frames, 0);
+                    for (c = 0; c < nvals; c++)
+                        valeurs[c] = inval[c][s];
+                    if (ecriture == IPOKE_CORE_SIGNAL)                                  // the fades take the ratio of the new index
+                        x->retour = overdub = retour_entree;
+                    ipoke_core_punch(x, tab, frames, nc, nvals, index_precedent, index, x->sens, valeurs);
+                    x->nb_hist = 0;
+                    x->pas_precedent = 0;
+                    index_precedent = index;
+                    continue;
+                }
+
+                ipoke_core_push(x, x->interp, x->histoires, nvals, valeurs);
+                for (c = 0; c < nvals; c++)                                             // the curves of all the channels
+                {
+                    if (x->interp < IPOKE_INTERP_CUBIC)
+                        ipoke_core_curve(x, x->interp, x->histoires + c, nvals, pas, valeurs[c], inval[c][s], x->coeffs + c, nvals);
+                    else
+                        ipoke_core_curve(x, x->interp, x->histoires + c, nvals, pas, valeurs[c], inval[c][s], x->points + c, nvals);
+                }
+
+                if (ecriture == IPOKE_CORE_SIGNAL)
+                {
+                    pente_retour = (retour_entree - overdub) / pas;                     // the ratio is interpolated linearly across the gap
+                    x->retour = retour_entree;
+                }
+                if (x->nb_restes)
+                    ipoke_core_coupe(x, (pas > 0) ? index_precedent : index + 1, labs(pas), frames);
+                if (labs(pas) - 1 > libre && labs(pas) > IPOKE_CORE_COURT)
+                    libre -= ipoke_core_differe(x, tab, frames, nc, nvals, index_precedent, pas, x->interp, valeurs,
+                                                (x->interp < IPOKE_INTERP_CUBIC) ? x->coeffs : x->points, overdub, retour_entree, libre);
+                else
+                {
+#define IPOKE_CORE_SEGMENT(start, len, offset) ipoke_core_fill_segment_multi(x, ecriture, tab + (start) * nc, nc, nvals, len, offset, pas, overdub, pente_retour)
+                    IPOKE_CORE_GAP(IPOKE_CORE_SEGMENT)
+#undef IPOKE_CORE_SEGMENT
+                    libre -= labs(pas) - 1;
+                }
+
+                ipoke_trace_pas(&trace, index_precedent, pas);
+                x->pas_precedent = labs(pas);
+                x->sens = (pas > 0) ? 1 : -1;
+                for (c = 0; c < nvals; c++)                                             // transfer the new previous values
+                    valeurs[c] = inval[c][s];
+                overdub = retour_entree;
+            }
+            index_precedent = index;                                                    // transfer the new previous address
+        }
+    }
+
+    x->index_precedent = index_precedent;
+    x->nb_val = nb_val;
+    if (ecriture == IPOKE_CORE_SIGNAL)
+        x->retour = overdub;
+    if (compter)
+    {
+        compte.echantillons = ecrits;
+        ipoke_core_comptes(x, &compte);
+    }
+    ipoke_core_trace(x, &trace, frames, 0);
+
+    return dirty_flag;
+}
+
+//***********************************************************************************************
+// staged writing
+
+long ipoke_core_set_journal(t_ipoke_core *x, long taille, long nchans, long vecteur)
+{
+    float *journal = NULL;
+    double *journal_index = NULL;
+
+    if (taille <= 0 || nchans <= 0)
+        taille = nchans = 0;
+    if (vecteur > 0)                                                                    // the indices alone are enough for ipoke_core_stage_arc
+    {
+        journal = taille ? (float *)malloc(taille * nchans * sizeof(float)) : NULL;
+        journal_index = (double *)malloc(vecteur * sizeof(double));
+        if ((taille && !journal) || !journal_index)
+        {
+            free(journal);
+            free(journal_index);
+            return 0;
+        }
+    }
+    else
+        taille = nchans = vecteur = 0;
+
+    free(x->journal);
+    free(x->journal_index);
+    x->journal = journal;
+    x->journal_index = journal_index;
+    x->taille_journal = taille;
+    x->nchans_journal = nchans;
+    x->vecteur_journal = vecteur;
+    x->journal_etendue = 0;
+    return 1;
+}
+
+// the frames written by a vector follow each other round the buffer from the pending index, as every step is filled:
+// returns the length of that arc and its first frame, or 0 if it cannot be staged
+// the positions, wrapped in the buffer as the kernels do, are kept in journal_index
+static long ipoke_core_etendue(t_ipoke_core *x, long frames, const double *inind, long n, long *debut)
+{
+    long demivie = (long)(frames * 0.5);
+    long index_precedent = x->index_precedent;
+    long origine = index_precedent;
+    long decalage = 0, bas = 0, haut = 0;
+    long index, pas, s;
+    double position;
+
+    for (s = 0; s < n; s++)
+    {
+        position = inind[s];
+        if (position < 0.0)                                                             // a stop writes the pending index, already in the arc
+        {
+            x->journal_index[s] = -1.;
+            continue;
+        }
+        if (x->splat)
+        {
+            position = wrap_position(position - x->origine, frames);
+            index = (long)position;
+        }
+        else
+            position = index = wrap_index((long)position - x->origine, frames);
+        x->journal_index[s] = position;
+
+        if (origine < 0)
+            origine = index;
+        else
+        {
+            pas = ipoke_core_pas(index, index_precedent, frames, demivie);              // a restart is joined the short way too, so the arc covers it
+            if (labs(pas) >= demivie - 1)                                               // too close to a tie on the way round: it could go the other way once rotated
+                return 0;
+            if (x->saut && labs(pas) + 1 > x->saut)                                     // a jump, crossfaded out of the arc
+                return 0;
+            decalage += pas;
+            if (decalage < bas)
+                bas = decalage;
+            else if (decalage > haut)
+                haut = decalage;
+        }
+        index_precedent = index;
+    }
+    if (origine < 0)
+        return 0;
+
+    *debut = origine + bas;
+    if (*debut < 0)
+        *debut += frames;
+    else if (*debut >= frames)
+        *debut -= frames;
+    return haut - bas + 1 + (x->splat ? 1 : 0);                                         // splatting also accumulates on the frame above the last one
+}
+
+// moves the state kept in frames by decalage, round the buffer
+static long ipoke_core_tourne(long index, long decalage, long frames)
+{
+    index -= decalage;
+    if (index < 0)
+        index += frames;
+    else if (index >= frames)
+        index -= frames;
+    return index;
+}
+
+static void ipoke_core_decale(t_ipoke_core *x, long decalage, long frames)
+{
+    double f;
+    long i, slot;
+
+    for (i = 0; i < x->nb_restes; i++)                                                  // the fills a staged write left over
+    {
+        slot = x->premier_reste + i;
+        if (slot >= IPOKE_CORE_RESTES)
+            slot -= IPOKE_CORE_RESTES;
+        x->restes[slot].index = ipoke_core_tourne(x->restes[slot].index, decalage, frames);
+    }
+    if (x->index_precedent >= 0)
+        x->index_precedent = ipoke_core_tourne(x->index_precedent, decalage, frames);
+    if (x->splat)
+    {
+        x->splat_index[0] = ipoke_core_tourne(x->splat_index[0], decalage, frames);
+        x->splat_index[1] = ipoke_core_tourne(x->splat_index[1], decalage, frames);
+        f = x->position_precedente - floor(x->position_precedente);
+        x->position_precedente = ipoke_core_tourne((long)floor(x->position_precedente), decalage, frames) + f;
+    }
+}
+
+// nchans interleaved channels of len frames, from a buffer of src_nc channels to one of dst_nc
+static void ipoke_core_copie(float *dst, long dst_nc, const float *src, long src_nc, long nchans, long len)
+{
+    long i, c;
+
+    if (dst_nc == nchans && src_nc == nchans)
+    {
+        memcpy(dst, src, len * nchans * sizeof(float));
+        return;
+    }
+    for (i = 0; i < len; i++)
+        for (c = 0; c < nchans; c++)
+            dst[i * dst_nc + c] = src[i * src_nc + c];
+}
+
+long ipoke_core_stage_arc(t_ipoke_core *x, long frames, long taille, const double *inind, long n, long *debut)
+{
+    long etendue, index, r, s;
+    double position;
+
+    x->journal_etendue = 0;
+    if (!x->journal_index || n > x->vecteur_journal || x->nb_restes)                   // carried fills may write anywhere
+        return 0;
+    frames = ipoke_core_cadre(x, frames);                                               // the arc is staged from the loop region
+    x->origine = x->region_debut;
+    etendue = ipoke_core_etendue(x, frames, inind, n, debut);
+    if (!etendue || etendue > taille || etendue > frames)
+        return 0;
+
+    for (s = 0; s < n; s++)                                                             // the indices and the state, relative to the start of the arc
+    {
+        position = x->journal_index[s];
+        if (position < 0.0)
+            continue;
+        index = (long)position;
+        r = ipoke_core_tourne(index, *debut, frames);
+        x->journal_index[s] = ((long)(r + (position - index)) == r) ? r + (position - index) : r;   // keep the fraction unless it rounds up to the next frame
+    }
+    ipoke_core_decale(x, *debut, frames);
+
+    x->journal_debut = *debut;
+    x->journal_etendue = etendue;
+    return etendue;
+}
+
+void ipoke_core_stage_end(t_ipoke_core *x)
+{
+    if (!x->journal_etendue)
+        return;
+    ipoke_core_decale(x, -x->journal_debut, x->region_etendue);
+    x->journal_etendue = 0;
+}
+
+long ipoke_core_stage_in(t_ipoke_core *x, const float *tab, long frames, long nc, long chan, long nchans, const double *inind, long n)
+{
+    long debut, etendue, premier;
+
+    x->journal_etendue = 0;
+    if (!x->journal || nchans > x->nchans_journal)
+        return 0;
+    etendue = ipoke_core_stage_arc(x, frames, x->taille_journal, inind, n, &debut);
+    if (!etendue)
+        return 0;
+    frames = x->region_etendue;
+    tab += x->region_debut * nc;
+
+    premier = (etendue < frames - debut) ? etendue : frames - debut;                    // the arc in one or two runs, up to the end of the buffer and from zero
+    ipoke_core_copie(x->journal, nchans, tab + debut * nc + chan, nc, nchans, premier);
+    ipoke_core_copie(x->journal + premier * nchans, nchans, tab + chan, nc, nchans, etendue - premier);
+    return etendue;
+}
+
+long ipoke_core_stage_out(t_ipoke_core *x, float *tab, long frames, long nc, long chan, long nchans, long dirty_flag)
+{
+    long debut = x->journal_debut;
+    long etendue = x->journal_etendue;
+    long premier;
+
+    if (!etendue)
+        return 0;
+    frames = x->region_etendue;                                                         // the one it was staged from
+    tab += x->region_debut * nc;
+    ipoke_core_stage_end(x);
+    if (!dirty_flag)
+        return 0;
+
+    premier = (etendue < frames - debut) ? etendue : frames - debut;
+    ipoke_core_copie(tab + debut * nc + chan, nc, x->journal, nchans, nchans, premier);
+    ipoke_core_copie(tab + chan, nc, x->journal + premier * nchans, nchans, nchans, etendue - premier);
+    return dirty_flag;
+}
+
+//***********************************************************************************************
+// offline rendering
+
+// the frame of an index in the region, as the kernels truncate it, and its fraction in splat mode
+static long ipoke_core_rendu_index(const t_ipoke_rendu *r, double position, double *f)
+{
+    long index;
+
+    *f = 0.;
+    if (!r->splat)
+        return wrap_index((long)position - r->region_debut, r->region_etendue);
+    position = wrap_position(position - r->region_debut, r->region_etendue);
+    index = (long)position;
+    *f = position - index;
+    return index;
+}
+
+// the frames the inputs from a to b write, as an arc of etendue frames from debut in the region: returns etendue, 0 if they write none
+// the steps are followed unwrapped from the index pending before a, each writing from where it leaves up to where it lands,
+// the one pending after the last input being written by the first of the next segment, or by the final stop
+static long ipoke_core_rendu_arc(const t_ipoke_rendu *r, long a, long b, long *debut)
+{
+    long frames = r->region_etendue, demivie = (long)(frames * 0.5);
+    long marge = r->splat ? 2 : 0;                                                      // the splat frames on both sides of a position
+    long fondu = r->saut ? r->long_fondu : 0;
+    long bas = LONG_MAX, haut = LONG_MIN, u = 0, index, precedent = -1, pas, k;
+    char pendant = 0;
+    double f;
+
+#define IPOKE_CORE_ARC(de, a)           \
+    do {                                \
+        if ((de) < bas)                 \
+            bas = (de);                 \
+        if ((a) > haut)                 \
+            haut = (a);                 \
+    } while (0)
+
+    for (k = (a > 0) ? a - 1 : 0; k < b; k++)
+    {
+        if (r->indices[k] < 0.)
+        {
+            if (pendant && k >= a)                                                      // the stop writes the pending frame
+                IPOKE_CORE_ARC(u, u);
+            pendant = 0;
+            continue;
+        }
+        index = ipoke_core_rendu_index(r, r->indices[k], &f);
+        if (precedent < 0)                                                              // unwrapped from the first index
+            u = precedent = index;
+        pas = ipoke_core_pas(index, precedent, frames, demivie);
+        if (pendant && k >= a && pas)
+        {
+            if (r->saut && labs(pas) > r->saut)                                         // a jump fades both ends instead
+            {
+                IPOKE_CORE_ARC(u - fondu, u + fondu);
+                IPOKE_CORE_ARC(u + pas - fondu, u + pas + fondu);
+            }
+            else if (pas > 0)
+                IPOKE_CORE_ARC(u, u + pas - 1);
+            else
+                IPOKE_CORE_ARC(u + pas + 1, u);
+        }
+        u += pas;
+        if (marge && k >= a)
+            IPOKE_CORE_ARC(u, u);
+        precedent = index;
+        pendant = 1;
+    }
+    if (pendant && b == r->n)
+        IPOKE_CORE_ARC(u, u);
+#undef IPOKE_CORE_ARC
+
+    if (bas > haut)
+        return 0;
+    bas -= marge;
+    haut += marge;
+    if (haut - bas + 1 >= frames)
+    {
+        *debut = 0;
+        return frames;
+    }
+    *debut = wrap_index(bas, frames);
+    return haut - bas + 1;
+}
+
+static int ipoke_core_chevauche(long debut1, long etendue1, long debut2, long etendue2, long frames)
+{
+    if (!etendue1 || !etendue2)
+        return 0;
+    return wrap_index(debut2 - debut1, frames) < etendue1 || wrap_index(debut1 - debut2, frames) < etendue2;
+}
+
+static long ipoke_core_racine(long *parents, long s)
+{
+    while (parents[s] != s)
+        s = parents[s] = parents[parents[s]];
+    return s;
+}
+
+long ipoke_core_render(t_ipoke_rendu *r, const t_ipoke_core *x, float *tab, long frames, long nc, long chan, const double * const *inval, long nvals,
+                       const double *inind, long n, long segments)
+{
+    long *arcs, *parents, s, t, i, j;
+
+    memset(r, 0, sizeof(t_ipoke_rendu));
+    if (n <= 0 || nvals <= 0 || frames < 2)
+        return 0;
+    r->interp = x->interp;
+    r->overdub = x->overdub;
+    r->combine = x->combine;
+    r->antialias = x->antialias;
+    r->splat = x->splat;
+    r->saut = x->saut;
+    r->long_fondu = x->long_fondu;
+    r->boucle_debut = x->boucle_debut;
+    r->boucle_fin = x->boucle_fin;
+    r->seuil = x->seuil;
+    r->tab = tab;
+    r->frames = frames;
+    r->nc = nc;
+    r->chan = chan;
+    r->nvals = nvals;
+    r->valeurs = inval;
+    r->indices = inind;
+    r->n = n;
+    r->region_etendue = ipoke_core_bornes(x, frames, &r->region_debut);
+
+    if (segments > n / IPOKE_CORE_BLOC)                                                 // not shorter than a block, the replay would cost more than they save
+        segments = n / IPOKE_CORE_BLOC;
+    if (segments < 1)
+        segments = 1;
+    r->nb_segments = segments;
+    r->bornes = (long *)malloc((segments + 1) * sizeof(long));
+    r->groupes = (long *)malloc(segments * sizeof(long));
+    r->faits = (volatile long *)calloc(segments * nvals, sizeof(long));
+    arcs = (long *)malloc(3 * segments * sizeof(long));
+    if (!r->bornes || !r->groupes || !r->faits || !arcs)
+    {
+        free(arcs);
+        ipoke_core_render_free(r);
+        return 0;
+    }
+    parents = arcs + 2 * segments;
+
+    for (s = 0; s <= segments; s++)
+        r->bornes[s] = (long)((double)n * s / segments);
+    for (s = 0; s < segments; s++)
+    {
+        arcs[2 * s + 1] = ipoke_core_rendu_arc(r, r->bornes[s], r->bornes[s + 1], arcs + 2 * s);
+        parents[s] = s;
+    }
+
+    // the segments writing over each other go in the same group, under the first of them
+    for (s = 0; s < segments; s++)
+        for (t = s + 1; t < segments; t++)
+            if (ipoke_core_chevauche(arcs[2 * s], arcs[2 * s + 1], arcs[2 * t], arcs[2 * t + 1], r->region_etendue))
+            {
+                i = ipoke_core_racine(parents, s);
+                j = ipoke_core_racine(parents, t);
+                if (i < j)
+                    parents[j] = i;
+                else if (j < i)
+                    parents[i] = j;
+            }
+    for (s = 0; s < segments; s++)
+    {
+        i = ipoke_core_racine(parents, s);
+        r->groupes[s] = (i == s) ? r->nb_groupes++ : r->groupes[i];
+    }
+    free(arcs);
+
+    r->nb_parts = r->nb_groupes * nvals;
+    return r->nb_parts;
+}
+
+// replays the inputs of the channel c before a in a scratch area, so that x is left as a single write would leave it at a:
+// from the last stop, or far enough for the averaging, the curves and the filters to forget where they started,
+// within IPOKE_CORE_AMORCE_MAX inputs and frames. Their positions are kept unwrapped, and the ones left in x moved back to the region
+static void ipoke_core_amorce(const t_ipoke_rendu *r, t_ipoke_core *x, long c, long a, double *positions, float *brouillon)
+{
+    long frames = r->region_etendue, demivie = (long)(frames * 0.5);
+    long marge = 2 + r->long_fondu;
+    long m, k, index, suivant = 0, ancre = 0, pas, u = 0, bas = 0, haut = 0, changes = 0, decalage, tampon;
+    double f;
+
+    ipoke_core_reset(x);
+    x->boucle_debut = x->boucle_fin = 0;                                                // the scratch area is a buffer of its own
+    x->region_debut = x->region_etendue = 0;
+
+    for (m = 0; m < a && m < IPOKE_CORE_AMORCE_MAX && (m < IPOKE_CORE_AMORCE || changes <= IPOKE_CORE_HISTORY); m++)
+    {
+        k = a - 1 - m;
+        if (r->indices[k] < 0.)                                                         // the writing starts again after a stop
+            break;
+        index = ipoke_core_rendu_index(r, r->indices[k], &f);
+        if (m)
+        {
+            pas = ipoke_core_pas(suivant, index, frames, demivie);
+            if (((u - pas < bas) ? haut - (u - pas) : (u - pas) - bas) > IPOKE_CORE_AMORCE_MAX)
+                break;
+            u -= pas;
+            if (u < bas)
+                bas = u;
+            if (u > haut)
+                haut = u;
+            if (pas)
+                changes++;
+        }
+        else
+            ancre = index;
+        suivant = index;
+        positions[m] = u + f;
+    }
+    if (!m)
+        return;
+
+    for (k = 0; k < m; k++)                                                             // in the order of the inputs, from marge in the scratch area
+        positions[k] += marge - bas;
+    for (k = 0; k < m / 2; k++)
+    {
+        f = positions[k];
+        positions[k] = positions[m - 1 - k];
+        positions[m - 1 - k] = f;
+    }
+    tampon = 2 * (haut - bas + 2 * marge + 1);                                         // twice the span, so every step goes the same way round as in the region
+    ipoke_core_write(x, brouillon, tampon, 1, 0, r->valeurs[c] + a - m, positions, m);
+
+    decalage = ancre - (marge - bas);
+    if (x->index_precedent >= 0)
+        x->index_precedent = wrap_index(x->index_precedent + decalage, frames);
+    x->splat_index[0] = wrap_index(x->splat_index[0] + decalage, frames);
+    x->splat_index[1] = wrap_index(x->splat_index[1] + decalage, frames);
+    x->position_precedente = wrap_position(x->position_precedente + decalage, frames);
+    x->modif_etendue = 0;
+}
+
+// what a block is written in: the buffer, taken from the host if it gives it a block at a time
+static float *ipoke_core_rendu_prend(t_ipoke_rendu *r)
+{
+    float *tab;
+
+    if (!r->prend)
+        return r->tab;
+    if (!(tab = r->prend(r->hote)))
+        r->arret = 1;                                                                   // gone or changed: all the parts stop
+    return tab;
+}
+
+static void ipoke_core_rendu_lache(t_ipoke_rendu *r)
+{
+    if (r->prend)
+        r->lache(r->hote);
+}
+
+long ipoke_core_render_part(t_ipoke_rendu *r, long part)
+{
+    static const double arret = -1., zero = 0.;
+    long c = part % r->nvals, groupe = part / r->nvals;
+    long s, a, b, k, len, fin = -1;
+    unsigned int mode;
+    float *tab;
+    t_ipoke_core *x = (t_ipoke_core *)malloc(sizeof(t_ipoke_core));
+    double *positions = (double *)malloc(IPOKE_CORE_AMORCE_MAX * sizeof(double));
+    float *brouillon = (float *)calloc(2 * (IPOKE_CORE_AMORCE_MAX + 2 * (2 + IPOKE_CORE_FONDU) + 1), sizeof(float));
+
+    if (!x || !positions || !brouillon)
+    {
+        free(x);
+        free(positions);
+        free(brouillon);
+        return 0;
+    }
+    ipoke_core_init(x);
+    x->interp = r->interp;
+    x->overdub = r->overdub;
+    x->combine = r->combine;
+    x->antialias = r->antialias;
+    x->splat = r->splat;
+    x->saut = r->saut;
+    x->seuil = r->seuil;
+    ipoke_core_set_fondu(x, r->long_fondu);
+    mode = ipoke_fill_flush_denormals();
+
+    for (s = 0; s < r->nb_segments && !r->arret; s++)
+    {
+        if (r->groupes[s] != groupe)
+            continue;
+        a = r->bornes[s];
+        b = r->bornes[s + 1];
+        if (a != fin)                                                                   // not following the previous segment of the group
+            ipoke_core_amorce(r, x, c, a, positions, brouillon);
+        x->boucle_debut = r->boucle_debut;
+        x->boucle_fin = r->boucle_fin;
+        x->region_debut = r->region_debut;                                              // already in place, so the writing goes on
+        x->region_etendue = r->region_etendue;
+        for (k = a; k < b && !r->arret; k += len)
+        {
+            len = (b - k < IPOKE_CORE_BLOC) ? b - k : IPOKE_CORE_BLOC;
+            if (!(tab = ipoke_core_rendu_prend(r)))
+                break;
+            ipoke_core_write(x, tab, r->frames, r->nc, r->chan + c, r->valeurs[c] + k, r->indices + k, len);
+            ipoke_core_rendu_lache(r);
+            r->faits[part] += len;
+        }
+        if (b == r->n && !r->arret && (tab = ipoke_core_rendu_prend(r)))               // the last pending frame
+        {
+            ipoke_core_write(x, tab, r->frames, r->nc, r->chan + c, &zero, &arret, 1);
+            ipoke_core_rendu_lache(r);
+        }
+        fin = b;
+    }
+
+    ipoke_fill_restore_denormals(mode);
+    ipoke_core_free(x);
+    free(x);
+    free(positions);
+    free(brouillon);
+    return 1;
+}
+
+double ipoke_core_render_progress(const t_ipoke_rendu *r)
+{
+    double faits = 0.;
+    long p;
+
+    if (!r->nb_parts)
+        return 1.;
+    for (p = 0; p < r->nb_parts; p++)
+        faits += r->faits[p];
+    return faits / ((double)r->n * r->nvals);
+}
+
+void ipoke_core_render_free(t_ipoke_rendu *r)
+{
+    free(r->bornes);
+    free(r->groupes);
+    free((void *)r->faits);
+    r->bornes = r->groupes = NULL;
+    r->faits = NULL;
+    r->nb_segments = r->nb_groupes = r->nb_parts = 0;
+}
+
+//***********************************************************************************************
+// statistics
+
+unsigned long long ipoke_core_ticks(void)
+{
+#if defined(IPOKE_TICKS)
+    return IPOKE_TICKS();
+#elif defined(__aarch64__) && defined(__GNUC__)
+    unsigned long long ticks;
+
+    __asm__ __volatile__("mrs %0, cntvct_el0" : "=r"(ticks));
+    return ticks;
+#else
+    return 0;
+#endif
+}
@@ -0,0 +1,300 @@
+//    ipoke_core - the host-independent write engine of ipoke~
+//    by Pierre Alexandre Tremblay
+//    the interpolating write kernel of ipoke~, working on a plain interleaved float array so it can be
+//    profiled and regression-tested outside of Max (see bench/ipoke_bench.c)
+
+#ifndef IPOKE_CORE_H
+#define IPOKE_CORE_H
+
+#include "ipoke_fill.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// gap filling modes
+#define IPOKE_INTERP_HOLD 0                 // the last value is held
+#define IPOKE_INTERP_LINEAR 1               // linear ramp to the new value
+#define IPOKE_INTERP_CUBIC 2                // cubic Hermite, tangents from the previous written point
+#define IPOKE_INTERP_SINC 3                 // windowed sinc through the previous written points
+
+#define IPOKE_CORE_HISTORY 4                // written points kept for the higher order modes
+
+// fractional splatting modes
+#define IPOKE_SPLAT_OFF 0                   // the index is truncated
+#define IPOKE_SPLAT_LINEAR 1                // each input is spread on its neighbouring frames with linear weights
+#define IPOKE_SPLAT_CUBIC 2                 // same with smoother cubic weights when writing slower than real time
+
+// write modes: how a written frame is combined with what the buffer held
+#define IPOKE_COMBINE_OVERDUB 0             // old * overdub + new, so replacing while overdub is 0 (the default)
+#define IPOKE_COMBINE_REPLACE 1             // new, whatever overdub is
+#define IPOKE_COMBINE_ADD 2                 // old + new
+#define IPOKE_COMBINE_XFADE 3               // equal power crossfade, overdub from 0 (new) to 1 (old): old * sin(overdub pi/2) + new * cos(overdub pi/2)
+#define IPOKE_COMBINE_MAX 4                 // the larger magnitude of the two
+#define IPOKE_COMBINE_SOFTSAT 5             // old + new through a soft saturation, so that repeated overdubs never clip
+
+// the units of the index signal, negative values stopping the writing in the first three
+#define IPOKE_UNITS_SAMPLES 0               // frames of the buffer (the default)
+#define IPOKE_UNITS_PHASE 1                 // from 0 to 1 over the loop region
+#define IPOKE_UNITS_MS 2                    // ms at the sample rate of the buffer
+#define IPOKE_UNITS_RATE 3                  // frames per input: the speed of a write position kept in 64-bit fixed point, set by ipoke_core_seek
+
+#define IPOKE_CORE_BROUILLON 256            // frames filled at once in a scratch area before being combined in the last three
+
+#define IPOKE_CORE_RESTES 8                 // gap fills carried over to the next vectors at most
+#define IPOKE_CORE_RESTE (2 + IPOKE_SINC_TAPS)  // doubles per channel of one carried fill: value, ramp scratch, curve
+
+#define IPOKE_CORE_FONDU 1024                // longest crossfade at the ends of a jump, in frames
+
+#define IPOKE_STATS_CLASSES 16             // gap lengths counted by number of bits: 1, 2, 3-4, 5-8... up to more than 16384
+
+// running counters of the write, only ever increased by the audio thread, so they can be read from any other one
+typedef struct _ipoke_stats
+{
+    unsigned long long echantillons;        // input samples written (with an index >= 0)
+    unsigned long long remplies;            // frames filled in the gaps
+    unsigned long long pas[IPOKE_STATS_CLASSES];    // steps of the index, by length
+    unsigned long long tours;               // steps filled across the end of the buffer
+    unsigned long long moyennes;            // indices written with the average of several inputs
+    unsigned long long sauts;               // steps over the jump threshold, left unfilled
+    unsigned long long appels;              // timed calls, counted by the host
+    unsigned long long ticks;               // ipoke_core_ticks spent in them
+    unsigned long long ticks_max;           // the longest one
+} t_ipoke_stats;
+
+// what is left of a gap fill that did not fit in the budget of its vector
+typedef struct _ipoke_reste
+{
+    long index;                             // the written point the gap starts from
+    long pas;                               // the signed step of the gap
+    long debut;                             // the steps from index still to fill, the nearest first: done when debut > fin
+    long fin;
+    char interp;                            // the curve it is filled with
+    double retour;                          // with a signal overdub, the ratios at index and at index + pas, interpolated along it
+    double retour_fin;
+    long nvals;                             // number of channels
+    double *valeurs;                        // the values at index, a scratch row and IPOKE_SINC_TAPS rows of curve, by rows of nvals
+} t_ipoke_reste;
+
+typedef struct _ipoke_core t_ipoke_core;
+
+// a single channel write kernel specialised for the modes, see ipoke_core_select
+// inval and inind point to doubles or to floats depending on the specialisation
+typedef long (*t_ipoke_core_noyau)(t_ipoke_core *x, float *tab, long frames, long nc, const void *inval, const void *inind, long n);
+
+struct _ipoke_core
+{
+    long index_precedent;                   // last index written, -1 when the writing is stopped
+    long nb_val;                            // number of values accumulated at index_precedent
+    double valeur;                          // accumulated value at index_precedent
+    char interp;                            // one of the IPOKE_INTERP modes
+    double overdub;                         // overdub ratio, 0 = replace
+    char combine;                           // one of the IPOKE_COMBINE modes
+    const double *retours;                  // per input overdub ratios of the next write, NULL to use overdub instead
+    double retour;                          // the last of them, where the next gap starts from
+    double histoire[IPOKE_CORE_HISTORY];    // last written points, the most recent last
+    long nb_hist;                           // 0 when the history has to restart from the next written point
+    long pas_precedent;                     // length of the previous gap, to scale the cubic tangents
+    char antialias;                         // low-pass the input instead of averaging it when writing slower than real time
+    double periode;                         // measured number of input samples per index step
+    double passe[2 * IPOKE_DECIM_TAPS];     // last inputs, twice so the last IPOKE_DECIM_TAPS are contiguous from pos_passe
+    long pos_passe;                         // -1 when the inputs have to restart from the next one
+    char splat;                             // one of the IPOKE_SPLAT modes
+    double position_precedente;             // last fractional index written in splat mode
+    long splat_index[2];                    // the two frames around the last input, still accumulating
+    double splat_poids[2];                  // their summed weights
+    double cumul[2];                        // their weighted sums
+    long nvals;                             // number of channels written by ipoke_core_write_multi
+    double *valeurs;                        // accumulated value per channel
+    double *coeffs;                         // per channel interpolation coefficient
+    double *bases;                          // per channel ramp start
+    double *histoires;                      // per channel history, by rows of nvals
+    double *points;                         // per channel cubic coefficients or sinc points, by rows of nvals
+    double *passes;                         // per channel last inputs, by rows of nvals
+    double *cumuls;                         // per channel weighted sums of the splat frames, by rows of nvals
+    float brouillon[IPOKE_CORE_BROUILLON];  // scratch area of the non-linear combine modes
+    float *brouillons;                      // the same for nvals channels, by frames
+    t_ipoke_core_noyau noyau;               // the single channel kernel of the current modes, for double inputs
+    t_ipoke_core_noyau noyau_float;         // same for float inputs
+    long choix;                             // the modes they were selected for, 0 before the first selection
+    long modif_debut;                       // first frame of the arc written since the last ipoke_core_modif
+    long modif_etendue;                     // its length, 0 if nothing was written
+    long saut;                              // steps longer than this are jumps, crossfaded instead of filled, 0 for none
+    long sens;                              // direction of the last step, 1 or -1
+    long long_fondu;                        // length of the crossfades
+    double fondu[IPOKE_CORE_FONDU];         // their decaying half raised cosine, from the frame next to the jump
+    long budget;                            // most frames filled in the gaps per write call, 0 for no limit
+    t_ipoke_reste restes[IPOKE_CORE_RESTES];    // the fills carried over, oldest first from premier_reste
+    long premier_reste;
+    long nb_restes;
+    double reste_simple[IPOKE_CORE_RESTES][IPOKE_CORE_RESTE];   // their values and curves when writing one channel
+    double *restes_multi;                   // the same for nvals channels, IPOKE_CORE_RESTES blocks of IPOKE_CORE_RESTE rows
+    char compter;                           // update stats, off by default
+    t_ipoke_stats stats;                    // zeroed by ipoke_core_init only
+    float *journal;                         // staging area of the frames written by one vector, see ipoke_core_stage_in
+    double *journal_index;                  // the indices of that vector, relative to journal_debut
+    long taille_journal;                    // frames the staging area can hold, 0 without one
+    long nchans_journal;                    // channels it can hold
+    long vecteur_journal;                   // longest vector it can take
+    long journal_debut;                     // first frame of the staged arc in the buffer
+    long journal_etendue;                   // its length, 0 when nothing is staged
+    long boucle_debut;                      // the loop region asked for: frames from boucle_debut up to boucle_fin excluded,
+    long boucle_fin;                        // boucle_fin 0 for up to the end of the buffer
+    long region_debut;                      // the one in use, set at the next write: the kernels see it as a buffer of its own
+    long region_etendue;
+    long frames_tampon;                     // the frames of the whole buffer
+    long origine;                           // taken from the indices before they are wrapped in the region, 0 while staged
+    double seuil;                           // when overdubbing, the frames written that decayed under this are snapped to zero, 0 for never
+    float *cible;                           // what the current write call writes in, to snap them as they are marked, NULL for no snapping
+    long cible_nc;
+    long cible_nvals;
+    long cible_frames;
+    char unites;                            // one of the IPOKE_UNITS the index signal is in, see ipoke_core_positions
+    double frames_ms;                       // frames per ms of the buffer, for IPOKE_UNITS_MS
+    long long tete;                         // the write position of IPOKE_UNITS_RATE, in 1/2^32 frames of the buffer
+    char marche;                            // it writes: from the last seek to a positive position, the default
+    volatile long long cale;                // the position of the last ipoke_core_seek, as the bits of a double so it is exchanged whole
+    volatile long calage;                   // counts them, so that the next vector takes the last one: bumped after cale is stored
+    long calage_vu;
+    double *positions;                      // the indices computed from the other units
+    long vecteur_positions;                 // the longest vector they can take
+};
+
+// the buffer of an offline rendering taken for one block by a thread writing it, NULL if it is gone or changed: see ipoke_core_render
+typedef float *(*t_ipoke_core_prend)(void *hote);
+typedef void (*t_ipoke_core_lache)(void *hote);
+
+// an offline rendering of a whole trajectory, split in parts that can be written at the same time, see ipoke_core_render
+typedef struct _ipoke_rendu
+{
+    char interp;                            // the modes of the object it was started from
+    double overdub;
+    char combine;
+    char antialias;
+    char splat;
+    long saut;
+    long long_fondu;
+    long boucle_debut;
+    long boucle_fin;
+    double seuil;
+    float *tab;                             // the buffer written, frames * nc interleaved floats, from its channel chan
+    long frames;
+    long nc;
+    long chan;
+    long nvals;                             // number of channels written
+    const double * const *valeurs;          // their n values
+    const double *indices;                  // and the n indices
+    long n;
+    long region_debut;                      // the loop region they are wrapped in
+    long region_etendue;
+    long nb_segments;                       // the trajectory is cut in segments of inputs, from bornes[s] to bornes[s + 1]
+    long *bornes;
+    long *groupes;                          // the group of each segment: the segments of a group write over each other, so are written in turn
+    long nb_groupes;
+    long nb_parts;                          // one per group and channel
+    volatile long *faits;                   // the inputs each part has written so far
+    volatile char arret;                    // set to stop the parts at their next block
+    t_ipoke_core_prend prend;               // NULL to write tab as it is, else what each block writes in, given back with lache
+    t_ipoke_core_lache lache;
+    void *hote;                             // passed to both
+} t_ipoke_rendu;
+
+void ipoke_core_init(t_ipoke_core *x);
+void ipoke_core_reset(t_ipoke_core *x);
+void ipoke_core_free(t_ipoke_core *x);
+
+// allocates the per-channel state of the multichannel mode (not to be called from the audio thread)
+// returns 0 if it could not be allocated
+long ipoke_core_set_nvals(t_ipoke_core *x, long nvals);
+
+// sets the length of the crossfades at the ends of a jump, up to IPOKE_CORE_FONDU frames (not from the audio thread)
+void ipoke_core_set_fondu(t_ipoke_core *x, long len);
+
+// retours, when set, gives the overdub ratio of each of the n inputs of the next write calls in place of overdub: the frames in the gaps
+// get it interpolated between the two inputs around them. It is read as doubles, also by ipoke_core_write_float, and only in IPOKE_COMBINE_OVERDUB
+
+// picks the single channel kernels specialised for the current combine mode, overdub (off, on or per input) and interp and for a buffer of nc channels,
+// without the tests of the low-pass, counting, jumps, budget and loop offset while none of them is on
+// to be called again when they change: the write functions also check it once per vector, so a missed call only costs that check
+void ipoke_core_select(t_ipoke_core *x, long nc);
+
+// writes n values at the n given indices in the channel chan of tab (frames * nc interleaved floats)
+// the indices are buffer frames, wrapped in the loop region set by boucle_debut and boucle_fin, which also bounds the fills and the way round;
+// moving it restarts the writing from the next index
+// returns non-zero if anything was written in tab
+long ipoke_core_write(t_ipoke_core *x, float *tab, long frames, long nc, long chan, const double *inval, const double *inind, long n);
+long ipoke_core_write_float(t_ipoke_core *x, float *tab, long frames, long nc, long chan, const float *inval, const float *inind, long n);
+
+// multichannel: writes the n values of each of the nvals inputs in the channels chan to chan + nvals - 1, at the same n indices
+// the step and gap logic is done once per index and each frame of the channels is written in one go
+// nvals is at most the one given to ipoke_core_set_nvals
+long ipoke_core_write_multi(t_ipoke_core *x, float *tab, long frames, long nc, long chan, const double * const *inval, long nvals, const double *inind, long n);
+
+// the frames written since the last call, as etendue frames from debut round the buffer: returns etendue, 0 if nothing was written
+// the wrapping arc covering everything written, so it may hold a few frames that were not
+long ipoke_core_modif(t_ipoke_core *x, long *debut);
+
+// several heads writing the same buffer: each has its own state, and follows the modes of the first one
+// gives x the modes of modele, restarting it where a change of mode restarted modele: once per vector, before writing with x
+void ipoke_core_follow(t_ipoke_core *x, const t_ipoke_core *modele);
+// adds the frames tete wrote and what it counted to x, so that the host reports all the heads as one: after writing with tete
+void ipoke_core_join(t_ipoke_core *x, t_ipoke_core *tete);
+
+// a timestamp for the stats: the cycle counter on x86, the virtual counter on arm64, 0 elsewhere
+unsigned long long ipoke_core_ticks(void);
+
+// staged writing: the frames a vector writes are copied out of the buffer, written in the staging area and copied back,
+// so a host only has to hold its buffer lock for the two copies instead of the whole write
+//   n = ipoke_core_stage_in(x, tab, frames, nc, chan, nchans, inind, n)   // copies the frames the vector will write, 0 if it has to be written in place
+//   dirty = ipoke_core_write(x, x->journal, frames, nchans, 0, inval, x->journal_index, n)   // or write_multi, without the lock
+//   ipoke_core_stage_out(x, tab, frames, nc, chan, nchans, dirty)         // copies them back
+// the host calls ipoke_core_reset instead of ipoke_core_stage_out if the buffer changed in between
+// allocates room for taille frames of nchans channels and vectors of up to vecteur samples, or frees it if vecteur is 0 (not from the audio thread)
+// taille 0 only keeps the room for the indices, which is what ipoke_core_stage_arc needs
+long ipoke_core_set_journal(t_ipoke_core *x, long taille, long nchans, long vecteur);
+long ipoke_core_stage_in(t_ipoke_core *x, const float *tab, long frames, long nc, long chan, long nchans, const double *inind, long n);
+long ipoke_core_stage_out(t_ipoke_core *x, float *tab, long frames, long nc, long chan, long nchans, long dirty_flag);
+// the same without the copies, for a host writing the arc where it lies (see ipoke_disk.c): returns its length, up to taille frames,
+// and its first frame in the region in debut, 0 if it cannot be staged. While it is staged the write functions take the indices
+// of x->journal_index and write the arc from the tab they are given; ipoke_core_stage_end then puts the state back in the region
+long ipoke_core_stage_arc(t_ipoke_core *x, long frames, long taille, const double *inind, long n, long *debut);
+void ipoke_core_stage_end(t_ipoke_core *x);
+
+// the index signal in the units of x->unites: returns the n buffer frames to write at, inind itself in IPOKE_UNITS_SAMPLES or without
+// the room of ipoke_core_set_positions, which the float version needs. From the audio thread, once per vector, before the write functions
+// and with the frames they are given; n is at most the vecteur of ipoke_core_set_positions
+const double *ipoke_core_positions(t_ipoke_core *x, long frames, const double *inind, long n);
+const double *ipoke_core_positions_float(t_ipoke_core *x, long frames, const float *inind, long n);
+// room for vectors of up to vecteur indices, or none with 0 (not from the audio thread): returns 0 if it could not be allocated
+long ipoke_core_set_positions(t_ipoke_core *x, long vecteur);
+// moves the write position of IPOKE_UNITS_RATE to a buffer frame, wrapped in the loop region, or stops it when negative. From any thread:
+// the next vector takes it
+void ipoke_core_seek(t_ipoke_core *x, double position);
+
+// the frames the next write of the n indices may change, for a host saving them beforehand: calls visite(data, debut, etendue)
+// for each run of them, in frames of the whole buffer, without changing x. Generous by the splat frames and the jump crossfades
+typedef void (*t_ipoke_core_visite)(void *data, long debut, long etendue);
+void ipoke_core_portee(const t_ipoke_core *x, long frames, const double *inind, long n, t_ipoke_core_visite visite, void *data);
+
+// offline rendering: the whole n inputs of each of nvals channels written at once, as the write functions would, outside of the audio thread
+//   parts = ipoke_core_render(r, x, tab, frames, nc, chan, inval, nvals, inind, n, segments)   // takes the modes of x, 0 if it could not be allocated
+//   ipoke_core_render_part(r, part)      // for each part from 0 to parts - 1, in any order, from as many threads as wanted
+//   ipoke_core_render_free(r)            // once they are all done
+// the trajectory is cut in about segments segments; the ones writing over different frames, and the channels, are different parts.
+// each segment starts from the state the inputs before it leave, replayed in a scratch area, so the result is the one of a single write
+// but for the anti-aliasing filter, which may differ slightly around the cuts. inval and inind must stay until the parts are done, and tab too
+// unless the host sets r->prend, r->lache and r->hote before the parts start: each block is then written in what prend returns,
+// frames * nc floats as tab was, between prend and lache, and the rendering stops at the first NULL
+long ipoke_core_render(t_ipoke_rendu *r, const t_ipoke_core *x, float *tab, long frames, long nc, long chan, const double * const *inval, long nvals,
+                       const double *inind, long n, long segments);
+// returns 0 if its scratch area could not be allocated, in which case nothing was written
+long ipoke_core_render_part(t_ipoke_rendu *r, long part);
+// the share of the inputs written so far, from any thread
+double ipoke_core_render_progress(const t_ipoke_rendu *r);
+void ipoke_core_render_free(t_ipoke_rendu *r);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
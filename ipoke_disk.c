@@ -0,0 +1,532 @@
+//    ipoke_disk - a sound file as the write target of ipoke~
+//    by Pierre Alexandre Tremblay
+//    the audio thread and the service thread only share the states of the windows and a few longs: the audio thread says which
+//    windows it writes in (courants) before checking that they are still mapped, the service marks a window as going before checking
+//    that it is not being written, with a full barrier in between on both sides, so neither ever waits for the other but the
+//    service, for the length of one vector at most
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE                                         // fallocate
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "ipoke_disk.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#define ipoke_disk_barriere() MemoryBarrier()
+#define ipoke_disk_cede() SwitchToThread()
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define ipoke_disk_barriere() __sync_synchronize()
+#define ipoke_disk_cede() sched_yield()
+#endif
+
+#define IPOKE_DISK_ENTETE 44                                // the header written for a new file
+#define IPOKE_DISK_PAGE 4096                                // the read ahead touches one float every so many bytes
+
+//***********************************************************************************************
+// the file
+
+#ifdef _WIN32
+#define IPOKE_DISK_FERME(d) ((d)->fichier == NULL)
+#else
+#define IPOKE_DISK_FERME(d) ((d)->fichier < 0)
+#endif
+
+static long ipoke_disk_lit(t_ipoke_disk *d, unsigned long long position, void *dst, long len)
+{
+#ifdef _WIN32
+    OVERLAPPED o = { 0 };
+    DWORD lus = 0;
+
+    o.Offset = (DWORD)position;
+    o.OffsetHigh = (DWORD)(position >> 32);
+    return ReadFile((HANDLE)d->fichier, dst, (DWORD)len, &lus, &o) && (long)lus == len;
+#else
+    return pread(d->fichier, dst, len, (off_t)position) == len;
+#endif
+}
+
+static long ipoke_disk_ecrit(t_ipoke_disk *d, unsigned long long position, const void *src, long len)
+{
+#ifdef _WIN32
+    OVERLAPPED o = { 0 };
+    DWORD ecrits = 0;
+
+    o.Offset = (DWORD)position;
+    o.OffsetHigh = (DWORD)(position >> 32);
+    return WriteFile((HANDLE)d->fichier, src, (DWORD)len, &ecrits, &o) && (long)ecrits == len;
+#else
+    return pwrite(d->fichier, src, len, (off_t)position) == len;
+#endif
+}
+
+static unsigned long long ipoke_disk_longueur(t_ipoke_disk *d)
+{
+#ifdef _WIN32
+    LARGE_INTEGER l;
+
+    return GetFileSizeEx((HANDLE)d->fichier, &l) ? (unsigned long long)l.QuadPart : 0;
+#else
+    struct stat s;
+
+    return fstat(d->fichier, &s) ? 0 : (unsigned long long)s.st_size;
+#endif
+}
+
+// sets the length of the file, with its room allocated where the system allows it
+static long ipoke_disk_alloue(t_ipoke_disk *d, unsigned long long longueur)
+{
+#ifdef _WIN32
+    LARGE_INTEGER l;
+
+    l.QuadPart = (LONGLONG)longueur;
+    return SetFilePointerEx((HANDLE)d->fichier, l, NULL, FILE_BEGIN) && SetEndOfFile((HANDLE)d->fichier);
+#else
+#if defined(__APPLE__)
+    fstore_t f = { F_ALLOCATEALL, F_PEOFPOSMODE, 0, (off_t)longueur, 0 };
+
+    fcntl(d->fichier, F_PREALLOCATE, &f);                   // best effort, the file is sparse otherwise
+#elif defined(__linux__)
+    if (!fallocate(d->fichier, 0, 0, (off_t)longueur))
+        return 1;
+#endif
+    return !ftruncate(d->fichier, (off_t)longueur);
+#endif
+}
+
+static unsigned long ipoke_disk_mot(const unsigned char *p, long octets)
+{
+    unsigned long v = 0;
+
+    while (octets--)
+        v = (v << 8) | p[octets];
+    return v;
+}
+
+static void ipoke_disk_pose(unsigned char *p, unsigned long v, long octets)
+{
+    while (octets--)
+    {
+        *p++ = (unsigned char)(v & 0xFF);
+        v >>= 8;
+    }
+}
+
+// a new file: the canonical 44 byte header, the sizes saturating past 4 GB as most readers then read up to the end of the file
+static long ipoke_disk_cree(t_ipoke_disk *d, long frames, long nc, double sr)
+{
+    unsigned char h[IPOKE_DISK_ENTETE];
+    unsigned long long donnees = (unsigned long long)frames * nc * sizeof(float);
+    unsigned long taille = (donnees + 36 > 0xFFFFFFFFULL) ? 0xFFFFFFFFUL : (unsigned long)(donnees + 36);
+
+    memcpy(h, "RIFF", 4);
+    ipoke_disk_pose(h + 4, taille, 4);
+    memcpy(h + 8, "WAVEfmt ", 8);
+    ipoke_disk_pose(h + 16, 16, 4);
+    ipoke_disk_pose(h + 20, 3, 2);                          // WAVE_FORMAT_IEEE_FLOAT
+    ipoke_disk_pose(h + 22, nc, 2);
+    ipoke_disk_pose(h + 24, (unsigned long)sr, 4);
+    ipoke_disk_pose(h + 28, (unsigned long)sr * nc * sizeof(float), 4);
+    ipoke_disk_pose(h + 32, nc * sizeof(float), 2);
+    ipoke_disk_pose(h + 34, 32, 2);
+    memcpy(h + 36, "data", 4);
+    ipoke_disk_pose(h + 40, (taille == 0xFFFFFFFFUL) ? taille : (unsigned long)donnees, 4);
+
+    if (!ipoke_disk_alloue(d, IPOKE_DISK_ENTETE + donnees) || !ipoke_disk_ecrit(d, 0, h, IPOKE_DISK_ENTETE))
+        return 0;
+    d->entete = IPOKE_DISK_ENTETE;
+    d->frames = frames;
+    d->nc = nc;
+    d->sr = sr;
+    return 1;
+}
+
+// an existing file: its fmt chunk has to be 32-bit float, and its data chunk gives the frames
+static long ipoke_disk_lit_entete(t_ipoke_disk *d)
+{
+    unsigned char h[40];
+    unsigned long long position = 12, longueur = ipoke_disk_longueur(d), taille;
+    long format = 0, bits = 0;
+
+    if (!ipoke_disk_lit(d, 0, h, 12) || memcmp(h, "RIFF", 4) || memcmp(h + 8, "WAVE", 4))
+        return 0;
+    while (position + 8 <= longueur)
+    {
+        if (!ipoke_disk_lit(d, position, h, 8))
+            return 0;
+        taille = ipoke_disk_mot(h + 4, 4);
+        if (!memcmp(h, "fmt ", 4))
+        {
+            if (taille < 16 || !ipoke_disk_lit(d, position + 8, h, (taille < 40) ? (long)taille : 40))
+                return 0;
+            format = ipoke_disk_mot(h, 2);
+            if (format == 0xFFFE && taille >= 26)           // WAVE_FORMAT_EXTENSIBLE: the format is the start of the sub-format
+                format = ipoke_disk_mot(h + 24, 2);
+            d->nc = ipoke_disk_mot(h + 2, 2);
+            d->sr = (double)ipoke_disk_mot(h + 4, 4);
+            bits = ipoke_disk_mot(h + 14, 2);
+        }
+        else if (!memcmp(h, "data", 4))
+        {
+            if (format != 3 || bits != 32 || d->nc < 1)
+                return 0;
+            d->entete = position + 8;
+            if (taille == 0xFFFFFFFFULL || d->entete + taille > longueur)
+                taille = longueur - d->entete;
+            d->frames = (long)(taille / (d->nc * sizeof(float)));
+            return d->frames > 1;
+        }
+        position += 8 + taille + (taille & 1);
+    }
+    return 0;
+}
+
+long ipoke_disk_open(t_ipoke_disk *d, const char *chemin, long frames, long nc, double sr)
+{
+    long i, ok;
+
+    memset(d, 0, sizeof(t_ipoke_disk));
+    for (i = 0; i < IPOKE_DISK_FENETRES; i++)
+        d->fenetres[i].bloc = -1;
+    d->voulu = d->suivant = -1;
+    d->sens = 1;
+#ifdef _WIN32
+    {
+        SYSTEM_INFO s;
+
+        GetSystemInfo(&s);
+        d->granularite = s.dwAllocationGranularity;
+    }
+    d->fichier = CreateFileA(chemin, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, (frames > 0) ? CREATE_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (d->fichier == INVALID_HANDLE_VALUE)
+        d->fichier = NULL;
+#else
+    d->granularite = (unsigned long long)sysconf(_SC_PAGESIZE);
+    d->fichier = open(chemin, (frames > 0) ? (O_RDWR | O_CREAT | O_TRUNC) : O_RDWR, 0644);
+#endif
+    if (IPOKE_DISK_FERME(d))
+        return 0;
+
+    ok = (frames > 0) ? (nc > 0 && frames > 1 && sr > 0. && ipoke_disk_cree(d, frames, nc, sr)) : ipoke_disk_lit_entete(d);
+#ifdef _WIN32
+    if (ok)
+    {
+        d->projection = CreateFileMappingA((HANDLE)d->fichier, NULL, PAGE_READWRITE, 0, 0, NULL);
+        ok = (d->projection != NULL);
+    }
+#endif
+    if (!ok)
+    {
+        ipoke_disk_close(d);
+        return 0;
+    }
+    d->nb_blocs = (d->frames + IPOKE_DISK_BLOC - 1) / IPOKE_DISK_BLOC;
+    d->pli = (float *)malloc(IPOKE_DISK_BLOC * d->nc * sizeof(float));
+    if (!d->pli)
+    {
+        ipoke_disk_close(d);
+        return 0;
+    }
+    return 1;
+}
+
+//***********************************************************************************************
+// the windows, from the service thread
+
+// writes the pages of a window to the file, waiting for it or not
+static void ipoke_disk_vide(t_ipoke_fenetre *f, long attendre)
+{
+#ifdef _WIN32
+    FlushViewOfFile(f->carte, (SIZE_T)f->taille_carte);     // starts the writes and returns
+    (void)attendre;
+#else
+    msync(f->carte, (size_t)f->taille_carte, attendre ? MS_SYNC : MS_ASYNC);
+#endif
+}
+
+// maps the window of two blocks from bloc and reads it ahead, so that the audio thread does not fault on it
+static void ipoke_disk_projette(t_ipoke_disk *d, t_ipoke_fenetre *f, long bloc)
+{
+    long debut = bloc * IPOKE_DISK_BLOC;
+    long fin = (debut + 2 * IPOKE_DISK_BLOC < d->frames) ? debut + 2 * IPOKE_DISK_BLOC : d->frames;
+    unsigned long long octets = d->entete + (unsigned long long)debut * d->nc * sizeof(float);
+    unsigned long long aligne = octets - octets % d->granularite;
+    unsigned long long taille = (unsigned long long)(fin - debut) * d->nc * sizeof(float) + (octets - aligne);
+    volatile float lu;
+    unsigned long long p;
+    void *carte;
+
+#ifdef _WIN32
+    carte = MapViewOfFile((HANDLE)d->projection, FILE_MAP_WRITE, (DWORD)(aligne >> 32), (DWORD)aligne, (SIZE_T)taille);
+    if (!carte)
+        return;
+#else
+#ifdef MAP_POPULATE
+    carte = mmap(NULL, (size_t)taille, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, d->fichier, (off_t)aligne);
+#else
+    carte = mmap(NULL, (size_t)taille, PROT_READ | PROT_WRITE, MAP_SHARED, d->fichier, (off_t)aligne);
+#endif
+    if (carte == MAP_FAILED)
+        return;
+    madvise(carte, (size_t)taille, MADV_WILLNEED);
+#endif
+    for (p = 0; p < taille; p += IPOKE_DISK_PAGE)
+        lu = *(float *)((char *)carte + p);
+    (void)lu;
+
+    f->carte = carte;
+    f->taille_carte = taille;
+    f->position = aligne;
+    f->base = (float *)((char *)carte + (octets - aligne));
+    f->etendue = fin - debut;
+    f->bloc = bloc;
+    f->sale = 0;
+    ipoke_disk_barriere();                                  // all of the above before the audio thread can see it
+    f->etat = IPOKE_DISK_PRETE;
+}
+
+// takes a window back from the audio thread, then flushes and unmaps it
+static void ipoke_disk_rend(t_ipoke_disk *d, long i)
+{
+    t_ipoke_fenetre *f = d->fenetres + i;
+
+    f->etat = IPOKE_DISK_RENDUE;
+    ipoke_disk_barriere();
+    while (d->courants & (1L << i))                         // it was taken just before: it is let go at the end of the vector
+        ipoke_disk_cede();
+    ipoke_disk_vide(f, 1);
+#ifdef _WIN32
+    UnmapViewOfFile(f->carte);
+#else
+    munmap(f->carte, (size_t)f->taille_carte);
+#ifdef POSIX_FADV_DONTNEED
+    posix_fadvise(d->fichier, (off_t)f->position, (off_t)f->taille_carte, POSIX_FADV_DONTNEED);   // written: the cache can let it go
+#endif
+#endif
+    f->carte = NULL;
+    f->base = NULL;
+    f->bloc = -1;
+    f->etat = IPOKE_DISK_LIBRE;
+}
+
+static long ipoke_disk_cherche(const t_ipoke_disk *d, long bloc)
+{
+    long i;
+
+    for (i = 0; i < IPOKE_DISK_FENETRES; i++)
+        if (d->fenetres[i].etat == IPOKE_DISK_PRETE && d->fenetres[i].bloc == bloc)
+            return i;
+    return -1;
+}
+
+// blocks apart round the file, the way the writing wraps
+static long ipoke_disk_distance(const t_ipoke_disk *d, long a, long b)
+{
+    long e = labs(a - b);
+
+    return (e < d->nb_blocs - e) ? e : d->nb_blocs - e;
+}
+
+// a free window, or the one farthest from the writing but the two wanted, given back
+static long ipoke_disk_place(t_ipoke_disk *d, const long *voulus)
+{
+    long i, e, choix = -1, loin = -1;
+    t_ipoke_fenetre *f;
+
+    for (i = 0; i < IPOKE_DISK_FENETRES; i++)
+    {
+        f = d->fenetres + i;
+        if (f->etat == IPOKE_DISK_LIBRE)
+            return i;
+        if (f->bloc == voulus[0] || f->bloc == voulus[1])
+            continue;
+        e = ipoke_disk_distance(d, f->bloc, voulus[0]);
+        if (e > loin)
+        {
+            loin = e;
+            choix = i;
+        }
+    }
+    if (choix >= 0)
+        ipoke_disk_rend(d, choix);
+    return choix;
+}
+
+void ipoke_disk_service(t_ipoke_disk *d)
+{
+    long voulus[2], i, k;
+    t_ipoke_fenetre *f;
+
+    voulus[0] = d->voulu;
+    voulus[1] = d->suivant;
+    if (voulus[0] >= 0)
+    {
+        for (k = 0; k < 2; k++)
+            if (voulus[k] >= 0 && ipoke_disk_cherche(d, voulus[k]) < 0 && (i = ipoke_disk_place(d, voulus)) >= 0)
+                ipoke_disk_projette(d, d->fenetres + i, voulus[k]);
+    }
+    for (i = 0; i < IPOKE_DISK_FENETRES; i++)              // the windows the writing has left: a page under writeback could stall the audio thread
+    {
+        f = d->fenetres + i;
+        if (f->etat == IPOKE_DISK_PRETE && f->sale && (voulus[0] < f->bloc || voulus[0] > f->bloc + 1))
+        {
+            f->sale = 0;                                    // before the flush, so that what is written meanwhile is flushed next time
+            ipoke_disk_vide(f, 0);
+        }
+    }
+}
+
+void ipoke_disk_close(t_ipoke_disk *d)
+{
+    long i;
+
+    if (IPOKE_DISK_FERME(d))
+        return;
+    for (i = 0; i < IPOKE_DISK_FENETRES; i++)
+        if (d->fenetres[i].etat != IPOKE_DISK_LIBRE)
+            ipoke_disk_rend(d, i);
+#ifdef _WIN32
+    if (d->projection)
+        CloseHandle((HANDLE)d->projection);
+    FlushFileBuffers((HANDLE)d->fichier);
+    CloseHandle((HANDLE)d->fichier);
+    d->projection = NULL;
+    d->fichier = NULL;
+#else
+    fsync(d->fichier);
+    close(d->fichier);
+    d->fichier = -1;
+#endif
+    free(d->pli);
+    d->pli = NULL;
+}
+
+//***********************************************************************************************
+// writing, from the audio thread
+
+// where the writing is, and where it goes next in its direction within the region, for the service to map them
+static void ipoke_disk_demande(t_ipoke_disk *d, const t_ipoke_core *x, long frame)
+{
+    long suivant;
+
+    if (frame > d->dernier)
+        d->sens = 1;
+    else if (frame < d->dernier)
+        d->sens = -1;
+    d->dernier = frame;
+    suivant = frame + d->sens * IPOKE_DISK_BLOC;
+    if (suivant >= x->region_debut + x->region_etendue)
+        suivant = x->region_debut;                          // round the region: its other end
+    else if (suivant < x->region_debut)
+        suivant = x->region_debut + x->region_etendue - 1;
+    d->voulu = frame / IPOKE_DISK_BLOC;
+    d->suivant = suivant / IPOKE_DISK_BLOC;
+}
+
+// a mapped window holding the frames from premier to premier + etendue, taken until ipoke_disk_lache: -1 if there is none
+static long ipoke_disk_prend(t_ipoke_disk *d, long premier, long etendue)
+{
+    t_ipoke_fenetre *f;
+    long i, bloc;
+
+    for (i = 0; i < IPOKE_DISK_FENETRES; i++)
+    {
+        f = d->fenetres + i;
+        bloc = f->bloc;
+        if (f->etat != IPOKE_DISK_PRETE || premier < bloc * IPOKE_DISK_BLOC || premier + etendue > bloc * IPOKE_DISK_BLOC + f->etendue)
+            continue;
+        d->courants |= 1L << i;
+        ipoke_disk_barriere();
+        if (f->etat == IPOKE_DISK_PRETE && f->bloc == bloc)
+            return i;
+        d->courants &= ~(1L << i);                          // taken back in between
+    }
+    return -1;
+}
+
+static void ipoke_disk_lache(t_ipoke_disk *d, long i, long dirty_flag)
+{
+    if (i < 0)
+        return;
+    if (dirty_flag)
+        d->fenetres[i].sale = 1;
+    ipoke_disk_barriere();                                  // the writes done before the window can go
+    d->courants &= ~(1L << i);
+}
+
+// frame premier in window i
+static float *ipoke_disk_frame(t_ipoke_disk *d, long i, long premier)
+{
+    return d->fenetres[i].base + (premier - d->fenetres[i].bloc * IPOKE_DISK_BLOC) * d->nc;
+}
+
+long ipoke_disk_write(t_ipoke_disk *d, t_ipoke_core *x, long chan, const double * const *inval, long nvals, const double *inind, long n)
+{
+    long debut, etendue, premier, a, b = -1, avant = 0, dirty_flag;
+    float *tab;
+
+    etendue = ipoke_core_stage_arc(x, d->frames, IPOKE_DISK_BLOC, inind, n, &debut);
+    if (!etendue)
+    {
+        for (a = n - 1; a >= 0 && inind[a] < 0.; a--)
+            ;
+        if (a < 0)                                          // stopped: nothing to write
+            return 0;
+        ipoke_disk_demande(d, x, (long)inind[a] % d->frames);   // a jump or a gap too long: the writing restarts there, once it is mapped
+        goto perdu;
+    }
+    premier = x->region_debut + debut;
+    ipoke_disk_demande(d, x, premier);
+
+    if (debut + etendue <= x->region_etendue)               // in one piece: written where it lies
+    {
+        if ((a = ipoke_disk_prend(d, premier, etendue)) < 0)
+            goto perdu;
+        tab = ipoke_disk_frame(d, a, premier);
+    }
+    else                                                    // around the end of the region: both ends gathered in the fold, and back
+    {
+        avant = x->region_etendue - debut;
+        a = ipoke_disk_prend(d, premier, avant);
+        b = ipoke_disk_prend(d, x->region_debut, etendue - avant);
+        if (a < 0 || b < 0)
+        {
+            ipoke_disk_lache(d, a, 0);
+            ipoke_disk_lache(d, b, 0);
+            goto perdu;
+        }
+        memcpy(d->pli, ipoke_disk_frame(d, a, premier), avant * d->nc * sizeof(float));
+        memcpy(d->pli + avant * d->nc, ipoke_disk_frame(d, b, x->region_debut), (etendue - avant) * d->nc * sizeof(float));
+        tab = d->pli;
+    }
+
+    if (nvals > 1)
+        dirty_flag = ipoke_core_write_multi(x, tab, d->frames, d->nc, chan, inval, nvals, x->journal_index, n);
+    else
+        dirty_flag = ipoke_core_write(x, tab, d->frames, d->nc, chan, inval[0], x->journal_index, n);
+
+    if (b >= 0 && dirty_flag)
+    {
+        memcpy(ipoke_disk_frame(d, a, premier), d->pli, avant * d->nc * sizeof(float));
+        memcpy(ipoke_disk_frame(d, b, x->region_debut), d->pli + avant * d->nc, (etendue - avant) * d->nc * sizeof(float));
+    }
+    ipoke_disk_lache(d, a, dirty_flag);
+    ipoke_disk_lache(d, b, dirty_flag);
+    ipoke_core_stage_end(x);
+    return dirty_flag;
+
+perdu:
+    ipoke_core_stage_end(x);
+    ipoke_core_reset(x);
+    d->perdus++;
+    return 0;
+}
@@ -0,0 +1,82 @@
+//    ipoke_disk - a sound file as the write target of ipoke~
+//    by Pierre Alexandre Tremblay
+//    a 32-bit float wav file, mapped a few windows at a time so that it can be longer than memory: the audio thread writes
+//    in the windows already mapped and never waits, while a service thread of the host maps the next ones ahead of the writing,
+//    flushes the written pages to the file and unmaps the windows left behind
+
+#ifndef IPOKE_DISK_H
+#define IPOKE_DISK_H
+
+#include "ipoke_core.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define IPOKE_DISK_BLOC 65536               // frames of a block: a window maps two blocks, so the arc of a vector up to a block long always fits in one
+#define IPOKE_DISK_FENETRES 4               // windows mapped at once: the one written, the one ahead, and older ones until they are needed
+
+// the states of a window
+#define IPOKE_DISK_LIBRE 0                  // not mapped
+#define IPOKE_DISK_PRETE 1                  // mapped and read ahead: the audio thread may write it
+#define IPOKE_DISK_RENDUE 2                 // being unmapped: the audio thread leaves it alone
+
+typedef struct _ipoke_fenetre
+{
+    volatile long bloc;                     // first block mapped, from frame bloc * IPOKE_DISK_BLOC
+    volatile long etat;                     // one of the states above
+    volatile long sale;                     // written since its last flush
+    long etendue;                           // frames mapped, two blocks but at the end of the file
+    float *base;                            // the first of them
+    void *carte;                            // the mapping itself, from the page boundary before base
+    unsigned long long taille_carte;        // its length in bytes
+    unsigned long long position;            // and where it starts in the file
+} t_ipoke_fenetre;
+
+typedef struct _ipoke_disk
+{
+#ifdef _WIN32
+    void *fichier;                          // the file handle
+    void *projection;                       // and its mapping object
+#else
+    int fichier;
+#endif
+    long frames;                            // frames of the file
+    long nc;                                // its channels
+    double sr;                              // and sample rate
+    long nb_blocs;
+    unsigned long long entete;              // bytes before the first frame
+    unsigned long long granularite;         // the mappings start on multiples of it
+    t_ipoke_fenetre fenetres[IPOKE_DISK_FENETRES];
+    float *pli;                             // a block of frames, to write an arc going round the end of the region in one piece
+    volatile long courants;                 // the windows the audio thread is writing, one bit each, 0 between vectors
+    volatile long voulu;                    // the block it writes in, -1 before the first vector: the service maps its window
+    volatile long suivant;                  // and the next one in its direction, mapped ahead
+    long sens;                              // that direction
+    long dernier;                           // the last frame it wrote from, for sens
+    volatile long perdus;                   // vectors not written as their window was not mapped yet
+} t_ipoke_disk;
+
+// opens the file at chemin, a 32-bit float wav, and maps nothing yet (not from the audio thread): returns 1, 0 if it could not
+// with frames 0 it has to exist, and gives frames and nc. Otherwise it is created (or replaced) for frames of nc channels at sr,
+// with all its room allocated so that flushing never finds the disk full
+long ipoke_disk_open(t_ipoke_disk *d, const char *chemin, long frames, long nc, double sr);
+// flushes, unmaps and closes, once the service thread is stopped and the audio thread does not write any more
+void ipoke_disk_close(t_ipoke_disk *d);
+
+// from a service thread of the host, every few ms while the file is open: maps and reads ahead the window the writing is in
+// and the next one in its direction, unmapping the farthest ones to make room, and flushes the windows written since the last call
+// that the writing has left: the one it is in is flushed when it leaves it, or when it is unmapped or the file closed
+void ipoke_disk_service(t_ipoke_disk *d);
+
+// from the audio thread: writes the vector as ipoke_core_write (nvals 1) or ipoke_core_write_multi would, from channel chan of the file
+// and its frame indices, within the loop region of x. It never waits: a vector whose frames are not all in mapped windows, or which
+// writes across a jump or a gap longer than a block, is not written and the writing restarts from the next index. x needs the room
+// for the indices of ipoke_core_set_journal, even without a staging area. Returns the dirty flag
+long ipoke_disk_write(t_ipoke_disk *d, t_ipoke_core *x, long chan, const double * const *inval, long nvals, const double *inind, long n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
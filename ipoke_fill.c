@@ -0,0 +1,1326 @@
+//    ipoke_fill - the gap-filling kernels of ipoke~
+//    by Pierre Alexandre Tremblay
+//    scalar, SSE2 and AVX2/FMA versions, chosen at runtime. The maths stay in double like the rest of the
+//    engine and are only narrowed to float on the store. Strided (interleaved) destinations use the scalar version.
+
+#include <math.h>
+
+#include "ipoke_fill.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define IPOKE_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define IPOKE_TARGET_SSE2
+#define IPOKE_TARGET_AVX2
+#else
+#define IPOKE_TARGET_SSE2 __attribute__((target("sse2")))
+#define IPOKE_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#endif
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define IPOKE_FILL_SHORT 8
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#define ipoke_fill_barriere() MemoryBarrier()
+#else
+#define ipoke_fill_barriere() __sync_synchronize()
+#endif
+
+typedef void (*t_fill_ramp)(float *tab, long stride, long len, double base, double step);
+typedef void (*t_fill_ramp_overdub)(float *tab, long stride, long len, double base, double step, double overdub);
+typedef void (*t_fill_ramp_multi)(float *tab, long stride, long nvals, long len, const double *base, const double *step);
+typedef void (*t_fill_ramp_multi_overdub)(float *tab, long stride, long nvals, long len, const double *base, const double *step, double overdub);
+typedef void (*t_fill_ramp_feedback)(float *tab, long stride, long len, double base, double step, double od, double dod);
+typedef void (*t_fill_ramp_multi_feedback)(float *tab, long stride, long nvals, long len, const double *base, const double *step, double od, double dod);
+typedef void (*t_fill_snap)(float *tab, long stride, long nvals, long len, float seuil);
+typedef void (*t_fill_scale)(float *tab, long stride, long nvals, long len, double od, double dod);
+typedef void (*t_fill_combine)(float *tab, long stride, long nvals, long len, const float *src, double a, double b);
+typedef void (*t_fill_curve)(float *tab, long len, double t0, double dt, const double *coefs, double overdub);
+typedef void (*t_fill_curve_multi)(float *tab, long stride, long nvals, long len, double t0, double dt, const double *coefs, double overdub);
+typedef double (*t_fill_dot)(const double *passe, const double *filtre);
+typedef void (*t_fill_dot_multi)(double *out, const double *passe, long nvals, const double *filtre);
+
+// one row of IPOKE_SINC_TAPS weights per phase, for t = phase / IPOKE_SINC_PHASES, from 0 to 1 included
+static double sinc_table[(IPOKE_SINC_PHASES + 1) * IPOKE_SINC_TAPS];
+
+static long sinc_phase(double t)
+{
+    long phase = (long)(t * IPOKE_SINC_PHASES + 0.5);
+
+    return (phase < 0) ? 0 : (phase > IPOKE_SINC_PHASES) ? IPOKE_SINC_PHASES : phase;
+}
+
+// one low-pass filter of IPOKE_DECIM_TAPS weights per cutoff, bank b passing up to (b + 1) / IPOKE_DECIM_BANKS of the input band
+static double decim_table[IPOKE_DECIM_BANKS * IPOKE_DECIM_TAPS];
+
+static const double *decim_filter(double periode)
+{
+    long bank = (long)(IPOKE_DECIM_BANKS / periode + 0.5) - 1;
+
+    return decim_table + ((bank < 0) ? 0 : (bank >= IPOKE_DECIM_BANKS) ? IPOKE_DECIM_BANKS - 1 : bank) * IPOKE_DECIM_TAPS;
+}
+
+//***********************************************************************************************
+// scalar
+
+static void fill_ramp_scalar(float *tab, long stride, long len, double base, double step)
+{
+    long k;
+
+    for (k = 0; k < len; k++)
+        tab[k * stride] = (float)(base + k * step);
+}
+
+static void fill_ramp_overdub_scalar(float *tab, long stride, long len, double base, double step, double overdub)
+{
+    long k;
+
+    for (k = 0; k < len; k++)
+        tab[k * stride] = (float)((tab[k * stride] * overdub) + (base + k * step));
+}
+
+// multichannel, frame by frame so interleaved buffers are walked contiguously
+
+static void fill_ramp_multi_scalar(float *tab, long stride, long nvals, long len, const double *base, const double *step)
+{
+    long k, c;
+
+    for (k = 0; k < len; k++, tab += stride)
+        for (c = 0; c < nvals; c++)
+            tab[c] = (float)(base[c] + k * step[c]);
+}
+
+static void fill_ramp_multi_overdub_scalar(float *tab, long stride, long nvals, long len, const double *base, const double *step, double overdub)
+{
+    long k, c;
+
+    for (k = 0; k < len; k++, tab += stride)
+        for (c = 0; c < nvals; c++)
+            tab[c] = (float)((tab[c] * overdub) + (base[c] + k * step[c]));
+}
+
+static void fill_ramp_feedback_scalar(float *tab, long stride, long len, double base, double step, double od, double dod)
+{
+    long k;
+
+    for (k = 0; k < len; k++)
+        tab[k * stride] = (float)((tab[k * stride] * (od + k * dod)) + (base + k * step));
+}
+
+static void fill_ramp_multi_feedback_scalar(float *tab, long stride, long nvals, long len, const double *base, const double *step, double od, double dod)
+{
+    double ratio;
+    long k, c;
+
+    for (k = 0; k < len; k++, tab += stride)
+    {
+        ratio = od + k * dod;
+        for (c = 0; c < nvals; c++)
+            tab[c] = (float)((tab[c] * ratio) + (base[c] + k * step[c]));
+    }
+}
+
+static void fill_scale_scalar(float *tab, long stride, long nvals, long len, double od, double dod)
+{
+    double ratio;
+    long k, c;
+
+    for (k = 0; k < len; k++, tab += stride)
+    {
+        ratio = od + k * dod;
+        for (c = 0; c < nvals; c++)
+            tab[c] = (float)(tab[c] * ratio);
+    }
+}
+
+// the combine modes, also used for the single frames written by the core
+
+double ipoke_fill_sature(double x)
+{
+    if (x > 3.)
+        x = 3.;
+    else if (x < -3.)
+        x = -3.;
+    return x * (27. + x * x) / (27. + 9. * x * x);                                      // Pade approximant of tanh, exactly 1 at 3
+}
+
+static void fill_xfade_scalar(float *tab, long stride, long nvals, long len, const float *src, double a, double b)
+{
+    long k, c;
+
+    for (k = 0; k < len; k++, tab += stride, src += nvals)
+        for (c = 0; c < nvals; c++)
+            tab[c] = (float)((tab[c] * a) + (src[c] * b));
+}
+
+static void fill_max_scalar(float *tab, long stride, long nvals, long len, const float *src, double a, double b)
+{
+    long k, c;
+
+    (void)a;
+    (void)b;
+    for (k = 0; k < len; k++, tab += stride, src += nvals)
+        for (c = 0; c < nvals; c++)
+            if (fabsf(src[c]) > fabsf(tab[c]))
+                tab[c] = src[c];
+}
+
+static void fill_snap_scalar(float *tab, long stride, long nvals, long len, float seuil)
+{
+    long k, c;
+
+    for (k = 0; k < len; k++, tab += stride)
+        for (c = 0; c < nvals; c++)
+            if (fabsf(tab[c]) < seuil)
+                tab[c] = 0.f;
+}
+
+static void fill_softsat_scalar(float *tab, long stride, long nvals, long len, const float *src, double a, double b)
+{
+    long k, c;
+
+    (void)a;
+    (void)b;
+    for (k = 0; k < len; k++, tab += stride, src += nvals)
+        for (c = 0; c < nvals; c++)
+            tab[c] = (float)ipoke_fill_sature((double)tab[c] + src[c]);
+}
+
+// higher orders. The strided single channel versions go through the multichannel ones with nvals = 1
+
+static void fill_cubic_multi_scalar(float *tab, long stride, long nvals, long len, double t0, double dt, const double *coefs, double overdub)
+{
+    double t, v;
+    long k, c;
+
+    for (k = 0; k < len; k++, tab += stride)
+    {
+        t = t0 + k * dt;
+        for (c = 0; c < nvals; c++)
+        {
+            v = ((coefs[3 * nvals + c] * t + coefs[2 * nvals + c]) * t + coefs[nvals + c]) * t + coefs[c];
+            tab[c] = (float)((overdub != 0.) ? (tab[c] * overdub) + v : v);
+        }
+    }
+}
+
+static void fill_sinc_multi_scalar(float *tab, long stride, long nvals, long len, double t0, double dt, const double *points, double overdub)
+{
+    const double *row;
+    double v;
+    long k, c, j;
+
+    for (k = 0; k < len; k++, tab += stride)
+    {
+        row = sinc_table + sinc_phase(t0 + k * dt) * IPOKE_SINC_TAPS;
+        for (c = 0; c < nvals; c++)
+        {
+            v = 0.;
+            for (j = 0; j < IPOKE_SINC_TAPS; j++)
+                v += row[j] * points[j * nvals + c];
+            tab[c] = (float)((overdub != 0.) ? (tab[c] * overdub) + v : v);
+        }
+    }
+}
+
+static void fill_cubic_scalar(float *tab, long len, double t0, double dt, const double *coefs, double overdub)
+{
+    fill_cubic_multi_scalar(tab, 1, 1, len, t0, dt, coefs, overdub);
+}
+
+static void fill_sinc_scalar(float *tab, long len, double t0, double dt, const double *points, double overdub)
+{
+    fill_sinc_multi_scalar(tab, 1, 1, len, t0, dt, points, overdub);
+}
+
+static double fill_dot_scalar(const double *passe, const double *filtre)
+{
+    double v = 0.;
+    long j;
+
+    for (j = 0; j < IPOKE_DECIM_TAPS; j++)
+        v += passe[j] * filtre[j];
+    return v;
+}
+
+static void fill_dot_multi_scalar(double *out, const double *passe, long nvals, const double *filtre)
+{
+    long j, c;
+
+    for (c = 0; c < nvals; c++)
+        out[c] = 0.;
+    for (j = 0; j < IPOKE_DECIM_TAPS; j++, passe += nvals)
+        for (c = 0; c < nvals; c++)
+            out[c] += passe[c] * filtre[j];
+}
+
+#ifdef IPOKE_X86
+
+//***********************************************************************************************
+// SSE2, 2 doubles per operation, 4 floats per store
+
+IPOKE_TARGET_SSE2 static void fill_ramp_sse2(float *tab, long stride, long len, double base, double step)
+{
+    __m128d vk, vbase, vstep, vtwo;
+    __m128 lo, hi;
+    long k = 0;
+
+    if (stride != 1)
+    {
+        fill_ramp_scalar(tab, stride, len, base, step);
+        return;
+    }
+
+    vk = _mm_set_pd(1., 0.);
+    vbase = _mm_set1_pd(base);
+    vstep = _mm_set1_pd(step);
+    vtwo = _mm_set1_pd(2.);
+
+    for (; k + 4 <= len; k += 4)
+    {
+        lo = _mm_cvtpd_ps(_mm_add_pd(vbase, _mm_mul_pd(vk, vstep)));
+        vk = _mm_add_pd(vk, vtwo);
+        hi = _mm_cvtpd_ps(_mm_add_pd(vbase, _mm_mul_pd(vk, vstep)));
+        vk = _mm_add_pd(vk, vtwo);
+        _mm_storeu_ps(tab + k, _mm_movelh_ps(lo, hi));
+    }
+    for (; k < len; k++)
+        tab[k] = (float)(base + k * step);
+}
+
+IPOKE_TARGET_SSE2 static void fill_ramp_overdub_sse2(float *tab, long stride, long len, double base, double step, double overdub)
+{
+    __m128d vk, vbase, vstep, vtwo, vod;
+    __m128 old, lo, hi;
+    long k = 0;
+
+    if (stride != 1)
+    {
+        fill_ramp_overdub_scalar(tab, stride, len, base, step, overdub);
+        return;
+    }
+
+    vk = _mm_set_pd(1., 0.);
+    vbase = _mm_set1_pd(base);
+    vstep = _mm_set1_pd(step);
+    vtwo = _mm_set1_pd(2.);
+    vod = _mm_set1_pd(overdub);
+
+    for (; k + 4 <= len; k += 4)
+    {
+        old = _mm_loadu_ps(tab + k);
+        lo = _mm_cvtpd_ps(_mm_add_pd(_mm_mul_pd(_mm_cvtps_pd(old), vod), _mm_add_pd(vbase, _mm_mul_pd(vk, vstep))));
+        vk = _mm_add_pd(vk, vtwo);
+        hi = _mm_cvtpd_ps(_mm_add_pd(_mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(old, old)), vod), _mm_add_pd(vbase, _mm_mul_pd(vk, vstep))));
+        vk = _mm_add_pd(vk, vtwo);
+        _mm_storeu_ps(tab + k, _mm_movelh_ps(lo, hi));
+    }
+    for (; k < len; k++)
+        tab[k] = (float)((tab[k] * overdub) + (base + k * step));
+}
+
+IPOKE_TARGET_SSE2 static void fill_ramp_feedback_sse2(float *tab, long stride, long len, double base, double step, double od, double dod)
+{
+    __m128d vk, vbase, vstep, vtwo, vod, vdod;
+    __m128 old, lo, hi;
+    long k = 0;
+
+    if (stride != 1)
+    {
+        fill_ramp_feedback_scalar(tab, stride, len, base, step, od, dod);
+        return;
+    }
+
+    vk = _mm_set_pd(1., 0.);
+    vbase = _mm_set1_pd(base);
+    vstep = _mm_set1_pd(step);
+    vtwo = _mm_set1_pd(2.);
+    vod = _mm_set1_pd(od);
+    vdod = _mm_set1_pd(dod);
+
+    for (; k + 4 <= len; k += 4)
+    {
+        old = _mm_loadu_ps(tab + k);
+        lo = _mm_cvtpd_ps(_mm_add_pd(_mm_mul_pd(_mm_cvtps_pd(old), _mm_add_pd(vod, _mm_mul_pd(vk, vdod))), _mm_add_pd(vbase, _mm_mul_pd(vk, vstep))));
+        vk = _mm_add_pd(vk, vtwo);
+        hi = _mm_cvtpd_ps(_mm_add_pd(_mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(old, old)), _mm_add_pd(vod, _mm_mul_pd(vk, vdod))), _mm_add_pd(vbase, _mm_mul_pd(vk, vstep))));
+        vk = _mm_add_pd(vk, vtwo);
+        _mm_storeu_ps(tab + k, _mm_movelh_ps(lo, hi));
+    }
+    for (; k < len; k++)
+        tab[k] = (float)((tab[k] * (od + k * dod)) + (base + k * step));
+}
+
+// multichannel: the vectors run across the channels of each frame
+
+IPOKE_TARGET_SSE2 static void fill_ramp_multi_sse2(float *tab, long stride, long nvals, long len, const double *base, const double *step)
+{
+    __m128d vk;
+    __m128 lo, hi;
+    long k, c;
+
+    for (k = 0; k < len; k++, tab += stride)
+    {
+        vk = _mm_set1_pd((double)k);
+        for (c = 0; c + 4 <= nvals; c += 4)
+        {
+            lo = _mm_cvtpd_ps(_mm_add_pd(_mm_loadu_pd(base + c), _mm_mul_pd(vk, _mm_loadu_pd(step + c))));
+            hi = _mm_cvtpd_ps(_mm_add_pd(_mm_loadu_pd(base + c + 2), _mm_mul_pd(vk, _mm_loadu_pd(step + c + 2))));
+            _mm_storeu_ps(tab + c, _mm_movelh_ps(lo, hi));
+        }
+        for (; c < nvals; c++)
+            tab[c] = (float)(base[c] + k * step[c]);
+    }
+}
+
+IPOKE_TARGET_SSE2 static void fill_ramp_multi_overdub_sse2(float *tab, long stride, long nvals, long len, const double *base, const double *step, double overdub)
+{
+    __m128d vk, vod;
+    __m128 old, lo, hi;
+    long k, c;
+
+    vod = _mm_set1_pd(overdub);
+    for (k = 0; k < len; k++, tab += stride)
+    {
+        vk = _mm_set1_pd((double)k);
+        for (c = 0; c + 4 <= nvals; c += 4)
+        {
+            old = _mm_loadu_ps(tab + c);
+            lo = _mm_cvtpd_ps(_mm_add_pd(_mm_mul_pd(_mm_cvtps_pd(old), vod), _mm_add_pd(_mm_loadu_pd(base + c), _mm_mul_pd(vk, _mm_loadu_pd(step + c)))));
+            hi = _mm_cvtpd_ps(_mm_add_pd(_mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(old, old)), vod), _mm_add_pd(_mm_loadu_pd(base + c + 2), _mm_mul_pd(vk, _mm_loadu_pd(step + c + 2)))));
+            _mm_storeu_ps(tab + c, _mm_movelh_ps(lo, hi));
+        }
+        for (; c < nvals; c++)
+            tab[c] = (float)((tab[c] * overdub) + (base[c] + k * step[c]));
+    }
+}
+
+// higher orders: 4 frames per store for the cubic, one dot product per frame for the sinc
+
+IPOKE_TARGET_SSE2 static void fill_cubic_sse2(float *tab, long len, double t0, double dt, const double *coefs, double overdub)
+{
+    __m128d vt, vdt2, vc0, vc1, vc2, vc3, vod, lo, hi;
+    __m128 old;
+    double t, v;
+    long k = 0;
+
+    vdt2 = _mm_set1_pd(2. * dt);
+    vc0 = _mm_set1_pd(coefs[0]);
+    vc1 = _mm_set1_pd(coefs[1]);
+    vc2 = _mm_set1_pd(coefs[2]);
+    vc3 = _mm_set1_pd(coefs[3]);
+    vod = _mm_set1_pd(overdub);
+
+    for (; k + 4 <= len; k += 4)
+    {
+        vt = _mm_set_pd(t0 + (k + 1) * dt, t0 + k * dt);
+        lo = _mm_add_pd(_mm_mul_pd(_mm_add_pd(_mm_mul_pd(_mm_add_pd(_mm_mul_pd(vc3, vt), vc2), vt), vc1), vt), vc0);
+        vt = _mm_add_pd(vt, vdt2);
+        hi = _mm_add_pd(_mm_mul_pd(_mm_add_pd(_mm_mul_pd(_mm_add_pd(_mm_mul_pd(vc3, vt), vc2), vt), vc1), vt), vc0);
+        if (overdub != 0.)
+        {
+            old = _mm_loadu_ps(tab + k);
+            lo = _mm_add_pd(_mm_mul_pd(_mm_cvtps_pd(old), vod), lo);
+            hi = _mm_add_pd(_mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(old, old)), vod), hi);
+        }
+        _mm_storeu_ps(tab + k, _mm_movelh_ps(_mm_cvtpd_ps(lo), _mm_cvtpd_ps(hi)));
+    }
+    for (; k < len; k++)
+    {
+        t = t0 + k * dt;
+        v = ((coefs[3] * t + coefs[2]) * t + coefs[1]) * t + coefs[0];
+        tab[k] = (float)((overdub != 0.) ? (tab[k] * overdub) + v : v);
+    }
+}
+
+IPOKE_TARGET_SSE2 static void fill_sinc_sse2(float *tab, long len, double t0, double dt, const double *points, double overdub)
+{
+    __m128d p0, p1, p2, p3, acc;
+    const double *row;
+    double v;
+    long k;
+
+    p0 = _mm_loadu_pd(points);
+    p1 = _mm_loadu_pd(points + 2);
+    p2 = _mm_loadu_pd(points + 4);
+    p3 = _mm_loadu_pd(points + 6);
+
+    for (k = 0; k < len; k++)
+    {
+        row = sinc_table + sinc_phase(t0 + k * dt) * IPOKE_SINC_TAPS;
+        acc = _mm_add_pd(_mm_add_pd(_mm_mul_pd(_mm_loadu_pd(row), p0), _mm_mul_pd(_mm_loadu_pd(row + 2), p1)),
+                         _mm_add_pd(_mm_mul_pd(_mm_loadu_pd(row + 4), p2), _mm_mul_pd(_mm_loadu_pd(row + 6), p3)));
+        v = _mm_cvtsd_f64(_mm_add_sd(acc, _mm_unpackhi_pd(acc, acc)));
+        tab[k] = (float)((overdub != 0.) ? (tab[k] * overdub) + v : v);
+    }
+}
+
+// the decayed frames snapped to zero, 4 at a time when they are contiguous
+
+IPOKE_TARGET_SSE2 static void fill_snap_sse2(float *tab, long stride, long nvals, long len, float seuil)
+{
+    __m128 vabs, vseuil, t;
+    long k = 0, n = len * nvals;
+
+    if (stride != nvals)
+    {
+        fill_snap_scalar(tab, stride, nvals, len, seuil);
+        return;
+    }
+    vabs = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+    vseuil = _mm_set1_ps(seuil);
+    for (; k + 4 <= n; k += 4)
+    {
+        t = _mm_loadu_ps(tab + k);
+        _mm_storeu_ps(tab + k, _mm_andnot_ps(_mm_cmplt_ps(_mm_and_ps(t, vabs), vseuil), t));
+    }
+    for (; k < n; k++)
+        if (fabsf(tab[k]) < seuil)
+            tab[k] = 0.f;
+}
+
+// the anti-aliasing filters: one dot product, 2 taps per operation
+
+IPOKE_TARGET_SSE2 static double fill_dot_sse2(const double *passe, const double *filtre)
+{
+    __m128d acc0, acc1;
+    long j;
+
+    acc0 = _mm_setzero_pd();
+    acc1 = _mm_setzero_pd();
+    for (j = 0; j < IPOKE_DECIM_TAPS; j += 4)
+    {
+        acc0 = _mm_add_pd(acc0, _mm_mul_pd(_mm_loadu_pd(passe + j), _mm_loadu_pd(filtre + j)));
+        acc1 = _mm_add_pd(acc1, _mm_mul_pd(_mm_loadu_pd(passe + j + 2), _mm_loadu_pd(filtre + j + 2)));
+    }
+    acc0 = _mm_add_pd(acc0, acc1);
+    return _mm_cvtsd_f64(_mm_add_sd(acc0, _mm_unpackhi_pd(acc0, acc0)));
+}
+
+//***********************************************************************************************
+// AVX2 + FMA, 4 doubles per operation, 8 floats per store
+
+IPOKE_TARGET_AVX2 static void fill_ramp_avx2(float *tab, long stride, long len, double base, double step)
+{
+    __m256d vk, vbase, vstep, vfour;
+    __m128 lo, hi;
+    long k = 0;
+
+    if (stride != 1)
+    {
+        fill_ramp_scalar(tab, stride, len, base, step);
+        return;
+    }
+
+    vk = _mm256_set_pd(3., 2., 1., 0.);
+    vbase = _mm256_set1_pd(base);
+    vstep = _mm256_set1_pd(step);
+    vfour = _mm256_set1_pd(4.);
+
+    for (; k + 8 <= len; k += 8)
+    {
+        lo = _mm256_cvtpd_ps(_mm256_fmadd_pd(vk, vstep, vbase));
+        vk = _mm256_add_pd(vk, vfour);
+        hi = _mm256_cvtpd_ps(_mm256_fmadd_pd(vk, vstep, vbase));
+        vk = _mm256_add_pd(vk, vfour);
+        _mm256_storeu_ps(tab + k, _mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1));
+    }
+    for (; k < len; k++)
+        tab[k] = (float)(base + k * step);
+}
+
+IPOKE_TARGET_AVX2 static void fill_ramp_overdub_avx2(float *tab, long stride, long len, double base, double step, double overdub)
+{
+    __m256d vk, vbase, vstep, vfour, vod;
+    __m128 lo, hi;
+    long k = 0;
+
+    if (stride != 1)
+    {
+        fill_ramp_overdub_scalar(tab, stride, len, base, step, overdub);
+        return;
+    }
+
+    vk = _mm256_set_pd(3., 2., 1., 0.);
+    vbase = _mm256_set1_pd(base);
+    vstep = _mm256_set1_pd(step);
+    vfour = _mm256_set1_pd(4.);
+    vod = _mm256_set1_pd(overdub);
+
+    for (; k + 8 <= len; k += 8)
+    {
+        lo = _mm256_cvtpd_ps(_mm256_fmadd_pd(_mm256_cvtps_pd(_mm_loadu_ps(tab + k)), vod, _mm256_fmadd_pd(vk, vstep, vbase)));
+        vk = _mm256_add_pd(vk, vfour);
+        hi = _mm256_cvtpd_ps(_mm256_fmadd_pd(_mm256_cvtps_pd(_mm_loadu_ps(tab + k + 4)), vod, _mm256_fmadd_pd(vk, vstep, vbase)));
+        vk = _mm256_add_pd(vk, vfour);
+        _mm256_storeu_ps(tab + k, _mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1));
+    }
+    for (; k < len; k++)
+        tab[k] = (float)((tab[k] * overdub) + (base + k * step));
+}
+
+// the ratio and the ramp both as fused multiply-adds, and one more for the overdub itself
+IPOKE_TARGET_AVX2 static void fill_ramp_feedback_avx2(float *tab, long stride, long len, double base, double step, double od, double dod)
+{
+    __m256d vk, vbase, vstep, vfour, vod, vdod;
+    __m128 lo, hi;
+    long k = 0;
+
+    if (stride != 1)
+    {
+        fill_ramp_feedback_scalar(tab, stride, len, base, step, od, dod);
+        return;
+    }
+
+    vk = _mm256_set_pd(3., 2., 1., 0.);
+    vbase = _mm256_set1_pd(base);
+    vstep = _mm256_set1_pd(step);
+    vfour = _mm256_set1_pd(4.);
+    vod = _mm256_set1_pd(od);
+    vdod = _mm256_set1_pd(dod);
+
+    for (; k + 8 <= len; k += 8)
+    {
+        lo = _mm256_cvtpd_ps(_mm256_fmadd_pd(_mm256_cvtps_pd(_mm_loadu_ps(tab + k)), _mm256_fmadd_pd(vk, vdod, vod), _mm256_fmadd_pd(vk, vstep, vbase)));
+        vk = _mm256_add_pd(vk, vfour);
+        hi = _mm256_cvtpd_ps(_mm256_fmadd_pd(_mm256_cvtps_pd(_mm_loadu_ps(tab + k + 4)), _mm256_fmadd_pd(vk, vdod, vod), _mm256_fmadd_pd(vk, vstep, vbase)));
+        vk = _mm256_add_pd(vk, vfour);
+        _mm256_storeu_ps(tab + k, _mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1));
+    }
+    for (; k < len; k++)
+        tab[k] = (float)((tab[k] * (od + k * dod)) + (base + k * step));
+}
+
+IPOKE_TARGET_AVX2 static void fill_scale_avx2(float *tab, long stride, long nvals, long len, double od, double dod)
+{
+    __m256d vk, vfour, vod, vdod;
+    __m128 lo, hi;
+    long k = 0;
+
+    if (stride != 1 || nvals != 1)
+    {
+        fill_scale_scalar(tab, stride, nvals, len, od, dod);
+        return;
+    }
+
+    vk = _mm256_set_pd(3., 2., 1., 0.);
+    vfour = _mm256_set1_pd(4.);
+    vod = _mm256_set1_pd(od);
+    vdod = _mm256_set1_pd(dod);
+
+    for (; k + 8 <= len; k += 8)
+    {
+        lo = _mm256_cvtpd_ps(_mm256_mul_pd(_mm256_cvtps_pd(_mm_loadu_ps(tab + k)), _mm256_fmadd_pd(vk, vdod, vod)));
+        vk = _mm256_add_pd(vk, vfour);
+        hi = _mm256_cvtpd_ps(_mm256_mul_pd(_mm256_cvtps_pd(_mm_loadu_ps(tab + k + 4)), _mm256_fmadd_pd(vk, vdod, vod)));
+        vk = _mm256_add_pd(vk, vfour);
+        _mm256_storeu_ps(tab + k, _mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1));
+    }
+    for (; k < len; k++)
+        tab[k] = (float)(tab[k] * (od + k * dod));
+}
+
+IPOKE_TARGET_AVX2 static void fill_snap_avx2(float *tab, long stride, long nvals, long len, float seuil)
+{
+    __m256 vabs, vseuil, t;
+    long k = 0, n = len * nvals;
+
+    if (stride != nvals)
+    {
+        fill_snap_scalar(tab, stride, nvals, len, seuil);
+        return;
+    }
+    vabs = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+    vseuil = _mm256_set1_ps(seuil);
+    for (; k + 8 <= n; k += 8)
+    {
+        t = _mm256_loadu_ps(tab + k);
+        _mm256_storeu_ps(tab + k, _mm256_andnot_ps(_mm256_cmp_ps(_mm256_and_ps(t, vabs), vseuil, _CMP_LT_OQ), t));
+    }
+    for (; k < n; k++)
+        if (fabsf(tab[k]) < seuil)
+            tab[k] = 0.f;
+}
+
+// the combines only vectorise when the frames are contiguous, src and tab then having the same layout; same rounding as the scalar ones
+IPOKE_TARGET_AVX2 static void fill_xfade_avx2(float *tab, long stride, long nvals, long len, const float *src, double a, double b)
+{
+    __m256d va, vb;
+    long k = 0, n = len * nvals;
+
+    if (stride != nvals)
+    {
+        fill_xfade_scalar(tab, stride, nvals, len, src, a, b);
+        return;
+    }
+    va = _mm256_set1_pd(a);
+    vb = _mm256_set1_pd(b);
+    for (; k + 4 <= n; k += 4)
+        _mm_storeu_ps(tab + k, _mm256_cvtpd_ps(_mm256_add_pd(_mm256_mul_pd(_mm256_cvtps_pd(_mm_loadu_ps(tab + k)), va),
+                                                             _mm256_mul_pd(_mm256_cvtps_pd(_mm_loadu_ps(src + k)), vb))));
+    for (; k < n; k++)
+        tab[k] = (float)((tab[k] * a) + (src[k] * b));
+}
+
+IPOKE_TARGET_AVX2 static void fill_max_avx2(float *tab, long stride, long nvals, long len, const float *src, double a, double b)
+{
+    __m256 vabs, t, u;
+    long k = 0, n = len * nvals;
+
+    if (stride != nvals)
+    {
+        fill_max_scalar(tab, stride, nvals, len, src, a, b);
+        return;
+    }
+    vabs = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+    for (; k + 8 <= n; k += 8)
+    {
+        t = _mm256_loadu_ps(tab + k);
+        u = _mm256_loadu_ps(src + k);
+        _mm256_storeu_ps(tab + k, _mm256_blendv_ps(t, u, _mm256_cmp_ps(_mm256_and_ps(u, vabs), _mm256_and_ps(t, vabs), _CMP_GT_OQ)));
+    }
+    for (; k < n; k++)
+        if (fabsf(src[k]) > fabsf(tab[k]))
+            tab[k] = src[k];
+}
+
+IPOKE_TARGET_AVX2 static void fill_softsat_avx2(float *tab, long stride, long nvals, long len, const float *src, double a, double b)
+{
+    __m256d vx, vx2, vtrois, vmoins, v27, v9;
+    long k = 0, n = len * nvals;
+
+    if (stride != nvals)
+    {
+        fill_softsat_scalar(tab, stride, nvals, len, src, a, b);
+        return;
+    }
+    vtrois = _mm256_set1_pd(3.);
+    vmoins = _mm256_set1_pd(-3.);
+    v27 = _mm256_set1_pd(27.);
+    v9 = _mm256_set1_pd(9.);
+    for (; k + 4 <= n; k += 4)
+    {
+        vx = _mm256_add_pd(_mm256_cvtps_pd(_mm_loadu_ps(tab + k)), _mm256_cvtps_pd(_mm_loadu_ps(src + k)));
+        vx = _mm256_max_pd(_mm256_min_pd(vx, vtrois), vmoins);
+        vx2 = _mm256_mul_pd(vx, vx);
+        _mm_storeu_ps(tab + k, _mm256_cvtpd_ps(_mm256_div_pd(_mm256_mul_pd(vx, _mm256_add_pd(v27, vx2)), _mm256_add_pd(v27, _mm256_mul_pd(v9, vx2)))));
+    }
+    for (; k < n; k++)
+        tab[k] = (float)ipoke_fill_sature((double)tab[k] + src[k]);
+}
+
+IPOKE_TARGET_AVX2 static void fill_ramp_multi_avx2(float *tab, long stride, long nvals, long len, const double *base, const double *step)
+{
+    __m256d vk;
+    long k, c;
+
+    for (k = 0; k < len; k++, tab += stride)
+    {
+        vk = _mm256_set1_pd((double)k);
+        for (c = 0; c + 4 <= nvals; c += 4)
+            _mm_storeu_ps(tab + c, _mm256_cvtpd_ps(_mm256_fmadd_pd(vk, _mm256_loadu_pd(step + c), _mm256_loadu_pd(base + c))));
+        for (; c < nvals; c++)
+            tab[c] = (float)(base[c] + k * step[c]);
+    }
+}
+
+IPOKE_TARGET_AVX2 static void fill_ramp_multi_overdub_avx2(float *tab, long stride, long nvals, long len, const double *base, const double *step, double overdub)
+{
+    __m256d vk, vod;
+    long k, c;
+
+    vod = _mm256_set1_pd(overdub);
+    for (k = 0; k < len; k++, tab += stride)
+    {
+        vk = _mm256_set1_pd((double)k);
+        for (c = 0; c + 4 <= nvals; c += 4)
+            _mm_storeu_ps(tab + c, _mm256_cvtpd_ps(_mm256_fmadd_pd(_mm256_cvtps_pd(_mm_loadu_ps(tab + c)), vod, _mm256_fmadd_pd(vk, _mm256_loadu_pd(step + c), _mm256_loadu_pd(base + c)))));
+        for (; c < nvals; c++)
+            tab[c] = (float)((tab[c] * overdub) + (base[c] + k * step[c]));
+    }
+}
+
+IPOKE_TARGET_AVX2 static void fill_ramp_multi_feedback_avx2(float *tab, long stride, long nvals, long len, const double *base, const double *step, double od, double dod)
+{
+    __m256d vk, vratio;
+    double ratio;
+    long k, c;
+
+    for (k = 0; k < len; k++, tab += stride)
+    {
+        vk = _mm256_set1_pd((double)k);
+        ratio = od + k * dod;
+        vratio = _mm256_set1_pd(ratio);
+        for (c = 0; c + 4 <= nvals; c += 4)
+            _mm_storeu_ps(tab + c, _mm256_cvtpd_ps(_mm256_fmadd_pd(_mm256_cvtps_pd(_mm_loadu_ps(tab + c)), vratio, _mm256_fmadd_pd(vk, _mm256_loadu_pd(step + c), _mm256_loadu_pd(base + c)))));
+        for (; c < nvals; c++)
+            tab[c] = (float)((tab[c] * ratio) + (base[c] + k * step[c]));
+    }
+}
+
+// higher orders: 8 frames per store for the cubic, one dot product per frame for the sinc, and across the channels of a frame
+
+IPOKE_TARGET_AVX2 static void fill_cubic_avx2(float *tab, long len, double t0, double dt, const double *coefs, double overdub)
+{
+    __m256d vt, vdt4, vc0, vc1, vc2, vc3, vod, lo, hi;
+    double t, v;
+    long k = 0;
+
+    vdt4 = _mm256_set1_pd(4. * dt);
+    vc0 = _mm256_set1_pd(coefs[0]);
+    vc1 = _mm256_set1_pd(coefs[1]);
+    vc2 = _mm256_set1_pd(coefs[2]);
+    vc3 = _mm256_set1_pd(coefs[3]);
+    vod = _mm256_set1_pd(overdub);
+
+    for (; k + 8 <= len; k += 8)
+    {
+        vt = _mm256_set_pd(t0 + (k + 3) * dt, t0 + (k + 2) * dt, t0 + (k + 1) * dt, t0 + k * dt);
+        lo = _mm256_fmadd_pd(_mm256_fmadd_pd(_mm256_fmadd_pd(vc3, vt, vc2), vt, vc1), vt, vc0);
+        vt = _mm256_add_pd(vt, vdt4);
+        hi = _mm256_fmadd_pd(_mm256_fmadd_pd(_mm256_fmadd_pd(vc3, vt, vc2), vt, vc1), vt, vc0);
+        if (overdub != 0.)
+        {
+            lo = _mm256_fmadd_pd(_mm256_cvtps_pd(_mm_loadu_ps(tab + k)), vod, lo);
+            hi = _mm256_fmadd_pd(_mm256_cvtps_pd(_mm_loadu_ps(tab + k + 4)), vod, hi);
+        }
+        _mm256_storeu_ps(tab + k, _mm256_insertf128_ps(_mm256_castps128_ps256(_mm256_cvtpd_ps(lo)), _mm256_cvtpd_ps(hi), 1));
+    }
+    for (; k < len; k++)
+    {
+        t = t0 + k * dt;
+        v = ((coefs[3] * t + coefs[2]) * t + coefs[1]) * t + coefs[0];
+        tab[k] = (float)((overdub != 0.) ? (tab[k] * overdub) + v : v);
+    }
+}
+
+IPOKE_TARGET_AVX2 static void fill_sinc_avx2(float *tab, long len, double t0, double dt, const double *points, double overdub)
+{
+    __m256d plo, phi, acc;
+    __m128d half;
+    const double *row;
+    double v;
+    long k;
+
+    plo = _mm256_loadu_pd(points);
+    phi = _mm256_loadu_pd(points + 4);
+
+    for (k = 0; k < len; k++)
+    {
+        row = sinc_table + sinc_phase(t0 + k * dt) * IPOKE_SINC_TAPS;
+        acc = _mm256_fmadd_pd(_mm256_loadu_pd(row + 4), phi, _mm256_mul_pd(_mm256_loadu_pd(row), plo));
+        half = _mm_add_pd(_mm256_castpd256_pd128(acc), _mm256_extractf128_pd(acc, 1));
+        v = _mm_cvtsd_f64(_mm_add_sd(half, _mm_unpackhi_pd(half, half)));
+        tab[k] = (float)((overdub != 0.) ? (tab[k] * overdub) + v : v);
+    }
+}
+
+IPOKE_TARGET_AVX2 static void fill_cubic_multi_avx2(float *tab, long stride, long nvals, long len, double t0, double dt, const double *coefs, double overdub)
+{
+    __m256d vt, vod, v;
+    double t;
+    long k, c;
+
+    vod = _mm256_set1_pd(overdub);
+    for (k = 0; k < len; k++, tab += stride)
+    {
+        t = t0 + k * dt;
+        vt = _mm256_set1_pd(t);
+        for (c = 0; c + 4 <= nvals; c += 4)
+        {
+            v = _mm256_fmadd_pd(_mm256_loadu_pd(coefs + 3 * nvals + c), vt, _mm256_loadu_pd(coefs + 2 * nvals + c));
+            v = _mm256_fmadd_pd(v, vt, _mm256_loadu_pd(coefs + nvals + c));
+            v = _mm256_fmadd_pd(v, vt, _mm256_loadu_pd(coefs + c));
+            if (overdub != 0.)
+                v = _mm256_fmadd_pd(_mm256_cvtps_pd(_mm_loadu_ps(tab + c)), vod, v);
+            _mm_storeu_ps(tab + c, _mm256_cvtpd_ps(v));
+        }
+        for (; c < nvals; c++)
+        {
+            double w = ((coefs[3 * nvals + c] * t + coefs[2 * nvals + c]) * t + coefs[nvals + c]) * t + coefs[c];
+            tab[c] = (float)((overdub != 0.) ? (tab[c] * overdub) + w : w);
+        }
+    }
+}
+
+IPOKE_TARGET_AVX2 static void fill_sinc_multi_avx2(float *tab, long stride, long nvals, long len, double t0, double dt, const double *points, double overdub)
+{
+    __m256d vod, v;
+    const double *row;
+    long k, c, j;
+
+    vod = _mm256_set1_pd(overdub);
+    for (k = 0; k < len; k++, tab += stride)
+    {
+        row = sinc_table + sinc_phase(t0 + k * dt) * IPOKE_SINC_TAPS;
+        for (c = 0; c + 4 <= nvals; c += 4)
+        {
+            v = _mm256_mul_pd(_mm256_set1_pd(row[0]), _mm256_loadu_pd(points + c));
+            for (j = 1; j < IPOKE_SINC_TAPS; j++)
+                v = _mm256_fmadd_pd(_mm256_set1_pd(row[j]), _mm256_loadu_pd(points + j * nvals + c), v);
+            if (overdub != 0.)
+                v = _mm256_fmadd_pd(_mm256_cvtps_pd(_mm_loadu_ps(tab + c)), vod, v);
+            _mm_storeu_ps(tab + c, _mm256_cvtpd_ps(v));
+        }
+        for (; c < nvals; c++)
+        {
+            double w = 0.;
+            for (j = 0; j < IPOKE_SINC_TAPS; j++)
+                w += row[j] * points[j * nvals + c];
+            tab[c] = (float)((overdub != 0.) ? (tab[c] * overdub) + w : w);
+        }
+    }
+}
+
+IPOKE_TARGET_AVX2 static double fill_dot_avx2(const double *passe, const double *filtre)
+{
+    __m256d acc0, acc1;
+    __m128d half;
+    long j;
+
+    acc0 = _mm256_setzero_pd();
+    acc1 = _mm256_setzero_pd();
+    for (j = 0; j < IPOKE_DECIM_TAPS; j += 8)
+    {
+        acc0 = _mm256_fmadd_pd(_mm256_loadu_pd(passe + j), _mm256_loadu_pd(filtre + j), acc0);
+        acc1 = _mm256_fmadd_pd(_mm256_loadu_pd(passe + j + 4), _mm256_loadu_pd(filtre + j + 4), acc1);
+    }
+    acc0 = _mm256_add_pd(acc0, acc1);
+    half = _mm_add_pd(_mm256_castpd256_pd128(acc0), _mm256_extractf128_pd(acc0, 1));
+    return _mm_cvtsd_f64(_mm_add_sd(half, _mm_unpackhi_pd(half, half)));
+}
+
+IPOKE_TARGET_AVX2 static void fill_dot_multi_avx2(double *out, const double *passe, long nvals, const double *filtre)
+{
+    __m256d v;
+    double w;
+    long j, c;
+
+    for (c = 0; c + 4 <= nvals; c += 4)
+    {
+        v = _mm256_mul_pd(_mm256_set1_pd(filtre[0]), _mm256_loadu_pd(passe + c));
+        for (j = 1; j < IPOKE_DECIM_TAPS; j++)
+            v = _mm256_fmadd_pd(_mm256_set1_pd(filtre[j]), _mm256_loadu_pd(passe + j * nvals + c), v);
+        _mm256_storeu_pd(out + c, v);
+    }
+    for (; c < nvals; c++)
+    {
+        w = 0.;
+        for (j = 0; j < IPOKE_DECIM_TAPS; j++)
+            w += passe[j * nvals + c] * filtre[j];
+        out[c] = w;
+    }
+}
+
+#endif
+
+//***********************************************************************************************
+// runtime dispatch
+
+static long fill_isa = -1;
+static t_fill_ramp fill_ramp_fn = fill_ramp_scalar;
+static t_fill_ramp_overdub fill_ramp_overdub_fn = fill_ramp_overdub_scalar;
+static t_fill_ramp_multi fill_ramp_multi_fn = fill_ramp_multi_scalar;
+static t_fill_ramp_multi_overdub fill_ramp_multi_overdub_fn = fill_ramp_multi_overdub_scalar;
+static t_fill_ramp_feedback fill_ramp_feedback_fn = fill_ramp_feedback_scalar;
+static t_fill_ramp_multi_feedback fill_ramp_multi_feedback_fn = fill_ramp_multi_feedback_scalar;
+static t_fill_scale fill_scale_fn = fill_scale_scalar;
+static t_fill_snap fill_snap_fn = fill_snap_scalar;
+static t_fill_combine fill_xfade_fn = fill_xfade_scalar;
+static t_fill_combine fill_max_fn = fill_max_scalar;
+static t_fill_combine fill_softsat_fn = fill_softsat_scalar;
+static t_fill_curve fill_cubic_fn = fill_cubic_scalar;
+static t_fill_curve fill_sinc_fn = fill_sinc_scalar;
+static t_fill_curve_multi fill_cubic_multi_fn = fill_cubic_multi_scalar;
+static t_fill_curve_multi fill_sinc_multi_fn = fill_sinc_multi_scalar;
+static t_fill_dot fill_dot_fn = fill_dot_scalar;
+static t_fill_dot_multi fill_dot_multi_fn = fill_dot_multi_scalar;
+
+// Blackman-windowed sinc over the IPOKE_SINC_TAPS points, each phase normalised to unity gain
+static void sinc_build(void)
+{
+    double x, w, sum, *row;
+    long phase, j;
+
+    for (phase = 0; phase <= IPOKE_SINC_PHASES; phase++)
+    {
+        row = sinc_table + phase * IPOKE_SINC_TAPS;
+        sum = 0.;
+        for (j = 0; j < IPOKE_SINC_TAPS; j++)
+        {
+            x = (double)phase / IPOKE_SINC_PHASES - (j - IPOKE_SINC_CENTRE);         // distance from the point
+            w = 0.42 + 0.5 * cos(M_PI * x / (IPOKE_SINC_TAPS * 0.5)) + 0.08 * cos(2. * M_PI * x / (IPOKE_SINC_TAPS * 0.5));
+            row[j] = ((fabs(x) < 1e-12) ? 1. : sin(M_PI * x) / (M_PI * x)) * ((fabs(x) < IPOKE_SINC_TAPS * 0.5) ? w : 0.);
+            sum += row[j];
+        }
+        for (j = 0; j < IPOKE_SINC_TAPS; j++)
+            row[j] /= sum;
+    }
+}
+
+// Blackman-windowed sinc low-pass filters, cut a bit under the band they keep so the transition is mostly outside of it, each normalised to unity gain
+static void decim_build(void)
+{
+    double x, w, fc, sum, *row;
+    long bank, j;
+
+    for (bank = 0; bank < IPOKE_DECIM_BANKS; bank++)
+    {
+        row = decim_table + bank * IPOKE_DECIM_TAPS;
+        fc = 0.45 * (bank + 1) / IPOKE_DECIM_BANKS;                                     // in cycles per input sample
+        sum = 0.;
+        for (j = 0; j < IPOKE_DECIM_TAPS; j++)
+        {
+            x = j - (IPOKE_DECIM_TAPS - 1) * 0.5;
+            w = 0.42 + 0.5 * cos(2. * M_PI * x / IPOKE_DECIM_TAPS) + 0.08 * cos(4. * M_PI * x / IPOKE_DECIM_TAPS);
+            row[j] = sin(2. * M_PI * fc * x) / (M_PI * x) * w;
+            sum += row[j];
+        }
+        for (j = 0; j < IPOKE_DECIM_TAPS; j++)
+            row[j] /= sum;
+    }
+}
+
+static long fill_detect(void)
+{
+#ifdef IPOKE_X86
+#ifdef _MSC_VER
+    int info[4];
+
+    __cpuid(info, 0);
+    if (info[0] >= 7)
+    {
+        int osxsave, avx, fma;
+
+        __cpuid(info, 1);
+        osxsave = (info[2] >> 27) & 1;
+        avx = (info[2] >> 28) & 1;
+        fma = (info[2] >> 12) & 1;
+        __cpuidex(info, 7, 0);
+        if (osxsave && avx && fma && ((info[1] >> 5) & 1) && ((_xgetbv(0) & 6) == 6))
+            return IPOKE_ISA_AVX2;
+    }
+    __cpuid(info, 1);
+    if ((info[3] >> 26) & 1)
+        return IPOKE_ISA_SSE2;
+#else
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        return IPOKE_ISA_AVX2;
+    if (__builtin_cpu_supports("sse2"))
+        return IPOKE_ISA_SSE2;
+#endif
+#endif
+    return IPOKE_ISA_SCALAR;
+}
+
+long ipoke_fill_select(long isa)
+{
+    long best = fill_detect();
+
+    if (isa < 0 || isa > best)
+        isa = best;
+    if (fill_isa < 0)                                                   // the sinc and the anti-aliasing tables, once
+    {
+        sinc_build();
+        decim_build();
+    }
+
+    switch (isa)
+    {
+#ifdef IPOKE_X86
+        case IPOKE_ISA_AVX2:
+            fill_ramp_fn = fill_ramp_avx2;
+            fill_ramp_overdub_fn = fill_ramp_overdub_avx2;
+            fill_ramp_multi_fn = fill_ramp_multi_avx2;
+            fill_ramp_multi_overdub_fn = fill_ramp_multi_overdub_avx2;
+            fill_ramp_feedback_fn = fill_ramp_feedback_avx2;
+            fill_ramp_multi_feedback_fn = fill_ramp_multi_feedback_avx2;
+            fill_scale_fn = fill_scale_avx2;
+            fill_snap_fn = fill_snap_avx2;
+            fill_xfade_fn = fill_xfade_avx2;
+            fill_max_fn = fill_max_avx2;
+            fill_softsat_fn = fill_softsat_avx2;
+            fill_cubic_fn = fill_cubic_avx2;
+            fill_sinc_fn = fill_sinc_avx2;
+            fill_cubic_multi_fn = fill_cubic_multi_avx2;
+            fill_sinc_multi_fn = fill_sinc_multi_avx2;
+            fill_dot_fn = fill_dot_avx2;
+            fill_dot_multi_fn = fill_dot_multi_avx2;
+            break;
+        case IPOKE_ISA_SSE2:
+            fill_ramp_fn = fill_ramp_sse2;
+            fill_ramp_overdub_fn = fill_ramp_overdub_sse2;
+            fill_ramp_multi_fn = fill_ramp_multi_sse2;
+            fill_ramp_multi_overdub_fn = fill_ramp_multi_overdub_sse2;
+            fill_ramp_feedback_fn = fill_ramp_feedback_sse2;
+            fill_ramp_multi_feedback_fn = fill_ramp_multi_feedback_scalar;
+            fill_scale_fn = fill_scale_scalar;
+            fill_snap_fn = fill_snap_sse2;
+            fill_xfade_fn = fill_xfade_scalar;
+            fill_max_fn = fill_max_scalar;
+            fill_softsat_fn = fill_softsat_scalar;
+            fill_cubic_fn = fill_cubic_sse2;
+            fill_sinc_fn = fill_sinc_sse2;
+            fill_cubic_multi_fn = fill_cubic_multi_scalar;
+            fill_sinc_multi_fn = fill_sinc_multi_scalar;
+            fill_dot_fn = fill_dot_sse2;
+            fill_dot_multi_fn = fill_dot_multi_scalar;
+            break;
+#endif
+        default:
+            fill_ramp_fn = fill_ramp_scalar;
+            fill_ramp_overdub_fn = fill_ramp_overdub_scalar;
+            fill_ramp_multi_fn = fill_ramp_multi_scalar;
+            fill_ramp_multi_overdub_fn = fill_ramp_multi_overdub_scalar;
+            fill_ramp_feedback_fn = fill_ramp_feedback_scalar;
+            fill_ramp_multi_feedback_fn = fill_ramp_multi_feedback_scalar;
+            fill_scale_fn = fill_scale_scalar;
+            fill_snap_fn = fill_snap_scalar;
+            fill_xfade_fn = fill_xfade_scalar;
+            fill_max_fn = fill_max_scalar;
+            fill_softsat_fn = fill_softsat_scalar;
+            fill_cubic_fn = fill_cubic_scalar;
+            fill_sinc_fn = fill_sinc_scalar;
+            fill_cubic_multi_fn = fill_cubic_multi_scalar;
+            fill_sinc_multi_fn = fill_sinc_multi_scalar;
+            fill_dot_fn = fill_dot_scalar;
+            fill_dot_multi_fn = fill_dot_multi_scalar;
+            break;
+    }
+    ipoke_fill_barriere();                                              // the tables and the kernels before the ISA that says they are there
+    fill_isa = isa;
+    return isa;
+}
+
+const char *ipoke_fill_name(void)
+{
+    static const char *names[3] = { "scalar", "sse2", "avx2" };
+
+    if (fill_isa < 0)
+        ipoke_fill_select(-1);
+    return names[fill_isa];
+}
+
+void ipoke_fill_ramp(float *tab, long stride, long len, double base, double step)
+{
+    if (len < IPOKE_FILL_SHORT)                                         // short gaps are not worth the dispatch
+    {
+        fill_ramp_scalar(tab, stride, len, base, step);
+        return;
+    }
+    fill_ramp_fn(tab, stride, len, base, step);
+}
+
+void ipoke_fill_ramp_overdub(float *tab, long stride, long len, double base, double step, double overdub)
+{
+    if (len < IPOKE_FILL_SHORT)
+    {
+        fill_ramp_overdub_scalar(tab, stride, len, base, step, overdub);
+        return;
+    }
+    fill_ramp_overdub_fn(tab, stride, len, base, step, overdub);
+}
+
+void ipoke_fill_ramp_multi(float *tab, long stride, long nvals, long len, const double *base, const double *step)
+{
+    if (nvals == 1)
+    {
+        ipoke_fill_ramp(tab, stride, len, base[0], step[0]);
+        return;
+    }
+    if (len <= 0)
+        return;
+    if (nvals < 4)                                                      // not enough channels to fill a vector
+    {
+        fill_ramp_multi_scalar(tab, stride, nvals, len, base, step);
+        return;
+    }
+    fill_ramp_multi_fn(tab, stride, nvals, len, base, step);
+}
+
+void ipoke_fill_ramp_multi_overdub(float *tab, long stride, long nvals, long len, const double *base, const double *step, double overdub)
+{
+    if (nvals == 1)
+    {
+        ipoke_fill_ramp_overdub(tab, stride, len, base[0], step[0], overdub);
+        return;
+    }
+    if (len <= 0)
+        return;
+    if (nvals < 4)
+    {
+        fill_ramp_multi_overdub_scalar(tab, stride, nvals, len, base, step, overdub);
+        return;
+    }
+    fill_ramp_multi_overdub_fn(tab, stride, nvals, len, base, step, overdub);
+}
+
+void ipoke_fill_ramp_feedback(float *tab, long stride, long len, double base, double step, double od, double dod)
+{
+    if (len < IPOKE_FILL_SHORT)
+    {
+        fill_ramp_feedback_scalar(tab, stride, len, base, step, od, dod);
+        return;
+    }
+    fill_ramp_feedback_fn(tab, stride, len, base, step, od, dod);
+}
+
+void ipoke_fill_ramp_multi_feedback(float *tab, long stride, long nvals, long len, const double *base, const double *step, double od, double dod)
+{
+    if (nvals == 1)
+    {
+        ipoke_fill_ramp_feedback(tab, stride, len, base[0], step[0], od, dod);
+        return;
+    }
+    if (len <= 0)
+        return;
+    if (nvals < 4)
+    {
+        fill_ramp_multi_feedback_scalar(tab, stride, nvals, len, base, step, od, dod);
+        return;
+    }
+    fill_ramp_multi_feedback_fn(tab, stride, nvals, len, base, step, od, dod);
+}
+
+void ipoke_fill_scale(float *tab, long stride, long nvals, long len, double od, double dod)
+{
+    if (len < IPOKE_FILL_SHORT)
+    {
+        fill_scale_scalar(tab, stride, nvals, len, od, dod);
+        return;
+    }
+    fill_scale_fn(tab, stride, nvals, len, od, dod);
+}
+
+void ipoke_fill_xfade(float *tab, long stride, long nvals, long len, const float *src, double a, double b)
+{
+    if (len < IPOKE_FILL_SHORT)
+    {
+        fill_xfade_scalar(tab, stride, nvals, len, src, a, b);
+        return;
+    }
+    fill_xfade_fn(tab, stride, nvals, len, src, a, b);
+}
+
+void ipoke_fill_max(float *tab, long stride, long nvals, long len, const float *src)
+{
+    if (len < IPOKE_FILL_SHORT)
+    {
+        fill_max_scalar(tab, stride, nvals, len, src, 0., 0.);
+        return;
+    }
+    fill_max_fn(tab, stride, nvals, len, src, 0., 0.);
+}
+
+void ipoke_fill_snap(float *tab, long stride, long nvals, long len, float seuil)
+{
+    if (len * nvals < IPOKE_FILL_SHORT)
+    {
+        fill_snap_scalar(tab, stride, nvals, len, seuil);
+        return;
+    }
+    fill_snap_fn(tab, stride, nvals, len, seuil);
+}
+
+unsigned int ipoke_fill_flush_denormals(void)
+{
+#ifdef IPOKE_X86
+    unsigned int mode = _mm_getcsr();
+
+    _mm_setcsr(mode | 0x8040);                                          // flush to zero and denormals are zero
+    return mode;
+#elif defined(__aarch64__) && defined(__GNUC__)
+    unsigned long long mode;
+
+    __asm__ __volatile__("mrs %0, fpcr" : "=r"(mode));
+    __asm__ __volatile__("msr fpcr, %0" : : "r"(mode | (1ULL << 24)));   // flush to zero, which covers the inputs too
+    return (unsigned int)mode;
+#else
+    return 0;
+#endif
+}
+
+void ipoke_fill_restore_denormals(unsigned int mode)
+{
+#ifdef IPOKE_X86
+    _mm_setcsr(mode);
+#elif defined(__aarch64__) && defined(__GNUC__)
+    unsigned long long fpcr = mode;
+
+    __asm__ __volatile__("msr fpcr, %0" : : "r"(fpcr));
+#else
+    (void)mode;
+#endif
+}
+
+void ipoke_fill_softsat(float *tab, long stride, long nvals, long len, const float *src)
+{
+    if (len < IPOKE_FILL_SHORT)
+    {
+        fill_softsat_scalar(tab, stride, nvals, len, src, 0., 0.);
+        return;
+    }
+    fill_softsat_fn(tab, stride, nvals, len, src, 0., 0.);
+}
+
+void ipoke_fill_cubic(float *tab, long stride, long len, double t0, double dt, const double *coefs, double overdub)
+{
+    if (len <= 0)
+        return;
+    if (stride != 1 || len < IPOKE_FILL_SHORT)
+        fill_cubic_multi_scalar(tab, stride, 1, len, t0, dt, coefs, overdub);
+    else
+        fill_cubic_fn(tab, len, t0, dt, coefs, overdub);
+}
+
+void ipoke_fill_sinc(float *tab, long stride, long len, double t0, double dt, const double *points, double overdub)
+{
+    if (len <= 0)
+        return;
+    if (stride != 1 || len < IPOKE_FILL_SHORT)
+        fill_sinc_multi_scalar(tab, stride, 1, len, t0, dt, points, overdub);
+    else
+        fill_sinc_fn(tab, len, t0, dt, points, overdub);
+}
+
+void ipoke_fill_cubic_multi(float *tab, long stride, long nvals, long len, double t0, double dt, const double *coefs, double overdub)
+{
+    if (len <= 0)
+        return;
+    if (nvals < 4)
+        fill_cubic_multi_scalar(tab, stride, nvals, len, t0, dt, coefs, overdub);
+    else
+        fill_cubic_multi_fn(tab, stride, nvals, len, t0, dt, coefs, overdub);
+}
+
+void ipoke_fill_sinc_multi(float *tab, long stride, long nvals, long len, double t0, double dt, const double *points, double overdub)
+{
+    if (len <= 0)
+        return;
+    if (nvals < 4)
+        fill_sinc_multi_scalar(tab, stride, nvals, len, t0, dt, points, overdub);
+    else
+        fill_sinc_multi_fn(tab, stride, nvals, len, t0, dt, points, overdub);
+}
+
+double ipoke_fill_lowpass(const double *passe, double periode)
+{
+    return fill_dot_fn(passe, decim_filter(periode));
+}
+
+void ipoke_fill_lowpass_multi(double *out, const double *passe, long nvals, double periode)
+{
+    if (nvals < 4)
+        fill_dot_multi_scalar(out, passe, nvals, decim_filter(periode));
+    else
+        fill_dot_multi_fn(out, passe, nvals, decim_filter(periode));
+}
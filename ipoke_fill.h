@@ -0,0 +1,84 @@
+//    ipoke_fill - the gap-filling kernels of ipoke~
+//    by Pierre Alexandre Tremblay
+//    the ramps are computed as base + k * step instead of accumulating, so they vectorise and do not drift
+
+#ifndef IPOKE_FILL_H
+#define IPOKE_FILL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define IPOKE_ISA_SCALAR 0
+#define IPOKE_ISA_SSE2 1
+#define IPOKE_ISA_AVX2 2
+
+#define IPOKE_SINC_TAPS 8                           // points used by the windowed sinc fill
+#define IPOKE_SINC_CENTRE 3                         // position of the last written point among them
+#define IPOKE_SINC_PHASES 512                       // resolution of the precomputed table, in phases between two points
+
+#define IPOKE_DECIM_TAPS 64                         // length of the anti-aliasing low-pass filters
+#define IPOKE_DECIM_BANKS 64                        // number of precomputed cutoffs, from 1/IPOKE_DECIM_BANKS of the input rate to all of it
+
+// tab[k * stride] = base + k * step, for k in [0, len)
+void ipoke_fill_ramp(float *tab, long stride, long len, double base, double step);
+// tab[k * stride] = tab[k * stride] * overdub + base + k * step, for k in [0, len)
+void ipoke_fill_ramp_overdub(float *tab, long stride, long len, double base, double step, double overdub);
+
+// multichannel: tab[k * stride + c] = base[c] + k * step[c], for k in [0, len) and c in [0, nvals)
+// one frame of all the channels at a time, so interleaved buffers are walked contiguously
+void ipoke_fill_ramp_multi(float *tab, long stride, long nvals, long len, const double *base, const double *step);
+void ipoke_fill_ramp_multi_overdub(float *tab, long stride, long nvals, long len, const double *base, const double *step, double overdub);
+
+// the overdub ratio ramping too, from od by dod per frame: tab[k * stride] = tab[k * stride] * (od + k * dod) + base + k * step
+void ipoke_fill_ramp_feedback(float *tab, long stride, long len, double base, double step, double od, double dod);
+void ipoke_fill_ramp_multi_feedback(float *tab, long stride, long nvals, long len, const double *base, const double *step, double od, double dod);
+// tab[k * stride + c] *= od + k * dod: the ramping ratio applied before a higher order fill added with an overdub of 1
+void ipoke_fill_scale(float *tab, long stride, long nvals, long len, double od, double dod);
+
+// combining what was filled in src (len frames of nvals contiguous channels) with what was in tab, for the non-linear write modes
+// equal power crossfade: tab = tab * a + src * b
+void ipoke_fill_xfade(float *tab, long stride, long nvals, long len, const float *src, double a, double b);
+// the larger magnitude of the two
+void ipoke_fill_max(float *tab, long stride, long nvals, long len, const float *src);
+// their sum through ipoke_fill_sature
+void ipoke_fill_softsat(float *tab, long stride, long nvals, long len, const float *src);
+// a tanh-like curve, unity gain around zero and reaching +-1 at +-3
+double ipoke_fill_sature(double x);
+
+// tab[k * stride + c] = 0 where |tab[k * stride + c]| < seuil: the frames an overdub decayed to nearly nothing, before they become denormals
+void ipoke_fill_snap(float *tab, long stride, long nvals, long len, float seuil);
+
+// denormals flushed to zero, in and out, until the mode returned is restored: around each perform call, as they slow down the x86 maths a lot
+unsigned int ipoke_fill_flush_denormals(void);
+void ipoke_fill_restore_denormals(unsigned int mode);
+
+// higher order gap fills, parameterised by t = t0 + k * dt, the position in the gap from the last written point (t = 0) to the new one (t = 1)
+// overdub == 0 replaces, anything else multiplies what was in tab before adding
+
+// cubic polynomial: tab[k * stride] = ((coefs[3] * t + coefs[2]) * t + coefs[1]) * t + coefs[0]
+void ipoke_fill_cubic(float *tab, long stride, long len, double t0, double dt, const double *coefs, double overdub);
+// windowed sinc through IPOKE_SINC_TAPS points, points[IPOKE_SINC_CENTRE] being the last written one (t = 0) and the next one the new one (t = 1)
+void ipoke_fill_sinc(float *tab, long stride, long len, double t0, double dt, const double *points, double overdub);
+
+// multichannel versions: the coefficients and the points are stored by rows of nvals, e.g. coefs[j * nvals + c]
+void ipoke_fill_cubic_multi(float *tab, long stride, long nvals, long len, double t0, double dt, const double *coefs, double overdub);
+void ipoke_fill_sinc_multi(float *tab, long stride, long nvals, long len, double t0, double dt, const double *points, double overdub);
+
+// anti-aliasing when writing slower than real time: the input low-passed for a write head moving
+// one index every periode input samples, from the IPOKE_DECIM_TAPS last inputs (in any order, the filters are symmetric)
+// the filters are the tables ipoke_fill_select builds at load time
+double ipoke_fill_lowpass(const double *passe, double periode);
+// multichannel: the inputs by rows of nvals, passe[j * nvals + c], the nvals filtered values in out
+void ipoke_fill_lowpass_multi(double *out, const double *passe, long nvals, double periode);
+
+// builds the tables and picks the best instruction set, or a lower one (for benchmarking), and returns the one in use:
+// called once when the host loads the object, before any audio thread runs, as the kernels never do it themselves
+long ipoke_fill_select(long isa);
+const char *ipoke_fill_name(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,204 @@
+//    ipoke_partage - several ipoke~ writing the same buffer from different threads
+//    by Pierre Alexandre Tremblay
+//    the buffers shared are kept in a list under a mutex, only touched at dsp time. A stripe is taken with an atomic exchange,
+//    spinning while another writer holds it: it only ever holds it for the writes of one vector
+
+#include <stdlib.h>
+
+#include "ipoke_partage.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+static SRWLOCK ipoke_partage_mutex = SRWLOCK_INIT;
+#define ipoke_partage_verrouille() AcquireSRWLockExclusive(&ipoke_partage_mutex)
+#define ipoke_partage_deverrouille() ReleaseSRWLockExclusive(&ipoke_partage_mutex)
+#define ipoke_partage_echange(p) InterlockedExchange((volatile LONG *)(p), 1)
+#define ipoke_partage_libere(p) InterlockedExchange((volatile LONG *)(p), 0)
+#define ipoke_partage_lit(p) (*(p))
+#define ipoke_partage_compte(p) InterlockedIncrement((volatile LONG *)(p))
+#define ipoke_partage_cede() SwitchToThread()
+#else
+#include <pthread.h>
+#include <sched.h>
+static pthread_mutex_t ipoke_partage_mutex = PTHREAD_MUTEX_INITIALIZER;
+#define ipoke_partage_verrouille() pthread_mutex_lock(&ipoke_partage_mutex)
+#define ipoke_partage_deverrouille() pthread_mutex_unlock(&ipoke_partage_mutex)
+#define ipoke_partage_echange(p) __sync_lock_test_and_set((p), 1)
+#define ipoke_partage_libere(p) __sync_lock_release(p)
+#define ipoke_partage_lit(p) __atomic_load_n((p), __ATOMIC_RELAXED)
+#define ipoke_partage_compte(p) __sync_fetch_and_add((p), 1)
+#define ipoke_partage_cede() sched_yield()
+#endif
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define ipoke_partage_pause() _mm_pause()
+#elif defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ipoke_partage_pause() _mm_pause()
+#elif defined(__aarch64__)
+#define ipoke_partage_pause() __asm__ __volatile__("yield")
+#else
+#define ipoke_partage_pause()
+#endif
+
+#define IPOKE_PARTAGE_TOURS 256             // spins before giving the core to another thread
+
+static t_ipoke_partage *ipoke_partages = NULL;
+
+t_ipoke_partage *ipoke_partage_prend(const void *cle, long frames)
+{
+    t_ipoke_partage *p;
+    long i;
+
+    ipoke_partage_verrouille();
+    for (p = ipoke_partages; p && p->cle != cle; p = p->suivant)
+        ;
+    if (!p && (p = (t_ipoke_partage *)malloc(sizeof(t_ipoke_partage))))
+    {
+        p->cle = cle;
+        p->nb_bandes = (frames > 0) ? (frames + IPOKE_PARTAGE_BANDE - 1) / IPOKE_PARTAGE_BANDE : 1;
+        p->bandes = (volatile long *)malloc(p->nb_bandes * sizeof(long));
+        if (!p->bandes)
+        {
+            free(p);
+            p = NULL;
+        }
+        else
+        {
+            for (i = 0; i < p->nb_bandes; i++)
+                p->bandes[i] = 0;
+            p->references = 0;
+            p->attentes = 0;
+            p->suivant = ipoke_partages;
+            ipoke_partages = p;
+        }
+    }
+    if (p)
+        p->references++;
+    ipoke_partage_deverrouille();
+    return p;
+}
+
+void ipoke_partage_lache(t_ipoke_partage *p)
+{
+    t_ipoke_partage **q;
+
+    if (!p)
+        return;
+    ipoke_partage_verrouille();
+    if (!--p->references)
+    {
+        for (q = &ipoke_partages; *q != p; q = &(*q)->suivant)
+            ;
+        *q = p->suivant;
+        free((void *)p->bandes);
+        free(p);
+    }
+    ipoke_partage_deverrouille();
+}
+
+//***********************************************************************************************
+// from the audio thread
+
+// a run of frames the writer may write, as a run of stripes: the frames past the buffer as it was at dsp time go to its last stripe,
+// which keeps the order the same for every writer
+static void ipoke_partage_visite(void *data, long debut, long etendue)
+{
+    t_ipoke_bandes *b = (t_ipoke_bandes *)data;
+    long a = debut / IPOKE_PARTAGE_BANDE, z = (debut + etendue - 1) / IPOKE_PARTAGE_BANDE, i;
+
+    if (a >= b->nb_bandes)
+        a = b->nb_bandes - 1;
+    if (z >= b->nb_bandes)
+        z = b->nb_bandes - 1;
+    for (i = 0; i < b->nb; i++)
+        if (a <= b->fin[i] + 1 && z >= b->debut[i] - 1)                                 // touches a run already there
+        {
+            if (a < b->debut[i])
+                b->debut[i] = a;
+            if (z > b->fin[i])
+                b->fin[i] = z;
+            return;
+        }
+    if (b->nb == IPOKE_PARTAGE_PLAGES)                                                  // too many: all of them as one
+    {
+        for (i = 1; i < b->nb; i++)
+        {
+            if (b->debut[i] < b->debut[0])
+                b->debut[0] = b->debut[i];
+            if (b->fin[i] > b->fin[0])
+                b->fin[0] = b->fin[i];
+        }
+        b->nb = 1;
+        ipoke_partage_visite(data, a * IPOKE_PARTAGE_BANDE, (z - a + 1) * IPOKE_PARTAGE_BANDE);
+        return;
+    }
+    b->debut[b->nb] = a;
+    b->fin[b->nb] = z;
+    b->nb++;
+}
+
+void ipoke_partage_entre(t_ipoke_partage *p, t_ipoke_bandes *b, const t_ipoke_core *x, long frames, const double *inind, long n)
+{
+    long i, j, k, a, z, tours;
+
+    b->nb = 0;
+    b->nb_bandes = p->nb_bandes;
+    ipoke_core_portee(x, frames, inind, n, ipoke_partage_visite, b);
+
+    for (i = 1; i < b->nb; i++)                                                         // in increasing order, merging the ones a later run joined
+    {
+        a = b->debut[i];
+        z = b->fin[i];
+        for (j = i; j > 0 && b->debut[j - 1] > a; j--)
+        {
+            b->debut[j] = b->debut[j - 1];
+            b->fin[j] = b->fin[j - 1];
+        }
+        b->debut[j] = a;
+        b->fin[j] = z;
+    }
+    for (i = 1, j = 0; i < b->nb; i++)
+    {
+        if (b->debut[i] <= b->fin[j] + 1)
+        {
+            if (b->fin[i] > b->fin[j])
+                b->fin[j] = b->fin[i];
+        }
+        else
+        {
+            j++;
+            b->debut[j] = b->debut[i];
+            b->fin[j] = b->fin[i];
+        }
+    }
+    if (b->nb)
+        b->nb = j + 1;
+
+    for (i = 0; i < b->nb; i++)
+        for (k = b->debut[i]; k <= b->fin[i]; k++)
+            if (ipoke_partage_echange(p->bandes + k))
+            {
+                ipoke_partage_compte(&p->attentes);
+                for (tours = 0; ipoke_partage_echange(p->bandes + k); tours++)
+                {
+                    while (ipoke_partage_lit(p->bandes + k))                                                // read until it looks free, not to bounce its cache line
+                        if (++tours < IPOKE_PARTAGE_TOURS)
+                            ipoke_partage_pause();
+                        else
+                            ipoke_partage_cede();
+                }
+            }
+}
+
+void ipoke_partage_sort(t_ipoke_partage *p, t_ipoke_bandes *b)
+{
+    long i, k;
+
+    for (i = 0; i < b->nb; i++)
+        for (k = b->debut[i]; k <= b->fin[i]; k++)
+            ipoke_partage_libere(p->bandes + k);
+    b->nb = 0;
+}
@@ -0,0 +1,51 @@
+//    ipoke_partage - several ipoke~ writing the same buffer from different threads
+//    by Pierre Alexandre Tremblay
+//    the buffer is cut in stripes, each with a flag: before its read-modify-writes, a writer takes the flags of the stripes it may
+//    write (see ipoke_core_portee), always in increasing order so that no two writers can wait for each other, and lets go of them
+//    once they are done. Writers in different parts of the buffer never wait, the ones on the same frames take turns, so no overdub is lost
+
+#ifndef IPOKE_PARTAGE_H
+#define IPOKE_PARTAGE_H
+
+#include "ipoke_core.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define IPOKE_PARTAGE_BANDE 4096            // frames of a stripe
+#define IPOKE_PARTAGE_PLAGES 16             // runs of stripes a writer holds at once: past them, one run from the first stripe to the last
+
+typedef struct _ipoke_partage
+{
+    const void *cle;                        // the buffer it guards, as the host knows it
+    long nb_bandes;
+    volatile long *bandes;                  // 1 while a writer holds the stripe
+    long references;                        // the writers sharing it
+    volatile long attentes;                 // times a writer found a stripe taken
+    struct _ipoke_partage *suivant;         // the other buffers
+} t_ipoke_partage;
+
+// the stripes a writer holds
+typedef struct _ipoke_bandes
+{
+    long debut[IPOKE_PARTAGE_PLAGES];       // first and last stripe of each run, in increasing order
+    long fin[IPOKE_PARTAGE_PLAGES];
+    long nb;
+    long nb_bandes;                         // of the buffer they were taken in, to clamp the frames past its size at dsp time
+} t_ipoke_bandes;
+
+// the stripes of the buffer known as cle, of frames frames, shared with the other writers that took it: NULL if it could not be allocated.
+// not from the audio thread. ipoke_partage_lache gives it back, the last one freeing it
+t_ipoke_partage *ipoke_partage_prend(const void *cle, long frames);
+void ipoke_partage_lache(t_ipoke_partage *p);
+
+// from the audio thread, around the writes of x with the n indices: waits for the stripes they may write and takes them
+void ipoke_partage_entre(t_ipoke_partage *p, t_ipoke_bandes *b, const t_ipoke_core *x, long frames, const double *inind, long n);
+void ipoke_partage_sort(t_ipoke_partage *p, t_ipoke_bandes *b);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,300 @@
+//    ipoke_undo - the undo of ipoke~
+//    by Pierre Alexandre Tremblay
+//    the pages saved in a take are found again through a small hash table, marked with the number of the take rather than cleared
+//    at each one. The audio thread and the thread undoing hand the buffer over as the sound file windows are (see ipoke_disk.c):
+//    each says what it is doing before checking the other, with a full barrier in between
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "ipoke_undo.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#define ipoke_undo_barriere() MemoryBarrier()
+#define ipoke_undo_cede() SwitchToThread()
+#else
+#include <sched.h>
+#define ipoke_undo_barriere() __sync_synchronize()
+#define ipoke_undo_cede() sched_yield()
+#endif
+
+typedef struct _ipoke_visee
+{
+    t_ipoke_undo *u;
+    const float *tab;
+    long frames;
+    long nc;
+    long chan;
+    long nchans;
+} t_ipoke_visee;
+
+void ipoke_undo_init(t_ipoke_undo *u)
+{
+    memset(u, 0, sizeof(t_ipoke_undo));
+}
+
+void ipoke_undo_free(t_ipoke_undo *u)
+{
+    free(u->pool);
+    free(u->pages);
+    free(u->chans);
+    free(u->table);
+    free(u->marques);
+    ipoke_undo_init(u);
+}
+
+long ipoke_undo_set(t_ipoke_undo *u, long frames)
+{
+    long capacite = (frames > 0) ? (frames + IPOKE_UNDO_PAGE - 1) / IPOKE_UNDO_PAGE : 0;
+    long taille = 1;
+
+    ipoke_undo_free(u);
+    if (!capacite)
+        return 1;
+    while (taille < 2 * capacite)
+        taille <<= 1;
+    u->pool = (float *)malloc(capacite * IPOKE_UNDO_PAGE * sizeof(float));
+    u->pages = (long *)malloc(capacite * sizeof(long));
+    u->chans = (long *)malloc(capacite * sizeof(long));
+    u->table = (long *)malloc(taille * sizeof(long));
+    u->marques = (unsigned long *)calloc(taille, sizeof(unsigned long));
+    if (!u->pool || !u->pages || !u->chans || !u->table || !u->marques)
+    {
+        ipoke_undo_free(u);
+        return 0;
+    }
+    u->capacite = capacite;
+    u->masque = taille - 1;
+    return 1;
+}
+
+//***********************************************************************************************
+// the takes
+
+static t_ipoke_prise *ipoke_undo_prise(t_ipoke_undo *u, long i)
+{
+    return u->prises + (u->premiere_prise + i) % IPOKE_UNDO_PRISES;
+}
+
+static void ipoke_undo_vide(t_ipoke_undo *u)
+{
+    u->premiere = u->nb = 0;
+    u->premiere_prise = u->nb_prises = u->defaites = 0;
+    u->ouverte = 0;
+    u->numero++;                                                    // and the table with them
+}
+
+// drops the oldest take, to make room
+static void ipoke_undo_oublie(t_ipoke_undo *u)
+{
+    t_ipoke_prise *p = ipoke_undo_prise(u, 0);
+
+    u->premiere = (u->premiere + p->nb) % u->capacite;
+    u->nb -= p->nb;
+    u->premiere_prise = (u->premiere_prise + 1) % IPOKE_UNDO_PRISES;
+    u->nb_prises--;
+    if (u->defaites > u->nb_prises)
+        u->defaites = u->nb_prises;
+}
+
+// a new take, after the last one: the ones undone cannot be redone any more
+static void ipoke_undo_ouvre(t_ipoke_undo *u)
+{
+    t_ipoke_prise *p;
+
+    for (; u->defaites; u->defaites--)
+    {
+        u->nb -= ipoke_undo_prise(u, u->nb_prises - 1)->nb;
+        u->nb_prises--;
+    }
+    if (u->nb_prises == IPOKE_UNDO_PRISES)
+        ipoke_undo_oublie(u);
+    p = ipoke_undo_prise(u, u->nb_prises);
+    p->premiere = (u->premiere + u->nb) % u->capacite;
+    p->nb = 0;
+    p->complete = 1;
+    u->nb_prises++;
+    u->numero++;
+    u->ouverte = 1;
+}
+
+// saves channel c of a page, unless this take already did
+static void ipoke_undo_garde(t_ipoke_undo *u, const float *tab, long frames, long nc, long page, long c)
+{
+    unsigned long h;
+    long e, k, debut, len;
+    t_ipoke_prise *p;
+
+    if (!u->ouverte)
+        ipoke_undo_ouvre(u);
+    p = ipoke_undo_prise(u, u->nb_prises - 1);
+    h = ((unsigned long)page * 2654435761UL + (unsigned long)c * 40503UL) & (unsigned long)u->masque;
+    while (u->marques[h] == u->numero)
+    {
+        e = u->table[h];
+        if (u->pages[e] == page && u->chans[e] == c)
+            return;
+        h = (h + 1) & (unsigned long)u->masque;
+    }
+    if (!p->complete)
+        return;
+    while (u->nb == u->capacite && u->nb_prises > 1)
+        ipoke_undo_oublie(u);
+    if (u->nb == u->capacite)                                       // this take alone fills the pool: it will not be undone
+    {
+        p->complete = 0;
+        return;
+    }
+
+    e = (u->premiere + u->nb) % u->capacite;
+    debut = page * IPOKE_UNDO_PAGE;
+    len = (frames - debut < IPOKE_UNDO_PAGE) ? frames - debut : IPOKE_UNDO_PAGE;
+    for (k = 0; k < len; k++)
+        u->pool[e * IPOKE_UNDO_PAGE + k] = tab[(debut + k) * nc + c];
+    u->pages[e] = page;
+    u->chans[e] = c;
+    u->table[h] = e;
+    u->marques[h] = u->numero;
+    u->nb++;
+    p->nb++;
+}
+
+static void ipoke_undo_visite(void *data, long debut, long etendue)
+{
+    t_ipoke_visee *v = (t_ipoke_visee *)data;
+    long page, c;
+
+    for (page = debut / IPOKE_UNDO_PAGE; page <= (debut + etendue - 1) / IPOKE_UNDO_PAGE; page++)
+        for (c = v->chan; c < v->chan + v->nchans; c++)
+            ipoke_undo_garde(v->u, v->tab, v->frames, v->nc, page, c);
+}
+
+//***********************************************************************************************
+// from the audio thread
+
+long ipoke_undo_enter(t_ipoke_undo *u)
+{
+    u->ecrit = 1;
+    ipoke_undo_barriere();
+    if (u->occupe)
+    {
+        u->ecrit = 0;
+        return 0;
+    }
+    return 1;
+}
+
+void ipoke_undo_leave(t_ipoke_undo *u)
+{
+    ipoke_undo_barriere();                                          // the writes done before the buffer is handed over
+    u->ecrit = 0;
+}
+
+void ipoke_undo_save(t_ipoke_undo *u, const t_ipoke_core *x, float *tab, long frames, long nc, long chan, long nchans, const double *inind, long n)
+{
+    t_ipoke_visee v;
+
+    if (!u->capacite)
+        return;
+    if (tab != u->tab || frames != u->frames || nc != u->nc)       // another buffer, or the same one resized
+    {
+        ipoke_undo_vide(u);
+        u->tab = tab;
+        u->frames = frames;
+        u->nc = nc;
+    }
+    v.u = u;
+    v.tab = tab;
+    v.frames = frames;
+    v.nc = nc;
+    v.chan = chan;
+    v.nchans = nchans;
+    ipoke_core_portee(x, frames, inind, n, ipoke_undo_visite, &v);
+}
+
+void ipoke_undo_close(t_ipoke_undo *u)
+{
+    u->ouverte = 0;
+}
+
+//***********************************************************************************************
+// undo and redo
+
+static void ipoke_undo_echange(t_ipoke_undo *u, const t_ipoke_prise *p, float *tab, long frames, long nc)
+{
+    long i, e, k, debut, len, c;
+    float t;
+
+    for (i = 0; i < p->nb; i++)
+    {
+        e = (p->premiere + i) % u->capacite;
+        debut = u->pages[e] * IPOKE_UNDO_PAGE;
+        len = (frames - debut < IPOKE_UNDO_PAGE) ? frames - debut : IPOKE_UNDO_PAGE;
+        c = u->chans[e];
+        for (k = 0; k < len; k++)
+        {
+            t = tab[(debut + k) * nc + c];
+            tab[(debut + k) * nc + c] = u->pool[e * IPOKE_UNDO_PAGE + k];
+            u->pool[e * IPOKE_UNDO_PAGE + k] = t;
+        }
+    }
+}
+
+// waits for the vector being written, and keeps the next ones out
+static void ipoke_undo_prend(t_ipoke_undo *u)
+{
+    u->occupe = 1;
+    ipoke_undo_barriere();
+    while (u->ecrit)
+        ipoke_undo_cede();
+}
+
+static void ipoke_undo_rend(t_ipoke_undo *u)
+{
+    ipoke_undo_barriere();
+    u->occupe = 0;
+}
+
+long ipoke_undo_undo(t_ipoke_undo *u, float *tab, long frames, long nc)
+{
+    t_ipoke_prise *p;
+    long r = 0;
+
+    ipoke_undo_prend(u);
+    u->ouverte = 0;                                                 // the take being written ends here
+    if (tab != u->tab || frames != u->frames || nc != u->nc)
+        ipoke_undo_vide(u);
+    else if (u->defaites < u->nb_prises)
+    {
+        p = ipoke_undo_prise(u, u->nb_prises - 1 - u->defaites);
+        if (p->complete)
+        {
+            ipoke_undo_echange(u, p, tab, frames, nc);
+            u->defaites++;
+            r = 1;
+        }
+        else
+            r = -1;
+    }
+    ipoke_undo_rend(u);
+    return r;
+}
+
+long ipoke_undo_redo(t_ipoke_undo *u, float *tab, long frames, long nc)
+{
+    long r = 0;
+
+    ipoke_undo_prend(u);
+    if (tab != u->tab || frames != u->frames || nc != u->nc)
+        ipoke_undo_vide(u);
+    else if (u->defaites)
+    {
+        ipoke_undo_echange(u, ipoke_undo_prise(u, u->nb_prises - u->defaites), tab, frames, nc);
+        u->defaites--;
+        r = 1;
+    }
+    ipoke_undo_rend(u);
+    return r;
+}
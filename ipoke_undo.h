@@ -0,0 +1,74 @@
+//    ipoke_undo - the undo of ipoke~
+//    by Pierre Alexandre Tremblay
+//    before each vector, the pages of the buffer it may write are saved in a pool allocated beforehand, the first time each of them
+//    is touched in a take (from a start of the writing to its stop), so that undoing a take only puts back what it wrote.
+//    undo and redo swap the saved pages with the buffer, so each can be taken back by the other
+
+#ifndef IPOKE_UNDO_H
+#define IPOKE_UNDO_H
+
+#include "ipoke_core.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define IPOKE_UNDO_PAGE 1024                // frames of one channel in a page, the unit saved
+#define IPOKE_UNDO_PRISES 64                // takes kept, the oldest going first
+
+typedef struct _ipoke_prise
+{
+    long premiere;                          // its first page in the pool
+    long nb;                                // and how many
+    char complete;                          // all it wrote was saved, so it can be undone
+} t_ipoke_prise;
+
+typedef struct _ipoke_undo
+{
+    float *pool;                            // capacite pages
+    long *pages;                            // the page each holds, and its channel
+    long *chans;
+    long capacite;
+    long premiere;                          // the pages in use, a ring from premiere
+    long nb;
+    long *table;                            // the pages saved in the current take, by page and channel, in open addressing
+    unsigned long *marques;                 // the take each slot was filled in, so that it never has to be cleared
+    long masque;                            // its size minus one, a power of two at least twice capacite
+    unsigned long numero;                   // the current take
+    t_ipoke_prise prises[IPOKE_UNDO_PRISES];    // a ring from premiere_prise
+    long premiere_prise;
+    long nb_prises;
+    long defaites;                          // how many of the last ones are undone, for redo
+    char ouverte;                           // the last one is still being written
+    const float *tab;                       // the buffer they were taken in: a new one drops them
+    long frames;
+    long nc;
+    volatile long ecrit;                    // the audio thread is writing
+    volatile long occupe;                   // undo or redo in progress: the audio thread does not write
+} t_ipoke_undo;
+
+void ipoke_undo_init(t_ipoke_undo *u);
+// room for frames frames of one channel, rounded up to pages, or none with 0 (not from the audio thread): returns 0 if it could not
+long ipoke_undo_set(t_ipoke_undo *u, long frames);
+void ipoke_undo_free(t_ipoke_undo *u);
+
+// from the audio thread, around all the writes of a vector in the buffer: returns 0 if an undo or a redo is going on,
+// in which case the vector is not written and ipoke_undo_leave is not called
+long ipoke_undo_enter(t_ipoke_undo *u);
+void ipoke_undo_leave(t_ipoke_undo *u);
+// before x writes the n indices in channels chan to chan + nchans - 1 of tab: saves the pages it may write that this take has not
+// saved yet, opening a take if none is. When the pool is full the oldest takes are dropped, and the current one if it alone fills it
+void ipoke_undo_save(t_ipoke_undo *u, const t_ipoke_core *x, float *tab, long frames, long nc, long chan, long nchans, const double *inind, long n);
+// the writing stopped: the next save opens a new take
+void ipoke_undo_close(t_ipoke_undo *u);
+
+// from any other thread, with the buffer in hand: put back the pages of the last take not undone, or take back the last undo.
+// return 1, 0 if there was none, -1 if the take was too long for the pool (then it stays as it is)
+long ipoke_undo_undo(t_ipoke_undo *u, float *tab, long frames, long nc);
+long ipoke_undo_redo(t_ipoke_undo *u, float *tab, long frames, long nc);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -10,26 +10,117 @@
 #include "ext_obex.h"
 #include "z_dsp.h"
 #include "ext_buffer.h"    // this defines our buffer's data structure and other goodies
+#include "ext_systime.h"   // systimer_gettime, to time the buffer lock
+#include "ext_systhread.h" // the threads of the offline rendering and of the sound file
+#include "ext_atomic.h"
+#include "ipoke_core.h"    // the host-independent write engine
+#include "ipoke_disk.h"    // and its sound file target
+#include "ipoke_undo.h"    // and the undo of its takes
+#include "ipoke_partage.h" // and the writers sharing a buffer from different threads
 
-#define CLIP(a, lo, hi) ( (a)>(lo)?( (a)<(hi)?(a):(hi) ):(lo) )
+#define IPOKE_FILS 4                    // threads of an offline rendering
+#define IPOKE_SUIVI 100.                // ms between two reports of its progress
+#define IPOKE_SERVICE 5                 // ms between two rounds of the sound file service
+
+// the written region handed from the audio thread to the scheduler: its first frame is stored before its length, read after it
+#ifdef WIN_VERSION
+#define ipoke_barriere() MemoryBarrier()
+#else
+#define ipoke_barriere() __sync_synchronize()
+#endif
+
+// the ipoke~ writing the same buffer~ from the audio thread: the first one to write in a tick looks it up and locks it for all of them,
+// the last one unlocks it, and the buffer~ is marked dirty once for all of them. They run in the order their dsp methods were called,
+// so each gets a rank there: a rank not above the last one starts a new tick. Two of them in it at once run in different threads
+// (a poly~ with parallel on): from then on each one locks the buffer~ on its own, until the next dsp start
+typedef struct _ipoke_groupe
+{
+    t_symbol *nom;                      // the buffer~
+    long membres;                       // the objects in it
+    long tour;                          // counts the dsp starts, see ipoke_groupe_range
+    long rangs;                         // the next rank in this one
+    long dernier;                       // the rank of the last one that came
+    long fin;                           // the last one that came in the last tick: it unlocks
+    t_int32_atomic dedans;              // the objects between ipoke_groupe_entre and ipoke_groupe_sort, counted atomically
+    t_int32_atomic divise;              // there were two at once: they lock on their own
+    char ouvert;                        // it is locked, or could not be
+    char ecrit;                         // something was written in this lock
+    t_buffer_obj *b;
+    float *tab;                         // NULL if it could not be locked
+    long frames;
+    long nc;
+    double msr;                         // samples per ms
+    double debut;                       // when it was locked
+    volatile char sale;                 // written since it was last marked dirty
+    struct _ipoke_groupe *suivant;      // the other buffers~
+} t_ipoke_groupe;
 
 typedef struct _ipoke
 {
     t_pxobject l_obj;
     t_symbol *l_sym;
+    t_symbol *l_nom;                    // the buffer~ set, l_sym until a set message
     t_buffer_ref *l_buf;
-    char l_chan;
-    bool l_interp;
-    double l_overdub;
-    long l_index_precedent;
-    long l_nb_val;
-    double l_valeur;
+    long l_chan;                        // first buffer channel written
+    long l_nchans;                      // number of buffer channels written, 0 for as many as there are value channels
+    long l_nvals;                       // number of value inlets
+    long l_ninputs;                     // number of value channels received, set at dsp time
+    long l_index_in;                    // position of the index among the signal inputs, after all the value channels
+    long l_retour_in;                   // position of the overdub ratio signal, -1 when none is connected
+    double **l_vals;                    // value channel of each written buffer channel, cycling through the inputs
+    double *l_valeurs;                  // the signals of the 32-bit perform routine widened to doubles, a vector per inlet
+    double **l_signaux;                 // pointing at them, as the 64-bit perform routine takes them
+    long l_journal;                     // frames of the staging area, 0 to write in the buffer under its lock
+    double l_verrou;                    // total time the buffer was locked since the last lockstat, in ms
+    double l_verrou_max;                // longest lock since the last lockstat, in ms
+    long l_nb_verrou;                   // number of locks since the last lockstat
+    void *l_out;                        // the written region, as dirty <first frame> <number of frames>
+    void *l_horloge;                    // reports it from the scheduler
+    double l_dirtyrate;                 // shortest time between two reports, in ms
+    double l_sr;                        // sample rate, to turn it into samples
+    long l_periode;                     // the same in samples
+    long l_attente;                     // samples since the last report
+    volatile long l_modif_debut;        // the region handed to the scheduler
+    volatile long l_modif_etendue;      // its length, 0 once reported
+    void *l_rapport;                    // reports the stats periodically
+    double l_statsrate;                 // every so many ms, 0 for only on the stats message
+    t_ipoke_rendu l_rendu;              // the offline rendering in progress, see ipoke_render
+    t_systhread l_fils[IPOKE_FILS];     // the threads writing its parts
+    long l_nb_fils;
+    volatile long l_part;               // the next part to write
+    volatile long l_finis;              // threads done
+    char l_rendant;                     // a rendering is in progress: the perform routines do not write meanwhile
+    t_buffer_obj *l_cible;              // the buffer~ it writes, locked by its threads a block at a time
+    double *l_donnees;                  // its inputs, copied from the message or the buffers~: the values of each channel, then the indices
+    const double **l_entrees;           // the values of each written channel
+    void *l_suivi;                      // reports its progress from the scheduler
+    t_symbol *l_fichier;                // sound file to write instead of the buffer~, NULL for the buffer~: opened at the next dsp start
+    long l_frames_fichier;              // its frames and channels when it is to be created, 0 to open it as it is
+    long l_nc_fichier;
+    char l_change;                      // l_fichier was set since the last dsp start
+    t_ipoke_disk *l_disque;             // the one open, NULL while writing the buffer~
+    t_systhread l_service;              // maps and flushes it ahead of the writing
+    volatile char l_arret;              // stops the service
+    long l_nb_tetes;                    // write heads, each with its own index: l_core and the l_nb_tetes - 1 of l_tetes
+    long l_actives;                     // the ones with an index signal, set at dsp time
+    t_ipoke_core *l_tetes;
+    long l_undo;                        // frames of the undo pool asked for, rounded up to pages, allocated at the next dsp start
+    t_ipoke_undo l_annule;              // the pages saved before each take
+    char l_concurrent;                  // other writers of the buffer may run in other threads, applied at the next dsp start
+    t_ipoke_partage *l_partage;         // the stripes of the buffer shared with them, taken at dsp time
+    t_ipoke_bandes l_bandes;            // the ones held by this vector
+    char l_groupe_on;                   // writes in the lock of the other ipoke~ of the buffer~, applied at the next dsp start
+    t_ipoke_groupe *l_groupe;           // the ones it joined, taken at dsp time
+    long l_rang;                        // its place in the group, in the order of the dsp
+    long l_tour;                        // the dsp start it was ranked in
+    t_ipoke_core l_core;
 } t_ipoke;
 
 // method prototypes
-void *ipoke_new(t_symbol *s, long chan);
+void *ipoke_new(t_symbol *s, long chan, long nvals, long tetes);
+void ipoke_free(t_ipoke *x);
 
-void ipoke_dsp(t_ipoke *x, t_signal **sp);
+void ipoke_dsp(t_ipoke *x, t_signal **sp, short *count);
 void ipoke_dsp64(t_ipoke *x, t_object *dsp64, short *count, double samplerate, long maxvectorsize, long flags);
 
 t_int *ipoke_perform(t_int *w);
@@ -37,59 +128,187 @@ void ipoke_perform64(t_ipoke *x, t_object *dsp64, double **ins, long numins, dou
 
 void ipoke_set(t_ipoke *x, t_symbol *s);
 void ipoke_int(t_ipoke *x, long n);
+void ipoke_list(t_ipoke *x, t_symbol *s, long argc, t_atom *argv);
 void ipoke_interp(t_ipoke *x, long n);
 void ipoke_overdub(t_ipoke *x, double n);
+void ipoke_combine(t_ipoke *x, long n);
+void ipoke_antialias(t_ipoke *x, long n);
+void ipoke_splat(t_ipoke *x, long n);
+void ipoke_maxfill(t_ipoke *x, long n);
+void ipoke_jump(t_ipoke *x, long n);
+void ipoke_jumpfade(t_ipoke *x, long n);
+void ipoke_snap(t_ipoke *x, double n);
+void ipoke_loop(t_ipoke *x, t_symbol *s, long argc, t_atom *argv);
+void ipoke_render(t_ipoke *x, t_symbol *s, long argc, t_atom *argv);
+void ipoke_suivi(t_ipoke *x);
+void ipoke_journal(t_ipoke *x, long n);
+void ipoke_disk(t_ipoke *x, t_symbol *s, long argc, t_atom *argv);
+void ipoke_undopool(t_ipoke *x, long n);
+void ipoke_units(t_ipoke *x, t_symbol *s);
+void ipoke_seek(t_ipoke *x, double position);
+void ipoke_reset_tete(t_ipoke *x);
+void ipoke_undo(t_ipoke *x);
+void ipoke_redo(t_ipoke *x);
+void ipoke_lockstat(t_ipoke *x);
+void ipoke_concurrent(t_ipoke *x, long n);
+void ipoke_group(t_ipoke *x, long n);
+void ipoke_dirtyrate(t_ipoke *x, double ms);
+void ipoke_tick(t_ipoke *x);
+void ipoke_stats(t_ipoke *x, t_symbol *s, long argc, t_atom *argv);
+void ipoke_statsrate(t_ipoke *x, double ms);
+void ipoke_rapport(t_ipoke *x);
+void ipoke_select(t_ipoke *x);
 void ipoke_dblclick(t_ipoke *x);
 void ipoke_assist(t_ipoke *x, void *b, long m, long a, char *s);
 
-inline long wrap_index(size_t index, size_t arrayLength);
-
 // global class pointer variable
 static t_class *ipoke_class = NULL;
+static t_symbol *ps_dirty;
 
 
 //***********************************************************************************************
 
 C74_EXPORT void ext_main(void *r)
 {
-	t_class *c = class_new("ipoke~", (method)ipoke_new, (method)dsp_free, (long)sizeof(t_ipoke), 0L, A_SYM, A_DEFLONG, 0);
+	t_class *c = class_new("ipoke~", (method)ipoke_new, (method)ipoke_free, (long)sizeof(t_ipoke), 0L, A_SYM, A_DEFLONG, A_DEFLONG, A_DEFLONG, 0);
 
     class_addmethod(c, (method)ipoke_int, "int", A_LONG, 0);
+    class_addmethod(c, (method)ipoke_list, "list", A_GIMME, 0);
     class_addmethod(c, (method)ipoke_dsp, "dsp", A_CANT, 0);
     class_addmethod (c, (method)ipoke_dsp64, "dsp64", A_CANT, 0L); //support max6 64 bits
     class_addmethod(c, (method)ipoke_set, "set", A_SYM, 0);
     class_addmethod(c, (method)ipoke_interp, "interp", A_LONG, 0);
     class_addmethod(c, (method)ipoke_overdub, "overdub", A_FLOAT, 0);
+    class_addmethod(c, (method)ipoke_combine, "combine", A_LONG, 0);
+    class_addmethod(c, (method)ipoke_antialias, "antialias", A_LONG, 0);
+    class_addmethod(c, (method)ipoke_splat, "splat", A_LONG, 0);
+    class_addmethod(c, (method)ipoke_maxfill, "maxfill", A_LONG, 0);
+    class_addmethod(c, (method)ipoke_jump, "jump", A_LONG, 0);
+    class_addmethod(c, (method)ipoke_jumpfade, "jumpfade", A_LONG, 0);
+    class_addmethod(c, (method)ipoke_snap, "snap", A_FLOAT, 0);
+    class_addmethod(c, (method)ipoke_loop, "loop", A_GIMME, 0);
+    class_addmethod(c, (method)ipoke_units, "units", A_SYM, 0);
+    class_addmethod(c, (method)ipoke_seek, "seek", A_FLOAT, 0);
+    class_addmethod(c, (method)ipoke_reset_tete, "reset", 0);
+    class_addmethod(c, (method)ipoke_render, "render", A_GIMME, 0);
+    class_addmethod(c, (method)ipoke_journal, "journal", A_LONG, 0);
+    class_addmethod(c, (method)ipoke_disk, "disk", A_GIMME, 0);
+    class_addmethod(c, (method)ipoke_undopool, "undopool", A_LONG, 0);
+    class_addmethod(c, (method)ipoke_undo, "undo", 0);
+    class_addmethod(c, (method)ipoke_redo, "redo", 0);
+    class_addmethod(c, (method)ipoke_lockstat, "lockstat", 0);
+    class_addmethod(c, (method)ipoke_concurrent, "concurrent", A_LONG, 0);
+    class_addmethod(c, (method)ipoke_group, "group", A_LONG, 0);
+    class_addmethod(c, (method)ipoke_dirtyrate, "dirtyrate", A_FLOAT, 0);
+    class_addmethod(c, (method)ipoke_stats, "stats", A_GIMME, 0);
+    class_addmethod(c, (method)ipoke_statsrate, "statsrate", A_FLOAT, 0);
     class_addmethod(c, (method)ipoke_assist, "assist", A_CANT, 0);
     class_addmethod(c, (method)ipoke_dblclick, "dblclick", A_CANT, 0);
     
     class_dspinit(c);
     class_register(CLASS_BOX, c);
     ipoke_class = c;    
+    ps_dirty = gensym("dirty");
+    ipoke_fill_select(-1);                              // the fill tables and kernels, here rather than on the audio thread
 }
 
 
-void *ipoke_new(t_symbol *s, long chan)
+void *ipoke_new(t_symbol *s, long chan, long nvals, long tetes)
 {
 	t_ipoke *x = (t_ipoke *)object_alloc(ipoke_class);
+    long i;
 
 	if (x) {
-        dsp_setup((t_pxobject *)x, 3);          // 3 audio inlets
+        x->l_nvals = MAX(nvals, 1);                     // 3rd argument - number of channels written at once
+        dsp_setup((t_pxobject *)x, x->l_nvals + 2);     // value inlets, index inlet, channel inlet
+        x->l_obj.z_misc |= Z_MC_INLETS;                 // the values can also come as one multichannel signal
         
         x->l_sym = s;
-        x->l_interp = 1;
-        x->l_overdub = 0;
-        x->l_index_precedent = -1;
+        x->l_nom = s;                                   // until a set message
+        x->l_ninputs = x->l_nvals;
+        x->l_index_in = x->l_nvals;
+        x->l_retour_in = -1;
+        ipoke_core_init(&x->l_core);
+        ipoke_undo_init(&x->l_annule);
+        
+        x->l_nb_tetes = MAX(tetes, 1);                  // 4th argument - number of write heads
+        x->l_actives = 1;
+        if (x->l_nb_tetes > 1)
+        {
+            x->l_tetes = (t_ipoke_core *)sysmem_newptr((x->l_nb_tetes - 1) * sizeof(t_ipoke_core));
+            if (!x->l_tetes)
+            {
+                object_error((t_object *)x, "could not allocate %ld write heads", x->l_nb_tetes);
+                x->l_nb_tetes = 1;
+            }
+            for (i = 1; i < x->l_nb_tetes; i++)
+                ipoke_core_init(x->l_tetes + i - 1);
+        }
+        
+        x->l_out = outlet_new((t_object *)x, NULL);
+        x->l_horloge = clock_new(x, (method)ipoke_tick);
+        x->l_rapport = clock_new(x, (method)ipoke_rapport);
+        x->l_suivi = clock_new(x, (method)ipoke_suivi);
+        x->l_sr = sys_getsr();
+        ipoke_dirtyrate(x, 40.);
         
         if (chan)
-            x->l_chan = CLIP(chan,1,4) - 1;        // check the argument - initial buffer channel
+            x->l_chan = MAX(chan,1) - 1;            // check the argument - initial buffer channel
         return (x);
     }
     
 }
 
+static void ipoke_fin_rendu(t_ipoke *x);
+static void ipoke_groupe_lache(t_ipoke_groupe *g);
+static t_ipoke_groupe *ipoke_groupe(t_ipoke *x);
+static void ipoke_ferme(t_ipoke *x);
+
+void ipoke_free(t_ipoke *x)
+{
+    long i;
+
+    dsp_free((t_pxobject *)x);
+    ipoke_ferme(x);
+    if (x->l_rendant)
+    {
+        x->l_rendu.arret = 1;
+        ipoke_fin_rendu(x);
+    }
+    freeobject((t_object *)x->l_horloge);
+    freeobject((t_object *)x->l_rapport);
+    freeobject((t_object *)x->l_suivi);
+    ipoke_core_free(&x->l_core);
+    ipoke_undo_free(&x->l_annule);
+    ipoke_partage_lache(x->l_partage);
+    ipoke_groupe_lache(x->l_groupe);
+    if (x->l_tetes)
+    {
+        for (i = 1; i < x->l_nb_tetes; i++)
+            ipoke_core_free(x->l_tetes + i - 1);
+        sysmem_freeptr(x->l_tetes);
+    }
+    if (x->l_vals)
+        sysmem_freeptr(x->l_vals);
+    if (x->l_valeurs)
+        sysmem_freeptr(x->l_valeurs);
+    if (x->l_signaux)
+        sysmem_freeptr(x->l_signaux);
+}
+
+// restarts the writing of every head
+static void ipoke_reset(t_ipoke *x)
+{
+    long i;
+
+    ipoke_core_reset(&x->l_core);
+    for (i = 1; i < x->l_nb_tetes; i++)
+        ipoke_core_reset(x->l_tetes + i - 1);
+}
+
 void ipoke_set(t_ipoke *x, t_symbol *s)
 {    
+    x->l_nom = s;                                       // out of its group until the next dsp start, if another one
     if (!x->l_buf)
 		x->l_buf = buffer_ref_new((t_object *)x, s);
 	else
@@ -98,27 +317,50 @@ void ipoke_set(t_ipoke *x, t_symbol *s)
 
 void ipoke_int(t_ipoke *x, long n)
 {
-    if (x->l_obj.z_in == 2)
+    if (x->l_obj.z_in == x->l_nvals + 1)
     {
         if (n)
-            x->l_chan = (char)(CLIP(n,1,4) - 1);
+            x->l_chan = MAX(n,1) - 1;
         else
             x->l_chan = 0;
-        x->l_index_precedent = -1;
+        x->l_nchans = 0;
+        ipoke_reset(x);
     }
     else
         object_error((t_object *)x, "buffer~ channel assignation by the rightmost inlet");
 }
 
+// a range of channels [first last]: the value channels are written in turn from first, cycling through them if there are more buffer channels than values
+void ipoke_list(t_ipoke *x, t_symbol *s, long argc, t_atom *argv)
+{
+    long first, last;
+    
+    if (x->l_obj.z_in != x->l_nvals + 1 || argc != 2)
+    {
+        object_error((t_object *)x, "buffer~ channel range assignation by the rightmost inlet, as first and last channels");
+        return;
+    }
+    
+    first = MAX(atom_getlong(argv), 1);
+    last = MAX(atom_getlong(argv + 1), first);
+    
+    x->l_chan = first - 1;
+    x->l_nchans = last - first + 1;
+    if (x->l_nchans > x->l_core.nvals)
+        object_warn((t_object *)x, "a range of %ld channels will be fully written after the next dsp start", x->l_nchans);
+    ipoke_reset(x);
+}
+
 void ipoke_interp(t_ipoke *x, long n)
 {
     switch (n)
     {
-        case 0:
-            x->l_interp = 0;
-            break;
-        case 1:
-            x->l_interp = 1;
+        case IPOKE_INTERP_HOLD:
+        case IPOKE_INTERP_LINEAR:
+        case IPOKE_INTERP_CUBIC:
+        case IPOKE_INTERP_SINC:
+            x->l_core.interp = (char)n;
+            ipoke_select(x);
             break;
         default:
             object_error((t_object *)x, "wrong interpolation type");
@@ -128,916 +370,1145 @@ void ipoke_interp(t_ipoke *x, long n)
 
 void ipoke_overdub(t_ipoke *x, double n)
 {
-    x->l_overdub = n;
-    //    post("overdub level is %f", x->l_overdub = n);
+    x->l_core.overdub = n;
+    //    post("overdub level is %f", x->l_core.overdub = n);
+    ipoke_select(x);
 }
 
-void ipoke_dblclick(t_ipoke *x)
+void ipoke_combine(t_ipoke *x, long n)
 {
-	buffer_view(buffer_ref_getobject(x->l_buf));
+    switch (n)
+    {
+        case IPOKE_COMBINE_OVERDUB:
+        case IPOKE_COMBINE_REPLACE:
+        case IPOKE_COMBINE_ADD:
+        case IPOKE_COMBINE_XFADE:
+        case IPOKE_COMBINE_MAX:
+        case IPOKE_COMBINE_SOFTSAT:
+            x->l_core.combine = (char)n;
+            ipoke_select(x);
+            break;
+        default:
+            object_error((t_object *)x, "wrong combine mode");
+            break;
+    }
 }
 
-void ipoke_assist(t_ipoke *x, void *b, long m, long a, char *s)
+void ipoke_antialias(t_ipoke *x, long n)
+{
+    x->l_core.antialias = (n != 0);
+    x->l_core.pos_passe = -1;                           // the filter restarts from the next input
+}
+
+void ipoke_splat(t_ipoke *x, long n)
 {
-    switch (a)
+    switch (n)
     {
-        case 0:
-            sprintf(s,"(signal) Value In");
-            break;
-        case 1:
-            sprintf(s,"(signal) Sample Index");
+        case IPOKE_SPLAT_OFF:
+        case IPOKE_SPLAT_LINEAR:
+        case IPOKE_SPLAT_CUBIC:
+            if (x->l_core.splat != (char)n)
+            {
+                x->l_core.splat = (char)n;
+                ipoke_core_reset(&x->l_core);           // the two ways of writing do not share their pending state
+            }
             break;
-        case 2:
-            sprintf(s,"(int) Audio Channel In buffer~");
+        default:
+            object_error((t_object *)x, "wrong splat type");
             break;
     }
 }
 
-long wrap_index(size_t index, size_t arrayLength)
+void ipoke_maxfill(t_ipoke *x, long n)
 {
-    while(index >= arrayLength)
-        index -= arrayLength;
-    return index;
+    x->l_core.budget = MAX(n, 0);                       // 0: the gaps are always filled at once
 }
 
-// registers a function for the signal chain in Max
+void ipoke_jump(t_ipoke *x, long n)
+{
+    x->l_core.saut = MAX(n, 0);                         // 0: every step is filled
+}
 
-void ipoke_dsp(t_ipoke *x, t_signal **sp)
+void ipoke_jumpfade(t_ipoke *x, long n)
 {
-    ipoke_set(x,x->l_sym);
-    x->l_index_precedent = -1;
-    dsp_add(ipoke_perform, 4, x, sp[0]->s_vec, sp[1]->s_vec, sp[0]->s_n);
+    if (n > IPOKE_CORE_FONDU)
+        object_warn((t_object *)x, "jumpfade is at most %d frames", IPOKE_CORE_FONDU);
+    ipoke_core_set_fondu(&x->l_core, n);
 }
 
-void ipoke_dsp64(t_ipoke *x, t_object *dsp64, short *count, double samplerate, long maxvectorsize, long flags)
+void ipoke_snap(t_ipoke *x, double n)
 {
-    ipoke_set(x,x->l_sym);
-    x->l_index_precedent = -1;
-    object_method(dsp64, gensym("dsp_add64"), x, ipoke_perform64, 0, NULL);
+    x->l_core.seuil = MAX(n, 0.);                       // 0: decayed frames are never snapped
 }
 
-// perform 32bit
-t_int *ipoke_perform(t_int *w)
+void ipoke_loop(t_ipoke *x, t_symbol *s, long argc, t_atom *argv)
+{
+    long debut = 0, fin = 0;                            // no argument: the whole buffer
+
+    if (argc == 2)
+    {
+        debut = atom_getlong(argv);
+        fin = atom_getlong(argv + 1);
+    }
+    else if (argc)
+    {
+        object_error((t_object *)x, "loop takes the first frame and the frame after the last one");
+        return;
+    }
+    if (debut < 0 || (fin && fin < debut + 2))
+    {
+        object_error((t_object *)x, "wrong loop region");
+        return;
+    }
+    x->l_core.boucle_debut = debut;                     // applied at the next vector, the writing restarts there
+    x->l_core.boucle_fin = fin;
+}
+
+// units samples, phase (0 to 1 over the loop region), ms, or rate: the index signal is then the speed of the object's own write position
+void ipoke_units(t_ipoke *x, t_symbol *s)
+{
+    if (s == gensym("samples"))
+        x->l_core.unites = IPOKE_UNITS_SAMPLES;
+    else if (s == gensym("phase"))
+        x->l_core.unites = IPOKE_UNITS_PHASE;
+    else if (s == gensym("ms"))
+        x->l_core.unites = IPOKE_UNITS_MS;
+    else if (s == gensym("rate"))
+        x->l_core.unites = IPOKE_UNITS_RATE;
+    else
+        object_error((t_object *)x, "units are samples, phase, ms or rate");
+}
+
+// moves the write position of the rate units to a frame, negative to stop writing
+void ipoke_seek(t_ipoke *x, double position)
+{
+    long i;
+
+    ipoke_core_seek(&x->l_core, position);
+    for (i = 1; i < x->l_nb_tetes; i++)
+        ipoke_core_seek(x->l_tetes + i - 1, position);
+}
+
+// back to the start of the loop region
+void ipoke_reset_tete(t_ipoke *x)
+{
+    ipoke_seek(x, x->l_core.boucle_debut);
+}
+
+void ipoke_journal(t_ipoke *x, long n)
+{
+    x->l_journal = MAX(n, 0);                           // allocated at the next dsp start, out of the audio thread
+}
+
+// disk <file> opens an existing 32-bit float wav, disk <file> <frames> [<channels>] creates one, disk alone goes back to the buffer~
+void ipoke_disk(t_ipoke *x, t_symbol *s, long argc, t_atom *argv)
+{
+    if (argc && atom_gettype(argv) != A_SYM)
+    {
+        object_error((t_object *)x, "disk: a file name first");
+        return;
+    }
+    x->l_fichier = argc ? atom_getsym(argv) : NULL;
+    x->l_frames_fichier = (argc > 1) ? MAX(atom_getlong(argv + 1), 0) : 0;
+    x->l_nc_fichier = (argc > 2) ? MAX(atom_getlong(argv + 2), 1) : x->l_nvals;
+    x->l_change = 1;                                    // opened at the next dsp start, out of the audio thread
+}
+
+static void *ipoke_service(t_ipoke *x)
+{
+    while (!x->l_arret)
+    {
+        ipoke_disk_service(x->l_disque);
+        systhread_sleep(IPOKE_SERVICE);
+    }
+    systhread_exit(0);
+    return NULL;
+}
+
+// stops the service and closes the sound file, flushing what was written
+static void ipoke_ferme(t_ipoke *x)
+{
+    unsigned int retour;
+
+    if (!x->l_disque)
+        return;
+    x->l_arret = 1;
+    systhread_join(x->l_service, &retour);
+    ipoke_disk_close(x->l_disque);
+    sysmem_freeptr(x->l_disque);
+    x->l_disque = NULL;
+}
+
+// from the dsp start: the file asked for since the last one, if any
+static void ipoke_ouvre(t_ipoke *x)
+{
+    char natif[MAX_PATH_CHARS];
+    t_ipoke_disk *d;
+
+    if (!x->l_change)
+        return;
+    x->l_change = 0;
+    ipoke_ferme(x);
+    if (!x->l_fichier)
+        return;
+    d = (t_ipoke_disk *)sysmem_newptr(sizeof(t_ipoke_disk));
+    path_nameconform(x->l_fichier->s_name, natif, PATH_STYLE_NATIVE, PATH_TYPE_ABSOLUTE);
+    if (!d || !ipoke_disk_open(d, natif, x->l_frames_fichier, x->l_nc_fichier, x->l_sr))
+    {
+        object_error((t_object *)x, x->l_frames_fichier ? "disk: could not create %s" : "disk: could not open %s as a 32-bit float wav", x->l_fichier->s_name);
+        if (d)
+            sysmem_freeptr(d);
+        return;
+    }
+    x->l_arret = 0;
+    x->l_disque = d;
+    if (systhread_create((method)ipoke_service, x, 0, 0, 0, &x->l_service))
+    {
+        object_error((t_object *)x, "disk: could not start its service thread");
+        ipoke_disk_close(d);
+        sysmem_freeptr(d);
+        x->l_disque = NULL;
+    }
+}
+
+void ipoke_undopool(t_ipoke *x, long n)
+{
+    n = MAX(n, 0);
+    x->l_undo = (n + IPOKE_UNDO_PAGE - 1) / IPOKE_UNDO_PAGE * IPOKE_UNDO_PAGE;   // in whole pages, as allocated at the next dsp start, out of the audio thread
+}
+
+// undo and redo, with the buffer in hand: what they put back is reported as written
+static void ipoke_annule(t_ipoke *x, long (*annule)(t_ipoke_undo *, float *, long, long), const char *nom)
 {
-    t_ipoke *x = (t_ipoke *)(w[1]);
-    float *inval = (float *)(w[2]);
-    float *inind = (float *)(w[3]);
-    int n = (int)(w[4]);
-    
     t_buffer_obj *b = buffer_ref_getobject(x->l_buf);
-    
-    bool interp, dirty_flag;
-    char chan, nc;
+    t_atom region[2];
     float *tab;
-    double valeur_entree, valeur, index_tampon, coeff, overdub;
-    long frames, nb_val, index, index_precedent, pas, i,demivie;
-    
-	tab = buffer_locksamples(b);
-	if (!tab)
-		goto out;
-    
-    nc = buffer_getchannelcount(b);
-    chan =  MIN(x->l_chan, nc);
+    long frames, r;
+
+    if (!x->l_annule.capacite)
+    {
+        object_error((t_object *)x, "%s: no undo pool, see undopool", nom);
+        return;
+    }
+    if (!b || !(tab = buffer_locksamples(b)))
+    {
+        object_error((t_object *)x, "%s: no buffer~ %s", nom, x->l_nom->s_name);
+        return;
+    }
     frames = buffer_getframecount(b);
-    demivie = (long)(frames * 0.5);
-    
-    index_precedent = x->l_index_precedent;
-    valeur = x->l_valeur;
-    nb_val = x->l_nb_val;
-    interp = x->l_interp;
-    dirty_flag = false;
-    overdub = x->l_overdub;
-    
-    if (overdub != 0.)
+    r = annule(&x->l_annule, tab, frames, buffer_getchannelcount(b));
+    buffer_unlocksamples(b);
+    if (r < 0)
+        object_error((t_object *)x, "%s: the take was longer than the undo pool", nom);
+    else if (!r)
+        object_error((t_object *)x, "%s: nothing to %s", nom, nom);
+    else
     {
-        if (interp)
+        object_method((t_object *)b, ps_dirty);
+        atom_setlong(region, 0);
+        atom_setlong(region + 1, frames);
+        outlet_anything(x->l_out, ps_dirty, 2, region);
+    }
+}
+
+void ipoke_undo(t_ipoke *x)
+{
+    ipoke_annule(x, ipoke_undo_undo, "undo");
+}
+
+void ipoke_redo(t_ipoke *x)
+{
+    ipoke_annule(x, ipoke_undo_redo, "redo");
+}
+
+void ipoke_lockstat(t_ipoke *x)
+{
+    long nb = x->l_nb_verrou;
+
+    if (nb)
+        object_post((t_object *)x, "buffer locked %ld times, %.2f us on average, %.2f us at most", nb, x->l_verrou * 1000. / nb, x->l_verrou_max * 1000.);
+    else
+        object_post((t_object *)x, "buffer not locked since the last lockstat");
+    x->l_verrou = x->l_verrou_max = 0.;
+    x->l_nb_verrou = 0;
+    if (x->l_disque)
+        object_post((t_object *)x, "disk: %ld vectors not written since it was opened, their frames not mapped yet", x->l_disque->perdus);
+    if (ipoke_groupe(x) && x->l_groupe->divise)
+        object_post((t_object *)x, "group: the %ld ipoke~ of the buffer run in several threads, each locks it on its own", x->l_groupe->membres);
+    else if (ipoke_groupe(x))
+        object_post((t_object *)x, "group: locked once a tick for the %ld ipoke~ of the buffer, counted on the one that unlocks it", x->l_groupe->membres);
+    if (x->l_partage)
+        object_post((t_object *)x, "concurrent: %ld waits for a stripe held by another writer of the buffer, with %ld writers", x->l_partage->attentes, x->l_partage->references);
+}
+
+// several ipoke~ writing the same buffer from different threads, as in a poly~ with parallel on: each one takes the stripes it writes
+void ipoke_concurrent(t_ipoke *x, long n)
+{
+    x->l_concurrent = n ? 1 : 0;                        // the stripes are taken at the next dsp start, out of the audio thread
+}
+
+// the ipoke~ writing the same buffer~ lock it once a tick for all of them, or each its own way (the default)
+void ipoke_group(t_ipoke *x, long n)
+{
+    x->l_groupe_on = n ? 1 : 0;                         // joined at the next dsp start
+}
+
+void ipoke_dirtyrate(t_ipoke *x, double ms)
+{
+    x->l_dirtyrate = MAX(ms, 0.);
+    x->l_periode = (long)(x->l_dirtyrate * x->l_sr * 0.001);
+}
+
+// marks the buffer dirty once for all the vectors written since the last time, and tells which frames were written
+void ipoke_tick(t_ipoke *x)
+{
+    t_buffer_obj *b = buffer_ref_getobject(x->l_buf);
+    t_ipoke_groupe *g;
+    t_atom region[2];
+    long etendue = x->l_modif_etendue;
+
+    if (!etendue)
+        return;
+    ipoke_barriere();                                   // the first frame stored with it
+    atom_setlong(region, x->l_modif_debut);
+    atom_setlong(region + 1, etendue);
+    ipoke_barriere();                                   // read before the perform routine may store the next one
+    x->l_modif_etendue = 0;                             // the perform routine can hand over the next region
+
+    g = ipoke_groupe(x);
+    if (b && (!g || g->sale))                           // a group is marked dirty by the first of its reports
+    {
+        if (g)
+            g->sale = 0;
+        object_method((t_object *)b, ps_dirty);
+    }
+    outlet_anything(x->l_out, ps_dirty, 2, region);
+}
+
+// from the perform routines: hands the written region to the scheduler, at most every l_periode samples
+static void ipoke_modif(t_ipoke *x, long n)
+{
+    long debut, etendue;
+
+    if (x->l_attente < x->l_periode)
+        x->l_attente += n;
+    if (x->l_attente < x->l_periode || x->l_modif_etendue || !x->l_core.modif_etendue)
+        return;                                         // too early, the last one not reported yet, or nothing written: it keeps growing
+    ipoke_barriere();                                   // the last one was read by the scheduler
+    etendue = ipoke_core_modif(&x->l_core, &debut);
+    x->l_modif_debut = debut;
+    ipoke_barriere();                                   // the first frame before the length that publishes it
+    x->l_modif_etendue = etendue;
+    x->l_attente = 0;
+    clock_delay(x->l_horloge, 0);
+}
+
+// stats 1 starts counting, stats 0 stops, stats alone reports the counters
+void ipoke_stats(t_ipoke *x, t_symbol *s, long argc, t_atom *argv)
+{
+    t_ipoke_stats *stats = &x->l_core.stats;
+    t_atom a[IPOKE_STATS_CLASSES];
+    long c;
+
+    if (argc)
+    {
+        x->l_core.compter = (atom_getlong(argv) != 0);
+        return;
+    }
+    if (!x->l_core.compter)
+        object_warn((t_object *)x, "not counting: send stats 1 first");
+
+    atom_setlong(a, (t_atom_long)stats->echantillons);
+    outlet_anything(x->l_out, gensym("samples"), 1, a);
+    atom_setlong(a, (t_atom_long)stats->remplies);
+    outlet_anything(x->l_out, gensym("filled"), 1, a);
+    atom_setlong(a, (t_atom_long)stats->tours);
+    outlet_anything(x->l_out, gensym("wraps"), 1, a);
+    atom_setlong(a, (t_atom_long)stats->moyennes);
+    outlet_anything(x->l_out, gensym("averaged"), 1, a);
+    atom_setlong(a, (t_atom_long)stats->sauts);
+    outlet_anything(x->l_out, gensym("jumps"), 1, a);
+    for (c = 0; c < IPOKE_STATS_CLASSES; c++)
+        atom_setlong(a + c, (t_atom_long)stats->pas[c]);
+    outlet_anything(x->l_out, gensym("gaps"), IPOKE_STATS_CLASSES, a);
+    atom_setlong(a, (t_atom_long)stats->appels);
+    atom_setlong(a + 1, (t_atom_long)(stats->appels ? stats->ticks / stats->appels : 0));
+    atom_setlong(a + 2, (t_atom_long)stats->ticks_max);
+    outlet_anything(x->l_out, gensym("perform"), 3, a);
+    stats->ticks_max = 0;                               // the longest call since the last report
+}
+
+void ipoke_statsrate(t_ipoke *x, double ms)
+{
+    x->l_statsrate = MAX(ms, 0.);
+    if (x->l_statsrate > 0.)
+    {
+        x->l_core.compter = 1;
+        clock_fdelay(x->l_rapport, x->l_statsrate);
+    }
+    else
+        clock_unset(x->l_rapport);
+}
+
+void ipoke_rapport(t_ipoke *x)
+{
+    ipoke_stats(x, NULL, 0, NULL);
+    if (x->l_statsrate > 0.)
+        clock_fdelay(x->l_rapport, x->l_statsrate);
+}
+
+// offline rendering: render <values buffer~> <indices buffer~> writes the whole of them at once, from IPOKE_FILS threads,
+// render <index> <value> <index> <value>... the pairs given, render stop stops it
+
+// copies the frames of the buffer~ named s, channel after channel: returns their number and the channels in *nc, 0 if there is none
+static long ipoke_copie(t_ipoke *x, t_symbol *s, double **donnees, long *nc, long marge)
+{
+    t_buffer_ref *ref = buffer_ref_new((t_object *)x, s);
+    t_buffer_obj *b = buffer_ref_getobject(ref);
+    float *tab;
+    long frames = 0, i, c;
+
+    if (b && (tab = buffer_locksamples(b)))
+    {
+        frames = (long)buffer_getframecount(b);
+        *nc = (long)buffer_getchannelcount(b);
+        *donnees = (double *)sysmem_newptr((*nc * frames + marge) * sizeof(double));
+        if (*donnees)
         {
-            while (n--)    // dsp loop with interpolation
-            {
-                valeur_entree = *inval++;
-                index_tampon = *inind++;
-                
-                if (index_tampon < 0.0)                                            // if the writing is stopped
-                {
-                    if (index_precedent >= 0)                                    // and if it is the 1st one to be stopped
-                    {
-                        tab[index_precedent * nc + chan] = (tab[index_precedent * nc + chan] * overdub) + (valeur/nb_val);        // write the average value at the last given index
-                        valeur = 0.0;
-                        index_precedent = -1;
-                        dirty_flag = true;
-                    }
-                }
-                else
-                {
-                    index = wrap_index((long)(index_tampon),frames);        // truncate the next index and make sure it is in the buffer's boundaries
-                    
-                    if (index_precedent < 0)                                    // if it is the first index to write, resets the averaging and the values
-                    {
-                        index_precedent = index;
-                        nb_val = 0;
-                    }
-                    
-                    if (index == index_precedent)                                // if the index has not moved, accumulate the value to average later.
-                    {
-                        valeur += valeur_entree;
-                        nb_val += 1;
-                    }
-                    else                                                        // if it moves
-                    {
-                        if (nb_val != 1)                                        // is there more than one values to average
-                        {
-                            valeur = valeur/nb_val;                                // if yes, calculate the average
-                            nb_val = 1;
-                        }
-                        
-                        tab[index_precedent * nc + chan] = (tab[index_precedent * nc + chan] * overdub) + valeur;                // write the average value at the last index
-                        dirty_flag = true;
-                        
-                        pas = index - index_precedent;                            // calculate the step to do
-                        
-                        if (pas > 0)                                            // are we going up
-                        {
-                            if (pas > demivie)                                    // is it faster to go the other way round?
-                            {
-                                pas -= frames;                                    // calculate the new number of steps
-                                coeff = (valeur_entree - valeur) / pas;            // calculate the interpolation coefficient
-                                
-                                for(i=(index_precedent-1);i>=0;i--)                    // fill the gap to zero
-                                {
-                                    valeur -= coeff;
-                                    tab[i * nc + chan] = (tab[i * nc + chan] * overdub) + valeur;
-                                }
-                                for(i=(frames-1);i>index;i--)                        // fill the gap from the top
-                                {
-                                    valeur -= coeff;
-                                    tab[i * nc + chan] = (tab[i * nc + chan] * overdub) + valeur;
-                                }
-                            }
-                            else                                                // if not, just fill the gaps
-                            {
-                                coeff = (valeur_entree - valeur) / pas;            // calculate the interpolation coefficient
-                                for (i=(index_precedent+1); i<index; i++)
-                                {
-                                    valeur += coeff;
-                                    tab[i * nc + chan] = (tab[i * nc + chan] * overdub) + valeur;
-                                }
-                            }
-                        }
-                        else                                                    // if we are going down
-                        {
-                            if ((-pas) > demivie)                                // is it faster to go the other way round?
-                            {
-                                pas += frames;                                    // calculate the new number of steps
-                                coeff = (valeur_entree - valeur) / pas;            // calculate the interpolation coefficient
-                                
-                                for(i=(index_precedent+1);i<frames;i++)            // fill the gap to the top
-                                {
-                                    valeur += coeff;
-                                    tab[i * nc + chan] = (tab[i * nc + chan] * overdub) + valeur;
-                                }
-                                for(i=0;i<index;i++)                            // fill the gap from zero
-                                {
-                                    valeur += coeff;
-                                    tab[i * nc + chan] = (tab[i * nc + chan] * overdub) + valeur;
-                                }
-                            }
-                            else                                                // if not, just fill the gaps
-                            {
-                                coeff = (valeur_entree - valeur) / pas;            // calculate the interpolation coefficient
-                                for (i=(index_precedent-1); i>index; i--)
-                                {
-                                    valeur -= coeff;
-                                    tab[i * nc + chan] = (tab[i * nc + chan] * overdub) + valeur;
-                                }
-                            }
-                        }
-                        
-                        valeur = valeur_entree;                                    // transfer the new previous value
-                    }
-                    index_precedent = index;                                        // transfer the new previous address
-                }
-            }
+            for (c = 0; c < *nc; c++)
+                for (i = 0; i < frames; i++)
+                    (*donnees)[c * frames + i] = tab[i * *nc + c];
         }
         else
+            frames = 0;
+        buffer_unlocksamples(b);
+    }
+    if (!frames)
+        object_error((t_object *)x, "%s: no such buffer~, or empty", s->s_name);
+    object_free(ref);
+    return frames;
+}
+
+static void ipoke_parts(t_ipoke *x)
+{
+    long part;
+
+    while ((part = ATOMIC_INCREMENT(&x->l_part) - 1) < x->l_rendu.nb_parts)
+        if (!ipoke_core_render_part(&x->l_rendu, part))
+            object_error((t_object *)x, "render: out of memory, a part was not written");
+}
+
+static void *ipoke_fil(t_ipoke *x)
+{
+    ipoke_parts(x);
+    ATOMIC_INCREMENT(&x->l_finis);
+    systhread_exit(0);
+    return NULL;
+}
+
+// waits for the threads and lets go of the buffer~ and the inputs
+static void ipoke_fin_rendu(t_ipoke *x)
+{
+    unsigned int retour;
+    long i;
+
+    for (i = 0; i < x->l_nb_fils; i++)
+        systhread_join(x->l_fils[i], &retour);
+    x->l_nb_fils = 0;
+    ipoke_core_render_free(&x->l_rendu);
+    sysmem_freeptr(x->l_donnees);
+    sysmem_freeptr(x->l_entrees);
+    x->l_donnees = NULL;
+    x->l_entrees = NULL;
+    x->l_rendant = 0;
+}
+
+// a block of the rendering, from its threads: the buffer~ locked, unless it was set to another one or resized since it started
+static float *ipoke_rendu_prend(void *hote)
+{
+    t_ipoke *x = (t_ipoke *)hote;
+    t_buffer_obj *b = buffer_ref_getobject(x->l_buf);
+    float *tab;
+
+    if (b != x->l_cible || !(tab = buffer_locksamples(b)))
+        return NULL;
+    if (buffer_getframecount(b) != x->l_rendu.frames || buffer_getchannelcount(b) != x->l_rendu.nc)
+    {
+        buffer_unlocksamples(b);
+        return NULL;
+    }
+    return tab;
+}
+
+static void ipoke_rendu_lache(void *hote)
+{
+    buffer_unlocksamples(((t_ipoke *)hote)->l_cible);
+}
+
+void ipoke_render(t_ipoke *x, t_symbol *s, long argc, t_atom *argv)
+{
+    t_buffer_obj *b = buffer_ref_getobject(x->l_buf);
+    double *indices = NULL, *donnees;
+    float *tab;
+    long n, nv = 1, ni, nc, chan, nchans, i;
+
+    if (argc == 1 && atom_getsym(argv) == gensym("stop"))
+    {
+        if (x->l_rendant)
+            x->l_rendu.arret = 1;                           // the threads stop at their next block, the end is reported as usual
+        return;
+    }
+    if (x->l_rendant)
+    {
+        object_error((t_object *)x, "render: already rendering");
+        return;
+    }
+    if (!b)
+    {
+        object_error((t_object *)x, "render: no buffer~ %s", x->l_nom->s_name);
+        return;
+    }
+    if (sys_getdspobjdspstate((t_object *)x) && !x->l_disque)
+    {
+        object_error((t_object *)x, "render: the object writes the buffer~ from its signals, turn its dsp off first");
+        return;
+    }
+
+    if (argc == 2 && atom_gettype(argv) == A_SYM && atom_gettype(argv + 1) == A_SYM)
+    {
+        if (!(ni = ipoke_copie(x, atom_getsym(argv + 1), &indices, &nc, 0)))
+            return;
+        n = ipoke_copie(x, atom_getsym(argv), &donnees, &nv, ni);    // with room for the indices after the values
+        if (!n)
         {
-            while (n--)    // dsp loop without interpolation
-            {
-                valeur_entree = *inval++;
-                index_tampon = *inind++;
-                
-                if (index_tampon < 0.0)                                            // if the writing is stopped
-                {
-                    if (index_precedent >= 0)                                    // and if it is the 1st one to be stopped
-                    {
-                        tab[index_precedent * nc + chan] = (tab[index_precedent * nc + chan] * overdub) + (valeur/nb_val);        // write the average value at the last given index
-                        valeur = 0.0;
-                        index_precedent = -1;
-                        dirty_flag = true;
-                    }
-                }
-                else
-                {
-                    index = wrap_index((long)(index_tampon),frames);        // truncate the next index and make sure it is in the buffer's boundaries
-                    
-                    if (index_precedent < 0)                                    // if it is the first index to write, resets the averaging and the values
-                    {
-                        index_precedent = index;
-                        nb_val = 0;
-                    }
-                    
-                    if (index == index_precedent)                                // if the index has not moved, accumulate the value to average later.
-                    {
-                        valeur += valeur_entree;
-                        nb_val += 1;
-                    }
-                    else                                                        // if it moves
-                    {
-                        if (nb_val != 1)                                        // is there more than one values to average
-                        {
-                            valeur = valeur/nb_val;                                // if yes, calculate the average
-                            nb_val = 1;
-                        }
-                        
-                        tab[index_precedent * nc + chan] = (tab[index_precedent * nc + chan] * overdub) + valeur;                // write the average value at the last index
-                        dirty_flag = true;
-                        
-                        pas = index - index_precedent;                            // calculate the step to do
-                        
-                        if (pas > 0)                                            // are we going up
-                        {
-                            if (pas > demivie)                                    // is it faster to go the other way round?
-                            {
-                                for(i=(index_precedent-1);i>=0;i--)                // fill the gap to zero
-                                    tab[i * nc + chan] = (tab[i * nc + chan] * overdub) + valeur;
-                                for(i=(frames-1);i>index;i--)                    // fill the gap from the top
-                                    tab[i * nc + chan] = (tab[i * nc + chan] * overdub) + valeur;
-                            }
-                            else                                                // if not, just fill the gaps
-                            {
-                                for (i=(index_precedent+1); i<index; i++)
-                                    tab[i * nc + chan] = (tab[i * nc + chan] * overdub) + valeur;
-                            }
-                        }
-                        else                                                    // if we are going down
-                        {
-                            if ((-pas) > demivie)                                // is it faster to go the other way round?
-                            {
-                                for(i=(index_precedent+1);i<frames;i++)            // fill the gap to the top
-                                    tab[i * nc + chan] = (tab[i * nc + chan] * overdub) + valeur;
-                                for(i=0;i<index;i++)                            // fill the gap from zero
-                                    tab[i * nc + chan] = (tab[i * nc + chan] * overdub) + valeur;
-                            }
-                            else                                                // if not, just fill the gaps
-                            {
-                                for (i=(index_precedent-1); i>index; i--)
-                                    tab[i * nc + chan] = (tab[i * nc + chan] * overdub) + valeur;
-                            }
-                        }
-                        
-                        valeur = valeur_entree;                                    // transfer the new previous value
-                    }
-                    index_precedent = index;                                        // transfer the new previous address
-                }
-            }
+            sysmem_freeptr(indices);
+            return;
+        }
+        // the values channel after channel, then the first channel of the indices
+        if (ni < n)
+        {
+            for (i = 1; i < nv; i++)
+                memmove(donnees + i * ni, donnees + i * n, ni * sizeof(double));
+            n = ni;
         }
+        else if (n < ni)
+            ni = n;
+        memcpy(donnees + nv * n, indices, n * sizeof(double));
+        sysmem_freeptr(indices);
     }
     else
     {
-        if (interp)
+        if (argc < 2 || argc % 2)
         {
-            while (n--)    // dsp loop with interpolation
-            {
-                valeur_entree = *inval++;
-                index_tampon = *inind++;
-                
-                if (index_tampon < 0.0)                                            // if the writing is stopped
-                {
-                    if (index_precedent >= 0)                                    // and if it is the 1st one to be stopped
-                    {
-                        tab[index_precedent * nc + chan] = valeur/nb_val;        // write the average value at the last given index
-                        valeur = 0.0;
-                        index_precedent = -1;
-                        dirty_flag = true;
-                    }
-                }
-                else
-                {
-                    index = wrap_index((long)(index_tampon),frames);        // truncate the next index and make sure it is in the buffer's boundaries
-                    
-                    if (index_precedent < 0)                                    // if it is the first index to write, resets the averaging and the values
-                    {
-                        index_precedent = index;
-                        nb_val = 0;
-                    }
-                    
-                    if (index == index_precedent)                                // if the index has not moved, accumulate the value to average later.
-                    {
-                        valeur += valeur_entree;
-                        nb_val += 1;
-                    }
-                    else                                                        // if it moves
-                    {
-                        if (nb_val != 1)                                        // is there more than one values to average
-                        {
-                            valeur = valeur/nb_val;                                // if yes, calculate the average
-                            nb_val = 1;
-                        }
-                        
-                        tab[index_precedent * nc + chan] = valeur;                // write the average value at the last index
-                        dirty_flag = true;
-                        
-                        pas = index - index_precedent;                            // calculate the step to do
-                        
-                        if (pas > 0)                                            // are we going up
-                        {
-                            if (pas > demivie)                                    // is it faster to go the other way round?
-                            {
-                                pas -= frames;                                    // calculate the new number of steps
-                                coeff = (valeur_entree - valeur) / pas;            // calculate the interpolation coefficient
-                                
-                                for(i=(index_precedent-1);i>=0;i--)                    // fill the gap to zero
-                                {
-                                    valeur -= coeff;
-                                    tab[i * nc + chan] = valeur;
-                                }
-                                for(i=(frames-1);i>index;i--)                        // fill the gap from the top
-                                {
-                                    valeur -= coeff;
-                                    tab[i * nc + chan] = valeur;
-                                }
-                            }
-                            else                                                // if not, just fill the gaps
-                            {
-                                coeff = (valeur_entree - valeur) / pas;            // calculate the interpolation coefficient
-                                for (i=(index_precedent+1); i<index; i++)
-                                {
-                                    valeur += coeff;
-                                    tab[i * nc + chan] = valeur;
-                                }
-                            }
-                        }
-                        else                                                    // if we are going down
-                        {
-                            if ((-pas) > demivie)                                // is it faster to go the other way round?
-                            {
-                                pas += frames;                                    // calculate the new number of steps
-                                coeff = (valeur_entree - valeur) / pas;            // calculate the interpolation coefficient
-                                
-                                for(i=(index_precedent+1);i<frames;i++)            // fill the gap to the top
-                                {
-                                    valeur += coeff;
-                                    tab[i * nc + chan] = valeur;
-                                }
-                                for(i=0;i<index;i++)                            // fill the gap from zero
-                                {
-                                    valeur += coeff;
-                                    tab[i * nc + chan] = valeur;
-                                }
-                            }
-                            else                                                // if not, just fill the gaps
-                            {
-                                coeff = (valeur_entree - valeur) / pas;            // calculate the interpolation coefficient
-                                for (i=(index_precedent-1); i>index; i--)
-                                {
-                                    valeur -= coeff;
-                                    tab[i * nc + chan] = valeur;
-                                }
-                            }
-                        }
-                        
-                        valeur = valeur_entree;                                    // transfer the new previous value
-                    }
-                    index_precedent = index;                                        // transfer the new previous address
-                }
-            }
+            object_error((t_object *)x, "render takes a buffer~ of values and one of indices, or pairs of index and value");
+            return;
         }
-        else
+        n = argc / 2;
+        if (!(donnees = (double *)sysmem_newptr(2 * n * sizeof(double))))
+            return;
+        for (i = 0; i < n; i++)
         {
-            while (n--)    // dsp loop without interpolation
-            {
-                valeur_entree = *inval++;
-                index_tampon = *inind++;
-                
-                if (index_tampon < 0.0)                                            // if the writing is stopped
-                {
-                    if (index_precedent >= 0)                                    // and if it is the 1st one to be stopped
-                    {
-                        tab[index_precedent * nc + chan] = valeur/nb_val;        // write the average value at the last given index
-                        valeur = 0.0;
-                        index_precedent = -1;
-                        dirty_flag = true;
-                    }
-                }
-                else
-                {
-                    index = wrap_index((long)(index_tampon),frames);        // truncate the next index and make sure it is in the buffer's boundaries
-                    
-                    if (index_precedent < 0)                                    // if it is the first index to write, resets the averaging and the values
-                    {
-                        index_precedent = index;
-                        nb_val = 0;
-                    }
-                    
-                    if (index == index_precedent)                                // if the index has not moved, accumulate the value to average later.
-                    {
-                        valeur += valeur_entree;
-                        nb_val += 1;
-                    }
-                    else                                                        // if it moves
-                    {
-                        if (nb_val != 1)                                        // is there more than one values to average
-                        {
-                            valeur = valeur/nb_val;                                // if yes, calculate the average
-                            nb_val = 1;
-                        }
-                        
-                        tab[index_precedent * nc + chan] = valeur;                // write the average value at the last index
-                        dirty_flag = true;
-                        
-                        pas = index - index_precedent;                            // calculate the step to do
-                        
-                        if (pas > 0)                                            // are we going up
-                        {
-                            if (pas > demivie)                                    // is it faster to go the other way round?
-                            {
-                                for(i=(index_precedent-1);i>=0;i--)                // fill the gap to zero
-                                    tab[i * nc + chan] = valeur;
-                                for(i=(frames-1);i>index;i--)                    // fill the gap from the top
-                                    tab[i * nc + chan] = valeur;
-                            }
-                            else                                                // if not, just fill the gaps
-                            {
-                                for (i=(index_precedent+1); i<index; i++)
-                                    tab[i * nc + chan] = valeur;
-                            }
-                        }
-                        else                                                    // if we are going down
-                        {
-                            if ((-pas) > demivie)                                // is it faster to go the other way round?
-                            {
-                                for(i=(index_precedent+1);i<frames;i++)            // fill the gap to the top
-                                    tab[i * nc + chan] = valeur;
-                                for(i=0;i<index;i++)                            // fill the gap from zero
-                                    tab[i * nc + chan] = valeur;
-                            }
-                            else                                                // if not, just fill the gaps
-                            {
-                                for (i=(index_precedent-1); i>index; i--)
-                                    tab[i * nc + chan] = valeur;
-                            }
-                        }
-                        
-                        valeur = valeur_entree;                                    // transfer the new previous value
-                    }
-                    index_precedent = index;                                        // transfer the new previous address
-                }
-            }
+            donnees[n + i] = atom_getfloat(argv + 2 * i);
+            donnees[i] = atom_getfloat(argv + 2 * i + 1);
         }
     }
-    //update the mod time
+    indices = donnees + nv * n;
+
+    nc = (long)buffer_getchannelcount(b);
+    chan = MIN(x->l_chan, nc - 1);
+    nchans = x->l_nchans ? x->l_nchans : nv;                // the value channels cycle over the range, as the signals do
+    nchans = MIN(nchans, nc - chan);
+    x->l_entrees = (const double **)sysmem_newptr(nchans * sizeof(double *));
+    tab = buffer_locksamples(b);
+    if (!x->l_entrees || !tab)
+    {
+        if (tab)
+            buffer_unlocksamples(b);
+        sysmem_freeptr(x->l_entrees);
+        sysmem_freeptr(donnees);
+        x->l_entrees = NULL;
+        return;
+    }
+    for (i = 0; i < nchans; i++)
+        x->l_entrees[i] = donnees + (i % nv) * n;
+    x->l_donnees = donnees;
+    x->l_cible = b;
+    x->l_rendant = 1;
+
+    if (!ipoke_core_render(&x->l_rendu, &x->l_core, tab, (long)buffer_getframecount(b), nc, chan, x->l_entrees, nchans, indices, n, 8 * IPOKE_FILS))
+    {
+        buffer_unlocksamples(b);
+        object_error((t_object *)x, "render: out of memory");
+        ipoke_fin_rendu(x);
+        return;
+    }
+    x->l_rendu.prend = ipoke_rendu_prend;                   // the threads lock it a block at a time, so it is not held by this one
+    x->l_rendu.lache = ipoke_rendu_lache;
+    x->l_rendu.hote = x;
+    buffer_unlocksamples(b);
+    x->l_part = x->l_finis = 0;
+    for (i = 0; i < IPOKE_FILS; i++)
+        if (systhread_create((method)ipoke_fil, x, 0, 0, 0, &x->l_fils[x->l_nb_fils]) == 0)
+            x->l_nb_fils++;
+    if (!x->l_nb_fils)                                      // no thread: all of it now
+        ipoke_parts(x);
+    clock_fdelay(x->l_suivi, x->l_nb_fils ? IPOKE_SUIVI : 0.);
+}
+
+// render <share written> while rendering, then the whole buffer~ dirty and rendered
+void ipoke_suivi(t_ipoke *x)
+{
+    t_atom a[2];
+    char arret = x->l_rendu.arret;
+
+    if (!x->l_rendant)
+        return;
+    if (x->l_finis < x->l_nb_fils)
+    {
+        atom_setfloat(a, ipoke_core_render_progress(&x->l_rendu));
+        outlet_anything(x->l_out, gensym("render"), 1, a);
+        clock_fdelay(x->l_suivi, IPOKE_SUIVI);
+        return;
+    }
+    atom_setlong(a, 0);
+    atom_setlong(a + 1, x->l_rendu.frames);
+    ipoke_fin_rendu(x);
+    if (buffer_ref_getobject(x->l_buf) == x->l_cible)       // not gone meanwhile
+        object_method((t_object *)x->l_cible, ps_dirty);
+    outlet_anything(x->l_out, ps_dirty, 2, a);
+    if (!arret)
+        outlet_anything(x->l_out, gensym("rendered"), 0, NULL);
+}
+
+// the ticks spent in one perform call
+static void ipoke_compte(t_ipoke *x, unsigned long long debut)
+{
+    t_ipoke_stats *stats = &x->l_core.stats;
+    unsigned long long ticks = ipoke_core_ticks() - debut;
+
+    stats->appels++;
+    stats->ticks += ticks;
+    if (ticks > stats->ticks_max)
+        stats->ticks_max = ticks;
+}
+
+// the time the buffer was held, from its lock to now
+static void ipoke_verrou(t_ipoke *x, double debut)
+{
+    double duree = systimer_gettime() - debut;
+
+    x->l_verrou += duree;
+    if (duree > x->l_verrou_max)
+        x->l_verrou_max = duree;
+    x->l_nb_verrou++;
+}
+
+//***********************************************************************************************
+// the ipoke~ of a buffer~, sharing its lock: taken and let go of at dsp time, in the main thread
+
+static t_ipoke_groupe *ipoke_groupes = NULL;
+
+static t_ipoke_groupe *ipoke_groupe_prend(t_symbol *nom)
+{
+    t_ipoke_groupe *g;
+
+    for (g = ipoke_groupes; g && g->nom != nom; g = g->suivant)
+        ;
+    if (!g && (g = (t_ipoke_groupe *)sysmem_newptrclear(sizeof(t_ipoke_groupe))))
+    {
+        g->nom = nom;
+        g->suivant = ipoke_groupes;
+        ipoke_groupes = g;
+    }
+    if (g)
+        g->membres++;
+    return g;
+}
+
+// the rank of x in the order of the dsp: one ranked again in the same round means the dsp is starting again,
+// so the members, whichever joined or left, are ranked from 0 in the order of this start
+static void ipoke_groupe_range(t_ipoke_groupe *g, t_ipoke *x)
+{
+    if (x->l_tour == g->tour)
+    {
+        g->tour++;
+        g->rangs = 0;
+        g->divise = 0;                                  // told again if they still run in several threads
+    }
+    x->l_tour = g->tour;
+    x->l_rang = g->rangs++;
+    g->fin = x->l_rang;                                 // the last one so far
+    g->dernier = -1;
+}
+
+// unlocked, and counted on the object that unlocks it; the buffer~ is marked dirty if one of them wrote in it
+static void ipoke_groupe_ferme(t_ipoke_groupe *g, t_ipoke *x)
+{
+    if (g->tab)
+    {
+        if (x)
+            ipoke_verrou(x, g->debut);
+        buffer_unlocksamples(g->b);
+        if (g->ecrit)
+            g->sale = 1;
+    }
+    g->ecrit = 0;
+    g->ouvert = 0;
+}
+
+static void ipoke_groupe_lache(t_ipoke_groupe *g)
+{
+    t_ipoke_groupe **q;
+
+    if (!g)
+        return;
+    if (g->ouvert)                                      // it may have been the one to close it
+        ipoke_groupe_ferme(g, NULL);
+    if (--g->membres)
+        return;
+    for (q = &ipoke_groupes; *q != g; q = &(*q)->suivant)
+        ;
+    *q = g->suivant;
+    sysmem_freeptr(g);
+}
+
+// the group x writes in, NULL if none or if it was set to another buffer~ since
+static t_ipoke_groupe *ipoke_groupe(t_ipoke *x)
+{
+    return (x->l_groupe && x->l_groupe->nom == x->l_nom) ? x->l_groupe : NULL;
+}
+
+// from the audio thread, before x writes: 0 if it has to lock the buffer~ itself, as they run in several threads, else 1 and the
+// buffer~ locked for this tick in *tab, or NULL. The last one that came in a tick unlocks it in the next: if it does not come (a muted
+// poly~ voice), the buffer~ is unlocked when the next tick starts, and one coming back after it locks it again for itself
+static long ipoke_groupe_entre(t_ipoke_groupe *g, t_ipoke *x, float **tab)
+{
+    if (ATOMIC_INCREMENT_BARRIER(&g->dedans) != 1)      // another one is in it from another thread
+    {
+        ATOMIC_COMPARE_SWAP32(0, 1, &g->divise);
+        ATOMIC_DECREMENT_BARRIER(&g->dedans);
+        return 0;
+    }
+    if (!ATOMIC_COMPARE_SWAP32(0, 0, &g->divise))       // the first one in after that lets go of the lock of the group
+    {
+        if (g->ouvert)
+            ipoke_groupe_ferme(g, x);
+        ATOMIC_DECREMENT_BARRIER(&g->dedans);
+        return 0;
+    }
+    if (x->l_rang <= g->dernier)
+    {
+        if (g->ouvert)
+            ipoke_groupe_ferme(g, x);
+        g->fin = g->dernier;
+    }
+    if (!g->ouvert)
+    {
+        g->ouvert = 1;
+        g->b = buffer_ref_getobject(x->l_buf);
+        g->tab = g->b ? buffer_locksamples(g->b) : NULL;
+        if (g->tab)
+        {
+            g->debut = systimer_gettime();
+            g->nc = buffer_getchannelcount(g->b);
+            g->frames = buffer_getframecount(g->b);
+            g->msr = buffer_getmillisamplerate(g->b);
+        }
+    }
+    g->dernier = x->l_rang;
+    *tab = g->tab;
+    return 1;
+}
+
+// after it wrote, or not, dirty_flag saying if it did: the last one expected closes the tick
+static void ipoke_groupe_sort(t_ipoke_groupe *g, t_ipoke *x, long dirty_flag)
+{
     if (dirty_flag)
-        object_method((t_object *)b, gensym("dirty"));
+        g->ecrit = 1;
+    if (x->l_rang >= g->fin)
+        ipoke_groupe_ferme(g, x);
+    ATOMIC_DECREMENT_BARRIER(&g->dedans);
+}
+
+// picks the write kernel specialised for the modes and the buffer: the perform routines check it again, in case the buffer changes while running
+void ipoke_select(t_ipoke *x)
+{
+    t_buffer_obj *b = buffer_ref_getobject(x->l_buf);
+
+    ipoke_core_select(&x->l_core, b ? (long)buffer_getchannelcount(b) : 1);
+}
+
+void ipoke_dblclick(t_ipoke *x)
+{
+	buffer_view(buffer_ref_getobject(x->l_buf));
+}
+
+void ipoke_assist(t_ipoke *x, void *b, long m, long a, char *s)
+{
+    if (m == ASSIST_OUTLET)
+        sprintf(s,"(list) dirty, First Frame and Number of Frames Written, the stats and the render progress");
+    else if (a < x->l_nvals)
+    {
+        if (x->l_nvals == 1)
+            sprintf(s,"(signal) Value In");
+        else if (a == 0)
+            sprintf(s,"(signal) Value In Channel 1, or (multichannel signal) All Values In");
+        else
+            sprintf(s,"(signal) Value In Channel %ld", a + 1);
+    }
+    else if (a == x->l_nvals && x->l_nb_tetes > 1)
+        sprintf(s,"(multichannel signal) Index of each Write Head, in samples, phase, ms or rate (see units)");
+    else if (a == x->l_nvals)
+        sprintf(s,"(signal) Index, in samples, phase, ms or rate (see units)");
+    else
+        sprintf(s,"(signal) Overdub Ratio, (int) Audio Channel In buffer~, (list) First and Last Channels");
+}
+
+// registers a function for the signal chain in Max
+
+// what both dsp methods do before and after finding the inputs
+static void ipoke_debut_dsp(t_ipoke *x, double samplerate)
+{
+    ipoke_set(x,x->l_sym);
+    ipoke_reset(x);
+    ipoke_select(x);
+    x->l_sr = samplerate;
+    ipoke_dirtyrate(x, x->l_dirtyrate);
+    ipoke_ouvre(x);
+}
+
+// room for the inputs, the channel range and the whole buffer, so that the range can change while running, then the heads,
+// the staging area, the undo pool, the stripes and the group
+static void ipoke_fin_dsp(t_ipoke *x, long maxvectorsize)
+{
+    long i, nvals;
+    t_buffer_obj *b;
+    
+    nvals = MAX(x->l_ninputs, x->l_nchans);
+    b = buffer_ref_getobject(x->l_buf);
+    if (b)
+        nvals = MAX(nvals, (long)buffer_getchannelcount(b));
+    if (x->l_disque)
+        nvals = MAX(nvals, x->l_disque->nc);
+    
+    if (x->l_vals)
+        sysmem_freeptr(x->l_vals);
+    x->l_vals = (double **)sysmem_newptr(nvals * sizeof(double *));
+    if (!x->l_vals || !ipoke_core_set_nvals(&x->l_core, nvals))
+    {
+        object_error((t_object *)x, "could not allocate %ld channels: only the first channel is written", nvals);
+        x->l_ninputs = 1;
+        x->l_nchans = 0;
+        ipoke_core_set_nvals(&x->l_core, 1);
+    }
+    if (!ipoke_core_set_positions(&x->l_core, maxvectorsize))
+        object_error((t_object *)x, "could not allocate the indices: they are taken in samples");
+    for (i = 1; i < x->l_actives; i++)
+        if (!ipoke_core_set_nvals(x->l_tetes + i - 1, x->l_core.nvals) || !ipoke_core_set_positions(x->l_tetes + i - 1, maxvectorsize))
+        {
+            object_error((t_object *)x, "could not allocate the write heads: only the first %ld are written", i);
+            x->l_actives = i;
+        }
+    if (!ipoke_core_set_journal(&x->l_core, x->l_journal, x->l_core.nvals, maxvectorsize))
+    {
+        object_error((t_object *)x, "could not allocate a staging area of %ld frames: writing under the buffer lock", x->l_journal);
+        ipoke_core_set_journal(&x->l_core, 0, 0, 0);
+    }
+    if (x->l_undo != x->l_annule.capacite * IPOKE_UNDO_PAGE && !ipoke_undo_set(&x->l_annule, x->l_undo))
+        object_error((t_object *)x, "could not allocate an undo pool of %ld frames: no undo", x->l_undo);
+    ipoke_partage_lache(x->l_partage);
+    x->l_partage = NULL;
+    if (x->l_concurrent && b && !(x->l_partage = ipoke_partage_prend(b, buffer_getframecount(b))))
+        object_error((t_object *)x, "could not allocate the stripes of the buffer: writing it as if alone");
+    if (x->l_groupe_on && !x->l_core.journal && !x->l_partage && !x->l_disque)   // the ones staging, in other threads or on the disk lock their own way
+    {
+        if (x->l_groupe && x->l_groupe->nom != x->l_nom)                // kept when it stays, so the ranks of this start follow each other
+        {
+            ipoke_groupe_lache(x->l_groupe);
+            x->l_groupe = NULL;
+        }
+        if (!x->l_groupe && (x->l_groupe = ipoke_groupe_prend(x->l_nom)))
+            x->l_tour = x->l_groupe->tour - 1;
+        if (x->l_groupe)
+            ipoke_groupe_range(x->l_groupe, x);
+    }
+    else
+    {
+        ipoke_groupe_lache(x->l_groupe);
+        x->l_groupe = NULL;
+    }
+}
+
+// the 32-bit signals are widened to doubles a vector at a time and written by the 64-bit perform routine, so that both have all the features
+void ipoke_dsp(t_ipoke *x, t_signal **sp, short *count)
+{
+    long n = sp[0]->s_n, nins = x->l_nvals + 2, i;
+    void **args;
     
-    //mark the buffers as free
-	buffer_unlocksamples(b);
+    ipoke_debut_dsp(x, sp[0]->s_sr);
+    x->l_index_in = x->l_nvals;                                         // one channel per inlet
+    x->l_ninputs = x->l_nvals;
+    x->l_actives = 1;
+    if (x->l_nb_tetes > 1)
+        object_error((t_object *)x, "several write heads need a multichannel index signal and the 64-bit audio engine: only the first head is written");
+    x->l_retour_in = count[x->l_nvals + 1] ? x->l_nvals + 1 : -1;
+    ipoke_fin_dsp(x, n);
     
-    x->l_index_precedent = index_precedent;
-    x->l_valeur = valeur;
-    x->l_nb_val = nb_val;
+    if (x->l_valeurs)
+        sysmem_freeptr(x->l_valeurs);
+    if (x->l_signaux)
+        sysmem_freeptr(x->l_signaux);
+    x->l_valeurs = (double *)sysmem_newptr(nins * n * sizeof(double));
+    x->l_signaux = (double **)sysmem_newptr(nins * sizeof(double *));
+    args = (void **)sysmem_newptr((nins + 2) * sizeof(void *));
+    if (!x->l_valeurs || !x->l_signaux || !args)
+    {
+        object_error((t_object *)x, "could not allocate the signals as doubles: nothing is written");
+        if (args)
+            sysmem_freeptr(args);
+        return;
+    }
+    args[0] = x;
+    args[1] = (void *)n;
+    for (i = 0; i < nins; i++)
+    {
+        x->l_signaux[i] = x->l_valeurs + i * n;
+        args[i + 2] = sp[i]->s_vec;
+    }
+    dsp_addv(ipoke_perform, nins + 2, args);
+    sysmem_freeptr(args);
+}
+
+void ipoke_dsp64(t_ipoke *x, t_object *dsp64, short *count, double samplerate, long maxvectorsize, long flags)
+{
+    long i, chans;
     
-out:
-    return (w + 5);
+    ipoke_debut_dsp(x, samplerate);
+    
+    // the value channels come first in ins: either one multichannel signal in the leftmost inlet or one signal per value inlet
+    x->l_index_in = 0;
+    for (i = 0; i < x->l_nvals; i++)
+    {
+        chans = (long)object_method(dsp64, gensym("getnuminputchannels"), x, i);
+        x->l_index_in += MAX(chans, 1);
+    }
+    chans = (long)object_method(dsp64, gensym("getnuminputchannels"), x, 0);
+    x->l_ninputs = (chans > 1) ? chans : x->l_nvals;
+    chans = MAX((long)object_method(dsp64, gensym("getnuminputchannels"), x, x->l_nvals), 1);
+    x->l_actives = MIN(x->l_nb_tetes, chans);                           // a head per channel of the index signal
+    x->l_retour_in = count[x->l_nvals + 1] ? x->l_index_in + chans : -1;   // a signal in the rightmost inlet overrides the overdub message
+    ipoke_fin_dsp(x, maxvectorsize);
+    object_method(dsp64, gensym("dsp_add64"), x, ipoke_perform64, 0, NULL);
+}
+
+// perform 32bit
+t_int *ipoke_perform(t_int *w)
+{
+    t_ipoke *x = (t_ipoke *)(w[1]);
+    long n = (long)(w[2]), nins = x->l_nvals + 2, i, c;
+    float *in;
+    
+    if (!x->l_signaux)                                          // as the dsp method could not allocate them
+        return (w + nins + 3);
+    for (c = 0; c < nins; c++)
+    {
+        in = (float *)(w[c + 3]);
+        for (i = 0; i < n; i++)
+            x->l_signaux[c][i] = in[i];
+    }
+    ipoke_perform64(x, NULL, x->l_signaux, nins, NULL, 0, n, 0, NULL);
+    return (w + nins + 3);
+}
+
+// several heads, in the lock of the vector: head h writes the value channels from h * nchans, cycling through them, at the channel h of the index signal
+// they take the modes of the first head, and what they wrote is reported with it
+static long ipoke_tetes(t_ipoke *x, t_ipoke_partage *partage, double **ins, float *tab, long frames, long nc, long chan, long nchans, long n)
+{
+    t_ipoke_core *tete;
+    const double *inind;
+    long h, c, dirty_flag = 0;
+
+    for (h = 0; h < x->l_actives; h++)
+    {
+        tete = h ? x->l_tetes + h - 1 : &x->l_core;
+        if (h)
+            ipoke_core_follow(tete, &x->l_core);
+        inind = ipoke_core_positions(tete, frames, ins[x->l_index_in + h], n);
+        if (partage)                                            // a head at a time, so that it never holds stripes while waiting for others
+            ipoke_partage_entre(partage, &x->l_bandes, tete, frames, inind, n);
+        ipoke_undo_save(&x->l_annule, tete, tab, frames, nc, chan, nchans, inind, n);
+        for (c = 0; c < nchans; c++)
+            x->l_vals[c] = ins[(h * nchans + c) % x->l_ninputs];
+        if (nchans > 1)
+            dirty_flag |= ipoke_core_write_multi(tete, tab, frames, nc, chan, (const double * const *)x->l_vals, nchans, inind, n);
+        else
+            dirty_flag |= ipoke_core_write(tete, tab, frames, nc, chan, x->l_vals[0], inind, n);
+        if (partage)
+            ipoke_partage_sort(partage, &x->l_bandes);
+        if (h)
+            ipoke_core_join(&x->l_core, tete);
+    }
+    return dirty_flag;
 }
 
 void ipoke_perform64(t_ipoke *x, t_object *dsp64, double **ins, long numins, double **outs, long numouts, long vec_size, long flags, void *userparam)
 {
-    //this is the only different code to above//
     double *inval = ins[0];
-    double *inind = ins[1];
+    const double *inind = ins[x->l_index_in];
     long n = vec_size;
-    //below is the same
     
-    t_buffer_obj *b = buffer_ref_getobject(x->l_buf);
+    t_ipoke_groupe *g = ipoke_groupe(x);
+    t_buffer_obj *b = NULL;                                     // a group looks it up once a tick
     
-    bool interp, dirty_flag;
-    char chan, nc;
-    float *tab;
-    double valeur_entree, valeur, index_tampon, coeff, overdub;
-    long frames, nb_val, index, index_precedent, pas, i,demivie;
+    float *tab = NULL, *cible;
+    long chan, nc, nchans, frames, dirty_flag = 0, c, stride, voie, h;
+    double debut;
+    char compter = x->l_core.compter;
+    char annule = 0;
+    t_ipoke_partage *partage = NULL;
+    unsigned long long ticks = compter ? ipoke_core_ticks() : 0;
+    unsigned int fpu = ipoke_fill_flush_denormals();            // flush to zero for this call only
     
-	tab = buffer_locksamples(b);
-	if (!tab)
-		goto out;
+    x->l_core.retours = (x->l_retour_in >= 0) ? ins[x->l_retour_in] : NULL;
+    if (x->l_disque)                                            // a sound file instead of the buffer~: nothing to lock, the first head only
+    {
+        nc = x->l_disque->nc;
+        chan = MIN(x->l_chan, nc - 1);
+        nchans = x->l_nchans ? x->l_nchans : x->l_ninputs;
+        nchans = MIN(nchans, nc - chan);
+        nchans = MIN(nchans, x->l_core.nvals);
+        for (c = 0; c < nchans; c++)
+            x->l_vals[c] = ins[c % x->l_ninputs];
+        x->l_core.frames_ms = x->l_disque->sr * 0.001;
+        inind = ipoke_core_positions(&x->l_core, x->l_disque->frames, inind, n);
+        ipoke_disk_write(x->l_disque, &x->l_core, chan, (const double * const *)x->l_vals, nchans, inind, n);
+        g = NULL;                                               // out of the group until the next dsp start, like a muted one
+        goto out;
+    }
+    if (x->l_rendant)                                           // an offline rendering writes the buffer~: muted until it is done
+    {
+        g = NULL;
+        goto out;
+    }
     
-    nc = buffer_getchannelcount(b);
-    chan =  MIN(x->l_chan, nc);
-    frames = buffer_getframecount(b);
-    demivie = (long)(frames * 0.5);
+    if (g && !ipoke_groupe_entre(g, x, &tab))                   // counted even when it does not write, so that the last one unlocks
+        g = NULL;
+    if (!g)
+        b = buffer_ref_getobject(x->l_buf);
+    if (x->l_annule.capacite)                                   // an undo or a redo has the buffer: this vector is dropped
+    {
+        if (!ipoke_undo_enter(&x->l_annule))
+            goto out;
+        annule = 1;
+    }
+    if (g)
+    {
+        if (!tab)
+            goto out;
+        debut = g->debut;
+        nc = g->nc;
+        frames = g->frames;
+    }
+    else
+    {
+        tab = buffer_locksamples(b);
+        if (!tab)
+            goto out;
+        debut = systimer_gettime();
+        nc = buffer_getchannelcount(b);
+        frames = buffer_getframecount(b);
+    }
+    chan =  MIN(x->l_chan, nc - 1);
     
-    index_precedent = x->l_index_precedent;
-    valeur = x->l_valeur;
-    nb_val = x->l_nb_val;
-    interp = x->l_interp;
-    dirty_flag = false;
-    overdub = x->l_overdub;
+    nchans = x->l_nchans ? x->l_nchans : x->l_ninputs;        // the channels written, within the buffer and the allocated state
+    nchans = MIN(nchans, nc - chan);
+    nchans = MIN(nchans, x->l_core.nvals);
+    if (x->l_core.unites == IPOKE_UNITS_MS)
+        x->l_core.frames_ms = g ? g->msr : buffer_getmillisamplerate(b);
+    if (x->l_partage && x->l_partage->cle == b)                 // not after a set, until the next dsp start
+        partage = x->l_partage;
     
-    if (overdub != 0.)
+    cible = tab;                                                // where the vector is written: the buffer itself,
+    stride = nc;
+    voie = chan;
+    if (x->l_actives > 1)                                       // several heads: all of them in this lock, unstaged
     {
-        if (interp)
+        dirty_flag = ipoke_tetes(x, partage, ins, tab, frames, nc, chan, nchans, n);
+        for (h = 0; h < x->l_actives && (h ? x->l_tetes[h - 1].index_precedent : x->l_core.index_precedent) < 0; h++)
+            ;
+        if (h == x->l_actives)                                  // all stopped: the take is over
+            ipoke_undo_close(&x->l_annule);
+        if (!g)
         {
-            while (n--)    // dsp loop with interpolation
-            {
-                valeur_entree = *inval++;
-                index_tampon = *inind++;
-                
-                if (index_tampon < 0.0)                                            // if the writing is stopped
-                {
-                    if (index_precedent >= 0)                                    // and if it is the 1st one to be stopped
-                    {
-                        tab[index_precedent * nc + chan] = (tab[index_precedent * nc + chan] * overdub) + (valeur/nb_val);        // write the average value at the last given index
-                        valeur = 0.0;
-                        index_precedent = -1;
-                        dirty_flag = true;
-                    }
-                }
-                else
-                {
-                    index = wrap_index((long)(index_tampon),frames);        // truncate the next index and make sure it is in the buffer's boundaries
-                    
-                    if (index_precedent < 0)                                    // if it is the first index to write, resets the averaging and the values
-                    {
-                        index_precedent = index;
-                        nb_val = 0;
-                    }
-                    
-                    if (index == index_precedent)                                // if the index has not moved, accumulate the value to average later.
-                    {
-                        valeur += valeur_entree;
-                        nb_val += 1;
-                    }
-                    else                                                        // if it moves
-                    {
-                        if (nb_val != 1)                                        // is there more than one values to average
-                        {
-                            valeur = valeur/nb_val;                                // if yes, calculate the average
-                            nb_val = 1;
-                        }
-                        
-                        tab[index_precedent * nc + chan] = (tab[index_precedent * nc + chan] * overdub) + valeur;                // write the average value at the last index
-                        dirty_flag = true;
-                        
-                        pas = index - index_precedent;                            // calculate the step to do
-                        
-                        if (pas > 0)                                            // are we going up
-                        {
-                            if (pas > demivie)                                    // is it faster to go the other way round?
-                            {
-                                pas -= frames;                                    // calculate the new number of steps
-                                coeff = (valeur_entree - valeur) / pas;            // calculate the interpolation coefficient
-                                
-                                for(i=(index_precedent-1);i>=0;i--)                    // fill the gap to zero
-                                {
-                                    valeur -= coeff;
-                                    tab[i * nc + chan] = (tab[i * nc + chan] * overdub) + valeur;
-                                }
-                                for(i=(frames-1);i>index;i--)                        // fill the gap from the top
-                                {
-                                    valeur -= coeff;
-                                    tab[i * nc + chan] = (tab[i * nc + chan] * overdub) + valeur;
-                                }
-                            }
-                            else                                                // if not, just fill the gaps
-                            {
-                                coeff = (valeur_entree - valeur) / pas;            // calculate the interpolation coefficient
-                                for (i=(index_precedent+1); i<index; i++)
-                                {
-                                    valeur += coeff;
-                                    tab[i * nc + chan] = (tab[i * nc + chan] * overdub) + valeur;
-                                }
-                            }
-                        }
-                        else                                                    // if we are going down
-                        {
-                            if ((-pas) > demivie)                                // is it faster to go the other way round?
-                            {
-                                pas += frames;                                    // calculate the new number of steps
-                                coeff = (valeur_entree - valeur) / pas;            // calculate the interpolation coefficient
-                                
-                                for(i=(index_precedent+1);i<frames;i++)            // fill the gap to the top
-                                {
-                                    valeur += coeff;
-                                    tab[i * nc + chan] = (tab[i * nc + chan] * overdub) + valeur;
-                                }
-                                for(i=0;i<index;i++)                            // fill the gap from zero
-                                {
-                                    valeur += coeff;
-                                    tab[i * nc + chan] = (tab[i * nc + chan] * overdub) + valeur;
-                                }
-                            }
-                            else                                                // if not, just fill the gaps
-                            {
-                                coeff = (valeur_entree - valeur) / pas;            // calculate the interpolation coefficient
-                                for (i=(index_precedent-1); i>index; i--)
-                                {
-                                    valeur -= coeff;
-                                    tab[i * nc + chan] = (tab[i * nc + chan] * overdub) + valeur;
-                                }
-                            }
-                        }
-                        
-                        valeur = valeur_entree;                                    // transfer the new previous value
-                    }
-                    index_precedent = index;                                        // transfer the new previous address
-                }
-            }
-        }
-        else
-        {
-            while (n--)    // dsp loop without interpolation
-            {
-                valeur_entree = *inval++;
-                index_tampon = *inind++;
-                
-                if (index_tampon < 0.0)                                            // if the writing is stopped
-                {
-                    if (index_precedent >= 0)                                    // and if it is the 1st one to be stopped
-                    {
-                        tab[index_precedent * nc + chan] = (tab[index_precedent * nc + chan] * overdub) + (valeur/nb_val);        // write the average value at the last given index
-                        valeur = 0.0;
-                        index_precedent = -1;
-                        dirty_flag = true;
-                    }
-                }
-                else
-                {
-                    index = wrap_index((long)(index_tampon),frames);        // truncate the next index and make sure it is in the buffer's boundaries
-                    
-                    if (index_precedent < 0)                                    // if it is the first index to write, resets the averaging and the values
-                    {
-                        index_precedent = index;
-                        nb_val = 0;
-                    }
-                    
-                    if (index == index_precedent)                                // if the index has not moved, accumulate the value to average later.
-                    {
-                        valeur += valeur_entree;
-                        nb_val += 1;
-                    }
-                    else                                                        // if it moves
-                    {
-                        if (nb_val != 1)                                        // is there more than one values to average
-                        {
-                            valeur = valeur/nb_val;                                // if yes, calculate the average
-                            nb_val = 1;
-                        }
-                        
-                        tab[index_precedent * nc + chan] = (tab[index_precedent * nc + chan] * overdub) + valeur;                // write the average value at the last index
-                        dirty_flag = true;
-                        
-                        pas = index - index_precedent;                            // calculate the step to do
-                        
-                        if (pas > 0)                                            // are we going up
-                        {
-                            if (pas > demivie)                                    // is it faster to go the other way round?
-                            {
-                                for(i=(index_precedent-1);i>=0;i--)                // fill the gap to zero
-                                    tab[i * nc + chan] = (tab[i * nc + chan] * overdub) + valeur;
-                                for(i=(frames-1);i>index;i--)                    // fill the gap from the top
-                                    tab[i * nc + chan] = (tab[i * nc + chan] * overdub) + valeur;
-                            }
-                            else                                                // if not, just fill the gaps
-                            {
-                                for (i=(index_precedent+1); i<index; i++)
-                                    tab[i * nc + chan] = (tab[i * nc + chan] * overdub) + valeur;
-                            }
-                        }
-                        else                                                    // if we are going down
-                        {
-                            if ((-pas) > demivie)                                // is it faster to go the other way round?
-                            {
-                                for(i=(index_precedent+1);i<frames;i++)            // fill the gap to the top
-                                    tab[i * nc + chan] = (tab[i * nc + chan] * overdub) + valeur;
-                                for(i=0;i<index;i++)                            // fill the gap from zero
-                                    tab[i * nc + chan] = (tab[i * nc + chan] * overdub) + valeur;
-                            }
-                            else                                                // if not, just fill the gaps
-                            {
-                                for (i=(index_precedent-1); i>index; i--)
-                                    tab[i * nc + chan] = (tab[i * nc + chan] * overdub) + valeur;
-                            }
-                        }
-                        
-                        valeur = valeur_entree;                                    // transfer the new previous value
-                    }
-                    index_precedent = index;                                        // transfer the new previous address
-                }
-            }
+            ipoke_verrou(x, debut);
+            buffer_unlocksamples(b);
         }
+        ipoke_modif(x, n);
+        goto out;
+    }
+    inind = ipoke_core_positions(&x->l_core, frames, inind, n);    // in frames, whatever the units
+    if (partage)                                                // held until the staged frames are copied back
+        ipoke_partage_entre(partage, &x->l_bandes, &x->l_core, frames, inind, n);
+    ipoke_undo_save(&x->l_annule, &x->l_core, tab, frames, nc, chan, nchans, inind, n);
+    if (ipoke_core_stage_in(&x->l_core, tab, frames, nc, chan, nchans, inind, n))
+    {                                                           // or the staging area, with the frames it writes copied out
+        ipoke_verrou(x, debut);
+        buffer_unlocksamples(b);
+        cible = x->l_core.journal;
+        stride = nchans;
+        voie = 0;
+        inind = x->l_core.journal_index;
+    }
+    
+    if (nchans > 1)                                             // multichannel: all the channels of a frame in one pass
+    {
+        for (c = 0; c < nchans; c++)
+            x->l_vals[c] = ins[c % x->l_ninputs];
+        dirty_flag = ipoke_core_write_multi(&x->l_core, cible, frames, stride, voie, (const double * const *)x->l_vals, nchans, inind, n);
     }
     else
+        dirty_flag = ipoke_core_write(&x->l_core, cible, frames, stride, voie, inval, inind, n);
+    
+    if (cible != tab)                                           // copy the staged frames back, in a lock of their own
     {
-        if (interp)
+        cible = buffer_locksamples(b);
+        if (!cible)
         {
-            while (n--)    // dsp loop with interpolation
-            {
-                valeur_entree = *inval++;
-                index_tampon = *inind++;
-                
-                if (index_tampon < 0.0)                                            // if the writing is stopped
-                {
-                    if (index_precedent >= 0)                                    // and if it is the 1st one to be stopped
-                    {
-                        tab[index_precedent * nc + chan] = valeur/nb_val;        // write the average value at the last given index
-                        valeur = 0.0;
-                        index_precedent = -1;
-                        dirty_flag = true;
-                    }
-                }
-                else
-                {
-                    index = wrap_index((long)(index_tampon),frames);        // truncate the next index and make sure it is in the buffer's boundaries
-                    
-                    if (index_precedent < 0)                                    // if it is the first index to write, resets the averaging and the values
-                    {
-                        index_precedent = index;
-                        nb_val = 0;
-                    }
-                    
-                    if (index == index_precedent)                                // if the index has not moved, accumulate the value to average later.
-                    {
-                        valeur += valeur_entree;
-                        nb_val += 1;
-                    }
-                    else                                                        // if it moves
-                    {
-                        if (nb_val != 1)                                        // is there more than one values to average
-                        {
-                            valeur = valeur/nb_val;                                // if yes, calculate the average
-                            nb_val = 1;
-                        }
-                        
-                        tab[index_precedent * nc + chan] = valeur;                // write the average value at the last index
-                        dirty_flag = true;
-                        
-                        pas = index - index_precedent;                            // calculate the step to do
-                        
-                        if (pas > 0)                                            // are we going up
-                        {
-                            if (pas > demivie)                                    // is it faster to go the other way round?
-                            {
-                                pas -= frames;                                    // calculate the new number of steps
-                                coeff = (valeur_entree - valeur) / pas;            // calculate the interpolation coefficient
-                                
-                                for(i=(index_precedent-1);i>=0;i--)                    // fill the gap to zero
-                                {
-                                    valeur -= coeff;
-                                    tab[i * nc + chan] = valeur;
-                                }
-                                for(i=(frames-1);i>index;i--)                        // fill the gap from the top
-                                {
-                                    valeur -= coeff;
-                                    tab[i * nc + chan] = valeur;
-                                }
-                            }
-                            else                                                // if not, just fill the gaps
-                            {
-                                coeff = (valeur_entree - valeur) / pas;            // calculate the interpolation coefficient
-                                for (i=(index_precedent+1); i<index; i++)
-                                {
-                                    valeur += coeff;
-                                    tab[i * nc + chan] = valeur;
-                                }
-                            }
-                        }
-                        else                                                    // if we are going down
-                        {
-                            if ((-pas) > demivie)                                // is it faster to go the other way round?
-                            {
-                                pas += frames;                                    // calculate the new number of steps
-                                coeff = (valeur_entree - valeur) / pas;            // calculate the interpolation coefficient
-                                
-                                for(i=(index_precedent+1);i<frames;i++)            // fill the gap to the top
-                                {
-                                    valeur += coeff;
-                                    tab[i * nc + chan] = valeur;
-                                }
-                                for(i=0;i<index;i++)                            // fill the gap from zero
-                                {
-                                    valeur += coeff;
-                                    tab[i * nc + chan] = valeur;
-                                }
-                            }
-                            else                                                // if not, just fill the gaps
-                            {
-                                coeff = (valeur_entree - valeur) / pas;            // calculate the interpolation coefficient
-                                for (i=(index_precedent-1); i>index; i--)
-                                {
-                                    valeur -= coeff;
-                                    tab[i * nc + chan] = valeur;
-                                }
-                            }
-                        }
-                        
-                        valeur = valeur_entree;                                    // transfer the new previous value
-                    }
-                    index_precedent = index;                                        // transfer the new previous address
-                }
-            }
+            ipoke_core_reset(&x->l_core);
+            goto out;
         }
-        else
+        debut = systimer_gettime();
+        if (cible != tab || buffer_getframecount(b) != frames || buffer_getchannelcount(b) != nc)
         {
-            while (n--)    // dsp loop without interpolation
-            {
-                valeur_entree = *inval++;
-                index_tampon = *inind++;
-                
-                if (index_tampon < 0.0)                                            // if the writing is stopped
-                {
-                    if (index_precedent >= 0)                                    // and if it is the 1st one to be stopped
-                    {
-                        tab[index_precedent * nc + chan] = valeur/nb_val;        // write the average value at the last given index
-                        valeur = 0.0;
-                        index_precedent = -1;
-                        dirty_flag = true;
-                    }
-                }
-                else
-                {
-                    index = wrap_index((long)(index_tampon),frames);        // truncate the next index and make sure it is in the buffer's boundaries
-                    
-                    if (index_precedent < 0)                                    // if it is the first index to write, resets the averaging and the values
-                    {
-                        index_precedent = index;
-                        nb_val = 0;
-                    }
-                    
-                    if (index == index_precedent)                                // if the index has not moved, accumulate the value to average later.
-                    {
-                        valeur += valeur_entree;
-                        nb_val += 1;
-                    }
-                    else                                                        // if it moves
-                    {
-                        if (nb_val != 1)                                        // is there more than one values to average
-                        {
-                            valeur = valeur/nb_val;                                // if yes, calculate the average
-                            nb_val = 1;
-                        }
-                        
-                        tab[index_precedent * nc + chan] = valeur;                // write the average value at the last index
-                        dirty_flag = true;
-                        
-                        pas = index - index_precedent;                            // calculate the step to do
-                        
-                        if (pas > 0)                                            // are we going up
-                        {
-                            if (pas > demivie)                                    // is it faster to go the other way round?
-                            {
-                                for(i=(index_precedent-1);i>=0;i--)                // fill the gap to zero
-                                    tab[i * nc + chan] = valeur;
-                                for(i=(frames-1);i>index;i--)                    // fill the gap from the top
-                                    tab[i * nc + chan] = valeur;
-                            }
-                            else                                                // if not, just fill the gaps
-                            {
-                                for (i=(index_precedent+1); i<index; i++)
-                                    tab[i * nc + chan] = valeur;
-                            }
-                        }
-                        else                                                    // if we are going down
-                        {
-                            if ((-pas) > demivie)                                // is it faster to go the other way round?
-                            {
-                                for(i=(index_precedent+1);i<frames;i++)            // fill the gap to the top
-                                    tab[i * nc + chan] = valeur;
-                                for(i=0;i<index;i++)                            // fill the gap from zero
-                                    tab[i * nc + chan] = valeur;
-                            }
-                            else                                                // if not, just fill the gaps
-                            {
-                                for (i=(index_precedent-1); i>index; i--)
-                                    tab[i * nc + chan] = valeur;
-                            }
-                        }
-                        
-                        valeur = valeur_entree;                                    // transfer the new previous value
-                    }
-                    index_precedent = index;                                        // transfer the new previous address
-                }
-            }
+            ipoke_core_reset(&x->l_core);                       // the buffer changed in between: this vector is lost
+            dirty_flag = 0;
         }
+        else
+            dirty_flag = ipoke_core_stage_out(&x->l_core, tab, frames, nc, chan, nchans, dirty_flag);
     }
-    //update the mod time
-    if (dirty_flag)
-        object_method((t_object *)b, gensym("dirty"));
     
-    //mark the buffers as free
-	buffer_unlocksamples(b);
+    if (x->l_core.index_precedent < 0)                          // stopped: the take is over
+        ipoke_undo_close(&x->l_annule);
+    
+    //mark the buffers as free, or leave it to the last of the group
+    if (!g)
+    {
+        ipoke_verrou(x, debut);
+        buffer_unlocksamples(b);
+    }
     
-    x->l_index_precedent = index_precedent;
-    x->l_valeur = valeur;
-    x->l_nb_val = nb_val;
+    //update the mod time
+    ipoke_modif(x, n);
     
 out:
+    if (g)
+        ipoke_groupe_sort(g, x, dirty_flag);
+    if (partage)
+        ipoke_partage_sort(partage, &x->l_bandes);
+    if (annule)
+        ipoke_undo_leave(&x->l_annule);
+    ipoke_fill_restore_denormals(fpu);
+    if (compter)
+        ipoke_compte(x, ticks);
     return;
 }
@@ -0,0 +1,452 @@
+//    ipoke~ for Pure Data - the interpolating array writer, on the write engine of the Max external
+//    by Pierre Alexandre Tremblay
+//    the same kernels as in Max (see ../ipoke_core.h), writing one Pd array: the left inlet takes the values, the right one the indices.
+//    the modes are set by the same messages, and render writes whole trajectories at once, for the batch renders of a headless Pd
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "m_pd.h"
+#include "ipoke_core.h"    // the host-independent write engine
+
+#if defined(PD_FLOATSIZE) && PD_FLOATSIZE != 32
+#error "the write engine writes 32-bit floats: build against a single precision Pd"
+#endif
+
+#define IPOKE_FILS 4                    // threads of an offline rendering
+#define IPOKE_PAS ((long)(sizeof(t_word) / sizeof(float)))  // floats from a point of an array to the next, its w_float first
+
+static t_class *ipoke_class = NULL;
+static t_symbol *ps_dirty;
+
+typedef struct _ipoke
+{
+    t_object l_obj;
+    t_float l_f;                        // the value while no signal is connected
+    t_symbol *l_sym;                    // the array written
+    t_word *l_vec;                      // its points, NULL when there is none, set at dsp time
+    long l_frames;
+    double *l_valeurs;                  // the values as doubles, when the indices are not in samples
+    long l_vecteur;
+    t_outlet *l_out;                    // the written region, as dirty <first frame> <number of frames>
+    t_clock *l_horloge;                 // redraws the array and reports it from the scheduler
+    double l_dirtyrate;                 // shortest time between two redraws, in ms
+    char l_attente;                     // a redraw is scheduled
+    t_ipoke_rendu l_rendu;              // the offline rendering, see ipoke_render
+    t_ipoke_core l_core;
+} t_ipoke;
+
+// the array named l_sym, as a plain interleaved float array of IPOKE_PAS channels written from the first: NULL with an error if there is none
+static t_word *ipoke_tableau(t_ipoke *x, t_symbol *s, long *frames)
+{
+    t_garray *a = (t_garray *)pd_findbyclass(s, garray_class);
+    t_word *vec;
+    int n;
+
+    if (!a)
+    {
+        if (*s->s_name)
+            pd_error(x, "ipoke~: %s: no such array", s->s_name);
+        return NULL;
+    }
+    if (!garray_getfloatwords(a, &n, &vec))
+    {
+        pd_error(x, "ipoke~: %s: bad template", s->s_name);
+        return NULL;
+    }
+    *frames = n;
+    return vec;
+}
+
+static void ipoke_set(t_ipoke *x, t_symbol *s)
+{
+    t_garray *a;
+
+    x->l_sym = s;
+    x->l_vec = ipoke_tableau(x, s, &x->l_frames);
+    if (x->l_vec && (a = (t_garray *)pd_findbyclass(s, garray_class)))
+        garray_usedindsp(a);                            // resizing it restarts the dsp, so l_vec stays valid
+    ipoke_core_reset(&x->l_core);
+}
+
+static void ipoke_interp(t_ipoke *x, t_floatarg f)
+{
+    switch ((long)f)
+    {
+        case IPOKE_INTERP_HOLD:
+        case IPOKE_INTERP_LINEAR:
+        case IPOKE_INTERP_CUBIC:
+        case IPOKE_INTERP_SINC:
+            x->l_core.interp = (char)f;
+            ipoke_core_select(&x->l_core, IPOKE_PAS);
+            break;
+        default:
+            pd_error(x, "ipoke~: wrong interpolation type");
+            break;
+    }
+}
+
+static void ipoke_overdub(t_ipoke *x, t_floatarg f)
+{
+    x->l_core.overdub = f;
+    ipoke_core_select(&x->l_core, IPOKE_PAS);
+}
+
+static void ipoke_combine(t_ipoke *x, t_floatarg f)
+{
+    switch ((long)f)
+    {
+        case IPOKE_COMBINE_OVERDUB:
+        case IPOKE_COMBINE_REPLACE:
+        case IPOKE_COMBINE_ADD:
+        case IPOKE_COMBINE_XFADE:
+        case IPOKE_COMBINE_MAX:
+        case IPOKE_COMBINE_SOFTSAT:
+            x->l_core.combine = (char)f;
+            ipoke_core_select(&x->l_core, IPOKE_PAS);
+            break;
+        default:
+            pd_error(x, "ipoke~: wrong combine mode");
+            break;
+    }
+}
+
+static void ipoke_antialias(t_ipoke *x, t_floatarg f)
+{
+    x->l_core.antialias = (f != 0);
+    x->l_core.pos_passe = -1;                           // the filter restarts from the next input
+}
+
+static void ipoke_splat(t_ipoke *x, t_floatarg f)
+{
+    switch ((long)f)
+    {
+        case IPOKE_SPLAT_OFF:
+        case IPOKE_SPLAT_LINEAR:
+        case IPOKE_SPLAT_CUBIC:
+            if (x->l_core.splat != (char)f)
+            {
+                x->l_core.splat = (char)f;
+                ipoke_core_reset(&x->l_core);           // the two ways of writing do not share their pending state
+            }
+            break;
+        default:
+            pd_error(x, "ipoke~: wrong splat type");
+            break;
+    }
+}
+
+static void ipoke_maxfill(t_ipoke *x, t_floatarg f)
+{
+    x->l_core.budget = (f > 0) ? (long)f : 0;           // 0: the gaps are always filled at once
+}
+
+static void ipoke_jump(t_ipoke *x, t_floatarg f)
+{
+    x->l_core.saut = (f > 0) ? (long)f : 0;             // 0: every step is filled
+}
+
+static void ipoke_jumpfade(t_ipoke *x, t_floatarg f)
+{
+    if (f > IPOKE_CORE_FONDU)
+        post("ipoke~: jumpfade is at most %d frames", IPOKE_CORE_FONDU);
+    ipoke_core_set_fondu(&x->l_core, (long)f);
+}
+
+static void ipoke_snap(t_ipoke *x, t_floatarg f)
+{
+    x->l_core.seuil = (f > 0) ? f : 0.;                 // 0: decayed frames are never snapped
+}
+
+static void ipoke_loop(t_ipoke *x, t_symbol *s, int argc, t_atom *argv)
+{
+    long debut = 0, fin = 0;                            // no argument: the whole array
+
+    if (argc == 2)
+    {
+        debut = (long)atom_getfloat(argv);
+        fin = (long)atom_getfloat(argv + 1);
+    }
+    else if (argc)
+    {
+        pd_error(x, "ipoke~: loop takes the first frame and the frame after the last one");
+        return;
+    }
+    if (debut < 0 || (fin && fin < debut + 2))
+    {
+        pd_error(x, "ipoke~: wrong loop region");
+        return;
+    }
+    x->l_core.boucle_debut = debut;                     // applied at the next vector, the writing restarts there
+    x->l_core.boucle_fin = fin;
+}
+
+// units samples, phase (0 to 1 over the loop region), ms, or rate: the index signal is then the speed of the object's own write position
+static void ipoke_units(t_ipoke *x, t_symbol *s)
+{
+    if (s == gensym("samples"))
+        x->l_core.unites = IPOKE_UNITS_SAMPLES;
+    else if (s == gensym("phase"))
+        x->l_core.unites = IPOKE_UNITS_PHASE;
+    else if (s == gensym("ms"))
+        x->l_core.unites = IPOKE_UNITS_MS;
+    else if (s == gensym("rate"))
+        x->l_core.unites = IPOKE_UNITS_RATE;
+    else
+        pd_error(x, "ipoke~: units are samples, phase, ms or rate");
+}
+
+// moves the write position of the rate units to a frame, negative to stop writing
+static void ipoke_seek(t_ipoke *x, t_floatarg f)
+{
+    ipoke_core_seek(&x->l_core, f);
+}
+
+// back to the start of the loop region
+static void ipoke_reset(t_ipoke *x)
+{
+    ipoke_core_seek(&x->l_core, x->l_core.boucle_debut);
+}
+
+static void ipoke_dirtyrate(t_ipoke *x, t_floatarg f)
+{
+    x->l_dirtyrate = (f > 0) ? f : 0.;
+}
+
+// redraws the array once for all the vectors written since the last time, and tells which frames were written
+static void ipoke_tick(t_ipoke *x)
+{
+    t_garray *a = (t_garray *)pd_findbyclass(x->l_sym, garray_class);
+    t_atom region[2];
+    long debut, etendue;
+
+    x->l_attente = 0;
+    if (!(etendue = ipoke_core_modif(&x->l_core, &debut)))
+        return;
+    if (a)
+        garray_redraw(a);
+    SETFLOAT(region, debut);
+    SETFLOAT(region + 1, etendue);
+    outlet_anything(x->l_out, ps_dirty, 2, region);
+}
+
+static t_int *ipoke_perform(t_int *w)
+{
+    t_ipoke *x = (t_ipoke *)(w[1]);
+    t_sample *inval = (t_sample *)(w[2]);
+    t_sample *inind = (t_sample *)(w[3]);
+    long n = (long)(w[4]), i;
+    unsigned int fpu;
+
+    if (!x->l_vec)
+        return (w + 5);
+    fpu = ipoke_fill_flush_denormals();                 // flush to zero for this call only
+    if (x->l_core.unites != IPOKE_UNITS_SAMPLES && x->l_valeurs)
+    {                                                   // the indices in other units, as doubles: a float cannot hold a frame past 2^24
+        for (i = 0; i < n; i++)
+            x->l_valeurs[i] = inval[i];
+        ipoke_core_write(&x->l_core, (float *)x->l_vec, x->l_frames, IPOKE_PAS, 0, x->l_valeurs,
+                         ipoke_core_positions_float(&x->l_core, x->l_frames, inind, n), n);
+    }
+    else
+        ipoke_core_write_float(&x->l_core, (float *)x->l_vec, x->l_frames, IPOKE_PAS, 0, inval, inind, n);
+    ipoke_fill_restore_denormals(fpu);
+    if (x->l_core.modif_etendue && !x->l_attente)       // the scheduler runs in this thread: no handshake needed
+    {
+        x->l_attente = 1;
+        clock_delay(x->l_horloge, x->l_dirtyrate);
+    }
+    return (w + 5);
+}
+
+static void ipoke_dsp(t_ipoke *x, t_signal **sp)
+{
+    ipoke_set(x, x->l_sym);
+    ipoke_core_select(&x->l_core, IPOKE_PAS);
+    x->l_core.frames_ms = sp[0]->s_sr * 0.001;          // an array has no sample rate of its own
+    if (x->l_valeurs)
+        freebytes(x->l_valeurs, x->l_vecteur * sizeof(double));
+    x->l_vecteur = sp[0]->s_n;
+    x->l_valeurs = (double *)getbytes(x->l_vecteur * sizeof(double));
+    if (!x->l_valeurs || !ipoke_core_set_positions(&x->l_core, x->l_vecteur))
+    {
+        pd_error(x, "ipoke~: could not allocate the indices: they are taken in samples");
+        if (x->l_valeurs)
+            freebytes(x->l_valeurs, x->l_vecteur * sizeof(double));
+        x->l_valeurs = NULL;
+    }
+    dsp_add(ipoke_perform, 4, x, sp[0]->s_vec, sp[1]->s_vec, (t_int)sp[0]->s_n);
+}
+
+//***********************************************************************************************
+// offline rendering
+
+// a thread of the rendering, writing every IPOKE_FILS part from its own first one
+typedef struct _ipoke_fil
+{
+    t_ipoke_rendu *rendu;
+    long premiere;
+} t_ipoke_fil;
+
+static void ipoke_parts(t_ipoke_rendu *r, long premiere)
+{
+    long part;
+
+    for (part = premiere; part < r->nb_parts; part += IPOKE_FILS)
+        ipoke_core_render_part(r, part);
+}
+
+static void *ipoke_fil(void *data)
+{
+    t_ipoke_fil *f = (t_ipoke_fil *)data;
+
+    ipoke_parts(f->rendu, f->premiere);
+    return NULL;
+}
+
+// the points of an array as doubles, with room for marge more: 0 with an error if there is none, or it is empty
+static long ipoke_copie(t_ipoke *x, t_symbol *s, double **donnees, long marge)
+{
+    t_word *vec;
+    long frames = 0, i;
+
+    if (!(vec = ipoke_tableau(x, s, &frames)) || !frames)
+    {
+        if (vec)
+            pd_error(x, "ipoke~: %s: empty array", s->s_name);
+        return 0;
+    }
+    if (!(*donnees = (double *)getbytes((frames + marge) * sizeof(double))))
+        return 0;
+    for (i = 0; i < frames; i++)
+        (*donnees)[i] = vec[i].w_float;
+    return frames;
+}
+
+// render <values array> <indices array>, or pairs of index and value: the whole trajectory written before it returns, from IPOKE_FILS threads
+static void ipoke_render(t_ipoke *x, t_symbol *s, int argc, t_atom *argv)
+{
+    t_garray *a;
+    t_atom region[2];
+    pthread_t fils[IPOKE_FILS];
+    t_ipoke_fil quoi[IPOKE_FILS];
+    double *donnees, *indices;
+    const double *entrees[1];
+    long n, ni, nb_fils = 0, parts, i, taille;
+    long frames;
+    t_word *vec = ipoke_tableau(x, x->l_sym, &frames);
+
+    if (!vec)
+        return;
+    if (argc == 2 && argv[0].a_type == A_SYMBOL && argv[1].a_type == A_SYMBOL)
+    {
+        if (!(ni = ipoke_copie(x, atom_getsymbol(argv + 1), &indices, 0)))
+            return;
+        n = ipoke_copie(x, atom_getsymbol(argv), &donnees, ni);  // with room for the indices after the values
+        taille = n + ni;
+        if (n)
+        {
+            n = (ni < n) ? ni : n;
+            memcpy(donnees + n, indices, n * sizeof(double));
+        }
+        freebytes(indices, ni * sizeof(double));
+        if (!n)
+            return;
+    }
+    else
+    {
+        if (argc < 2 || argc % 2)
+        {
+            pd_error(x, "ipoke~: render takes an array of values and one of indices, or pairs of index and value");
+            return;
+        }
+        n = argc / 2;
+        taille = 2 * n;
+        if (!(donnees = (double *)getbytes(taille * sizeof(double))))
+            return;
+        for (i = 0; i < n; i++)
+        {
+            donnees[n + i] = atom_getfloat(argv + 2 * i);
+            donnees[i] = atom_getfloat(argv + 2 * i + 1);
+        }
+    }
+    indices = donnees + n;
+    entrees[0] = donnees;
+
+    if (!(parts = ipoke_core_render(&x->l_rendu, &x->l_core, (float *)vec, frames, IPOKE_PAS, 0, entrees, 1, indices, n, 8 * IPOKE_FILS)))
+        pd_error(x, "ipoke~: render: out of memory");
+    else
+    {
+        for (i = 0; i < IPOKE_FILS && i < parts; i++)
+        {
+            quoi[i].rendu = &x->l_rendu;
+            quoi[i].premiere = i;
+            if (pthread_create(fils + i, NULL, ipoke_fil, quoi + i))
+                break;
+            nb_fils++;
+        }
+        for (i = nb_fils; i < IPOKE_FILS; i++)          // the parts of the threads that could not start, from here
+            ipoke_parts(&x->l_rendu, i);
+        for (i = 0; i < nb_fils; i++)
+            pthread_join(fils[i], NULL);
+        ipoke_core_render_free(&x->l_rendu);
+        if ((a = (t_garray *)pd_findbyclass(x->l_sym, garray_class)))
+            garray_redraw(a);
+        SETFLOAT(region, 0);
+        SETFLOAT(region + 1, frames);
+        outlet_anything(x->l_out, ps_dirty, 2, region);
+        outlet_anything(x->l_out, gensym("rendered"), 0, NULL);
+    }
+    freebytes(donnees, taille * sizeof(double));
+}
+
+//***********************************************************************************************
+
+static void *ipoke_new(t_symbol *s)
+{
+    t_ipoke *x = (t_ipoke *)pd_new(ipoke_class);
+
+    inlet_new(&x->l_obj, &x->l_obj.ob_pd, &s_signal, &s_signal);  // the index
+    x->l_out = outlet_new(&x->l_obj, &s_anything);
+    x->l_horloge = clock_new(x, (t_method)ipoke_tick);
+    x->l_dirtyrate = 40.;
+    x->l_sym = s;
+    ipoke_core_init(&x->l_core);
+    return (x);
+}
+
+static void ipoke_free(t_ipoke *x)
+{
+    clock_free(x->l_horloge);
+    if (x->l_valeurs)
+        freebytes(x->l_valeurs, x->l_vecteur * sizeof(double));
+    ipoke_core_free(&x->l_core);
+}
+
+void ipoke_tilde_setup(void)
+{
+    t_class *c = class_new(gensym("ipoke~"), (t_newmethod)ipoke_new, (t_method)ipoke_free, sizeof(t_ipoke), 0, A_DEFSYM, 0);
+
+    CLASS_MAINSIGNALIN(c, t_ipoke, l_f);
+    class_addmethod(c, (t_method)ipoke_dsp, gensym("dsp"), A_CANT, 0);
+    class_addmethod(c, (t_method)ipoke_set, gensym("set"), A_SYMBOL, 0);
+    class_addmethod(c, (t_method)ipoke_interp, gensym("interp"), A_FLOAT, 0);
+    class_addmethod(c, (t_method)ipoke_overdub, gensym("overdub"), A_FLOAT, 0);
+    class_addmethod(c, (t_method)ipoke_combine, gensym("combine"), A_FLOAT, 0);
+    class_addmethod(c, (t_method)ipoke_antialias, gensym("antialias"), A_FLOAT, 0);
+    class_addmethod(c, (t_method)ipoke_splat, gensym("splat"), A_FLOAT, 0);
+    class_addmethod(c, (t_method)ipoke_maxfill, gensym("maxfill"), A_FLOAT, 0);
+    class_addmethod(c, (t_method)ipoke_jump, gensym("jump"), A_FLOAT, 0);
+    class_addmethod(c, (t_method)ipoke_jumpfade, gensym("jumpfade"), A_FLOAT, 0);
+    class_addmethod(c, (t_method)ipoke_snap, gensym("snap"), A_FLOAT, 0);
+    class_addmethod(c, (t_method)ipoke_loop, gensym("loop"), A_GIMME, 0);
+    class_addmethod(c, (t_method)ipoke_units, gensym("units"), A_SYMBOL, 0);
+    class_addmethod(c, (t_method)ipoke_seek, gensym("seek"), A_FLOAT, 0);
+    class_addmethod(c, (t_method)ipoke_reset, gensym("reset"), 0);
+    class_addmethod(c, (t_method)ipoke_dirtyrate, gensym("dirtyrate"), A_FLOAT, 0);
+    class_addmethod(c, (t_method)ipoke_render, gensym("render"), A_GIMME, 0);
+    ipoke_class = c;
+    ps_dirty = gensym("dirty");
+    ipoke_fill_select(-1);                              // the fill tables and kernels, here rather than on the audio thread
+}
@@ -0,0 +1,141 @@
+//    ipoke_test_disk - regression test of the sound file ipoke~ writes to
+//    by Pierre Alexandre Tremblay
+//    writes a temporary 32-bit float wav through ipoke_disk_write, calling ipoke_disk_service between the vectors as the service thread
+//    of ipoke~ would, while the same head writes a buffer in memory, then reads the file back and compares them frame by frame.
+//    The head goes over the ends of the blocks and of the windows, round the end of the file both ways, and jumps back into a window
+//    flushed and unmapped since, to overdub what it wrote there: the vectors dropped until a window is mapped are dropped from the buffer too
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "ipoke_core.h"
+#include "ipoke_disk.h"
+
+#define TEST_FICHIER "ipoke_test_disk.wav"              // in the directory it runs in
+#define TEST_FRAMES (5 * IPOKE_DISK_BLOC + 1000)        // the last block short
+#define TEST_NC 2
+#define TEST_VECTOR 64
+#define TEST_SR 44100.
+#define TEST_PERDUS 2                                   // the first vector, and the one of the jump
+
+// where the head goes: from debut, at vitesse frames per input, for n inputs
+typedef struct _trajet
+{
+    double debut;
+    double vitesse;
+    long n;
+} t_trajet;
+
+static const t_trajet test_trajets[] = {
+    { 60000., 1.3, 230000 },                            // over the blocks and the windows, round the end of the file to 20000
+    { -1., -0.8, 40000 },                               // back from there, round the start to the end
+    { 100000., 1.1, 70000 },                            // a jump into a window left long ago
+};
+#define TEST_TRAJETS (long)(sizeof(test_trajets) / sizeof(test_trajets[0]))
+
+static float memoire[TEST_FRAMES * TEST_NC];
+static float lu[TEST_FRAMES * TEST_NC];
+
+// reads the file back as any reader would: its header, then the frames: 0 if it could not
+static long test_relit(void)
+{
+    unsigned char h[44];
+    FILE *f = fopen(TEST_FICHIER, "rb");
+    long ok;
+
+    if (!f)
+        return 0;
+    ok = fread(h, 1, 44, f) == 44 && !memcmp(h, "RIFF", 4) && !memcmp(h + 8, "WAVEfmt ", 8) && h[20] == 3 && h[22] == TEST_NC && h[34] == 32
+         && !memcmp(h + 36, "data", 4) && (h[40] | h[41] << 8 | (unsigned long)h[42] << 16 | (unsigned long)h[43] << 24) == TEST_FRAMES * TEST_NC * sizeof(float)
+         && fread(lu, sizeof(float), TEST_FRAMES * TEST_NC, f) == TEST_FRAMES * TEST_NC;
+    fclose(f);
+    return ok;
+}
+
+int main(void)
+{
+    t_ipoke_disk d;
+    t_ipoke_core x, r;
+    double indices[TEST_VECTOR], valeurs[TEST_NC][TEST_VECTOR], position = 0.;
+    const double *vals[TEST_NC];
+    long t, i, j, c, perdus, cas_faits = 0, echecs = 0;
+
+    for (c = 0; c < TEST_NC; c++)
+        vals[c] = valeurs[c];
+    ipoke_core_init(&x);
+    ipoke_core_init(&r);
+    if (!ipoke_core_set_nvals(&x, TEST_NC) || !ipoke_core_set_nvals(&r, TEST_NC) || !ipoke_core_set_journal(&x, 0, 0, TEST_VECTOR))
+    {
+        fprintf(stderr, "could not allocate the heads\n");
+        exit(2);
+    }
+    if (!ipoke_disk_open(&d, TEST_FICHIER, TEST_FRAMES, TEST_NC, TEST_SR))
+    {
+        fprintf(stderr, "could not create %s\n", TEST_FICHIER);
+        exit(2);
+    }
+    x.overdub = r.overdub = 0.5;                        // what was written shows through what is written over it
+    ipoke_core_select(&x, TEST_NC);
+    ipoke_core_select(&r, TEST_NC);
+
+    for (t = 0; t < TEST_TRAJETS; t++)
+    {
+        if (test_trajets[t].debut >= 0.)
+            position = test_trajets[t].debut;
+        for (i = 0; i < test_trajets[t].n; i += TEST_VECTOR)
+        {
+            for (j = 0; j < TEST_VECTOR; j++)
+            {
+                indices[j] = position;
+                position = fmod(position + test_trajets[t].vitesse + TEST_FRAMES, TEST_FRAMES);
+                for (c = 0; c < TEST_NC; c++)
+                    valeurs[c][j] = sin((i + j) * 0.01 + t + c);
+            }
+            perdus = d.perdus;
+            ipoke_disk_write(&d, &x, 0, vals, TEST_NC, indices, TEST_VECTOR);
+            if (d.perdus != perdus)                     // not written: the head starts again from the next one
+                ipoke_core_reset(&r);
+            else
+                ipoke_core_write_multi(&r, memoire, TEST_FRAMES, TEST_NC, 0, vals, TEST_NC, indices, TEST_VECTOR);
+            ipoke_disk_service(&d);
+        }
+    }
+    cas_faits++;
+    if (d.perdus != TEST_PERDUS)
+    {
+        fprintf(stderr, "%ld vectors dropped instead of %d\n", d.perdus, TEST_PERDUS);
+        echecs++;
+    }
+    ipoke_disk_close(&d);
+
+    cas_faits++;
+    if (!ipoke_disk_open(&d, TEST_FICHIER, 0, 0, 0.) || d.frames != TEST_FRAMES || d.nc != TEST_NC || d.sr != TEST_SR)
+    {
+        fprintf(stderr, "%s could not be opened again as it was created\n", TEST_FICHIER);
+        echecs++;
+    }
+    ipoke_disk_close(&d);
+
+    cas_faits++;
+    if (!test_relit())
+    {
+        fprintf(stderr, "%s could not be read back\n", TEST_FICHIER);
+        echecs++;
+    }
+    else
+        for (i = 0; i < TEST_FRAMES * TEST_NC; i++)
+            if (memcmp(lu + i, memoire + i, sizeof(float)))
+            {
+                fprintf(stderr, "frame %ld, channel %ld is %.9g in the file instead of %.9g\n", i / TEST_NC, i % TEST_NC, lu[i], memoire[i]);
+                echecs++;
+                break;
+            }
+    remove(TEST_FICHIER);
+    ipoke_core_free(&x);
+    ipoke_core_free(&r);
+
+    printf("%ld cases, %ld failed\n", cas_faits, echecs);
+    return echecs ? 1 : 0;
+}
@@ -0,0 +1,426 @@
+//    ipoke_test_groupe - regression test of the ipoke~ sharing the lock of their buffer~
+//    by Pierre Alexandre Tremblay
+//    builds ipoke~ on a stubbed Max runtime (the headers of max/) that counts the locks of one buffer~, and drives 4 objects
+//    for 3000 ticks: grouped, they must leave the buffer as they do each on its own, with one lock a tick, members muted and
+//    unmuted at the start, middle and end of the chain, an undo pool on one of them, their dsp restarted in the other order,
+//    a silent tail that leaves the buffer~ clean, and two threads running them, which must fall back to locking one by one.
+//    Configured with -DCMAKE_C_FLAGS=-fsanitize=thread, ThreadSanitizer watches the group state under the two threads
+
+#include <stdarg.h>
+#include <math.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "ipoke~.c"
+
+#define TEST_OBJETS 4
+#define TEST_VECTOR 64
+#define TEST_TICKS 3000
+#define TEST_FRAMES 50000
+
+//***********************************************************************************************
+// the runtime: one buffer~, its locks counted
+
+struct _buffer_ref { t_symbol *nom; };
+
+static t_object test_buffer;
+static float test_tab[TEST_FRAMES];
+static volatile long test_verrous, test_deverrous, test_tenus, test_sales;
+static int test_dsp;
+static int test_lent;                                   // the lock takes a while, so that the other thread comes in meanwhile
+static int test_moities;                                // the objects of each thread in their half of the buffer, as a buffer~ lock does not keep them apart
+
+t_class *class_new(const char *name, method mnew, method mfree, long size, method mmenu, short type, ...)
+{
+    static long taille;
+
+    taille = size;
+    return (t_class *)&taille;
+}
+
+t_max_err class_addmethod(t_class *c, method m, const char *name, ...) { return 0; }
+t_max_err class_register(t_symbol *name_space, t_class *c) { return 0; }
+void class_dspinit(t_class *c) { }
+void *object_alloc(t_class *c) { return calloc(1, *(long *)c); }
+void object_free(void *x) { }
+
+void *object_method(void *x, t_symbol *s, ...)
+{
+    if (x == &test_buffer)
+        __sync_fetch_and_add(&test_sales, 1);
+    return NULL;
+}
+
+void object_error(t_object *x, const char *s, ...)
+{
+    va_list ap;
+
+    va_start(ap, s);
+    vfprintf(stderr, s, ap);
+    fprintf(stderr, "\n");
+    va_end(ap);
+}
+
+void object_warn(t_object *x, const char *s, ...) { }
+void object_post(t_object *x, const char *s, ...) { }
+void post(const char *fmt, ...) { }
+
+t_symbol *gensym(const char *s)
+{
+    static t_symbol symboles[64];
+    static long n;
+    long i;
+
+    for (i = 0; i < n; i++)
+        if (!strcmp(symboles[i].s_name, s))
+            return symboles + i;
+    symboles[n].s_name = strdup(s);
+    return symboles + n++;
+}
+
+void *outlet_new(void *x, const char *s) { return (void *)1; }
+void *outlet_anything(void *o, t_symbol *s, short ac, t_atom *av) { return NULL; }
+void *outlet_list(void *o, t_symbol *s, short ac, t_atom *av) { return NULL; }
+void *outlet_int(void *o, long n) { return NULL; }
+void *outlet_float(void *o, double f) { return NULL; }
+void *outlet_bang(void *o) { return NULL; }
+void *proxy_new(void *x, long id, long *stuffloc) { return NULL; }
+long proxy_getinlet(t_object *master) { return 0; }
+
+void atom_setlong(t_atom *a, t_atom_long b) { a->a_type = A_LONG; a->a_w.w_long = b; }
+void atom_setfloat(t_atom *a, double b) { a->a_type = A_FLOAT; a->a_w.w_float = b; }
+void atom_setsym(t_atom *a, t_symbol *b) { a->a_type = A_SYM; a->a_w.w_sym = b; }
+t_atom_long atom_getlong(const t_atom *a) { return (a->a_type == A_FLOAT) ? (t_atom_long)a->a_w.w_float : a->a_w.w_long; }
+double atom_getfloat(const t_atom *a) { return (a->a_type == A_LONG) ? a->a_w.w_long : a->a_w.w_float; }
+t_symbol *atom_getsym(const t_atom *a) { return (a->a_type == A_SYM) ? a->a_w.w_sym : gensym(""); }
+long atom_gettype(const t_atom *a) { return a->a_type; }
+long attr_args_offset(short ac, t_atom *av) { return ac; }
+void attr_args_process(void *x, short ac, t_atom *av) { }
+
+void *sysmem_newptr(long size) { return malloc(size); }
+void *sysmem_newptrclear(long size) { return calloc(1, size); }
+void *sysmem_resizeptr(void *ptr, long newsize) { return realloc(ptr, newsize); }
+void sysmem_freeptr(void *ptr) { free(ptr); }
+
+void *qelem_new(void *obj, method fn) { return (void *)1; }
+void qelem_set(void *q) { }
+void qelem_unset(void *q) { }
+void qelem_free(void *q) { }
+void *clock_new(void *obj, method fn) { return (void *)1; }
+void clock_delay(void *x, long n) { }                   // the tests tick the objects themselves
+void clock_fdelay(void *c, double time) { }
+void clock_unset(void *x) { }
+void clock_getftime(double *time) { *time = 0.; }
+void freeobject(t_object *op) { }
+void defer(void *ob, method fn, t_symbol *sym, short argc, t_atom *argv) { }
+void defer_low(void *ob, method fn, t_symbol *sym, short argc, t_atom *argv) { }
+short path_nameconform(const char *src, char *dst, long style, long type) { strcpy(dst, src); return 0; }
+
+void z_dsp_setup(t_pxobject *x, long nsignals) { }
+void dsp_setup(t_pxobject *x, long nsignals) { }
+void dsp_free(t_pxobject *x) { }
+void dsp_add(t_perfroutine f, long n, ...) { }
+void dsp_addv(t_perfroutine f, long n, void **vector) { }
+double sys_getsr(void) { return 44100.; }
+short sys_getdspobjdspstate(t_object *o) { return test_dsp; }
+double systimer_gettime(void) { return 0.; }
+
+long systhread_create(method entryproc, void *arg, long stacksize, long priority, long flags, t_systhread *thread) { return 1; }
+long systhread_join(t_systhread thread, unsigned int *retval) { return 0; }
+void systhread_sleep(long milliseconds) { }
+void systhread_exit(long status) { }
+long systhread_mutex_new(t_systhread_mutex *pmutex, long flags) { return 1; }
+long systhread_mutex_free(t_systhread_mutex pmutex) { return 0; }
+long systhread_mutex_lock(t_systhread_mutex pmutex) { return 0; }
+long systhread_mutex_unlock(t_systhread_mutex pmutex) { return 0; }
+
+long ATOMIC_INCREMENT(volatile long *p) { return __sync_add_and_fetch(p, 1); }
+long ATOMIC_DECREMENT(volatile long *p) { return __sync_sub_and_fetch(p, 1); }
+long ATOMIC_INCREMENT_BARRIER(volatile long *p) { return __sync_add_and_fetch(p, 1); }
+long ATOMIC_DECREMENT_BARRIER(volatile long *p) { return __sync_sub_and_fetch(p, 1); }
+long ATOMIC_COMPARE_SWAP32(long oldvalue, long newvalue, volatile long *target) { return __sync_bool_compare_and_swap(target, oldvalue, newvalue); }
+
+t_buffer_ref *buffer_ref_new(t_object *self, t_symbol *name)
+{
+    t_buffer_ref *r = malloc(sizeof(t_buffer_ref));
+
+    r->nom = name;
+    return r;
+}
+
+void buffer_ref_set(t_buffer_ref *x, t_symbol *name) { x->nom = name; }
+t_buffer_obj *buffer_ref_getobject(t_buffer_ref *x) { return &test_buffer; }
+long buffer_ref_exists(t_buffer_ref *x) { return 1; }
+t_max_err buffer_ref_notify(t_buffer_ref *x, t_symbol *s, t_symbol *msg, void *sender, void *data) { return 0; }
+
+float *buffer_locksamples(t_buffer_obj *buffer_object)
+{
+    __sync_fetch_and_add(&test_verrous, 1);
+    __sync_fetch_and_add(&test_tenus, 1);
+    if (test_lent)
+        usleep(100);
+    return test_tab;
+}
+
+void buffer_unlocksamples(t_buffer_obj *buffer_object)
+{
+    __sync_fetch_and_add(&test_deverrous, 1);
+    __sync_fetch_and_sub(&test_tenus, 1);
+}
+
+t_atom_long buffer_getchannelcount(t_buffer_obj *buffer_object) { return 1; }
+t_atom_long buffer_getframecount(t_buffer_obj *buffer_object) { return TEST_FRAMES; }
+double buffer_getsamplerate(t_buffer_obj *buffer_object) { return 44100.; }
+double buffer_getmillisamplerate(t_buffer_obj *buffer_object) { return 44.1; }
+t_max_err buffer_setdirty(t_buffer_obj *buffer_object) { return 0; }
+t_max_err buffer_view(t_buffer_obj *buffer_object) { return 0; }
+t_symbol *buffer_getfilename(t_buffer_obj *buffer_object) { return gensym(""); }
+
+//***********************************************************************************************
+// the objects
+
+static t_ipoke *objets[TEST_OBJETS];
+static short test_connectes[2] = { 1, 1 };
+
+typedef struct _entrees
+{
+    double valeurs[TEST_VECTOR];
+    double indices[TEST_VECTOR];
+    double *ins[2];
+} t_entrees;
+
+static t_entrees entrees[TEST_OBJETS];
+
+static void test_reset(void)
+{
+    memset(test_tab, 0, sizeof(test_tab));
+    test_verrous = test_deverrous = test_tenus = test_sales = 0;
+}
+
+static void test_nouveaux(long groupe, long annule)
+{
+    long k;
+
+    for (k = 0; k < TEST_OBJETS; k++)
+    {
+        objets[k] = (t_ipoke *)ipoke_new(gensym("tampon"), 0, 1, 1);
+        ipoke_group(objets[k], groupe);
+        if (annule && k == 1)
+            ipoke_undopool(objets[k], 100000);
+        ipoke_overdub(objets[k], 0.5);
+        ipoke_dsp64(objets[k], (t_object *)1, test_connectes, 44100., TEST_VECTOR, 0);
+    }
+}
+
+static void test_libere(void)
+{
+    long k;
+
+    for (k = 0; k < TEST_OBJETS; k++)
+        ipoke_free(objets[k]);
+}
+
+// the vector of object k at tick t, each at its own speed from its own place, or stopped
+static void test_perform(long k, long t, char silence)
+{
+    t_entrees *e = entrees + k;
+    long i, etendue = test_moities ? TEST_FRAMES / 2 : TEST_FRAMES, debut = test_moities ? (k % 2) * etendue : 0;
+
+    for (i = 0; i < TEST_VECTOR; i++)
+    {
+        e->valeurs[i] = sin((t * TEST_VECTOR + i) * 0.01 * (k + 1));
+        e->indices[i] = silence ? -1. : debut + fmod((t * TEST_VECTOR + i) * (0.5 + 0.3 * k) + k * 1000., etendue);
+    }
+    e->ins[0] = e->valeurs;
+    e->ins[1] = e->indices;
+    ipoke_perform64(objets[k], (t_object *)1, e->ins, 2, NULL, 0, TEST_VECTOR, 0, NULL);
+}
+
+static long test_echec(const char *s)
+{
+    fprintf(stderr, "%s\n", s);
+    return 1;
+}
+
+//***********************************************************************************************
+// the tests
+
+// one member muted in the middle, then the first, then the last of the chain: returns the ticks that ended with the buffer~ locked
+static long test_chaine(long groupe, float *resultat)
+{
+    long t, k, tenus = 0;
+    char muet;
+
+    test_reset();
+    test_nouveaux(groupe, 1);
+    for (t = 0; t < TEST_TICKS; t++)
+    {
+        for (k = 0; k < TEST_OBJETS; k++)
+        {
+            muet = (k == 2 && t > 1000 && t < 1500) || (k == 0 && t > 2000 && t < 2100) || (k == 3 && t > 2500 && t < 2600);
+            if (!muet)
+                test_perform(k, t, 0);
+        }
+        if (test_tenus)
+            tenus++;
+    }
+    for (k = 0; k < TEST_OBJETS; k++)
+        ipoke_tick(objets[k]);
+    test_libere();
+    memcpy(resultat, test_tab, sizeof(test_tab));
+    return tenus;
+}
+
+static long test_groupe(void)
+{
+    static float seuls[TEST_FRAMES], groupes[TEST_FRAMES];
+    long verrous_seuls, tenus, echecs = 0;
+
+    test_chaine(0, seuls);
+    verrous_seuls = test_verrous;
+    tenus = test_chaine(1, groupes);
+    if (memcmp(seuls, groupes, sizeof(seuls)))
+        echecs += test_echec("group: the buffer differs from the one the objects write each on its own");
+    if (test_verrous > TEST_TICKS + 1 || test_verrous >= verrous_seuls)
+    {
+        fprintf(stderr, "group: %ld locks in %d ticks, %ld without the group\n", test_verrous, TEST_TICKS, verrous_seuls);
+        echecs++;
+    }
+    if (tenus > 1)                                      // the mute of the last member costs one
+        echecs += test_echec("group: the buffer~ left locked at the end of more than one tick");
+    if (test_tenus || test_verrous != test_deverrous)
+        echecs += test_echec("group: the locks are not balanced once the objects are freed");
+    return echecs;
+}
+
+// the dsp restarted in the other order at tick 1000 (mode 1), or the objects stopped from then on (mode 2)
+static long test_redemarre(long mode)
+{
+    long t, k, ordre[TEST_OBJETS], tenus = 0, sales, echecs = 0;
+
+    test_reset();
+    test_nouveaux(1, 0);
+    for (k = 0; k < TEST_OBJETS; k++)
+        ordre[k] = k;
+    for (t = 0; t < TEST_TICKS; t++)
+    {
+        if (mode == 1 && t == 1000)
+        {
+            for (k = 0; k < TEST_OBJETS; k++)
+                ordre[k] = TEST_OBJETS - 1 - k;
+            for (k = 0; k < TEST_OBJETS; k++)
+                ipoke_dsp64(objets[ordre[k]], (t_object *)1, test_connectes, 44100., TEST_VECTOR, 0);
+        }
+        if (mode == 2 && (t == 1000 || t == 1500))      // what was written reported, then the silence
+            for (k = 0; k < TEST_OBJETS; k++)
+                ipoke_tick(objets[k]);
+        for (k = 0; k < TEST_OBJETS; k++)
+            test_perform(ordre[k], t, mode == 2 && t >= 1000);
+        if (test_tenus)
+            tenus++;
+    }
+    if (test_verrous != TEST_TICKS || tenus)
+    {
+        fprintf(stderr, "group, %s: %ld locks in %d ticks, %ld ending locked\n", (mode == 1) ? "dsp restarted" : "silent tail", test_verrous,
+                TEST_TICKS, tenus);
+        echecs++;
+    }
+    if (mode == 2 && objets[0]->l_groupe->sale)         // left to be marked dirty by the next report
+        echecs += test_echec("group, silent tail: the group counts as written while nothing was");
+    sales = test_sales;
+    for (k = 0; k < TEST_OBJETS; k++)
+        ipoke_tick(objets[k]);
+    if (mode == 1 && test_sales - sales != 1)
+        echecs += test_echec("group, dsp restarted: the buffer~ not marked dirty once for the group");
+    if (mode == 2 && test_sales != sales)
+        echecs += test_echec("group, silent tail: the buffer~ marked dirty while nothing was written");
+    test_libere();
+    if (test_tenus || test_verrous != test_deverrous)
+        echecs += test_echec("group: the locks are not balanced once the objects are freed");
+    return echecs;
+}
+
+// the two threads meet at each tick, as the audio threads of a parallel poly~ (macOS has no pthread_barrier_t)
+static pthread_mutex_t test_verrou = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t test_signal = PTHREAD_COND_INITIALIZER;
+static long test_arrives, test_tour;
+
+static void test_rendezvous(void)
+{
+    long tour;
+
+    pthread_mutex_lock(&test_verrou);
+    tour = test_tour;
+    if (++test_arrives == 2)
+    {
+        test_arrives = 0;
+        test_tour++;
+        pthread_cond_broadcast(&test_signal);
+    }
+    else
+        while (tour == test_tour)
+            pthread_cond_wait(&test_signal, &test_verrou);
+    pthread_mutex_unlock(&test_verrou);
+}
+
+// one of two threads, each running every other object of the group
+static void *test_fil(void *d)
+{
+    long premier = (long)d, t, k;
+
+    for (t = 0; t < TEST_TICKS; t++)
+    {
+        test_rendezvous();
+        for (k = premier; k < TEST_OBJETS; k += 2)
+            test_perform(k, t, 0);
+        test_rendezvous();
+    }
+    return NULL;
+}
+
+static long test_fils(void)
+{
+    pthread_t fils[2];
+    long i, divise, echecs = 0;
+
+    test_reset();
+    test_nouveaux(1, 0);
+    test_lent = 1;
+    test_moities = 1;
+    for (i = 0; i < 2; i++)
+        if (pthread_create(fils + i, NULL, test_fil, (void *)i))
+        {
+            fprintf(stderr, "could not start a thread\n");
+            exit(2);
+        }
+    for (i = 0; i < 2; i++)
+        pthread_join(fils[i], NULL);
+    test_lent = 0;
+    test_moities = 0;
+    divise = objets[0]->l_groupe->divise;
+    if (!divise)
+        echecs += test_echec("group, two threads: not detected");
+    if (test_tenus || test_verrous != test_deverrous)
+    {
+        fprintf(stderr, "group, two threads: %ld locks, %ld unlocks\n", test_verrous, test_deverrous);
+        echecs++;
+    }
+    test_libere();
+    if (test_tenus)
+        echecs += test_echec("group, two threads: the buffer~ still locked once the objects are freed");
+    return echecs;
+}
+
+int main(void)
+{
+    long echecs = 0;
+
+    ext_main(NULL);
+    echecs += test_groupe();
+    echecs += test_redemarre(1);
+    echecs += test_redemarre(2);
+    echecs += test_fils();
+
+    printf("%ld failed\n", echecs);
+    return echecs ? 1 : 0;
+}
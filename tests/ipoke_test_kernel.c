@@ -0,0 +1,1395 @@
+//    ipoke_test_kernel - regression test of the ipoke~ write engine
+//    by Pierre Alexandre Tremblay
+//    writes the same trajectories with the engine and with a plain reference kernel, one input at a time with none of the
+//    specialisations, and fails on the first frame that differs: for every interp and write mode, with one to three heads,
+//    one or several channels, double or float inputs, in a loop region or not, up and down, round the buffer, stopping and
+//    jumping, and for several vector sizes, the heads taking turns by vectors as in a host; then again with a gap budget, the fills it
+//    carries over being drained by a last vector without one, and the frames each write changes checked against ipoke_core_portee;
+//    with a jump threshold, the long steps crossfaded at both ends instead of filled; and with fractional splatting, one head writing
+//    runs of the same direction, each frame the weighted average of the inputs around it; and with the anti-aliasing, the inputs
+//    low-passed instead of averaged when writing slower than real time; and with a snap threshold, the frames of each arc the head
+//    went over snapped to zero when under it, at the stops and at the end of each vector
+//    the scalar and SSE2 fills must match the reference bit for bit; AVX2 fuses some multiply-adds, so it is only held
+//    within 1e-5 of it, as are the splatting and the low-pass, which add up in another order. The snapping is not tested on AVX2,
+//    where a frame that close to the threshold could go either way
+//    the index in phase, ms and rate units is also turned into positions here and compared with the engine's, exactly, the rate one
+//    through seeks and region moves
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+
+#include "ipoke_core.h"
+#include "ipoke_fill.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define TEST_FRAMES 1999                                // odd, so the way round is never a tie
+#define TEST_INPUTS 6000
+#define TEST_HEADS 3
+#define TEST_NC 5
+#define TEST_BROUILLON IPOKE_CORE_BROUILLON
+#define TEST_RATIO 4.                                   // as IPOKE_CORE_RATIO
+#define TEST_SIGNAL 2                                   // as IPOKE_CORE_SIGNAL
+#define TEST_LISSAGE 0.1                                // as IPOKE_CORE_LISSAGE
+#define TEST_COURT 64                                   // as IPOKE_CORE_COURT
+#define TEST_BUDGET 100                                 // frames filled per vector with a budget, less than the jumps
+#define TEST_SAUT 250                                   // steps longer than this are jumps with a threshold, so are the fastest runs
+#define TEST_FONDU 100                                  // and the length of their crossfades
+#define TEST_SEUIL 0.2                                  // the snap threshold, a good share of the written frames
+
+// the features tested on top of the plain write, one at a time
+#define TEST_SANS 0
+#define TEST_MAXFILL 1
+#define TEST_JUMP 2
+#define TEST_SPLAT 3
+#define TEST_SPLAT_CUBIC 4
+#define TEST_ANTIALIAS 5
+#define TEST_SNAP 6
+
+static const char *test_options[] = { "", ", maxfill", ", jump", ", splat", ", cubic splat", ", antialias", ", snap" };
+#define TEST_OPTIONS (long)(sizeof(test_options) / sizeof(test_options[0]))
+
+// the write modes tested: the combine mode, and for IPOKE_COMBINE_OVERDUB the ratio, -1 for a signal one
+typedef struct _mode
+{
+    const char *nom;
+    char combine;
+    double overdub;
+} t_mode;
+
+static const t_mode test_modes[] = {
+    { "replace", IPOKE_COMBINE_OVERDUB, 0. },
+    { "overdub", IPOKE_COMBINE_OVERDUB, 0.6 },
+    { "signal", IPOKE_COMBINE_OVERDUB, -1. },
+    { "replace mode", IPOKE_COMBINE_REPLACE, 0.6 },
+    { "add", IPOKE_COMBINE_ADD, 0. },
+    { "crossfade", IPOKE_COMBINE_XFADE, 0.3 },
+    { "max", IPOKE_COMBINE_MAX, 0. },
+    { "softsat", IPOKE_COMBINE_SOFTSAT, 0. },
+};
+#define TEST_MODES (long)(sizeof(test_modes) / sizeof(test_modes[0]))
+
+static const long test_vectors[] = { 1, 7, 64, 300 };
+#define TEST_VECTORS (long)(sizeof(test_vectors) / sizeof(test_vectors[0]))
+
+// the windowed sinc the engine interpolates with, rebuilt here: one row of weights per phase between two points
+static double test_sinc[(IPOKE_SINC_PHASES + 1) * IPOKE_SINC_TAPS];
+
+static void test_sinc_build(void)
+{
+    double x, w, sum, *row;
+    long phase, j;
+
+    for (phase = 0; phase <= IPOKE_SINC_PHASES; phase++)
+    {
+        row = test_sinc + phase * IPOKE_SINC_TAPS;
+        sum = 0.;
+        for (j = 0; j < IPOKE_SINC_TAPS; j++)
+        {
+            x = (double)phase / IPOKE_SINC_PHASES - (j - IPOKE_SINC_CENTRE);
+            w = 0.42 + 0.5 * cos(M_PI * x / (IPOKE_SINC_TAPS * 0.5)) + 0.08 * cos(2. * M_PI * x / (IPOKE_SINC_TAPS * 0.5));
+            row[j] = ((fabs(x) < 1e-12) ? 1. : sin(M_PI * x) / (M_PI * x)) * ((fabs(x) < IPOKE_SINC_TAPS * 0.5) ? w : 0.);
+            sum += row[j];
+        }
+        for (j = 0; j < IPOKE_SINC_TAPS; j++)
+            row[j] /= sum;
+    }
+}
+
+// the decaying half raised cosine of the jump crossfades
+static double test_fondu[TEST_FONDU];
+
+static void test_fondu_build(void)
+{
+    long k;
+
+    for (k = 0; k < TEST_FONDU; k++)
+        test_fondu[k] = 0.5 * (1. + cos(M_PI * (k + 1) / (TEST_FONDU + 1)));
+}
+
+// the anti-aliasing low-pass filters, one per cutoff: Blackman-windowed sincs of unity gain
+static double test_decim[IPOKE_DECIM_BANKS * IPOKE_DECIM_TAPS];
+
+static void test_decim_build(void)
+{
+    double x, w, fc, sum, *row;
+    long bank, j;
+
+    for (bank = 0; bank < IPOKE_DECIM_BANKS; bank++)
+    {
+        row = test_decim + bank * IPOKE_DECIM_TAPS;
+        fc = 0.45 * (bank + 1) / IPOKE_DECIM_BANKS;
+        sum = 0.;
+        for (j = 0; j < IPOKE_DECIM_TAPS; j++)
+        {
+            x = j - (IPOKE_DECIM_TAPS - 1) * 0.5;
+            w = 0.42 + 0.5 * cos(2. * M_PI * x / IPOKE_DECIM_TAPS) + 0.08 * cos(4. * M_PI * x / IPOKE_DECIM_TAPS);
+            row[j] = sin(2. * M_PI * fc * x) / (M_PI * x) * w;
+            sum += row[j];
+        }
+        for (j = 0; j < IPOKE_DECIM_TAPS; j++)
+            row[j] /= sum;
+    }
+}
+
+static long test_sinc_phase(double t)
+{
+    long phase = (long)(t * IPOKE_SINC_PHASES + 0.5);
+
+    return (phase < 0) ? 0 : (phase > IPOKE_SINC_PHASES) ? IPOKE_SINC_PHASES : phase;
+}
+
+//***********************************************************************************************
+// reference kernel: what the engine does, written out for one channel and one input at a time
+
+// a gap fill carried over, as t_ipoke_reste
+typedef struct _reference_reste
+{
+    long index;
+    long pas;
+    long debut;
+    long fin;
+    double valeur;
+    double curve[IPOKE_SINC_TAPS];
+    double retour;                                      // the signal ratio at index, and its slope
+    double pente_retour;
+} t_reference_reste;
+
+typedef struct _reference
+{
+    char interp;
+    int ecriture;                                       // 0 replaces, 1 a constant ratio, TEST_SIGNAL a signal one, or the non-linear combine mode
+    double ratio;                                       // of the old content
+    double gain;                                        // of the new one
+    long index_precedent;
+    long nb_val;
+    double valeur;
+    double retour;
+    double histoire[IPOKE_CORE_HISTORY];
+    long nb_hist;
+    long pas_precedent;
+    long budget;                                        // frames the gaps may fill per vector, 0 for all
+    long libre;                                         // what is left of it in the current one
+    t_reference_reste restes[IPOKE_CORE_RESTES];        // the fills carried over, oldest first
+    long nb_restes;
+    long saut;                                          // the jump threshold, 0 for none
+    long sens;                                          // the direction of the last step that was not one
+    char antialias;
+    double passe[IPOKE_DECIM_TAPS];                     // the last inputs, the oldest at pos_passe
+    long pos_passe;                                     // -1 to restart them from the next one
+    double periode;                                     // the smoothed inputs per step
+    double seuil;                                       // the snap threshold, 0 for none
+    long trace_origine;                                 // the arc the head went over since it was last snapped, from trace_origine + trace_bas
+    long trace_decalage;                                // up to trace_origine + trace_haut, trace_origine -1 for none
+    long trace_bas;
+    long trace_haut;
+} t_reference;
+
+static void reference_init(t_reference *r, char interp, const t_mode *m, char option)
+{
+    memset(r, 0, sizeof(t_reference));
+    r->interp = interp;
+    r->index_precedent = -1;
+    r->gain = 1.;
+    r->budget = (option == TEST_MAXFILL) ? TEST_BUDGET : 0;
+    r->saut = (option == TEST_JUMP) ? TEST_SAUT : 0;
+    r->sens = 1;
+    r->antialias = (option == TEST_ANTIALIAS);
+    r->seuil = (option == TEST_SNAP) ? TEST_SEUIL : 0.;
+    r->trace_origine = -1;
+    switch (m->combine)
+    {
+        case IPOKE_COMBINE_REPLACE:
+            r->ecriture = 0;
+            break;
+        case IPOKE_COMBINE_ADD:
+            r->ecriture = 1;
+            r->ratio = 1.;
+            break;
+        case IPOKE_COMBINE_XFADE:
+            r->ecriture = IPOKE_COMBINE_XFADE;
+            r->ratio = sin(m->overdub * M_PI * 0.5);
+            r->gain = cos(m->overdub * M_PI * 0.5);
+            break;
+        case IPOKE_COMBINE_MAX:
+        case IPOKE_COMBINE_SOFTSAT:
+            r->ecriture = m->combine;
+            r->ratio = 1.;
+            break;
+        default:
+            r->ecriture = (m->overdub < 0.) ? TEST_SIGNAL : (m->overdub != 0.);
+            r->ratio = (m->overdub < 0.) ? 0. : m->overdub;
+            break;
+    }
+}
+
+static double reference_point(const t_reference *r, float old, double v, double a)
+{
+    switch (r->ecriture)
+    {
+        case 0:
+            return v;
+        case IPOKE_COMBINE_XFADE:
+            return (old * a) + (v * r->gain);
+        case IPOKE_COMBINE_MAX:
+            return (fabs(v) > fabsf(old)) ? v : old;
+        case IPOKE_COMBINE_SOFTSAT:
+            return ipoke_fill_sature(old + v);
+        default:
+            return (old * a) + v;
+    }
+}
+
+// the new value of a gap frame t steps into it, t0 + k * dt with the offset the engine fills it from
+static double reference_courbe(const t_reference *r, const double *curve, double valeur, double offset, long k, long pas)
+{
+    const double *row;
+    double t, v = 0.;
+    long j;
+
+    switch (r->interp)
+    {
+        case IPOKE_INTERP_HOLD:
+        case IPOKE_INTERP_LINEAR:
+            return (valeur + offset * curve[0]) + k * curve[0];
+        case IPOKE_INTERP_CUBIC:
+            t = offset / pas + k * (1. / pas);
+            return ((curve[3] * t + curve[2]) * t + curve[1]) * t + curve[0];
+        default:
+            t = offset / pas + k * (1. / pas);
+            row = test_sinc + test_sinc_phase(t) * IPOKE_SINC_TAPS;
+            for (j = 0; j < IPOKE_SINC_TAPS; j++)
+                v += row[j] * curve[j];
+            return v;
+    }
+}
+
+// one segment of a gap, len frames from tab, offset steps from the last written point
+static void reference_segment(const t_reference *r, float *tab, long nc, long len, double offset, long pas, double valeur, const double *curve,
+                              double overdub, double pente_retour)
+{
+    double od, v;
+    float brouillon;
+    long k, base;
+
+    if (r->ecriture > TEST_SIGNAL)                      // filled by blocks of the scratch area, then combined
+    {
+        for (base = 0; base < len; base += TEST_BROUILLON)
+            for (k = 0; k < len - base && k < TEST_BROUILLON; k++)
+            {
+                float *f = tab + (base + k) * nc;
+
+                brouillon = (float)reference_courbe(r, curve, valeur, offset + base, k, pas);
+                switch (r->ecriture)
+                {
+                    case IPOKE_COMBINE_XFADE:
+                        *f = (float)((*f * r->ratio) + (brouillon * r->gain));
+                        break;
+                    case IPOKE_COMBINE_MAX:
+                        if (fabsf(brouillon) > fabsf(*f))
+                            *f = brouillon;
+                        break;
+                    default:
+                        *f = (float)ipoke_fill_sature((double)*f + brouillon);
+                        break;
+                }
+            }
+        return;
+    }
+
+    for (k = 0; k < len; k++)
+    {
+        float *f = tab + k * nc;
+
+        v = reference_courbe(r, curve, valeur, offset, k, pas);
+        if (r->ecriture == TEST_SIGNAL)
+        {
+            od = (overdub + offset * pente_retour) + k * pente_retour;
+            if (r->interp < IPOKE_INTERP_CUBIC)
+                *f = (float)((*f * od) + v);
+            else
+            {
+                *f = (float)(*f * od);                  // scaled first, then the curve added with a ratio of 1
+                *f = (float)((*f * 1.) + v);
+            }
+        }
+        else if (r->ecriture && (r->interp < IPOKE_INTERP_CUBIC || overdub != 0.))
+            *f = (float)((*f * overdub) + v);
+        else
+            *f = (float)v;
+    }
+}
+
+static void reference_curve(t_reference *r, long pas, double valeur, double entree, double *curve)
+{
+    double m0, m1, d0, d1, h0, h1;
+    long j;
+
+    switch (r->interp)
+    {
+        case IPOKE_INTERP_HOLD:
+            curve[0] = 0.;
+            break;
+        case IPOKE_INTERP_LINEAR:
+            curve[0] = (entree - valeur) / pas;
+            break;
+        case IPOKE_INTERP_CUBIC:
+            h1 = labs(pas);
+            h0 = r->pas_precedent ? r->pas_precedent : h1;
+            if (h1 > TEST_RATIO * h0)
+                h0 = h1 / TEST_RATIO;
+            else if (h0 > TEST_RATIO * h1)
+                h0 = h1 * TEST_RATIO;
+            d1 = entree - valeur;
+            d0 = (valeur - r->histoire[IPOKE_CORE_HISTORY - 2]) * h1 / h0;
+            m0 = (d1 * h0 + d0 * h1) / (h0 + h1);
+            m1 = d1 + (d1 - d0) * h1 / (h0 + h1);
+            curve[0] = valeur;
+            curve[1] = m0;
+            curve[2] = 3. * (entree - valeur) - 2. * m0 - m1;
+            curve[3] = 2. * (valeur - entree) + m0 + m1;
+            break;
+        default:
+            for (j = 0; j <= IPOKE_SINC_CENTRE; j++)
+                curve[j] = r->histoire[IPOKE_CORE_HISTORY - 1 - IPOKE_SINC_CENTRE + j];
+            curve[j] = entree;
+            for (j++; j < IPOKE_SINC_TAPS; j++)
+                curve[j] = 2. * entree - curve[2 * (IPOKE_SINC_CENTRE + 1) - j];
+            break;
+    }
+}
+
+// the arc the head goes over, from where it is at the start of a vector, a restart or a jump
+static void reference_trace_point(t_reference *r, long index)
+{
+    if (r->trace_origine < 0)
+    {
+        r->trace_origine = index;
+        r->trace_decalage = r->trace_bas = r->trace_haut = 0;
+    }
+}
+
+static void reference_trace_avance(t_reference *r, long pas)
+{
+    r->trace_decalage += pas;
+    r->trace_bas = (r->trace_decalage < r->trace_bas) ? r->trace_decalage : r->trace_bas;
+    r->trace_haut = (r->trace_decalage > r->trace_haut) ? r->trace_decalage : r->trace_haut;
+}
+
+// the frames of the arc under the threshold are snapped to zero, when overdubbing, and a new arc starts from the next point
+static void reference_trace(t_reference *r, float *tab, long frames, long nc)
+{
+    long debut, etendue, k;
+    float *f;
+
+    if (r->trace_origine < 0)
+        return;
+    debut = ((r->trace_origine + r->trace_bas) % frames + frames) % frames;
+    etendue = r->trace_haut - r->trace_bas + 1;
+    if (r->seuil > 0. && r->ecriture)
+        for (k = 0; k < etendue && k < frames; k++)
+        {
+            f = tab + ((debut + k) % frames) * nc;
+            if (fabsf(*f) < (float)r->seuil)
+                *f = 0.f;
+        }
+    r->trace_origine = -1;
+}
+
+// fills at most libre of the steps q has left, in the order the engine does, and returns how many
+static long reference_avance(t_reference *r, t_reference_reste *q, float *tab, long frames, long nc, long libre)
+{
+    long fin = q->fin, len, bas, start, premier;
+    double overdub = (r->ecriture == TEST_SIGNAL) ? q->retour : r->ratio;
+
+    if (fin - q->debut + 1 > libre)
+        fin = q->debut + libre - 1;
+    len = fin - q->debut + 1;
+    if (len <= 0)
+        return 0;
+    bas = (q->pas > 0) ? q->debut : -fin;
+    start = ((q->index + bas) % frames + frames) % frames;
+    premier = (len < frames - start) ? len : frames - start;
+    reference_segment(r, tab + start * nc, nc, premier, bas, q->pas, q->valeur, q->curve, overdub, q->pente_retour);
+    reference_segment(r, tab, nc, len - premier, bas + premier, q->pas, q->valeur, q->curve, overdub, q->pente_retour);
+    q->debut = fin + 1;
+    return len;
+}
+
+// the start of a vector: the budget is renewed and the queued fills go on, oldest first
+static void reference_vecteur(t_reference *r, float *tab, long frames, long nc)
+{
+    long fait = 0;
+
+    r->libre = (r->budget > 0) ? r->budget : LONG_MAX;
+    while (r->nb_restes && fait < r->libre)
+    {
+        fait += reference_avance(r, r->restes, tab, frames, nc, r->libre - fait);
+        if (r->restes[0].debut > r->restes[0].fin)
+            memmove(r->restes, r->restes + 1, --r->nb_restes * sizeof(t_reference_reste));
+    }
+    r->libre -= fait;
+    r->trace_origine = -1;
+    if (r->index_precedent >= 0)
+        reference_trace_point(r, r->index_precedent);
+}
+
+// the end of a vector: the arc is snapped if the head moved, the frame it is on still accumulating otherwise
+static void reference_fin_vecteur(t_reference *r, float *tab, long frames, long nc)
+{
+    if (r->trace_haut > r->trace_bas)
+        reference_trace(r, tab, frames, nc);
+}
+
+// the len frames from start were written: each queued fill keeps its steps before the first of them, or after the last one
+// if they start at its nearest step. As steps of the fill they are an arc from a, also met a turn lower when it wraps
+static void reference_coupe(t_reference *r, long frames, long start, long len)
+{
+    t_reference_reste *q;
+    long i, a, tour, bas, haut, premier, dernier;
+
+    for (i = 0; i < r->nb_restes; i++)
+    {
+        q = r->restes + i;
+        a = (((q->pas > 0) ? start - q->index : q->index - start - len + 1) % frames + frames) % frames;
+        premier = q->fin + 1;
+        dernier = q->debut - 1;
+        for (tour = 0; tour < 2; tour++)
+        {
+            bas = (len >= frames) ? 0 : a - tour * frames;
+            haut = (len >= frames) ? frames - 1 : a + len - 1 - tour * frames;
+            bas = (bas < q->debut) ? q->debut : bas;
+            haut = (haut > q->fin) ? q->fin : haut;
+            if (bas > haut)
+                continue;
+            premier = (bas < premier) ? bas : premier;
+            dernier = (haut > dernier) ? haut : dernier;
+        }
+        if (premier > dernier)
+            continue;
+        if (premier > q->debut)
+            q->fin = premier - 1;
+        else
+            q->debut = dernier + 1;
+    }
+}
+
+// a gap longer than the budget left: queued behind the others, the oldest dropped when there are too many, and filled as far as it goes
+static void reference_differe(t_reference *r, float *tab, long frames, long nc, long pas, const double *curve, double overdub, double pente_retour)
+{
+    t_reference_reste *q;
+
+    if (r->nb_restes == IPOKE_CORE_RESTES)
+        memmove(r->restes, r->restes + 1, --r->nb_restes * sizeof(t_reference_reste));
+    q = r->restes + r->nb_restes++;
+    q->index = r->index_precedent;
+    q->pas = pas;
+    q->debut = 1;
+    q->fin = labs(pas) - 1;
+    q->valeur = r->valeur;
+    memcpy(q->curve, curve, sizeof(q->curve));
+    q->retour = overdub;
+    q->pente_retour = pente_retour;
+    r->libre -= reference_avance(r, q, tab, frames, nc, r->libre);
+}
+
+// a jump from depart to arrivee, where entree arrives: the step each end leaves with the old content is faded into it, away from the jump
+static void reference_punch(t_reference *r, float *tab, long frames, long nc, long depart, long arrivee, double entree, double ratio)
+{
+    long len = (TEST_FONDU < frames / 2 - 1) ? TEST_FONDU : frames / 2 - 1;
+    long apres = (depart + r->sens + frames) % frames, avant = (arrivee - r->sens + frames) % frames, k;
+    double sortie = tab[depart * nc] - tab[apres * nc];
+    double arrivant = reference_point(r, tab[arrivee * nc], entree, ratio) - tab[avant * nc];
+
+    for (k = 0; k < len; k++)
+        tab[((apres + r->sens * k + frames) % frames) * nc] += (float)(sortie * test_fondu[k]);
+    for (k = 0; k < len; k++)
+        tab[((avant - r->sens * k + frames) % frames) * nc] += (float)(arrivant * test_fondu[k]);
+}
+
+// the input kept for the low-pass: a restart fills the whole memory with it
+static void reference_ecoute(t_reference *r, double entree)
+{
+    long j;
+
+    if (r->pos_passe < 0)
+    {
+        for (j = 0; j < IPOKE_DECIM_TAPS; j++)
+            r->passe[j] = entree;
+        r->pos_passe = 0;
+        r->periode = 1.;
+        return;
+    }
+    r->passe[r->pos_passe] = entree;
+    r->pos_passe = (r->pos_passe + 1) % IPOKE_DECIM_TAPS;
+}
+
+// the last inputs through the filter of the cutoff the period asks for, the oldest first
+static double reference_lowpass(const t_reference *r)
+{
+    long bank = (long)(IPOKE_DECIM_BANKS / r->periode + 0.5) - 1, j;
+    const double *row;
+    double v = 0.;
+
+    bank = (bank < 0) ? 0 : (bank >= IPOKE_DECIM_BANKS) ? IPOKE_DECIM_BANKS - 1 : bank;
+    row = test_decim + bank * IPOKE_DECIM_TAPS;
+    for (j = 0; j < IPOKE_DECIM_TAPS; j++)
+        v += r->passe[(r->pos_passe + j) % IPOKE_DECIM_TAPS] * row[j];
+    return v;
+}
+
+// one input written in frames of tab (nc channels, from the written one): retour is its overdub ratio for TEST_SIGNAL
+static void reference_write(t_reference *r, float *tab, long frames, long nc, long origine, double entree, double position, double retour)
+{
+    double curve[IPOKE_SINC_TAPS], overdub, pente_retour = 0.;
+    long index, pas, demivie = (long)(frames * 0.5), j;
+    char differe;
+    float *f;
+
+    overdub = (r->ecriture == TEST_SIGNAL) ? r->retour : r->ratio;
+    if (position < 0.)
+    {
+        if (r->index_precedent >= 0)
+        {
+            f = tab + r->index_precedent * nc;
+            *f = (float)reference_point(r, *f, r->valeur / r->nb_val, overdub);
+            reference_coupe(r, frames, r->index_precedent, 1);
+            reference_trace_point(r, r->index_precedent);
+            reference_trace(r, tab, frames, nc);
+            r->valeur = 0.;
+            r->index_precedent = -1;
+            r->nb_hist = 0;
+        }
+        return;
+    }
+
+    index = (long)position - origine;
+    if (index >= frames || index < 0)
+    {
+        index %= frames;
+        if (index < 0)
+            index += frames;
+    }
+    if (r->index_precedent < 0)
+    {
+        r->index_precedent = index;
+        r->nb_val = 0;
+        r->pos_passe = -1;
+        reference_trace_point(r, index);
+    }
+    if (r->antialias)
+        reference_ecoute(r, entree);
+    if (index == r->index_precedent)
+    {
+        r->valeur += entree;
+        r->nb_val++;
+        if (r->ecriture == TEST_SIGNAL)
+            r->retour = retour;
+        return;
+    }
+
+    pas = index - r->index_precedent;                   // the shortest way round
+    if (pas > demivie)
+        pas -= frames;
+    else if (-pas > demivie)
+        pas += frames;
+    if (r->antialias)                                   // the period is smoothed at every step
+        r->periode += TEST_LISSAGE * ((double)r->nb_val / labs(pas) - r->periode);
+    if (r->antialias && r->periode > 1.)                // slower than real time
+    {
+        r->valeur = reference_lowpass(r);
+        r->nb_val = 1;
+    }
+    else if (r->nb_val != 1)
+    {
+        r->valeur = r->valeur / r->nb_val;
+        r->nb_val = 1;
+    }
+    f = tab + r->index_precedent * nc;
+    *f = (float)reference_point(r, *f, r->valeur, overdub);
+
+    if (r->saut && labs(pas) > r->saut)                 // a jump: nothing filled, the curves restart from the new index
+    {
+        reference_coupe(r, frames, r->index_precedent, 1);
+        reference_trace_point(r, r->index_precedent);
+        reference_trace(r, tab, frames, nc);
+        if (r->ecriture == TEST_SIGNAL)
+            r->retour = overdub = retour;
+        reference_punch(r, tab, frames, nc, r->index_precedent, index, entree, overdub);
+        r->nb_hist = 0;
+        r->pas_precedent = 0;
+        r->valeur = entree;
+        r->index_precedent = index;
+        reference_trace_point(r, index);
+        return;
+    }
+
+    if (r->interp >= IPOKE_INTERP_CUBIC)                // the history of the written points
+    {
+        if (!r->nb_hist)
+        {
+            for (j = 0; j < IPOKE_CORE_HISTORY; j++)
+                r->histoire[j] = r->valeur;
+            r->nb_hist = 1;
+            r->pas_precedent = 0;
+        }
+        else
+        {
+            for (j = 0; j < IPOKE_CORE_HISTORY - 1; j++)
+                r->histoire[j] = r->histoire[j + 1];
+            r->histoire[IPOKE_CORE_HISTORY - 1] = r->valeur;
+        }
+    }
+    reference_curve(r, pas, r->valeur, entree, curve);
+    reference_coupe(r, frames, (pas > 0) ? r->index_precedent : index + 1, labs(pas));
+    if (r->ecriture == TEST_SIGNAL)
+    {
+        pente_retour = (retour - overdub) / pas;
+        r->retour = retour;
+    }
+
+    // the gap, in memory order, each run with its offset from the last written point
+    differe = (labs(pas) - 1 > r->libre && labs(pas) > TEST_COURT);
+    if (differe)
+        reference_differe(r, tab, frames, nc, pas, curve, overdub, pente_retour);
+    else if (index - r->index_precedent > 0)
+    {
+        if (pas < 0)
+        {
+            reference_segment(r, tab, nc, r->index_precedent, -r->index_precedent, pas, r->valeur, curve, overdub, pente_retour);
+            reference_segment(r, tab + (index + 1) * nc, nc, frames - index - 1, -(r->index_precedent + frames - index - 1), pas, r->valeur, curve,
+                              overdub, pente_retour);
+        }
+        else
+            reference_segment(r, tab + (r->index_precedent + 1) * nc, nc, pas - 1, 1, pas, r->valeur, curve, overdub, pente_retour);
+    }
+    else
+    {
+        if (pas > 0)
+        {
+            reference_segment(r, tab + (r->index_precedent + 1) * nc, nc, frames - r->index_precedent - 1, 1, pas, r->valeur, curve, overdub, pente_retour);
+            reference_segment(r, tab, nc, index, frames - r->index_precedent, pas, r->valeur, curve, overdub, pente_retour);
+        }
+        else
+            reference_segment(r, tab + (index + 1) * nc, nc, -pas - 1, pas + 1, pas, r->valeur, curve, overdub, pente_retour);
+    }
+    if (!differe)
+        r->libre -= labs(pas) - 1;
+    reference_trace_avance(r, pas);
+
+    if (r->interp >= IPOKE_INTERP_CUBIC)
+        r->pas_precedent = labs(pas);
+    r->sens = (pas > 0) ? 1 : -1;
+    r->valeur = entree;
+    r->index_precedent = index;
+}
+
+//***********************************************************************************************
+// reference splatting, for one channel of a head: each run of inputs between two stops is written when it stops, each frame it reaches
+// getting the average of the inputs around it weighted by their distance over the reach of the step they make, which is the step itself
+// and linear for the steps of more than a frame, a frame with the splat weights for the others. The first input of a run only starts it,
+// the way round is the shortest and a run is shorter than the buffer, so it reaches each frame once
+
+static double splat_poids[TEST_FRAMES];
+static double splat_somme[TEST_FRAMES];
+
+static double reference_poids(char mode, double x)
+{
+    if (x >= 1.)
+        return 0.;
+    return (mode == IPOKE_SPLAT_CUBIC) ? 1. - x * x * (3. - 2. * x) : 1. - x;
+}
+
+static void reference_splat(const t_reference *r, float *tab, long frames, long nc, char splat, const double *vals, const double *ind, long n)
+{
+    double p0 = 0., v0 = 0., p1, dp, h, wo, wi;
+    long s, f, k, demivie = (long)(frames * 0.5);
+    char mode, ecrit = 0;
+
+    for (s = 0; s <= n; s++)
+    {
+        if (s == n || ind[s] < 0.)                      // the run is written
+        {
+            for (k = 0; k < frames; k++)
+                if (splat_poids[k] > 0.)
+                {
+                    tab[k * nc] = (float)reference_point(r, tab[k * nc], splat_somme[k] / splat_poids[k], r->ratio);
+                    splat_poids[k] = splat_somme[k] = 0.;
+                }
+            ecrit = 0;
+            continue;
+        }
+        if (ecrit)
+        {
+            dp = ind[s] - p0;
+            if (dp > demivie)
+                dp -= frames;
+            else if (dp < -demivie)
+                dp += frames;
+            p1 = p0 + dp;                               // unrolled from the previous one
+            h = (fabs(dp) > 1.) ? fabs(dp) : 1.;
+            mode = (fabs(dp) > 1.) ? IPOKE_SPLAT_LINEAR : splat;
+            for (f = (long)floor(fmin(p0, p1)); f <= (long)floor(fmax(p0, p1)) + 1; f++)
+            {
+                if (dp > 0.)                            // the previous input reaches up, the new one down
+                {
+                    wo = (f > p0) ? reference_poids(mode, (f - p0) / h) : 0.;
+                    wi = (f <= p1) ? reference_poids(mode, (p1 - f) / h) : 0.;
+                }
+                else
+                {
+                    wo = (f < p0) ? reference_poids(mode, (p0 - f) / h) : 0.;
+                    wi = (f >= p1) ? reference_poids(mode, (f - p1) / h) : 0.;
+                }
+                k = (f % frames + frames) % frames;
+                splat_poids[k] += wo + wi;
+                splat_somme[k] += wo * v0 + wi * vals[s];
+            }
+        }
+        p0 = ind[s];
+        v0 = vals[s];
+        ecrit = 1;
+    }
+}
+
+//***********************************************************************************************
+// trajectories
+
+static unsigned long test_seed = 1;
+
+static double test_rand(void)
+{
+    test_seed = test_seed * 1103515245UL + 12345UL;
+    return (double)((test_seed >> 16) & 0x7FFF) / 32768.;
+}
+
+// runs of different speeds both ways, scrubbing, jumps across more than half the buffer, steps over the scratch area and stops
+static void test_trajectoire(double *ind, long n, long frames, long tete)
+{
+    static const double vitesses[] = { 1., 2., 0.37, -1., -2.6, 9.5, -17., 1.1, 0.5, -0.25, 300., -700. };
+    double pos = frames * (0.1 + 0.3 * tete), vitesse = 1.;
+    long i, reste = 0;
+
+    test_seed = 7 + tete;
+    for (i = 0; i < n; i++)
+    {
+        if (!reste)
+        {
+            reste = 50 + (long)(test_rand() * 400.);
+            vitesse = vitesses[(long)(test_rand() * (sizeof(vitesses) / sizeof(vitesses[0])))];
+            if (test_rand() < 0.15)                     // a jump
+                pos += frames * (0.45 + 0.2 * test_rand());
+        }
+        reste--;
+        if (vitesse == 0.5 && (i / 13) % 4 == 1)        // scrubbing
+            pos += 12. * sin(i * 0.05);
+        else
+            pos += vitesse;
+        while (pos >= frames)
+            pos -= frames;
+        while (pos < 0.)
+            pos += frames;
+        ind[i] = ((i / 97) % 11 == 4 && vitesse != 300.) ? -1. : pos;   // stops, some one input long
+    }
+}
+
+// runs of one speed, faster or slower than real time, both ways and round the buffer, from anywhere and shorter than half of it,
+// separated by one stop
+static void test_trajectoire_splat(double *ind, long n, long frames)
+{
+    static const double vitesses[] = { 0.37, 0.5, 0.9, 1.1, 2.3, 9.5, 17.25, -0.25, -0.37, -0.8, -1.1, -3.7 };
+    double pos, vitesse;
+    long i = 0, k, longueur;
+
+    test_seed = 11;
+    while (i < n - 1)
+    {
+        pos = test_rand() * frames;
+        vitesse = vitesses[(long)(test_rand() * (sizeof(vitesses) / sizeof(vitesses[0])))];
+        longueur = 20 + (long)(test_rand() * 300.);
+        if (longueur * fabs(vitesse) > frames * 0.4)
+            longueur = (long)(frames * 0.4 / fabs(vitesse));
+        for (k = 0; k < longueur && i < n - 1; k++)
+        {
+            ind[i++] = pos;
+            pos += vitesse;
+            if (pos >= frames)
+                pos -= frames;
+            else if (pos < 0.)
+                pos += frames;
+        }
+        ind[i++] = -1.;
+    }
+    ind[n - 1] = -1.;                                   // so everything is written
+}
+
+//***********************************************************************************************
+// one case
+
+typedef struct _cas
+{
+    char interp;
+    const t_mode *mode;
+    long tetes;
+    long nvals;                                         // channels written, 0 for the single channel write of float inputs
+    long nc;
+    long chan;
+    char region;
+    char compter;                                       // the counters on, so the kernels that test the features are taken
+    char option;                                        // one of the TEST_ features
+} t_cas;
+
+static double valeurs[TEST_NC][TEST_INPUTS];
+static float valeurs_float[TEST_INPUTS];
+static double indices[TEST_HEADS][TEST_INPUTS];
+static float indices_float[TEST_HEADS][TEST_INPUTS];
+static double indices_doubles[TEST_HEADS][TEST_INPUTS];    // the float ones, for ipoke_core_portee
+static double valeurs_doubles[TEST_INPUTS];
+static double indices_splat[TEST_INPUTS];
+static float indices_splat_float[TEST_INPUTS];
+static double indices_splat_doubles[TEST_INPUTS];
+static double retours[TEST_INPUTS];
+static float attendu[TEST_FRAMES * TEST_NC];
+static float obtenu[TEST_FRAMES * TEST_NC];
+static float avant[TEST_FRAMES * TEST_NC];
+static char portee[TEST_FRAMES];
+
+static void test_reference(const t_cas *cas, long vecteur)
+{
+    t_reference r[TEST_HEADS][TEST_NC];
+    long h, c, i, j, debut = 0, frames = TEST_FRAMES, nvals = cas->nvals ? cas->nvals : 1;
+    float *tab = attendu;
+
+    if (cas->region)
+    {
+        debut = 300;
+        frames = 1500;
+    }
+    for (i = 0; i < TEST_FRAMES * TEST_NC; i++)
+        attendu[i] = 0.1f * (float)sin(i * 0.3);
+    tab += debut * cas->nc + cas->chan;
+    for (h = 0; h < cas->tetes; h++)
+        for (c = 0; c < nvals; c++)
+            reference_init(&r[h][c], cas->interp, cas->mode, cas->option);
+    if (cas->option == TEST_SPLAT || cas->option == TEST_SPLAT_CUBIC)    // one head, whatever the vectors
+    {
+        for (c = 0; c < nvals; c++)
+            reference_splat(&r[0][c], tab + c, frames, cas->nc, (cas->option == TEST_SPLAT) ? IPOKE_SPLAT_LINEAR : IPOKE_SPLAT_CUBIC,
+                            cas->nvals ? valeurs[c] : valeurs_doubles, cas->nvals ? indices_splat : indices_splat_doubles, TEST_INPUTS);
+        return;
+    }
+
+    for (i = 0; i < TEST_INPUTS; i += vecteur)          // the heads take turns by vectors, as they cross each other
+        for (h = 0; h < cas->tetes; h++)
+        {
+            for (c = 0; c < nvals; c++)
+                reference_vecteur(&r[h][c], tab + c, frames, cas->nc);
+            for (j = i; j < i + vecteur && j < TEST_INPUTS; j++)
+                for (c = 0; c < nvals; c++)
+                    reference_write(&r[h][c], tab + c, frames, cas->nc, debut, cas->nvals ? valeurs[c][j] : valeurs_float[j],
+                                    cas->nvals ? indices[h][j] : indices_float[h][j], retours[j]);
+            for (c = 0; c < nvals; c++)
+                reference_fin_vecteur(&r[h][c], tab + c, frames, cas->nc);
+        }
+    if (cas->option == TEST_MAXFILL)                    // a last vector without a budget, stopping, drains the fills left
+        for (h = 0; h < cas->tetes; h++)
+            for (c = 0; c < nvals; c++)
+            {
+                r[h][c].budget = 0;
+                reference_vecteur(&r[h][c], tab + c, frames, cas->nc);
+                reference_write(&r[h][c], tab + c, frames, cas->nc, debut, 0., -1., retours[0]);
+            }
+}
+
+static void test_visite(void *data, long debut, long etendue)
+{
+    long k;
+
+    (void)data;
+    for (k = 0; k < etendue; k++)
+        portee[(debut + k) % TEST_FRAMES] = 1;
+}
+
+// one vector of a head, from the input i: when verifier is set, 0 if it only changed frames ipoke_core_portee gave beforehand
+static long test_vecteur(const t_cas *cas, t_ipoke_core *x, long h, long i, long n, const double *ind, const float *ind_float, char verifier)
+{
+    const double *vals[TEST_NC];
+    long c, f, k;
+
+    if (verifier)
+    {
+        memset(portee, 0, sizeof(portee));
+        ipoke_core_portee(x, TEST_FRAMES, cas->nvals ? ind : indices_doubles[h] + i, n, test_visite, NULL);
+        memcpy(avant, obtenu, sizeof(obtenu));
+    }
+    if (!cas->nvals)
+        ipoke_core_write_float(x, obtenu, TEST_FRAMES, cas->nc, cas->chan, valeurs_float + i, ind_float, n);
+    else
+    {
+        for (c = 0; c < cas->nvals; c++)
+            vals[c] = valeurs[c] + i;
+        if (cas->nvals == 1)
+            ipoke_core_write(x, obtenu, TEST_FRAMES, cas->nc, cas->chan, vals[0], ind, n);
+        else
+            ipoke_core_write_multi(x, obtenu, TEST_FRAMES, cas->nc, cas->chan, vals, cas->nvals, ind, n);
+    }
+    if (verifier)
+        for (f = 0; f < TEST_FRAMES; f++)
+            for (k = f * cas->nc; !portee[f] && k < (f + 1) * cas->nc; k++)
+                if (obtenu[k] != avant[k])
+                {
+                    fprintf(stderr, "%s: interp %d, %s, %ld heads, %ld channels of %ld%s, maxfill: head %ld changed frame %ld outside of its portee at input %ld\n",
+                            ipoke_fill_name(), cas->interp, cas->mode->nom, cas->tetes, cas->nvals, cas->nc, cas->region ? " in a region" : "", h, f, i);
+                    return 1;
+                }
+    return 0;
+}
+
+// the engine over the same trajectories: returns 1 if a vector wrote outside of its portee, which is checked with the budget
+// and vectors of 64 or more, the copy it takes costing too much with shorter ones
+static long test_engine(const t_cas *cas, long vecteur)
+{
+    static const double arret = -1.;
+    static const float arret_float = -1.f;
+    t_ipoke_core x[TEST_HEADS];
+    long h, i, n, hors = 0;
+    char verifier = (cas->option == TEST_MAXFILL && vecteur >= 64);
+
+    for (i = 0; i < TEST_FRAMES * TEST_NC; i++)
+        obtenu[i] = 0.1f * (float)sin(i * 0.3);
+    for (h = 0; h < cas->tetes; h++)
+    {
+        ipoke_core_init(x + h);
+        if (cas->nvals && !ipoke_core_set_nvals(x + h, cas->nvals))
+        {
+            fprintf(stderr, "could not allocate %ld channels\n", cas->nvals);
+            exit(2);
+        }
+    }
+    x[0].interp = cas->interp;
+    x[0].combine = cas->mode->combine;
+    x[0].overdub = (cas->mode->overdub < 0.) ? 0. : cas->mode->overdub;
+    x[0].compter = cas->compter;
+    if (cas->region)
+    {
+        x[0].boucle_debut = 300;
+        x[0].boucle_fin = 1800;
+    }
+    if (cas->option == TEST_MAXFILL)
+        x[0].budget = TEST_BUDGET;
+    if (cas->option == TEST_JUMP)
+    {
+        x[0].saut = TEST_SAUT;
+        ipoke_core_set_fondu(x, TEST_FONDU);
+    }
+    x[0].antialias = (cas->option == TEST_ANTIALIAS);
+    x[0].seuil = (cas->option == TEST_SNAP) ? TEST_SEUIL : 0.;
+    if (cas->option == TEST_SPLAT || cas->option == TEST_SPLAT_CUBIC)
+        x[0].splat = (cas->option == TEST_SPLAT) ? IPOKE_SPLAT_LINEAR : IPOKE_SPLAT_CUBIC;
+
+    for (i = 0; i < TEST_INPUTS; i += n)
+    {
+        n = (TEST_INPUTS - i < vecteur) ? TEST_INPUTS - i : vecteur;
+        if (cas->mode->overdub < 0.)
+            x[0].retours = retours + i;
+        for (h = 0; h < cas->tetes; h++)
+        {
+            if (h)
+                ipoke_core_follow(x + h, x);
+            ipoke_core_select(x + h, cas->nc);
+            if (x[0].splat)
+                test_vecteur(cas, x + h, h, i, n, indices_splat + i, indices_splat_float + i, 0);
+            else
+                hors += test_vecteur(cas, x + h, h, i, n, indices[h] + i, indices_float[h] + i, verifier);
+        }
+    }
+    if (cas->option == TEST_MAXFILL)
+    {
+        x[0].budget = 0;
+        if (cas->mode->overdub < 0.)
+            x[0].retours = retours;
+        for (h = 0; h < cas->tetes; h++)
+        {
+            if (h)
+                ipoke_core_follow(x + h, x);
+            ipoke_core_select(x + h, cas->nc);
+            hors += test_vecteur(cas, x + h, h, 0, 1, &arret, &arret_float, verifier);
+        }
+    }
+    for (h = 0; h < cas->tetes; h++)
+        ipoke_core_free(x + h);
+    return hors ? 1 : 0;
+}
+
+// the first sample that differs, -1 if they match: exactly, or within tolerance of the larger of the two
+static long test_ecart(double tolerance)
+{
+    long i;
+    double ecart;
+
+    for (i = 0; i < TEST_FRAMES * TEST_NC; i++)
+    {
+        if (attendu[i] == obtenu[i] || (attendu[i] != attendu[i] && obtenu[i] != obtenu[i]))
+            continue;
+        ecart = fabs((double)attendu[i] - obtenu[i]);
+        if (tolerance > 0. && ecart <= tolerance * fmax(1., fmax(fabsf(attendu[i]), fabsf(obtenu[i]))))
+            continue;
+        return i;
+    }
+    return -1;
+}
+
+// 0 if they match
+static long test_compare(const t_cas *cas, long vecteur, double tolerance)
+{
+    long i = test_ecart(tolerance);
+
+    if (i >= 0)
+    {
+        fprintf(stderr, "%s: interp %d, %s, %ld heads, %ld channels of %ld from %ld%s%s%s, vector %ld: frame %ld channel %ld is %.9g instead of %.9g\n",
+                ipoke_fill_name(), cas->interp, cas->mode->nom, cas->tetes, cas->nvals, cas->nc, cas->chan, cas->nvals ? "" : " (float)",
+                cas->region ? " in a region" : "", test_options[(int)cas->option], vecteur, i / cas->nc, i % cas->nc, obtenu[i], attendu[i]);
+        return 1;
+    }
+    return 0;
+}
+
+// a newer write on frames a queued fill still has to fill, in its middle then on its nearest step: cut out of the fill, which
+// keeps the steps before it in the first case and the ones after it in the second, so that it is never overwritten once drained
+static long test_coupe(void)
+{
+    static const long departs[] = { 500, 401 };         // steps 400 and 301 of the ramp from 100, of which 300 are filled by then
+    double vals[11], ind[11];
+    t_ipoke_core x;
+    long k, f, depart, echecs = 0;
+    float attendu_f;
+
+    for (k = 0; k < 2; k++)
+    {
+        depart = departs[k];
+        memset(obtenu, 0, sizeof(obtenu));
+        ipoke_core_init(&x);
+        x.interp = IPOKE_INTERP_LINEAR;
+        x.budget = TEST_BUDGET;
+        ipoke_core_select(&x, 1);
+        vals[0] = 0.;                                   // a ramp of 900 steps, 100 of them filled
+        ind[0] = 100.;
+        vals[1] = 900.;
+        ind[1] = 1000.;
+        ipoke_core_write(&x, obtenu, TEST_FRAMES, 1, 0, vals, ind, 2);
+        ind[0] = -1.;                                   // 100 more
+        ipoke_core_write(&x, obtenu, TEST_FRAMES, 1, 0, vals, ind, 1);
+        for (f = 0; f < 10; f++)                        // 100 more, then over the queued frames
+        {
+            vals[f] = -5.;
+            ind[f] = (double)(depart + f);
+        }
+        ind[10] = -1.;
+        ipoke_core_write(&x, obtenu, TEST_FRAMES, 1, 0, vals, ind, 11);
+        x.budget = 0;                                   // the rest at once
+        ind[0] = -1.;
+        ipoke_core_write(&x, obtenu, TEST_FRAMES, 1, 0, vals, ind, 1);
+        ipoke_core_free(&x);
+
+        for (f = 100; f <= 1000; f++)
+        {
+            if (f >= depart && f < depart + 10)
+                attendu_f = -5.f;
+            else if (k == 0 && f >= depart + 10 && f < 1000)
+                attendu_f = 0.f;
+            else
+                attendu_f = (float)(f - 100);
+            if (obtenu[f] != attendu_f)
+            {
+                fprintf(stderr, "%s: a write at %ld over a queued fill: frame %ld is %.9g instead of %.9g\n", ipoke_fill_name(), depart, f, obtenu[f], attendu_f);
+                echecs++;
+                break;
+            }
+        }
+    }
+    return echecs;
+}
+
+//***********************************************************************************************
+// index units: the positions are worked out here, the rate one as an integer number of 1/2^32 frames kept in the region,
+// then written by the reference into a one channel buffer
+
+#define TEST_MS 48.                                     // frames per ms
+#define TEST_UN 4294967296.                             // one frame of the rate position
+
+static const char *test_unites[] = { "samples", "phase", "ms", "rate" };
+
+// what happens before the first vector from an input on, in rate units: a seek, or the region moved to debut - fin
+typedef struct _evenement
+{
+    long entree;
+    char seek;
+    double cale;
+    long debut;
+    long fin;
+} t_evenement;
+
+static const t_evenement test_evenements[] = {
+    { 1000, 1, 1234.5, 0, 0 },
+    { 2000, 0, 0., 500, 1500 },                         // under the head
+    { 2500, 1, -1., 0, 0 },                             // stops
+    { 3000, 1, 100.25, 0, 0 },                          // out of the region, so wrapped in it
+    { 4000, 0, 0., 0, 0 },                              // the whole buffer again
+    { 4500, 1, 5000., 0, 0 },                           // past the end: the start of the region
+};
+#define TEST_EVENEMENTS (long)(sizeof(test_evenements) / sizeof(test_evenements[0]))
+
+static double unites[IPOKE_UNITS_RATE + 1][TEST_INPUTS];
+static float unites_float[IPOKE_UNITS_RATE + 1][TEST_INPUTS];
+static double positions[TEST_INPUTS];
+
+// phases over 1.3 of the region, ms round the buffer, both with stops; speeds both ways, a long one clamped to the region
+static void test_unites_build(void)
+{
+    static const double vitesses[] = { 0.37, 1., -2.5, 1.1, 3000., -0.8, 9.5 };
+    long i, u;
+
+    for (i = 0; i < TEST_INPUTS; i++)
+    {
+        unites[IPOKE_UNITS_PHASE][i] = ((i / 97) % 11 == 4) ? -1. : fmod(0.1 + i * 0.00037, 1.3);
+        unites[IPOKE_UNITS_MS][i] = ((i / 97) % 11 == 4) ? -1. : 3. + i * 0.02;
+        unites[IPOKE_UNITS_RATE][i] = vitesses[(i / 250) % (sizeof(vitesses) / sizeof(vitesses[0]))] + 0.05 * sin(i * 0.01);
+    }
+    for (u = IPOKE_UNITS_PHASE; u <= IPOKE_UNITS_RATE; u++)
+        for (i = 0; i < TEST_INPUTS; i++)
+            unites_float[u][i] = (float)unites[u][i];
+}
+
+// the reference over the whole inputs, vector by vector: the positions, then the writes
+static void test_reference_unites(char u, char flottant, char interp, const t_mode *m, long vecteur)
+{
+    t_reference r;
+    long i, j, n, e = 0, debut = (u == IPOKE_UNITS_PHASE) ? 300 : 0, etendue = (u == IPOKE_UNITS_PHASE) ? 1500 : TEST_FRAMES;
+    long long tete = 0, bas, haut, pas;
+    char marche = 1;
+    double v;
+
+    for (i = 0; i < TEST_FRAMES * TEST_NC; i++)
+        attendu[i] = 0.1f * (float)sin(i * 0.3);
+    reference_init(&r, interp, m, TEST_SANS);
+    for (i = 0; i < TEST_INPUTS; i += n)
+    {
+        n = (TEST_INPUTS - i < vecteur) ? TEST_INPUTS - i : vecteur;
+        for (; u == IPOKE_UNITS_RATE && e < TEST_EVENEMENTS && test_evenements[e].entree <= i; e++)
+        {
+            if (test_evenements[e].seek)
+            {
+                marche = (test_evenements[e].cale >= 0.);
+                if (marche)
+                    tete = (test_evenements[e].cale < TEST_FRAMES) ? (long long)(test_evenements[e].cale * TEST_UN) : (long long)debut * (long long)TEST_UN;
+            }
+            else
+            {
+                debut = test_evenements[e].debut;
+                etendue = (test_evenements[e].fin ? test_evenements[e].fin : TEST_FRAMES) - debut;
+            }
+            r.index_precedent = -1;                     // both restart the writing, dropping the frame it was on
+            r.valeur = 0.;
+            r.nb_hist = 0;
+        }
+        bas = (long long)debut * (long long)TEST_UN;
+        haut = (long long)(debut + etendue) * (long long)TEST_UN;
+        for (j = i; j < i + n; j++)
+        {
+            v = flottant ? unites_float[(int)u][j] : unites[(int)u][j];
+            switch (u)
+            {
+                case IPOKE_UNITS_PHASE:
+                    positions[j] = (v < 0.) ? -1. : debut + v * etendue;
+                    break;
+                case IPOKE_UNITS_MS:
+                    positions[j] = (v < 0.) ? -1. : v * TEST_MS;
+                    break;
+                default:
+                    if (!marche)
+                    {
+                        positions[j] = -1.;
+                        break;
+                    }
+                    while (tete >= haut)
+                        tete -= haut - bas;
+                    while (tete < bas)
+                        tete += haut - bas;
+                    positions[j] = (double)tete / TEST_UN;
+                    v = (v > etendue) ? etendue : (v < -etendue) ? -etendue : v;
+                    pas = (long long)floor(v * TEST_UN + 0.5);
+                    tete += pas;
+                    break;
+            }
+        }
+        while (marche && tete >= haut)                  // kept in the region between two vectors too
+            tete -= haut - bas;
+        while (marche && tete < bas)
+            tete += haut - bas;
+
+        reference_vecteur(&r, attendu + debut, etendue, 1);
+        for (j = i; j < i + n; j++)
+            reference_write(&r, attendu + debut, etendue, 1, debut, valeurs[0][j], positions[j], 0.);
+        reference_fin_vecteur(&r, attendu + debut, etendue, 1);
+    }
+}
+
+// the engine over the same inputs: 0 if it gives the same positions
+static long test_engine_unites(char u, char flottant, char interp, const t_mode *m, long vecteur)
+{
+    t_ipoke_core x;
+    const double *pos;
+    long i, j, n, e = 0, echecs = 0;
+
+    for (i = 0; i < TEST_FRAMES * TEST_NC; i++)
+        obtenu[i] = 0.1f * (float)sin(i * 0.3);
+    ipoke_core_init(&x);
+    if (!ipoke_core_set_positions(&x, vecteur))
+    {
+        fprintf(stderr, "could not allocate the positions\n");
+        exit(2);
+    }
+    x.unites = u;
+    x.frames_ms = TEST_MS;
+    x.interp = interp;
+    x.combine = m->combine;
+    x.overdub = m->overdub;
+    if (u == IPOKE_UNITS_PHASE)
+    {
+        x.boucle_debut = 300;
+        x.boucle_fin = 1800;
+    }
+    for (i = 0; i < TEST_INPUTS; i += n)
+    {
+        n = (TEST_INPUTS - i < vecteur) ? TEST_INPUTS - i : vecteur;
+        for (; u == IPOKE_UNITS_RATE && e < TEST_EVENEMENTS && test_evenements[e].entree <= i; e++)
+        {
+            if (test_evenements[e].seek)
+                ipoke_core_seek(&x, test_evenements[e].cale);
+            else
+            {
+                x.boucle_debut = test_evenements[e].debut;
+                x.boucle_fin = test_evenements[e].fin;
+            }
+        }
+        pos = flottant ? ipoke_core_positions_float(&x, TEST_FRAMES, unites_float[(int)u] + i, n) : ipoke_core_positions(&x, TEST_FRAMES, unites[(int)u] + i, n);
+        for (j = 0; j < n && !echecs; j++)
+            if (pos[j] != positions[i + j])
+            {
+                fprintf(stderr, "%s: %s%s, vector %ld: input %ld is at %.17g instead of %.17g\n", ipoke_fill_name(), test_unites[(int)u],
+                        flottant ? " (float)" : "", vecteur, i + j, pos[j], positions[i + j]);
+                echecs = 1;
+            }
+        ipoke_core_write(&x, obtenu, TEST_FRAMES, 1, 0, valeurs[0] + i, pos, n);
+    }
+    ipoke_core_set_positions(&x, 0);
+    ipoke_core_free(&x);
+    return echecs;
+}
+
+static const t_cas test_dispositions[] = {              // interp, mode, compter, option: set for each case
+    { 0, NULL, 1, 1, 1, 0, 0, 0, 0 },
+    { 0, NULL, 2, 1, 1, 0, 0, 1, 0 },
+    { 0, NULL, 3, 1, 3, 1, 1, 0, 0 },
+    { 0, NULL, 1, 0, 1, 0, 0, 0, 0 },
+    { 0, NULL, 2, 0, 3, 2, 1, 0, 0 },
+    { 0, NULL, 1, 2, 5, 3, 0, 0, 0 },
+    { 0, NULL, 2, 5, 5, 0, 1, 0, 0 },
+    { 0, NULL, 1, 4, 5, 1, 0, 1, 0 },
+};
+#define TEST_DISPOSITIONS (long)(sizeof(test_dispositions) / sizeof(test_dispositions[0]))
+
+int main(void)
+{
+    static const long isas[] = { IPOKE_ISA_SCALAR, IPOKE_ISA_SSE2, IPOKE_ISA_AVX2 };
+    long a, o, m, d, v, h, i, c, echecs = 0, cas_faits = 0;
+    char interp, u, flottant;
+    t_cas cas;
+
+    test_sinc_build();
+    test_fondu_build();
+    test_decim_build();
+    for (c = 0; c < TEST_NC; c++)
+        for (i = 0; i < TEST_INPUTS; i++)
+            valeurs[c][i] = sin(i * (0.031 + 0.017 * c)) + 0.3 * sin(i * 0.71 + c);
+    for (i = 0; i < TEST_INPUTS; i++)
+    {
+        valeurs_float[i] = (float)valeurs[0][i];
+        valeurs_doubles[i] = valeurs_float[i];
+        retours[i] = 0.5 + 0.45 * sin(i * 0.004);
+    }
+    for (h = 0; h < TEST_HEADS; h++)
+    {
+        test_trajectoire(indices[h], TEST_INPUTS, TEST_FRAMES, h);
+        for (i = 0; i < TEST_INPUTS; i++)
+        {
+            indices_float[h][i] = (float)indices[h][i];
+            indices_doubles[h][i] = indices_float[h][i];
+        }
+    }
+    test_trajectoire_splat(indices_splat, TEST_INPUTS, TEST_FRAMES);
+    test_unites_build();
+    for (i = 0; i < TEST_INPUTS; i++)
+    {
+        indices_splat_float[i] = (float)indices_splat[i];
+        indices_splat_doubles[i] = indices_splat_float[i];
+    }
+
+    for (a = 0; a < 3; a++)
+    {
+        if (ipoke_fill_select(isas[a]) != isas[a])      // not on this machine
+            continue;
+        for (o = 0; o < TEST_OPTIONS; o++)
+            for (d = 0; d < TEST_DISPOSITIONS; d++)
+                for (m = 0; m < TEST_MODES; m++)
+                    for (interp = IPOKE_INTERP_HOLD; interp <= IPOKE_INTERP_SINC; interp++)
+                    {
+                        cas = test_dispositions[d];
+                        cas.interp = interp;
+                        cas.mode = test_modes + m;
+                        cas.option = (char)o;
+                        if (cas.mode->overdub < 0. && !cas.nvals)
+                            continue;                   // the signal ratio is read as doubles, tested with them
+                        if (o == TEST_SNAP && isas[a] == IPOKE_ISA_AVX2)
+                            continue;
+                        if ((o == TEST_SPLAT || o == TEST_SPLAT_CUBIC) && (cas.tetes > 1 || cas.region || cas.mode->overdub < 0. || interp != IPOKE_INTERP_LINEAR))
+                            continue;                   // splatting takes no interp, nor the signal ratio in the reference
+                        for (v = o ? 1 : 0; v < (o ? 3 : TEST_VECTORS); v++)    // the features over two sizes only
+                        {
+                            test_reference(&cas, test_vectors[v]);
+                            echecs += test_engine(&cas, test_vectors[v]);
+                            echecs += test_compare(&cas, test_vectors[v], (isas[a] == IPOKE_ISA_AVX2 || o >= TEST_SPLAT) ? 1e-5 : 0.);
+                            cas_faits++;
+                        }
+                    }
+        echecs += test_coupe();
+        cas_faits += 2;
+
+        for (u = IPOKE_UNITS_PHASE; u <= IPOKE_UNITS_RATE; u++)
+            for (flottant = 0; flottant < 2; flottant++)
+                for (m = 0; m < 2; m++)                 // replacing and overdubbing
+                    for (interp = IPOKE_INTERP_LINEAR; interp <= IPOKE_INTERP_SINC; interp += 2)
+                        for (v = 1; v < 3; v++)
+                        {
+                            test_reference_unites(u, flottant, interp, test_modes + m, test_vectors[v]);
+                            if (test_engine_unites(u, flottant, interp, test_modes + m, test_vectors[v]))
+                                echecs++;
+                            else if ((i = test_ecart((isas[a] == IPOKE_ISA_AVX2) ? 1e-5 : 0.)) >= 0)
+                            {
+                                fprintf(stderr, "%s: %s%s, interp %d, %s, vector %ld: frame %ld is %.9g instead of %.9g\n", ipoke_fill_name(), test_unites[(int)u],
+                                        flottant ? " (float)" : "", interp, test_modes[m].nom, test_vectors[v], i, obtenu[i], attendu[i]);
+                                echecs++;
+                            }
+                            cas_faits++;
+                        }
+    }
+    ipoke_fill_select(-1);
+
+    printf("%ld cases, %ld failed\n", cas_faits, echecs);
+    return echecs ? 1 : 0;
+}
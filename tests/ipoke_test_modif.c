@@ -0,0 +1,194 @@
+//    ipoke_test_modif - regression test of the modified frames the ipoke~ write engine reports
+//    by Pierre Alexandre Tremblay
+//    diffs the buffer around every vector written, in every mode and with each of the optional features, staged or not, and fails when
+//    a frame changed outside of the arc ipoke_core_modif gives, or when that arc goes more than two frames past the
+//    changed ones at either end (but in the max mode, where a frame written may well keep what it had)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "ipoke_core.h"
+#include "ipoke_fill.h"
+
+#define TEST_FRAMES 3000
+#define TEST_INPUTS 8192
+#define TEST_VECTOR 64
+#define TEST_NC 2
+#define TEST_JOURNAL 1024                               // frames of the staging area, so the longer jumps are written in place
+#define TEST_MARGE 2                                    // frames the arc may hold past the written ones at each end
+
+enum { SANS, ANTIALIAS, COMPTER, SAUT, BUDGET, REGION, SIGNAL, SPLAT, TEST_FEATURES };
+
+static const char *test_features[TEST_FEATURES] = { "none", "antialias", "compter", "saut", "budget", "region", "signal", "splat" };
+
+static double valeurs[TEST_NC][TEST_INPUTS];
+static double indices[TEST_INPUTS];
+static double retours[TEST_INPUTS];
+static float tab[TEST_FRAMES * TEST_NC];
+static float avant[TEST_FRAMES * TEST_NC];
+
+// frames from debut round the buffer to f
+static long test_distance(long debut, long f)
+{
+    return (f - debut + TEST_FRAMES) % TEST_FRAMES;
+}
+
+// 0 if the frames changed by the last vector are all in the arc, and if serre, it does not go too far past them
+static long test_arc(long etendue, long debut, long nvals, char serre, const char *cas, long vecteur)
+{
+    long f, c, d, premier = -1, dernier = -1;
+
+    for (f = 0; f < TEST_FRAMES; f++)
+        for (c = 0; c < nvals; c++)
+        {
+            if (memcmp(tab + f * TEST_NC + c, avant + f * TEST_NC + c, sizeof(float)) == 0)
+                continue;
+            d = etendue ? test_distance(debut, f) : TEST_FRAMES;
+            if (d >= etendue)
+            {
+                fprintf(stderr, "%s, vector %ld: frame %ld changed out of the %ld frames from %ld\n", cas, vecteur, f, etendue, debut);
+                return 1;
+            }
+            if (premier < 0 || d < premier)
+                premier = d;
+            if (d > dernier)
+                dernier = d;
+        }
+    if (!serre || premier < 0 || etendue >= TEST_FRAMES)  // nothing that shows, or all of it
+        return 0;
+    if (premier > TEST_MARGE || etendue - 1 - dernier > TEST_MARGE)
+    {
+        fprintf(stderr, "%s, vector %ld: %ld frames from %ld reported for the ones from %ld to %ld\n", cas, vecteur, etendue, debut,
+                (debut + premier) % TEST_FRAMES, (debut + dernier) % TEST_FRAMES);
+        return 1;
+    }
+    return 0;
+}
+
+static long test_cas(char interp, char overdub, char combine, long feature, long nvals, char stage)
+{
+    t_ipoke_core x;
+    const double *vals[TEST_NC];
+    const double *inind;
+    float *cible;
+    char cas[128];
+    long i, c, debut, etendue, stride, dirty, echecs = 0;
+
+    snprintf(cas, sizeof(cas), "interp %d, overdub %d, combine %d, %s, %ld channels%s", interp, overdub, combine, test_features[feature], nvals,
+             stage ? ", staged" : "");
+    for (i = 0; i < TEST_FRAMES * TEST_NC; i++)
+        tab[i] = 0.01f * (float)sin(i * 0.37);
+    ipoke_core_init(&x);
+    if (!ipoke_core_set_nvals(&x, nvals))
+    {
+        fprintf(stderr, "could not allocate %ld channels\n", nvals);
+        exit(2);
+    }
+    if (stage && !ipoke_core_set_journal(&x, TEST_JOURNAL, nvals, TEST_VECTOR))
+    {
+        fprintf(stderr, "could not allocate the staging area\n");
+        exit(2);
+    }
+    x.interp = interp;
+    x.overdub = overdub ? 0.7 : 0.;
+    x.combine = combine;
+    switch (feature)
+    {
+        case ANTIALIAS:
+            x.antialias = 1;
+            break;
+        case COMPTER:
+            x.compter = 1;
+            break;
+        case SAUT:
+            x.saut = 200;
+            break;
+        case BUDGET:
+            x.budget = 50;                              // the gaps carried over to the next vectors
+            break;
+        case REGION:
+            x.boucle_debut = 100;
+            x.boucle_fin = 2500;
+            break;
+        case SPLAT:
+            x.splat = IPOKE_SPLAT_LINEAR;
+            break;
+    }
+    ipoke_core_select(&x, TEST_NC);
+
+    for (i = 0; i < TEST_INPUTS; i += TEST_VECTOR)
+    {
+        if (feature == SIGNAL)
+            x.retours = retours + i;
+        if (feature == BUDGET && i == TEST_INPUTS / 2)
+            x.budget = 0;
+        memcpy(avant, tab, sizeof(tab));
+        for (c = 0; c < nvals; c++)
+            vals[c] = valeurs[c] + i;
+        cible = tab;                                    // as ipoke~ does
+        stride = TEST_NC;
+        inind = indices + i;
+        if (stage && ipoke_core_stage_in(&x, tab, TEST_FRAMES, TEST_NC, 0, nvals, inind, TEST_VECTOR))
+        {
+            cible = x.journal;
+            stride = nvals;
+            inind = x.journal_index;
+        }
+        if (nvals == 1)
+            dirty = ipoke_core_write(&x, cible, TEST_FRAMES, stride, 0, vals[0], inind, TEST_VECTOR);
+        else
+            dirty = ipoke_core_write_multi(&x, cible, TEST_FRAMES, stride, 0, vals, nvals, inind, TEST_VECTOR);
+        if (cible != tab)
+            ipoke_core_stage_out(&x, tab, TEST_FRAMES, TEST_NC, 0, nvals, dirty);
+        etendue = ipoke_core_modif(&x, &debut);
+        if (test_arc(etendue, debut, nvals, combine != IPOKE_COMBINE_MAX, cas, i / TEST_VECTOR))
+        {
+            echecs = 1;
+            break;
+        }
+    }
+    ipoke_core_free(&x);
+    return echecs;
+}
+
+int main(void)
+{
+    long i, c, feature, nvals, cas_faits = 0, echecs = 0;
+    double pos = 10., vitesse;
+    char interp, overdub, combine, stage;
+
+    ipoke_fill_select(-1);
+    // inputs well above what the buffer holds, so that every frame written changes in every mode
+    // and the index slow and fast both ways, jumping round the buffer, and stopping
+    for (i = 0; i < TEST_INPUTS; i++)
+    {
+        for (c = 0; c < TEST_NC; c++)
+            valeurs[c][i] = 0.7 + 0.2 * sin(i * (0.05 + 0.01 * c)) + 0.05 * sin(i * 0.71);
+        retours[i] = 0.5 + 0.4 * sin(i * 0.003);
+        vitesse = 2.5 * sin(i * 0.001) + (((i / 700) % 5 == 0) ? 7. : 0.) + ((i % 997 == 0) ? 900. : 0.) - (((i / 1300) % 3 == 1) ? 4. : 0.);
+        pos += vitesse;
+        while (pos >= TEST_FRAMES)
+            pos -= TEST_FRAMES;
+        while (pos < 0.)
+            pos += TEST_FRAMES;
+        indices[i] = (((i / 900) % 7 == 3) || ((i / 64) % 11 == 5 && i % 64 > 40)) ? -1. : pos;
+    }
+
+    for (stage = 0; stage < 2; stage++)
+        for (nvals = 1; nvals <= TEST_NC; nvals++)
+            for (feature = 0; feature < TEST_FEATURES; feature++)
+                for (combine = IPOKE_COMBINE_OVERDUB; combine <= IPOKE_COMBINE_SOFTSAT; combine++)
+                    for (overdub = 0; overdub < 2; overdub++)
+                        for (interp = IPOKE_INTERP_HOLD; interp <= IPOKE_INTERP_SINC; interp++)
+                        {
+                            if (feature == SIGNAL && combine != IPOKE_COMBINE_OVERDUB)
+                                continue;               // the signal ratio is only read when overdubbing
+                            echecs += test_cas(interp, overdub, combine, feature, nvals, stage);
+                            cas_faits++;
+                        }
+
+    printf("%ld cases, %ld failed\n", cas_faits, echecs);
+    return echecs ? 1 : 0;
+}
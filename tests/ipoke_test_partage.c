@@ -0,0 +1,218 @@
+//    ipoke_test_partage - regression test of several ipoke~ writing one buffer from different threads
+//    by Pierre Alexandre Tremblay
+//    four threads add to overlapping parts of one buffer, each holding its stripes around its vectors, and must leave exactly
+//    what the same writers leave one after the other; then every frame one writer changes, in 96 combinations of the modes,
+//    must lie in a stripe it holds. Configure with -DCMAKE_C_FLAGS=-fsanitize=thread to have ThreadSanitizer watch them
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+
+#include "ipoke_partage.h"
+
+#define TEST_FRAMES 20000
+#define TEST_VECTOR 64
+#define TEST_WRITERS 4
+#define TEST_INPUTS (TEST_VECTOR * 4000)
+#define TEST_MODES 96
+#define TEST_INPUTS_MODES (TEST_VECTOR * 500)
+
+static float tab[TEST_FRAMES];
+static float attendu[TEST_FRAMES];
+static float avant[TEST_FRAMES];
+static double valeurs[TEST_INPUTS];
+static double indices[TEST_WRITERS][TEST_INPUTS];
+
+typedef struct _ecrivain
+{
+    long numero;
+    t_ipoke_partage *partage;                           // NULL to write without the stripes
+} t_ecrivain;
+
+//***********************************************************************************************
+// concurrent writers
+
+// adds 1 at each frame its indices go through: the sums are exact in floats, so the order the writers take turns in does not show
+static void *test_ecrivain(void *d)
+{
+    t_ecrivain *e = (t_ecrivain *)d;
+    t_ipoke_core x;
+    t_ipoke_bandes b;
+    long i;
+
+    ipoke_core_init(&x);
+    x.combine = IPOKE_COMBINE_ADD;
+    x.interp = (e->numero & 1) ? IPOKE_INTERP_LINEAR : IPOKE_INTERP_HOLD;
+    b.nb = 0;
+    for (i = 0; i < TEST_INPUTS; i += TEST_VECTOR)
+    {
+        if (e->partage)
+            ipoke_partage_entre(e->partage, &b, &x, TEST_FRAMES, indices[e->numero] + i, TEST_VECTOR);
+        ipoke_core_write(&x, tab, TEST_FRAMES, 1, 0, valeurs + i, indices[e->numero] + i, TEST_VECTOR);
+        if (e->partage)
+            ipoke_partage_sort(e->partage, &b);
+    }
+    ipoke_core_free(&x);
+    return NULL;
+}
+
+static long test_concurrents(void)
+{
+    static const double vitesses[TEST_WRITERS] = { 1., 1., -1., 2. };
+    t_ecrivain e[TEST_WRITERS];
+    pthread_t fils[TEST_WRITERS];
+    double pos;
+    long i, k, ecarts = 0;
+
+    for (i = 0; i < TEST_INPUTS; i++)
+        valeurs[i] = 1.;
+    for (k = 0; k < TEST_WRITERS; k++)                  // starting 777 frames apart, crossing each other
+    {
+        pos = k * 777.;
+        for (i = 0; i < TEST_INPUTS; i++)
+        {
+            indices[k][i] = pos;
+            pos += vitesses[k];
+            if (pos >= TEST_FRAMES)
+                pos -= TEST_FRAMES;
+            if (pos < 0.)
+                pos += TEST_FRAMES;
+        }
+    }
+
+    memset(tab, 0, sizeof(tab));                        // one after the other
+    for (k = 0; k < TEST_WRITERS; k++)
+    {
+        e[k].numero = k;
+        e[k].partage = NULL;
+        test_ecrivain(e + k);
+    }
+    memcpy(attendu, tab, sizeof(tab));
+
+    memset(tab, 0, sizeof(tab));                        // all at once
+    for (k = 0; k < TEST_WRITERS; k++)
+    {
+        e[k].partage = ipoke_partage_prend(tab, TEST_FRAMES);
+        if (!e[k].partage)
+        {
+            fprintf(stderr, "could not allocate the stripes\n");
+            exit(2);
+        }
+    }
+    for (k = 0; k < TEST_WRITERS; k++)
+        if (pthread_create(fils + k, NULL, test_ecrivain, e + k))
+        {
+            fprintf(stderr, "could not start a writer\n");
+            exit(2);
+        }
+    for (k = 0; k < TEST_WRITERS; k++)
+        pthread_join(fils[k], NULL);
+    for (k = 0; k < TEST_WRITERS; k++)
+        ipoke_partage_lache(e[k].partage);
+
+    for (i = 0; i < TEST_FRAMES; i++)
+        if (tab[i] != attendu[i])
+        {
+            if (!ecarts)
+                fprintf(stderr, "concurrent writers: frame %ld is %g instead of %g\n", i, tab[i], attendu[i]);
+            ecarts++;
+        }
+    if (ecarts)
+        fprintf(stderr, "concurrent writers: %ld frames differ from the serial writes\n", ecarts);
+    return ecarts != 0;
+}
+
+//***********************************************************************************************
+// frames written in the stripes held
+
+// mode m: the interp, splatting, jumps, low-pass and loop region, each writer at its own speed, jumping and stopping now and then
+static long test_mode(long m, long k)
+{
+    static const double vitesses[5] = { 1., -1., 2.3, 0.37, -17. };
+    t_ipoke_core x;
+    t_ipoke_partage *p;
+    t_ipoke_bandes b;
+    double pos = k * 777.;
+    long i, j, f, s, tenue;
+
+    for (i = 0; i < TEST_INPUTS_MODES; i++)
+    {
+        if (i % 5000 == 4000 || i % 9000 == 1500)
+            pos += 6000.;
+        if (i % 7000 == 100 || i % 3000 == 2500)
+        {
+            indices[0][i] = -1.;
+            continue;
+        }
+        indices[0][i] = pos;
+        pos += vitesses[k];
+        if (pos >= TEST_FRAMES)
+            pos -= TEST_FRAMES;
+        if (pos < 0.)
+            pos += TEST_FRAMES;
+    }
+
+    ipoke_core_init(&x);
+    x.combine = IPOKE_COMBINE_ADD;
+    x.interp = m % 4;
+    x.splat = (m / 4) % 3;
+    x.saut = ((m / 12) % 2) ? 300 : 0;
+    x.antialias = (m / 24) % 2;
+    if ((m / 48) % 2)
+    {
+        x.boucle_debut = 3000;
+        x.boucle_fin = 15000;
+    }
+    p = ipoke_partage_prend(tab, TEST_FRAMES);
+    if (!p)
+    {
+        fprintf(stderr, "could not allocate the stripes\n");
+        exit(2);
+    }
+    b.nb = 0;
+
+    for (i = 0; i < TEST_INPUTS_MODES; i += TEST_VECTOR)
+    {
+        memcpy(avant, tab, sizeof(tab));
+        ipoke_partage_entre(p, &b, &x, TEST_FRAMES, indices[0] + i, TEST_VECTOR);
+        ipoke_core_write(&x, tab, TEST_FRAMES, 1, 0, valeurs + i, indices[0] + i, TEST_VECTOR);
+        for (f = 0; f < TEST_FRAMES; f++)
+        {
+            if (tab[f] == avant[f])
+                continue;
+            s = f / IPOKE_PARTAGE_BANDE;
+            for (j = 0, tenue = 0; j < b.nb; j++)
+                if (s >= b.debut[j] && s <= b.fin[j])
+                    tenue = 1;
+            if (!tenue)
+            {
+                fprintf(stderr, "mode %ld, writer %ld, vector %ld: frame %ld written out of the stripes held\n", m, k, i / TEST_VECTOR, f);
+                ipoke_partage_sort(p, &b);
+                ipoke_partage_lache(p);
+                ipoke_core_free(&x);
+                return 1;
+            }
+        }
+        ipoke_partage_sort(p, &b);
+    }
+    ipoke_partage_lache(p);
+    ipoke_core_free(&x);
+    return 0;
+}
+
+int main(void)
+{
+    long i, m, k, echecs;
+
+    echecs = test_concurrents();
+    for (i = 0; i < TEST_INPUTS_MODES; i++)
+        valeurs[i] = sin(i * 0.1) + 1.5;
+    for (m = 0; m < TEST_MODES; m++)
+        for (k = 0; k < 5; k++)
+            echecs += test_mode(m, k);
+
+    printf("%ld failed\n", echecs);
+    return echecs ? 1 : 0;
+}
@@ -0,0 +1,140 @@
+//    ipoke_test_undo - regression test of the undo of ipoke~
+//    by Pierre Alexandre Tremblay
+//    writes takes through a pool of a few pages, as ipoke~ does, and checks the whole buffer after each undo and redo against the
+//    copies kept between the takes: undone back to the start and redone to the end, a new take dropping the ones undone, and a take
+//    longer than the pool, which is refused and left as it is until the next take needs its pages
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "ipoke_core.h"
+#include "ipoke_undo.h"
+
+#define TEST_FRAMES 8000                                // not a whole number of pages, so the last one is short
+#define TEST_NC 2
+#define TEST_VECTOR 64
+#define TEST_POOL (6 * IPOKE_UNDO_PAGE)                 // frames of one channel
+#define TEST_ETATS 8
+
+static float tab[TEST_FRAMES * TEST_NC];
+static float etats[TEST_ETATS][TEST_FRAMES * TEST_NC];  // the buffer after each take
+static long cas_faits, echecs;
+
+// a take from debut over longueur frames, at 0.7 frame per input, in nchans channels from chan
+static void test_prise(t_ipoke_undo *u, t_ipoke_core *x, long chan, long nchans, double debut, double longueur, double graine)
+{
+    double indices[TEST_VECTOR], valeurs[TEST_NC][TEST_VECTOR];
+    const double *vals[TEST_NC];
+    long i, j, c, n = (long)(longueur / 0.7);
+
+    for (c = 0; c < TEST_NC; c++)
+        vals[c] = valeurs[c];
+    ipoke_core_reset(x);
+    for (i = 0; i < n; i += TEST_VECTOR)
+    {
+        for (j = 0; j < TEST_VECTOR; j++)
+        {
+            indices[j] = (i + j < n) ? debut + (i + j) * 0.7 : -1.;    // stopped at the end of the last vector
+            for (c = 0; c < TEST_NC; c++)
+                valeurs[c][j] = sin(graine + (i + j) * 0.05 + c);
+        }
+        if (!ipoke_undo_enter(u))
+        {
+            fprintf(stderr, "a vector was refused with no undo going on\n");
+            echecs++;
+            continue;
+        }
+        ipoke_undo_save(u, x, tab, TEST_FRAMES, TEST_NC, chan, nchans, indices, TEST_VECTOR);
+        if (nchans == 1)
+            ipoke_core_write(x, tab, TEST_FRAMES, TEST_NC, chan, valeurs[0], indices, TEST_VECTOR);
+        else
+            ipoke_core_write_multi(x, tab, TEST_FRAMES, TEST_NC, chan, vals, nchans, indices, TEST_VECTOR);
+        ipoke_undo_leave(u);
+    }
+    ipoke_undo_close(u);
+}
+
+// undo or redo, then the result and the buffer
+static void test_annule(t_ipoke_undo *u, long redo, long attendu, long etat)
+{
+    long r, i;
+
+    r = redo ? ipoke_undo_redo(u, tab, TEST_FRAMES, TEST_NC) : ipoke_undo_undo(u, tab, TEST_FRAMES, TEST_NC);
+    cas_faits++;
+    if (r != attendu)
+    {
+        fprintf(stderr, "%s %ld: returned %ld instead of %ld\n", redo ? "redo" : "undo", cas_faits, r, attendu);
+        echecs++;
+        return;
+    }
+    for (i = 0; i < TEST_FRAMES * TEST_NC; i++)
+        if (memcmp(tab + i, etats[etat] + i, sizeof(float)))
+        {
+            fprintf(stderr, "%s %ld: frame %ld, channel %ld is %.9g instead of %.9g\n", redo ? "redo" : "undo", cas_faits, i / TEST_NC, i % TEST_NC,
+                    tab[i], etats[etat][i]);
+            echecs++;
+            return;
+        }
+}
+
+int main(void)
+{
+    t_ipoke_core x;
+    t_ipoke_undo u;
+    long i;
+
+    for (i = 0; i < TEST_FRAMES * TEST_NC; i++)
+        tab[i] = 0.01f * (float)sin(i * 0.37);
+    memcpy(etats[0], tab, sizeof(tab));
+    ipoke_core_init(&x);
+    ipoke_undo_init(&u);
+    if (!ipoke_core_set_nvals(&x, TEST_NC) || !ipoke_undo_set(&u, TEST_POOL))
+    {
+        fprintf(stderr, "could not allocate the undo pool\n");
+        exit(2);
+    }
+    x.overdub = 0.5;                                    // so that what was there shows through
+    ipoke_core_select(&x, TEST_NC);
+
+    test_annule(&u, 0, 0, 0);                           // nothing to undo yet
+    test_prise(&u, &x, 0, 1, 100., 1400., 0.);          // pages 0 and 1 of the first channel
+    memcpy(etats[1], tab, sizeof(tab));
+    test_prise(&u, &x, 1, 1, 3000., 500., 1.);          // page 2 of the second
+    memcpy(etats[2], tab, sizeof(tab));
+
+    test_annule(&u, 0, 1, 1);                           // all the way back, and forth again
+    test_annule(&u, 0, 1, 0);
+    test_annule(&u, 0, 0, 0);
+    test_annule(&u, 1, 1, 1);
+    test_annule(&u, 1, 1, 2);
+    test_annule(&u, 1, 0, 2);
+
+    test_annule(&u, 0, 1, 1);                           // a new take after an undo: the one undone is gone
+    test_prise(&u, &x, 0, 2, 7100., 890., 2.);          // pages 6 and the short 7, in both channels
+    memcpy(etats[3], tab, sizeof(tab));
+    test_annule(&u, 1, 0, 3);
+    test_annule(&u, 0, 1, 1);
+    test_annule(&u, 0, 1, 0);
+    test_annule(&u, 1, 1, 1);
+    test_annule(&u, 1, 1, 3);
+
+    test_prise(&u, &x, 0, 1, 10., 7000., 3.);           // seven pages: longer than the pool, the others dropped to make room
+    memcpy(etats[4], tab, sizeof(tab));
+    test_annule(&u, 0, -1, 4);
+    test_annule(&u, 0, -1, 4);                          // still there, still refused
+    test_annule(&u, 1, 0, 4);
+
+    test_prise(&u, &x, 1, 1, 200., 100., 4.);           // a short one after it takes its pages: it can be undone, and nothing past it
+    memcpy(etats[5], tab, sizeof(tab));
+    test_annule(&u, 0, 1, 4);
+    test_annule(&u, 0, 0, 4);
+    test_annule(&u, 1, 1, 5);
+
+    ipoke_undo_free(&u);
+    ipoke_core_free(&x);
+
+    printf("%ld cases, %ld failed\n", cas_faits, echecs);
+    return echecs ? 1 : 0;
+}
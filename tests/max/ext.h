@@ -0,0 +1,87 @@
+// the parts of the Max API ipoke~ uses, declared for the tests: the runtime they run on is theirs
+
+#ifndef IPOKE_TEST_EXT_H
+#define IPOKE_TEST_EXT_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+typedef long t_atom_long;
+typedef double t_atom_float;
+typedef intptr_t t_int;
+typedef long t_max_err;
+typedef unsigned long long t_uint64;
+typedef long long t_int64;
+typedef void *(*method)(void *, ...);
+
+typedef struct _symbol { char *s_name; void *s_thing; } t_symbol;
+typedef struct _object { void *o_messlist; } t_object;
+typedef struct _class t_class;
+typedef struct _atom { short a_type; union { long w_long; double w_float; t_symbol *w_sym; } a_w; } t_atom;
+typedef void *t_qelem;
+typedef void *t_clock;
+
+enum { A_NOTHING, A_LONG, A_FLOAT, A_SYM, A_OBJ, A_DEFLONG, A_DEFFLOAT, A_DEFSYM, A_GIMME, A_CANT };
+
+#define CLASS_BOX gensym("box")
+#define C74_EXPORT
+#define MAX_ERR_NONE 0
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+#define ASSIST_INLET 1
+#define ASSIST_OUTLET 2
+#define MAX_PATH_CHARS 2048
+#define PATH_STYLE_NATIVE 2
+#define PATH_TYPE_ABSOLUTE 1
+
+t_class *class_new(const char *name, method mnew, method mfree, long size, method mmenu, short type, ...);
+t_max_err class_addmethod(t_class *c, method m, const char *name, ...);
+t_max_err class_register(t_symbol *name_space, t_class *c);
+void *object_alloc(t_class *c);
+void object_free(void *x);
+void *object_method(void *x, t_symbol *s, ...);
+void object_error(t_object *x, const char *s, ...);
+void object_warn(t_object *x, const char *s, ...);
+void object_post(t_object *x, const char *s, ...);
+void post(const char *fmt, ...);
+t_symbol *gensym(const char *s);
+
+void *outlet_new(void *x, const char *s);
+void *outlet_anything(void *o, t_symbol *s, short ac, t_atom *av);
+void *outlet_list(void *o, t_symbol *s, short ac, t_atom *av);
+void *outlet_int(void *o, long n);
+void *outlet_float(void *o, double f);
+void *outlet_bang(void *o);
+void *proxy_new(void *x, long id, long *stuffloc);
+long proxy_getinlet(t_object *master);
+
+void atom_setlong(t_atom *a, t_atom_long b);
+void atom_setfloat(t_atom *a, double b);
+void atom_setsym(t_atom *a, t_symbol *b);
+t_atom_long atom_getlong(const t_atom *a);
+double atom_getfloat(const t_atom *a);
+t_symbol *atom_getsym(const t_atom *a);
+
+void *sysmem_newptr(long size);
+void *sysmem_newptrclear(long size);
+void *sysmem_resizeptr(void *ptr, long newsize);
+void sysmem_freeptr(void *ptr);
+
+void *qelem_new(void *obj, method fn);
+void qelem_set(void *q);
+void qelem_unset(void *q);
+void qelem_free(void *q);
+void *clock_new(void *obj, method fn);
+void clock_delay(void *x, long n);
+void clock_fdelay(void *c, double time);
+void clock_unset(void *x);
+void clock_getftime(double *time);
+void freeobject(t_object *op);
+void defer(void *ob, method fn, t_symbol *sym, short argc, t_atom *argv);
+void defer_low(void *ob, method fn, t_symbol *sym, short argc, t_atom *argv);
+
+short path_nameconform(const char *src, char *dst, long style, long type);
+
+#endif
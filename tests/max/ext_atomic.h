@@ -0,0 +1,12 @@
+#ifndef IPOKE_TEST_EXT_ATOMIC_H
+#define IPOKE_TEST_EXT_ATOMIC_H
+
+typedef volatile long t_int32_atomic;
+
+long ATOMIC_INCREMENT(volatile long *p);
+long ATOMIC_DECREMENT(volatile long *p);
+long ATOMIC_INCREMENT_BARRIER(volatile long *p);
+long ATOMIC_DECREMENT_BARRIER(volatile long *p);
+long ATOMIC_COMPARE_SWAP32(long oldvalue, long newvalue, volatile long *target);
+
+#endif
@@ -0,0 +1,10 @@
+#ifndef IPOKE_TEST_EXT_OBEX_H
+#define IPOKE_TEST_EXT_OBEX_H
+
+#include "ext.h"
+
+long attr_args_offset(short ac, t_atom *av);
+void attr_args_process(void *x, short ac, t_atom *av);
+long atom_gettype(const t_atom *a);
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef IPOKE_TEST_EXT_SYSTIME_H
+#define IPOKE_TEST_EXT_SYSTIME_H
+
+double systimer_gettime(void);
+
+#endif
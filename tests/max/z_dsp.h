@@ -0,0 +1,22 @@
+#ifndef IPOKE_TEST_Z_DSP_H
+#define IPOKE_TEST_Z_DSP_H
+
+#include "ext.h"
+
+typedef struct _pxobject { t_object z_ob; long z_in; void *z_proxy; long z_disabled; short z_count; short z_misc; } t_pxobject;
+typedef struct _signal { long s_n; float *s_vec; double s_sr; long s_nchans; } t_signal;
+typedef t_int *(*t_perfroutine)(t_int *);
+
+#define Z_NO_INPLACE 1
+#define Z_MC_INLETS 2
+
+void class_dspinit(t_class *c);
+void z_dsp_setup(t_pxobject *x, long nsignals);
+void dsp_setup(t_pxobject *x, long nsignals);
+void dsp_free(t_pxobject *x);
+void dsp_add(t_perfroutine f, long n, ...);
+void dsp_addv(t_perfroutine f, long n, void **vector);
+double sys_getsr(void);
+short sys_getdspobjdspstate(t_object *o);
+
+#endif